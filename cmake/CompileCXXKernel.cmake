@@ -0,0 +1,56 @@
+#
+# Copyright (C) 2011 by Justin Holewinski
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+
+# Kernels written in C++ against the __builtin_ptx_* intrinsics share the
+# opt and llc stages with the OpenCL kernels (see CompileOpenCL.cmake); only
+# the front-end invocation differs.  The pointer width must match the host
+# so that kernel parameters line up with CUdeviceptr.
+if(CMAKE_SIZEOF_VOID_P EQUAL 8)
+  set(PTX_KERNEL_TRIPLE nvptx64-unknown-cuda)
+else()
+  set(PTX_KERNEL_TRIPLE nvptx-unknown-cuda)
+endif()
+
+set(CXX_KERNEL_FLAGS -target ${PTX_KERNEL_TRIPLE} -x c++ -S -emit-llvm -O4)
+
+# By default, _llout is assumed to be relative to RESOURCE_OUTPUT_DIR and
+# _srcin is assumed to be relative to CMAKE_CURRENT_SOURCE_DIR
+macro(compile_cxx_to_llvmir _llout _srcin)
+  get_filename_component(_srcin_abs ${_srcin} ABSOLUTE)
+  add_custom_command(OUTPUT ${RESOURCE_OUTPUT_DIR}/${_llout}
+                     DEPENDS ${_srcin_abs}
+                     COMMAND ${CLANG_PROGRAM} ${CXX_KERNEL_FLAGS} ${_srcin_abs} -o ${_llout}
+                     WORKING_DIRECTORY ${RESOURCE_OUTPUT_DIR}
+                     COMMENT "Compiling ${_srcin} -> ${_llout}")
+  add_custom_target(${_llout} DEPENDS ${RESOURCE_OUTPUT_DIR}/${_llout})
+endmacro()
+
+# Builds ${_kernel}.ptx in RESOURCE_OUTPUT_DIR from ${_kernel}.cpp, which is
+# where the CUDA driver samples expect to find it at run time
+macro(create_ptx_targets _targets _kernel)
+  set(${_targets})
+  compile_cxx_to_llvmir(${_kernel}.ll ${_kernel}.cpp)
+  optimize_llvmir(${_kernel}.opt.ll ${_kernel}.ll)
+  codegen_ptx(${_kernel}.ptx ${_kernel}.opt.ll)
+  analyze_ptx(${_kernel}.ptx.stats ${_kernel}.ptx)
+  list(APPEND ${_targets} ${_kernel}.ptx ${_kernel}.ptx.stats)
+endmacro()
@@ -27,15 +27,22 @@ set(CLANG_FLAGS -target nvptx-unknown-nvcl -S -emit-llvm -O4 ${LIBCLC_FLAGS})
 set(OPT_FLAGS -O3 -loop-unroll)
 set(LLC_FLAGS -mcpu=sm_20)
 
+# Build-time PTX analysis
+set(PTX_STATS_SM sm_20 CACHE STRING "SM model for the occupancy estimate of generated PTX")
+set(PTX_STATS_FLAGS "" CACHE STRING "Extra ptx-stats options, e.g. --max-registers 63")
+set(PTX_STATS_ARGS ${PTX_STATS_FLAGS})
+separate_arguments(PTX_STATS_ARGS)
+
 set(RESOURCE_OUTPUT_DIR ${CMAKE_BINARY_DIR}/bin)
 
 # By default, _llout is assumed to be relative to RESOURCE_OUTPUT_DIR and
-# _srcin is assumed to be relative to CMAKE_CURRENT_SOURCE_DIR
+# _srcin is assumed to be relative to CMAKE_CURRENT_SOURCE_DIR.  Any further
+# arguments, such as -D definitions, are passed on to Clang.
 macro(compile_opencl_to_llvmir _llout _srcin)
   get_filename_component(_srcin_abs ${_srcin} ABSOLUTE)
   add_custom_command(OUTPUT ${RESOURCE_OUTPUT_DIR}/${_llout}
                      DEPENDS ${_srcin_abs}
-                     COMMAND ${CLANG_PROGRAM} ${CLANG_FLAGS} ${_srcin_abs} -o ${_llout}
+                     COMMAND ${CLANG_PROGRAM} ${CLANG_FLAGS} ${ARGN} ${_srcin_abs} -o ${_llout}
                      WORKING_DIRECTORY ${RESOURCE_OUTPUT_DIR}
                      COMMENT "Compiling ${_srcin} -> ${_llout}")
   add_custom_target(${_llout} DEPENDS ${RESOURCE_OUTPUT_DIR}/${_llout})
@@ -63,6 +70,20 @@ macro(codegen_ptx _ptxout _llin)
   add_custom_target(${_ptxout} DEPENDS ${_ptxout_abs})
 endmacro()
 
+# Reports register pressure, instruction mix and estimated occupancy of the
+# generated PTX (see tools/ptx-stats) into ${_ptxout}.stats, failing the
+# build if PTX_STATS_FLAGS sets limits that a kernel breaks
+macro(analyze_ptx _statsout _ptxin)
+  set(_statsout_abs ${RESOURCE_OUTPUT_DIR}/${_statsout})
+  set(_ptxin_abs ${RESOURCE_OUTPUT_DIR}/${_ptxin})
+  add_custom_command(OUTPUT ${_statsout_abs}
+                     DEPENDS ${_ptxin_abs} ptx-stats
+                     COMMAND ptx-stats --sm ${PTX_STATS_SM} ${PTX_STATS_ARGS} ${_ptxin_abs} -o ${_statsout_abs}
+                     WORKING_DIRECTORY ${RESOURCE_OUTPUT_DIR}
+                     COMMENT "Analyzing ${_ptxin}")
+  add_custom_target(${_statsout} DEPENDS ${_statsout_abs})
+endmacro()
+
 macro(copy_opencl _clin)
   set(_dest_abs ${RESOURCE_OUTPUT_DIR}/${_clin})
   set(_src_abs ${CMAKE_CURRENT_SOURCE_DIR}/${_clin})
@@ -74,11 +95,14 @@ macro(copy_opencl _clin)
   add_custom_target(${_clin} DEPENDS ${_dest_abs})
 endmacro()
 
+# Any arguments after _kernel are passed on to Clang; see
+# compile_opencl_to_llvmir
 macro(create_opencl_targets _targets _kernel)
   set(${_targets})
-  compile_opencl_to_llvmir(${_kernel}.ll ${_kernel}.cl)
+  compile_opencl_to_llvmir(${_kernel}.ll ${_kernel}.cl ${ARGN})
   optimize_llvmir(${_kernel}.opt.ll ${_kernel}.ll)
   codegen_ptx(${_kernel}.ptx ${_kernel}.opt.ll)
+  analyze_ptx(${_kernel}.ptx.stats ${_kernel}.ptx)
   copy_opencl(${_kernel}.cl)
-  list(APPEND ${_targets} ${_kernel}.ptx ${_kernel}.cl)
+  list(APPEND ${_targets} ${_kernel}.ptx ${_kernel}.ptx.stats ${_kernel}.cl)
 endmacro()
@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cassert>
+#include "common/CUDASample.hpp"
+
+namespace {
+
+/**
+ * Reads an integer of at least minimum from the environment variable name
+ * into count.  Returns false, leaving count alone, if the variable is not
+ * set or is invalid.
+ */
+bool getCountFromEnvironment(const char* name, long minimum,
+                             unsigned& count) {
+  const char* value = getenv(name);
+  if(value == NULL || *value == '\0') {
+    return false;
+  }
+
+  char* end;
+  long parsed = strtol(value, &end, 10);
+  if(*end != '\0' || parsed < minimum) {
+    std::cerr << "Ignoring invalid " << name << "=" << value << "\n";
+    return false;
+  }
+  count = (unsigned)parsed;
+  return true;
+}
+
+}
+
+CUDASample::CUDASample()
+: kernel_(0), numIterations_(4), numWarmupIterations_(1) {
+  // Every timing loop needs at least one time to summarize
+  fixedIterations_ = getCountFromEnvironment("CUDASAMPLE_ITERATIONS", 1,
+                                             numIterations_);
+  fixedWarmupIterations_ = getCountFromEnvironment("CUDASAMPLE_WARMUP", 0,
+                                                   numWarmupIterations_);
+  initCUDA();
+}
+
+CUDASample::~CUDASample() {
+  cuStreamDestroy(stream_);
+  cuCtxDestroy(context_);
+}
+
+void CUDASample::initialize() {
+}
+
+void CUDASample::createMemoryBuffers() {
+}
+
+void CUDASample::setupKernel(CUfunction kernel) {
+}
+
+void CUDASample::finishKernel(CUfunction kernel) {
+}
+
+void CUDASample::runKernel(CUfunction kernel, CUstream stream) {
+}
+
+void CUDASample::reportPerformance(const Timing& timing) {
+}
+
+void CUDASample::run() {
+  Timing timing;
+
+  initialize();
+  assert(kernel_ != 0 && "initialize() must select a kernel");
+  createMemoryBuffers();
+
+  assert(numIterations_ > 0 && "At least one iteration must be timed");
+
+  int numRegisters;
+  cuFuncGetAttribute(&numRegisters, CU_FUNC_ATTRIBUTE_NUM_REGS, kernel_);
+
+  std::cout << "------------------------------\n";
+  std::cout << "* PTX Kernel\n";
+  std::cout << "------------------------------\n";
+  std::cout << "Register Usage:       " << numRegisters << "\n";
+  setupKernel(kernel_);
+  timeKernel(kernel_, timing);
+  finishKernel(kernel_);
+
+  std::cout << "Warm-up Iterations:   " << numWarmupIterations_ << "\n";
+  std::cout << "Number of Iterations: " << timing.iterations << "\n";
+  std::cout << "Total Time:           " << timing.total << " sec\n";
+  std::cout << "Average Time:         " << timing.average << " sec\n";
+  std::cout << "Minimum Time:         " << timing.minimum << " sec\n";
+  std::cout << "Median Time:          " << timing.median << " sec\n";
+  reportPerformance(timing);
+}
+
+void CUDASample::timeKernel(CUfunction kernel, Timing& timing) {
+  std::vector<double> times;
+  EventTimer          timer;
+
+  // Untimed launches to load the module and warm up the caches
+  for(unsigned i = 0; i < numWarmupIterations_; ++i) {
+    runKernel(kernel, stream_);
+  }
+  checkSuccess(cuStreamSynchronize(stream_), "cuStreamSynchronize");
+
+  for(unsigned i = 0; i < numIterations_; ++i) {
+    timer.start(stream_);
+    runKernel(kernel, stream_);
+    times.push_back(timer.stop(stream_));
+  }
+
+  timing = summarize(times);
+}
+
+CUDASample::Timing CUDASample::summarize(std::vector<double>& times) {
+  Timing timing;
+
+  assert(!times.empty() && "No times to summarize");
+
+  timing.iterations = times.size();
+  timing.total      = 0.0;
+  for(unsigned i = 0; i < times.size(); ++i) {
+    timing.total += times[i];
+  }
+  timing.average = timing.total / (double)times.size();
+
+  std::sort(times.begin(), times.end());
+  unsigned middle = times.size() / 2;
+  timing.minimum = times[0];
+  timing.median  = (times.size() % 2 == 1) ? times[middle]
+                   : 0.5 * (times[middle - 1] + times[middle]);
+
+  return timing;
+}
+
+CUmodule CUDASample::loadModule(const std::string& filename) {
+  const unsigned kLogSize = 4096;
+  char errorLog[kLogSize] = "";
+  char infoLog[kLogSize]  = "";
+
+  std::ifstream kernelStream(filename.c_str());
+  if(!kernelStream.is_open()) {
+    std::cerr << "Failed to open " << filename << "\n";
+    exit(1);
+  }
+  std::string source(std::istreambuf_iterator<char>(kernelStream),
+                     (std::istreambuf_iterator<char>()));
+  kernelStream.close();
+
+  CUjit_option options[] = { CU_JIT_ERROR_LOG_BUFFER_SIZE_BYTES,
+                             CU_JIT_ERROR_LOG_BUFFER,
+                             CU_JIT_INFO_LOG_BUFFER_SIZE_BYTES,
+                             CU_JIT_INFO_LOG_BUFFER };
+  void* values[] = { reinterpret_cast<void*>((size_t)kLogSize), errorLog,
+                     reinterpret_cast<void*>((size_t)kLogSize), infoLog };
+
+  CUmodule module;
+  CUresult status = cuModuleLoadDataEx(&module, source.c_str(),
+                                       sizeof(options) / sizeof(options[0]),
+                                       options, values);
+  checkSuccess(status, "cuModuleLoadDataEx", errorLog);
+
+  if(infoLog[0] != '\0') {
+    std::cout << "JIT Log:\n" << infoLog << "\n";
+  }
+
+  return module;
+}
+
+CUfunction CUDASample::getFunction(CUmodule module, const std::string& name) {
+  CUfunction function;
+  checkSuccess(cuModuleGetFunction(&function, module, name.c_str()),
+               "cuModuleGetFunction");
+  return function;
+}
+
+void CUDASample::launchKernel(CUfunction kernel, Dim3 grid, Dim3 block,
+                              unsigned sharedBytes, CUstream stream,
+                              void** params) {
+  CUresult status = cuLaunchKernel(kernel, grid.x, grid.y, grid.z,
+                                   block.x, block.y, block.z, sharedBytes,
+                                   stream, params, NULL);
+  checkSuccess(status, "cuLaunchKernel");
+}
+
+const char* CUDASample::statusToString(CUresult status) {
+  switch(status) {
+  case CUDA_SUCCESS: return "No errors";
+  case CUDA_ERROR_INVALID_VALUE: return "Invalid value";
+  case CUDA_ERROR_OUT_OF_MEMORY: return "Out of memory";
+  case CUDA_ERROR_NOT_INITIALIZED: return "Driver not initialized";
+  case CUDA_ERROR_DEINITIALIZED: return "Driver deinitialized";
+
+  case CUDA_ERROR_NO_DEVICE: return "No CUDA-capable device available";
+  case CUDA_ERROR_INVALID_DEVICE: return "Invalid device";
+
+  case CUDA_ERROR_INVALID_IMAGE: return "Invalid kernel image";
+  case CUDA_ERROR_INVALID_CONTEXT: return "Invalid context";
+  case CUDA_ERROR_CONTEXT_ALREADY_CURRENT: return "Context already current";
+  case CUDA_ERROR_MAP_FAILED: return "Map failed";
+  case CUDA_ERROR_UNMAP_FAILED: return "Unmap failed";
+  case CUDA_ERROR_ARRAY_IS_MAPPED: return "Array is mapped";
+  case CUDA_ERROR_ALREADY_MAPPED: return "Already mapped";
+  case CUDA_ERROR_NO_BINARY_FOR_GPU: return "No binary for GPU";
+  case CUDA_ERROR_ALREADY_ACQUIRED: return "Already acquired";
+  case CUDA_ERROR_NOT_MAPPED: return "Not mapped";
+
+  case CUDA_ERROR_INVALID_SOURCE: return "Invalid source";
+  case CUDA_ERROR_FILE_NOT_FOUND: return "File not found";
+
+  case CUDA_ERROR_INVALID_HANDLE: return "Invalid handle";
+
+  case CUDA_ERROR_NOT_FOUND: return "Not found";
+
+  case CUDA_ERROR_NOT_READY: return "CUDA not ready";
+
+  case CUDA_ERROR_LAUNCH_FAILED: return "Launch failed";
+  case CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES: return "Launch exceeded resources";
+  case CUDA_ERROR_LAUNCH_TIMEOUT: return "Launch exceeded timeout";
+  case CUDA_ERROR_LAUNCH_INCOMPATIBLE_TEXTURING:
+    return "Launch with incompatible texturing";
+
+  case CUDA_ERROR_UNKNOWN: return "Unknown error";
+  default: return "Unknown error ID";
+  }
+}
+
+void CUDASample::checkSuccess(CUresult status, const char* func,
+                              const char* log) {
+  if(status != CUDA_SUCCESS) {
+    if(log != 0 && log[0] != '\0') {
+      std::cerr << "ERROR LOG:\n" << log << "\n";
+    }
+
+    std::cerr << "ERROR: Could not execute '" << func << "', error ("
+              << status << ") " << statusToString(status) << "\n";
+    exit(1);
+  }
+}
+
+CUDASample::EventTimer::EventTimer() {
+  checkSuccess(cuEventCreate(&start_, CU_EVENT_DEFAULT), "cuEventCreate");
+  checkSuccess(cuEventCreate(&end_, CU_EVENT_DEFAULT), "cuEventCreate");
+}
+
+CUDASample::EventTimer::~EventTimer() {
+  cuEventDestroy(start_);
+  cuEventDestroy(end_);
+}
+
+void CUDASample::EventTimer::start(CUstream stream) {
+  checkSuccess(cuEventRecord(start_, stream), "cuEventRecord");
+}
+
+double CUDASample::EventTimer::stop(CUstream stream) {
+  float milliseconds;
+
+  checkSuccess(cuEventRecord(end_, stream), "cuEventRecord");
+  checkSuccess(cuEventSynchronize(end_), "cuEventSynchronize");
+  checkSuccess(cuEventElapsedTime(&milliseconds, start_, end_),
+               "cuEventElapsedTime");
+
+  return (double)1e-3 * milliseconds;
+}
+
+void CUDASample::initCUDA() {
+  char name[256];
+
+  checkSuccess(cuInit(0), "cuInit");
+
+  // For now, just blindly select the first device.
+  checkSuccess(cuDeviceGet(&device_, 0), "cuDeviceGet");
+  checkSuccess(cuDeviceGetName(name, sizeof(name), device_),
+               "cuDeviceGetName");
+  std::cout << "Device:               " << name << "\n";
+
+  checkSuccess(cuCtxCreate(&context_, 0, device_), "cuCtxCreate");
+  checkSuccess(cuStreamCreate(&stream_, 0), "cuStreamCreate");
+}
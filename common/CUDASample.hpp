@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#if !defined(CUDA_SAMPLE_HPP_INC)
+#define CUDA_SAMPLE_HPP_INC 1
+
+#include <string>
+#include <vector>
+#include "cuda.h"
+#include "common/Sample.hpp"
+
+/**
+ * Base class for CUDA driver API samples.  This mirrors OCLSample: the
+ * constructor creates a context on the first device, and run() calls the
+ * hooks below, timing each launch of runKernel() with events after a number
+ * of warm-up launches.  The CUDASAMPLE_ITERATIONS and CUDASAMPLE_WARMUP
+ * environment variables override the counts a sample sets.
+ */
+class CUDASample : public Sample {
+public:
+
+  /**
+   * Grid or block dimensions of a launch.
+   */
+  struct Dim3 {
+
+    Dim3(unsigned x_ = 1, unsigned y_ = 1, unsigned z_ = 1)
+    : x(x_), y(y_), z(z_) {
+    }
+
+    unsigned x;
+    unsigned y;
+    unsigned z;
+  };
+
+  /**
+   * Event times of the measured launches, in seconds.
+   */
+  struct Timing {
+    unsigned iterations;
+    double   total;
+    double   average;
+    double   minimum;
+    double   median;
+  };
+
+  /**
+   * Measures the device time between start() and stop() with a pair of
+   * events recorded on a stream.  Events on the default stream also wait for
+   * the work of every other stream.
+   */
+  class EventTimer {
+  public:
+
+    EventTimer();
+
+    ~EventTimer();
+
+    void start(CUstream stream = 0);
+
+    /**
+     * Waits for the work issued since start() and returns its duration in
+     * seconds.
+     */
+    double stop(CUstream stream = 0);
+
+  private:
+
+    EventTimer(const EventTimer&);
+
+    EventTimer& operator=(const EventTimer&);
+
+    CUevent start_;
+    CUevent end_;
+  };
+
+  CUDASample();
+
+  virtual ~CUDASample();
+
+  virtual void run();
+
+  /**
+   * Returns a description of a driver API status code.
+   */
+  static const char* statusToString(CUresult status);
+
+  /**
+   * Reports a failed driver call, with the JIT log if there is one, and
+   * exits.
+   */
+  static void checkSuccess(CUresult status, const char* func,
+                           const char* log = 0);
+
+  /**
+   * Summarizes the times of a number of measured runs, in seconds.  times is
+   * sorted in the process.
+   */
+  static Timing summarize(std::vector<double>& times);
+
+protected:
+
+  /**
+   * Hook for samples to perform any initialization, such as loading their
+   * module.
+   */
+  virtual void initialize();
+
+  /**
+   * Hook for samples to allocate any needed memory buffers.
+   */
+  virtual void createMemoryBuffers();
+
+  /**
+   * Hook for samples to perform any kernel setup, such as copying data from
+   * the host to the device.
+   */
+  virtual void setupKernel(CUfunction kernel);
+
+  /**
+   * Hook for samples to perform any kernel finalization, such as copying data
+   * from the device to the host and checking it.
+   */
+  virtual void finishKernel(CUfunction kernel);
+
+  /**
+   * Hook for samples to launch the kernel once on the given stream.
+   */
+  virtual void runKernel(CUfunction kernel, CUstream stream);
+
+  /**
+   * Hook for samples to report derived performance figures, such as
+   * throughput or bandwidth.  Figures derived from the median are the least
+   * sensitive to outliers; those from the minimum show the best case.
+   */
+  virtual void reportPerformance(const Timing& timing);
+
+  /**
+   * Loads a PTX module from disk, JIT-compiling it for the device.  Compile
+   * errors are reported with the JIT log.
+   */
+  CUmodule loadModule(const std::string& filename);
+
+  CUfunction getFunction(CUmodule module, const std::string& name);
+
+  /**
+   * Launches kernel with the given parameters, which must match the types of
+   * the kernel's parameters (CUdeviceptr for pointers).
+   */
+  template <typename A0>
+  void launch(CUfunction kernel, Dim3 grid, Dim3 block, A0 a0) {
+    void* params[] = { &a0 };
+    launchKernel(kernel, grid, block, 0, stream_, params);
+  }
+
+  template <typename A0, typename A1>
+  void launch(CUfunction kernel, Dim3 grid, Dim3 block, A0 a0, A1 a1) {
+    void* params[] = { &a0, &a1 };
+    launchKernel(kernel, grid, block, 0, stream_, params);
+  }
+
+  template <typename A0, typename A1, typename A2>
+  void launch(CUfunction kernel, Dim3 grid, Dim3 block, A0 a0, A1 a1,
+              A2 a2) {
+    void* params[] = { &a0, &a1, &a2 };
+    launchKernel(kernel, grid, block, 0, stream_, params);
+  }
+
+  template <typename A0, typename A1, typename A2, typename A3>
+  void launch(CUfunction kernel, Dim3 grid, Dim3 block, A0 a0, A1 a1,
+              A2 a2, A3 a3) {
+    void* params[] = { &a0, &a1, &a2, &a3 };
+    launchKernel(kernel, grid, block, 0, stream_, params);
+  }
+
+  template <typename A0, typename A1, typename A2, typename A3, typename A4>
+  void launch(CUfunction kernel, Dim3 grid, Dim3 block, A0 a0, A1 a1,
+              A2 a2, A3 a3, A4 a4) {
+    void* params[] = { &a0, &a1, &a2, &a3, &a4 };
+    launchKernel(kernel, grid, block, 0, stream_, params);
+  }
+
+  template <typename A0, typename A1, typename A2, typename A3, typename A4,
+            typename A5>
+  void launch(CUfunction kernel, Dim3 grid, Dim3 block, A0 a0, A1 a1,
+              A2 a2, A3 a3, A4 a4, A5 a5) {
+    void* params[] = { &a0, &a1, &a2, &a3, &a4, &a5 };
+    launchKernel(kernel, grid, block, 0, stream_, params);
+  }
+
+  /**
+   * Launches kernel on stream with a parameter array as cuLaunchKernel takes
+   * it.
+   */
+  void launchKernel(CUfunction kernel, Dim3 grid, Dim3 block,
+                    unsigned sharedBytes, CUstream stream, void** params);
+
+  void setKernel(CUfunction kernel) {
+    kernel_ = kernel;
+  }
+
+  CUfunction getKernel() {
+    return kernel_;
+  }
+
+  CUdevice getDevice() {
+    return device_;
+  }
+
+  CUcontext getContext() {
+    return context_;
+  }
+
+  /**
+   * Returns the stream that runKernel() is called with; launch() uses it.
+   */
+  CUstream getStream() {
+    return stream_;
+  }
+
+  unsigned getNumberOfIterations() const {
+    return numIterations_;
+  }
+
+  /**
+   * Sets the number of timed launches, unless CUDASAMPLE_ITERATIONS does.
+   */
+  void setNumberOfIterations(unsigned iters) {
+    if(!fixedIterations_) {
+      numIterations_ = iters;
+    }
+  }
+
+  unsigned getNumberOfWarmupIterations() const {
+    return numWarmupIterations_;
+  }
+
+  /**
+   * Sets the number of untimed launches, unless CUDASAMPLE_WARMUP does.
+   */
+  void setNumberOfWarmupIterations(unsigned iters) {
+    if(!fixedWarmupIterations_) {
+      numWarmupIterations_ = iters;
+    }
+  }
+
+private:
+
+  void initCUDA();
+  void timeKernel(CUfunction kernel, Timing& timing);
+
+  CUdevice   device_;
+  CUcontext  context_;
+  CUstream   stream_;
+  CUfunction kernel_;
+  unsigned   numIterations_;
+  unsigned   numWarmupIterations_;
+  bool       fixedIterations_;
+  bool       fixedWarmupIterations_;
+
+};
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "common/MappedFile.hpp"
+
+MappedFile::MappedFile()
+: fd_(-1), data_(NULL), size_(0) {
+}
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+bool MappedFile::open(const std::string& filename) {
+  struct stat info;
+
+  close();
+
+  fd_ = ::open(filename.c_str(), O_RDONLY);
+  if(fd_ < 0) {
+    return false;
+  }
+
+  if(fstat(fd_, &info) != 0 || info.st_size == 0) {
+    close();
+    return false;
+  }
+
+  void* data = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd_, 0);
+  if(data == MAP_FAILED) {
+    close();
+    return false;
+  }
+
+  // Inputs are consumed front-to-back, so let the kernel read ahead
+  madvise(data, info.st_size, MADV_SEQUENTIAL);
+
+  data_ = data;
+  size_ = info.st_size;
+  return true;
+}
+
+bool MappedFile::create(const std::string& filename, size_t size) {
+  close();
+
+  fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(fd_ < 0) {
+    return false;
+  }
+
+  if(size == 0 || ftruncate(fd_, size) != 0) {
+    close();
+    return false;
+  }
+
+  void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if(data == MAP_FAILED) {
+    close();
+    return false;
+  }
+
+  data_ = data;
+  size_ = size;
+  return true;
+}
+
+void MappedFile::close() {
+  if(data_ != NULL) {
+    munmap(data_, size_);
+    data_ = NULL;
+    size_ = 0;
+  }
+  if(fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
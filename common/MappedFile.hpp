@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#if !defined(MAPPED_FILE_HPP_INC)
+#define MAPPED_FILE_HPP_INC 1
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Memory mapping of a file on disk.  Samples use this to stream large inputs
+ * and outputs to and from the device without staging them in host memory.
+ */
+class MappedFile {
+public:
+
+  MappedFile();
+
+  ~MappedFile();
+
+  /**
+   * Maps the given file into memory.  Returns false if the file cannot be
+   * opened or mapped.
+   */
+  bool open(const std::string& filename);
+
+  /**
+   * Creates (or truncates) the given file with the given size and maps it
+   * for writing.  Returns false if the file cannot be created or mapped.
+   */
+  bool create(const std::string& filename, size_t size);
+
+  /**
+   * Unmaps the file, if one is mapped.
+   */
+  void close();
+
+  bool isOpen() const {
+    return data_ != NULL;
+  }
+
+  const void* getData() const {
+    return data_;
+  }
+
+  /**
+   * Returns the mapped data for writing.  Only valid for files mapped with
+   * create().
+   */
+  void* getData() {
+    return data_;
+  }
+
+  size_t getSize() const {
+    return size_;
+  }
+
+private:
+
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+
+  int    fd_;
+  void*  data_;
+  size_t size_;
+
+};
+
+#endif
@@ -0,0 +1,442 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <pthread.h>
+#include "common/MappedFile.hpp"
+#include "common/MatrixMarket.hpp"
+
+namespace {
+
+enum Field {
+  FIELD_REAL,
+  FIELD_PATTERN
+};
+
+enum Symmetry {
+  SYMMETRY_GENERAL,
+  SYMMETRY_SYMMETRIC,
+  SYMMETRY_SKEW
+};
+
+/**
+ * A stored entry, with zero-based indices.
+ */
+struct Entry {
+  unsigned row;
+  int      column;
+  float    value;
+};
+
+bool compareColumns(const std::pair<int, float>& a,
+                    const std::pair<int, float>& b) {
+  return a.first < b.first;
+}
+
+/**
+ * Cursor over the mapped text.  Unlike the C library parsers, it never reads
+ * past the end of the mapping, which need not be NUL-terminated.
+ */
+class TextReader {
+public:
+
+  TextReader(const char* begin, const char* end)
+  : pos_(begin), end_(end) {
+  }
+
+  const char* getPosition() const {
+    return pos_;
+  }
+
+  bool atEnd() const {
+    return pos_ >= end_;
+  }
+
+  /**
+   * Skips spaces and tabs, but not line breaks.
+   */
+  void skipBlanks() {
+    while(pos_ < end_ && (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\r')) {
+      ++pos_;
+    }
+  }
+
+  bool atEndOfLine() {
+    skipBlanks();
+    return pos_ >= end_ || *pos_ == '\n';
+  }
+
+  /**
+   * Moves to the start of the next line.
+   */
+  void skipLine() {
+    while(pos_ < end_ && *pos_++ != '\n') {
+    }
+  }
+
+  bool readWord(std::string& word) {
+    word.clear();
+    skipBlanks();
+    while(pos_ < end_ && !std::isspace((unsigned char)*pos_)) {
+      word += (char)std::tolower((unsigned char)*pos_++);
+    }
+    return !word.empty();
+  }
+
+  bool readUnsigned(unsigned long& value) {
+    skipBlanks();
+    if(pos_ >= end_ || !std::isdigit((unsigned char)*pos_)) {
+      return false;
+    }
+    value = 0;
+    while(pos_ < end_ && std::isdigit((unsigned char)*pos_)) {
+      value = value * 10 + (*pos_++ - '0');
+    }
+    return true;
+  }
+
+  bool readReal(double& value) {
+    char   token[64];
+    size_t length = 0;
+    char*  tokenEnd;
+
+    skipBlanks();
+    while(pos_ < end_ && !std::isspace((unsigned char)*pos_)) {
+      if(length + 1 == sizeof(token)) {
+        return false;
+      }
+      token[length++] = *pos_++;
+    }
+    token[length] = '\0';
+    value = std::strtod(token, &tokenEnd);
+    return length > 0 && *tokenEnd == '\0';
+  }
+
+private:
+
+  const char* pos_;
+  const char* end_;
+};
+
+/**
+ * Builds a CSR matrix from the entries of a mapped file in three threaded
+ * phases: each thread parses a slice of the lines and counts its entries
+ * per row, each thread then scatters its entries into the rows, and finally
+ * each thread sorts a slice of the rows by column.
+ */
+class MatrixMarketLoader {
+public:
+
+  MatrixMarketLoader(const char* begin, const char* end, unsigned numThreads,
+                     Field field, Symmetry symmetry, unsigned long numEntries,
+                     CSRMatrix& matrix)
+  : begin_(begin), end_(end), numThreads_(numThreads), field_(field),
+    symmetry_(symmetry), numEntries_(numEntries), matrix_(matrix),
+    entries_(numThreads), counts_(numThreads), parsed_(numThreads),
+    valid_(numThreads) {
+  }
+
+  bool load() {
+    runThreads(parseThread);
+
+    unsigned long parsed = 0;
+    for(unsigned t = 0; t < numThreads_; ++t) {
+      if(!valid_[t]) {
+        return false;
+      }
+      parsed += parsed_[t];
+    }
+    if(parsed != numEntries_) {
+      return false;
+    }
+
+    // Row offsets, and where each thread's entries of each row start
+    size_t offset = 0;
+    matrix_.rowOffsets.resize(matrix_.numRows + 1);
+    for(unsigned r = 0; r < matrix_.numRows; ++r) {
+      matrix_.rowOffsets[r] = offset;
+      for(unsigned t = 0; t < numThreads_; ++t) {
+        unsigned count = counts_[t][r];
+        counts_[t][r] = offset;
+        offset += count;
+      }
+    }
+    if(offset > 0xffffffffUL) {
+      return false;
+    }
+    matrix_.rowOffsets[matrix_.numRows] = offset;
+
+    matrix_.columns.resize(offset);
+    matrix_.values.resize(offset);
+    runThreads(scatterThread);
+    runThreads(sortThread);
+    return true;
+  }
+
+private:
+
+  struct ThreadArgs {
+    MatrixMarketLoader* loader;
+    unsigned            thread;
+  };
+
+  /**
+   * Runs body once per slice in parallel.  Slices that no thread could be
+   * created for run on the calling thread.
+   */
+  void runThreads(void* (*body)(void*)) {
+    std::vector<pthread_t>  threads(numThreads_);
+    std::vector<ThreadArgs> args(numThreads_);
+    unsigned                numStarted = 0;
+
+    for(unsigned t = 0; t < numThreads_; ++t) {
+      args[t].loader = this;
+      args[t].thread = t;
+      if(numStarted == t &&
+         pthread_create(&threads[t], NULL, body, &args[t]) == 0) {
+        ++numStarted;
+      }
+    }
+    for(unsigned t = numStarted; t < numThreads_; ++t) {
+      body(&args[t]);
+    }
+    for(unsigned t = 0; t < numStarted; ++t) {
+      pthread_join(threads[t], NULL);
+    }
+  }
+
+  /**
+   * Start of the first line that begins in the given slice of the text.
+   */
+  const char* getLineStart(unsigned slice) const {
+    if(slice == 0) {
+      return begin_;
+    }
+    if(slice == numThreads_) {
+      return end_;
+    }
+
+    const char* pos = begin_ + (end_ - begin_) * (size_t)slice / numThreads_;
+    while(pos < end_ && pos[-1] != '\n') {
+      ++pos;
+    }
+    return pos;
+  }
+
+  static void* parseThread(void* data) {
+    ThreadArgs*         args   = static_cast<ThreadArgs*>(data);
+    MatrixMarketLoader* self   = args->loader;
+    unsigned            thread = args->thread;
+    CSRMatrix&          matrix = self->matrix_;
+    std::vector<Entry>& out    = self->entries_[thread];
+    unsigned long       parsed = 0;
+    TextReader          reader(self->getLineStart(thread),
+                               self->getLineStart(thread + 1));
+
+    self->counts_[thread].assign(matrix.numRows, 0);
+    self->valid_[thread] = false;
+
+    while(!reader.atEnd()) {
+      unsigned long row, column;
+      double        value = 1.0;
+
+      // Blank lines may appear anywhere, comments only in the header
+      if(reader.atEndOfLine()) {
+        reader.skipLine();
+        continue;
+      }
+      if(!reader.readUnsigned(row) || !reader.readUnsigned(column)
+         || (self->field_ == FIELD_REAL && !reader.readReal(value))
+         || !reader.atEndOfLine()) {
+        return NULL;
+      }
+      reader.skipLine();
+
+      if(row < 1 || row > matrix.numRows || column < 1
+         || column > matrix.numCols) {
+        return NULL;
+      }
+
+      Entry entry;
+      entry.row    = row - 1;
+      entry.column = column - 1;
+      entry.value  = (float)value;
+      out.push_back(entry);
+      ++self->counts_[thread][entry.row];
+
+      // Only one triangle of a symmetric matrix is stored
+      if(self->symmetry_ != SYMMETRY_GENERAL && row != column) {
+        Entry mirror;
+        mirror.row    = column - 1;
+        mirror.column = row - 1;
+        mirror.value  = (self->symmetry_ == SYMMETRY_SKEW) ? -entry.value
+                                                           : entry.value;
+        out.push_back(mirror);
+        ++self->counts_[thread][mirror.row];
+      }
+      ++parsed;
+    }
+
+    self->parsed_[thread] = parsed;
+    self->valid_[thread]  = true;
+    return NULL;
+  }
+
+  static void* scatterThread(void* data) {
+    ThreadArgs*            args    = static_cast<ThreadArgs*>(data);
+    MatrixMarketLoader*    self    = args->loader;
+    std::vector<Entry>&    entries = self->entries_[args->thread];
+    std::vector<unsigned>& starts  = self->counts_[args->thread];
+
+    for(size_t i = 0; i < entries.size(); ++i) {
+      unsigned position = starts[entries[i].row]++;
+      self->matrix_.columns[position] = entries[i].column;
+      self->matrix_.values[position]  = entries[i].value;
+    }
+
+    // The entries are no longer needed
+    std::vector<Entry>().swap(entries);
+    return NULL;
+  }
+
+  static void* sortThread(void* data) {
+    ThreadArgs*         args   = static_cast<ThreadArgs*>(data);
+    MatrixMarketLoader* self   = args->loader;
+    CSRMatrix&          matrix = self->matrix_;
+    unsigned            begin  = (size_t)matrix.numRows * args->thread
+                                 / self->numThreads_;
+    unsigned            end    = (size_t)matrix.numRows * (args->thread + 1)
+                                 / self->numThreads_;
+    std::vector<std::pair<int, float> > row;
+
+    for(unsigned r = begin; r < end; ++r) {
+      unsigned first = matrix.rowOffsets[r];
+      unsigned last  = matrix.rowOffsets[r + 1];
+
+      row.clear();
+      for(unsigned j = first; j < last; ++j) {
+        row.push_back(std::make_pair(matrix.columns[j], matrix.values[j]));
+      }
+      std::stable_sort(row.begin(), row.end(), compareColumns);
+      for(unsigned j = first; j < last; ++j) {
+        matrix.columns[j] = row[j - first].first;
+        matrix.values[j]  = row[j - first].second;
+      }
+    }
+    return NULL;
+  }
+
+  const char*    begin_;
+  const char*    end_;
+  unsigned       numThreads_;
+  Field          field_;
+  Symmetry       symmetry_;
+  unsigned long  numEntries_;
+  CSRMatrix&     matrix_;
+
+  std::vector<std::vector<Entry> >    entries_;
+  std::vector<std::vector<unsigned> > counts_;
+  std::vector<unsigned long>          parsed_;
+  std::vector<char>                   valid_;
+};
+
+}
+
+
+bool loadMatrixMarket(const std::string& filename, unsigned numThreads,
+                      CSRMatrix& matrix) {
+  MappedFile  file;
+  std::string word;
+  Field       field;
+  Symmetry    symmetry;
+
+  if(!file.open(filename)) {
+    return false;
+  }
+
+  const char* data = static_cast<const char*>(file.getData());
+  TextReader  reader(data, data + file.getSize());
+
+  // Banner: %%MatrixMarket matrix coordinate <field> <symmetry>
+  if(!reader.readWord(word) || word != "%%matrixmarket"
+     || !reader.readWord(word) || word != "matrix"
+     || !reader.readWord(word) || word != "coordinate"
+     || !reader.readWord(word)) {
+    return false;
+  }
+  if(word == "real" || word == "integer") {
+    field = FIELD_REAL;
+  } else if(word == "pattern") {
+    field = FIELD_PATTERN;
+  } else {
+    return false;
+  }
+  if(!reader.readWord(word)) {
+    return false;
+  }
+  if(word == "general") {
+    symmetry = SYMMETRY_GENERAL;
+  } else if(word == "symmetric") {
+    symmetry = SYMMETRY_SYMMETRIC;
+  } else if(word == "skew-symmetric") {
+    symmetry = SYMMETRY_SKEW;
+  } else {
+    return false;
+  }
+  reader.skipLine();
+
+  // Comments and blank lines, then the size line
+  while(!reader.atEnd()) {
+    reader.skipBlanks();
+    if(!reader.atEndOfLine() && *reader.getPosition() != '%') {
+      break;
+    }
+    reader.skipLine();
+  }
+
+  unsigned long numRows, numCols, numEntries;
+  if(!reader.readUnsigned(numRows) || !reader.readUnsigned(numCols)
+     || !reader.readUnsigned(numEntries) || !reader.atEndOfLine()
+     || numRows == 0 || numCols == 0 || numRows > 0x7fffffffUL
+     || numCols > 0x7fffffffUL) {
+    return false;
+  }
+  reader.skipLine();
+
+  if(symmetry != SYMMETRY_GENERAL && numRows != numCols) {
+    return false;
+  }
+
+  matrix = CSRMatrix();
+  matrix.numRows = numRows;
+  matrix.numCols = numCols;
+
+  MatrixMarketLoader loader(reader.getPosition(), data + file.getSize(),
+                            std::max(numThreads, 1u), field, symmetry,
+                            numEntries, matrix);
+  return loader.load();
+}
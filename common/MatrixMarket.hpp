@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#if !defined(MATRIX_MARKET_HPP_INC)
+#define MATRIX_MARKET_HPP_INC 1
+
+#include <string>
+#include <vector>
+
+/**
+ * Sparse matrix in compressed sparse row (CSR) form.  The entries of row i
+ * are at [rowOffsets[i], rowOffsets[i+1]) of columns and values, in
+ * increasing column order.
+ */
+struct CSRMatrix {
+
+  CSRMatrix()
+  : numRows(0), numCols(0) {
+  }
+
+  unsigned              numRows;
+  unsigned              numCols;
+  std::vector<unsigned> rowOffsets;
+  std::vector<int>      columns;
+  std::vector<float>    values;
+
+  size_t getNumNonZeros() const {
+    return values.size();
+  }
+
+  unsigned getRowLength(unsigned row) const {
+    return rowOffsets[row + 1] - rowOffsets[row];
+  }
+};
+
+/**
+ * Reads a Matrix Market coordinate file (real, integer or pattern; general,
+ * symmetric or skew-symmetric) into CSR form.  The file is mapped rather
+ * than read, and its entries are parsed and sorted into rows by numThreads
+ * threads.  Returns false if the file cannot be mapped or is not a
+ * supported Matrix Market file.
+ */
+bool loadMatrixMarket(const std::string& filename, unsigned numThreads,
+                      CSRMatrix& matrix);
+
+#endif
@@ -20,6 +20,7 @@
  * THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <vector>
 #include <iostream>
 #include <fstream>
@@ -49,8 +50,17 @@ void OCLSample::finishKernel(cl::Kernel kernel) {
 void OCLSample::runKernel(cl::Kernel kernel, cl::Event* evt) {
 }
 
+void OCLSample::runPasses(cl::Kernel kernel, cl::Event* first,
+                          cl::Event* last) {
+  runKernel(kernel, first);
+  *last = *first;
+}
+
+void OCLSample::reportPerformance(double average) {
+}
+
 void OCLSample::run() {
-  double elapsed, average;
+  std::vector<double> times;
 
   initialize();
   createMemoryBuffers();
@@ -59,54 +69,99 @@ void OCLSample::run() {
   std::cout << "* Source Kernel\n";
   std::cout << "------------------------------\n";
   setupKernel(sourceKernel_);
-  timeKernel(sourceKernel_, elapsed, average);
+  times = timeKernel(sourceKernel_);
   finishKernel(sourceKernel_);
-
-  std::cout << "Number of Iterations: " << numIterations_ << "\n";
-  std::cout << "Total Time:           " << elapsed << " sec\n";
-  std::cout << "Average Time:         " << average << " sec\n";
+  reportTimes(times);
 
   std::cout << "------------------------------\n";
   std::cout << "* Binary Kernel\n";
   std::cout << "------------------------------\n";
   setupKernel(binaryKernel_);
-  timeKernel(binaryKernel_, elapsed, average);
+  times = timeKernel(binaryKernel_);
   finishKernel(binaryKernel_);
+  reportTimes(times);
+}
+
+void OCLSample::reportTimes(const std::vector<double>& times) {
+  double elapsed = 0.0;
+
+  for(unsigned i = 0; i < times.size(); ++i) {
+    elapsed += times[i];
+  }
+
+  double average = elapsed / (double)times.size();
 
-  std::cout << "Number of Iterations: " << numIterations_ << "\n";
+  std::cout << "Number of Iterations: " << times.size() << "\n";
   std::cout << "Total Time:           " << elapsed << " sec\n";
   std::cout << "Average Time:         " << average << " sec\n";
+  reportPerformance(average);
 }
 
-void OCLSample::timeKernel(cl::Kernel kernel, double& elapsed,
-                           double& average) {
-  cl::Event* events = new cl::Event[numIterations_];
-  cl_int result;
-
-  elapsed = 0.0;
+std::vector<double> OCLSample::timeKernel(cl::Kernel kernel) {
+  std::vector<double> times;
 
   for(unsigned i = 0; i < numIterations_; ++i) {
-    cl_ulong start, end;
-    runKernel(kernel, &events[i]);
-
-    queue_.flush();
-    events[i].wait();
-
-    result = events[i].getProfilingInfo<cl_ulong>(CL_PROFILING_COMMAND_START,
-                                                  &start);
-    assert(result == CL_SUCCESS && "Unable to get profiling information");
-    result = events[i].getProfilingInfo<cl_ulong>(CL_PROFILING_COMMAND_END,
-                                                  &end);
-    assert(result == CL_SUCCESS && "Unable to get profiling information");
-    elapsed += (double)1e-9 * (end - start);
+    cl::Event first, last;
+    runPasses(kernel, &first, &last);
+    times.push_back(getElapsed(first, last));
   }
 
-  average = elapsed / (double)numIterations_;
+  return times;
+}
+
+double OCLSample::getElapsed(cl::Event& first, cl::Event& last) {
+  cl_int   result;
+  cl_ulong start, end;
+
+  queue_.flush();
+  last.wait();
+
+  result = first.getProfilingInfo<cl_ulong>(CL_PROFILING_COMMAND_START,
+                                            &start);
+  assert(result == CL_SUCCESS && "Unable to get profiling information");
+  result = last.getProfilingInfo<cl_ulong>(CL_PROFILING_COMMAND_END, &end);
+  assert(result == CL_SUCCESS && "Unable to get profiling information");
+  return (double)1e-9 * (end - start);
+}
+
+double OCLSample::median(std::vector<double> times) {
+  assert(!times.empty() && "No times to summarize");
+
+  std::sort(times.begin(), times.end());
+  unsigned middle = times.size() / 2;
+  return (times.size() % 2 == 1) ? times[middle]
+         : 0.5 * (times[middle - 1] + times[middle]);
+}
+
+double OCLSample::measureCopyBandwidth(size_t bytes) {
+  cl_int              result;
+  std::vector<double> times;
+  cl::Buffer          source(context_, CL_MEM_READ_WRITE, bytes, NULL,
+                             &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  cl::Buffer          target(context_, CL_MEM_READ_WRITE, bytes, NULL,
+                             &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+
+  for(unsigned i = 0; i <= numIterations_; ++i) {
+    cl::Event event;
+
+    result = queue_.enqueueCopyBuffer(source, target, 0, 0, bytes, NULL,
+                                      &event);
+    assert(result == CL_SUCCESS && "Failed to queue buffer copy");
+    double time = getElapsed(event, event);
+
+    // The first copy is a warm-up
+    if(i > 0) {
+      times.push_back(time);
+    }
+  }
 
-  delete [] events;
+  return 2.0 * bytes / median(times) / 1e9;
 }
 
-cl::Program OCLSample::compileSource(const std::string& filename) {
+cl::Program OCLSample::compileSource(const std::string& filename,
+                                     const std::string& options) {
   cl_int result;
 
   std::ifstream kernelStream(filename.c_str());
@@ -120,7 +175,7 @@ cl::Program OCLSample::compileSource(const std::string& filename) {
   assert(result == CL_SUCCESS && "Failed to load program source");
   std::vector<cl::Device> devices;
   devices.push_back(device_);
-  result = program.build(devices);
+  result = program.build(devices, options.c_str());
   if(result != CL_SUCCESS) {
     std::cerr << "Source compilation failed.\n";
     std::cerr << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device_);
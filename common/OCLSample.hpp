@@ -23,6 +23,7 @@
 #if !defined(OCL_SAMPLE_HPP_INC)
 #define OCL_SAMPLE_HPP_INC 1
 
+#include <vector>
 #include "common/cl.hpp"
 #include "common/Sample.hpp"
 /**
@@ -65,7 +66,27 @@ protected:
    */
   virtual void runKernel(cl::Kernel kernel, cl::Event* evt);
 
-  cl::Program compileSource(const std::string& source);
+  /**
+   * Hook for samples that launch the requested kernel in several passes,
+   * such as a reduction followed by a pass over its partials.  Stores the
+   * events of the first and last commands of one run.  The default runs
+   * runKernel() and uses its event for both.
+   */
+  virtual void runPasses(cl::Kernel kernel, cl::Event* first,
+                         cl::Event* last);
+
+  /**
+   * Hook for samples to report derived performance figures, such as
+   * throughput or bandwidth, given the average kernel time in seconds.
+   */
+  virtual void reportPerformance(double average);
+
+  /**
+   * Builds the OpenCL C program in the given file, passing options, such as
+   * -D definitions, to the compiler.
+   */
+  cl::Program compileSource(const std::string& source,
+                            const std::string& options = std::string());
   cl::Program loadBinary(const std::string& binary);
 
   void setSourceKernel(cl::Kernel kernel) {
@@ -84,6 +105,10 @@ protected:
     return binaryKernel_;
   }
 
+  cl::Device& getDevice() {
+    return device_;
+  }
+
   cl::Context& getContext() {
     return context_;
   }
@@ -100,10 +125,36 @@ protected:
     numIterations_ = iters;
   }
 
+  /**
+   * Waits for last to complete and returns the device time in seconds from
+   * the start of first to the end of last.  Pass the same event twice to
+   * time a single command.
+   */
+  double getElapsed(cl::Event& first, cl::Event& last);
+
+  /**
+   * Returns the median of times, averaging the middle two of an even count.
+   */
+  static double median(std::vector<double> times);
+
+  /**
+   * Runs kernel through runPasses() getNumberOfIterations() times and
+   * returns the device time of each run in seconds.
+   */
+  std::vector<double> timeKernel(cl::Kernel kernel);
+
+  /**
+   * Returns the median rate in GB/s of a device-to-device copy of bytes,
+   * counting a read and a write per byte, over getNumberOfIterations()
+   * copies after a warm-up.  Bandwidth-bound samples report their kernels
+   * against it.
+   */
+  double measureCopyBandwidth(size_t bytes);
+
 private:
 
   void initOpenCL();
-  void timeKernel(cl::Kernel kernel, double& elapsed, double& average);
+  void reportTimes(const std::vector<double>& times);
 
   cl::Platform     platform_;
   cl::Device       device_;
@@ -115,4 +166,31 @@ private:
 
 };
 
+/**
+ * Steps a xorshift64* generator.  Samples seed it with a fixed value, so
+ * every run, and both programs of a sample, see the same inputs.
+ */
+static inline cl_ulong nextRandom(cl_ulong& state) {
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 2685821657736338717ULL;
+}
+
+/**
+ * Uniform in [0, 1), from the top 53 bits of nextRandom().
+ */
+static inline double nextUniform(cl_ulong& state) {
+  return (nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * The AND of four nextRandom() words, in which each bit is set with
+ * probability 1/16.  Samples draw skewed keys from it.
+ */
+static inline cl_ulong nextSkewed(cl_ulong& state) {
+  return nextRandom(state) & nextRandom(state) & nextRandom(state) &
+         nextRandom(state);
+}
+
 #endif
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+#include "common/PNMFile.hpp"
+
+namespace {
+
+/**
+ * Minimal tokenizer over a mapped PNM header.
+ */
+class HeaderReader {
+public:
+
+  HeaderReader(const MappedFile& file)
+  : data_(static_cast<const char*>(file.getData())), size_(file.getSize()),
+    pos_(0) {
+  }
+
+  /**
+   * Reads the next whitespace-delimited token, skipping '#' comments.
+   */
+  bool next(std::string& token) {
+    token.clear();
+    while(pos_ < size_) {
+      if(data_[pos_] == '#') {
+        while(pos_ < size_ && data_[pos_] != '\n') {
+          ++pos_;
+        }
+      } else if(std::isspace((unsigned char)data_[pos_])) {
+        ++pos_;
+      } else {
+        break;
+      }
+    }
+    while(pos_ < size_ && !std::isspace((unsigned char)data_[pos_])) {
+      token += data_[pos_++];
+    }
+    return !token.empty();
+  }
+
+  bool nextUnsigned(unsigned& value) {
+    std::string token;
+    char*       end;
+    if(!next(token)) {
+      return false;
+    }
+    value = (unsigned)std::strtoul(token.c_str(), &end, 10);
+    return *end == '\0';
+  }
+
+  /**
+   * Consumes the single whitespace character that ends the header.
+   */
+  bool endHeader(size_t& offset) {
+    if(pos_ >= size_ || !std::isspace((unsigned char)data_[pos_])) {
+      return false;
+    }
+    offset = pos_ + 1;
+    return true;
+  }
+
+private:
+
+  const char* data_;
+  size_t      size_;
+  size_t      pos_;
+};
+
+}
+
+bool parsePNMHeader(const MappedFile& file, PNMHeader& header) {
+  HeaderReader reader(file);
+  std::string  token;
+
+  if(!file.isOpen() || !reader.next(token) || token.size() != 2 ||
+     token[0] != 'P' || token[1] < '5' || token[1] > '7') {
+    return false;
+  }
+  header.magic = token[1];
+
+  if(header.magic == '7') {
+    header.width = header.height = header.depth = header.maxval = 0;
+    while(reader.next(token) && token != "ENDHDR") {
+      if(token == "WIDTH") {
+        reader.nextUnsigned(header.width);
+      } else if(token == "HEIGHT") {
+        reader.nextUnsigned(header.height);
+      } else if(token == "DEPTH") {
+        reader.nextUnsigned(header.depth);
+      } else if(token == "MAXVAL") {
+        reader.nextUnsigned(header.maxval);
+      } else if(token == "TUPLTYPE") {
+        reader.next(token);
+      } else {
+        return false;
+      }
+    }
+    if(token != "ENDHDR") {
+      return false;
+    }
+  } else {
+    header.depth = (header.magic == '6') ? 3 : 1;
+    if(!reader.nextUnsigned(header.width) ||
+       !reader.nextUnsigned(header.height) ||
+       !reader.nextUnsigned(header.maxval)) {
+      return false;
+    }
+  }
+
+  if(header.width == 0 || header.height == 0 || header.depth == 0 ||
+     header.maxval == 0 || header.maxval > 65535 ||
+     !reader.endHeader(header.dataOffset)) {
+    return false;
+  }
+
+  return header.getFileSize() <= file.getSize();
+}
+
+std::string formatPNMHeader(PNMHeader& header) {
+  std::ostringstream text;
+
+  text << 'P' << header.magic << '\n';
+  if(header.magic == '7') {
+    const char* tupleType = "GRAYSCALE";
+    if(header.depth == 2) {
+      tupleType = "GRAYSCALE_ALPHA";
+    } else if(header.depth == 3) {
+      tupleType = "RGB";
+    } else if(header.depth == 4) {
+      tupleType = "RGB_ALPHA";
+    }
+    text << "WIDTH " << header.width << '\n'
+         << "HEIGHT " << header.height << '\n'
+         << "DEPTH " << header.depth << '\n'
+         << "MAXVAL " << header.maxval << '\n'
+         << "TUPLTYPE " << tupleType << '\n'
+         << "ENDHDR\n";
+  } else {
+    text << header.width << ' ' << header.height << '\n'
+         << header.maxval << '\n';
+  }
+
+  std::string result = text.str();
+  header.dataOffset = result.size();
+  return result;
+}
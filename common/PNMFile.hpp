@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#if !defined(PNM_FILE_HPP_INC)
+#define PNM_FILE_HPP_INC 1
+
+#include <cstddef>
+#include <string>
+#include "common/MappedFile.hpp"
+
+/**
+ * Header of a binary Netpbm image: PGM (P5), PPM (P6) or PAM (P7).  Samples
+ * wider than 8 bits are stored big-endian, as the format requires.
+ */
+struct PNMHeader {
+
+  PNMHeader()
+  : magic('5'), width(0), height(0), depth(1), maxval(255), dataOffset(0) {
+  }
+
+  char     magic;
+  unsigned width;
+  unsigned height;
+  unsigned depth;
+  unsigned maxval;
+
+  /// Offset of the first sample from the start of the file.
+  size_t   dataOffset;
+
+  size_t getBytesPerSample() const {
+    return maxval > 255 ? 2 : 1;
+  }
+
+  size_t getPixelSize() const {
+    return depth * getBytesPerSample();
+  }
+
+  size_t getFileSize() const {
+    return dataOffset + (size_t)width * height * getPixelSize();
+  }
+};
+
+/**
+ * Parses the header of a mapped PNM file.  Returns false if the file is not
+ * a binary PGM, PPM or PAM image.
+ */
+bool parsePNMHeader(const MappedFile& file, PNMHeader& header);
+
+/**
+ * Produces the header text for the given image description and updates its
+ * data offset to match.
+ */
+std::string formatPNMHeader(PNMHeader& header);
+
+#endif
@@ -0,0 +1,455 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include "common/PTXAnalysis.hpp"
+
+namespace ptx {
+
+//==--- SM Models ----------------------------------------------------------== //
+
+namespace {
+
+const SMModel kModels[] = {
+  // name    warps blocks regs   unit max  shared  unit per-block
+  { "sm_20", 48,   8,     32768, 64,  63,  49152,  128, 49152 },
+  { "sm_30", 64,   16,    65536, 256, 63,  49152,  256, 49152 },
+  { "sm_35", 64,   16,    65536, 256, 255, 49152,  256, 49152 },
+  { "sm_50", 64,   32,    65536, 256, 255, 65536,  256, 49152 },
+  { "sm_52", 64,   32,    65536, 256, 255, 98304,  256, 49152 },
+  { "sm_60", 64,   32,    65536, 256, 255, 65536,  256, 49152 },
+  { "sm_70", 64,   32,    65536, 256, 255, 98304,  256, 49152 },
+  { "sm_75", 32,   16,    65536, 256, 255, 65536,  256, 49152 },
+  { "sm_80", 64,   32,    65536, 256, 255, 167936, 128, 49152 },
+  { "sm_86", 48,   16,    65536, 256, 255, 102400, 128, 49152 },
+  { "sm_90", 64,   32,    65536, 256, 255, 233472, 128, 49152 },
+  { NULL,    0,    0,     0,     0,   0,   0,      0,   0 }
+};
+
+}
+
+const SMModel* getSMModels() {
+  return kModels;
+}
+
+const SMModel* findSMModel(const std::string& name) {
+  for(const SMModel* model = kModels; model->name != NULL; ++model) {
+    if(name == model->name) {
+      return model;
+    }
+  }
+  return NULL;
+}
+
+//==--- Register Pressure --------------------------------------------------== //
+
+namespace {
+
+typedef std::vector<uint64_t> BitSet;
+
+inline void setBit(BitSet& set, unsigned bit) {
+  set[bit / 64] |= (uint64_t)1 << (bit % 64);
+}
+
+inline void clearBit(BitSet& set, unsigned bit) {
+  set[bit / 64] &= ~((uint64_t)1 << (bit % 64));
+}
+
+/**
+ * Returns the number of leading operands that the instruction writes.
+ */
+unsigned getNumDefinitions(const Instruction& inst) {
+  switch(inst.opcode) {
+  case OP_ST:
+  case OP_RED:
+  case OP_BRA:
+  case OP_BAR:
+  case OP_MEMBAR:
+  case OP_RET:
+  case OP_EXIT:
+  case OP_NOP:
+    return 0;
+  case OP_LD:
+  case OP_UNPACK:
+    return inst.vector;
+  case OP_SETP:
+  case OP_SHFL:
+    return 2;
+  default:
+    return inst.numOperands > 0 ? 1 : 0;
+  }
+}
+
+/**
+ * Backward liveness over the control-flow graph of one function.  Only
+ * declared registers take part; special registers are read-only and never
+ * allocated.
+ */
+class LivenessAnalysis {
+public:
+
+  LivenessAnalysis(const Function& function)
+  : function_(function), words_((function.numRegisters + 63) / 64),
+    narrow_(words_, 0), wide_(words_, 0), predicates_(words_, 0) {
+    for(size_t i = 0; i < function.registers.size(); ++i) {
+      const RegisterDeclaration& decl = function.registers[i];
+      BitSet* set = decl.type == TYPE_PRED ? &predicates_ :
+        getTypeSize(decl.type) == 8 ? &wide_ : &narrow_;
+      for(unsigned j = 0; j < decl.count; ++j) {
+        setBit(*set, decl.first + j);
+      }
+    }
+  }
+
+  void run(unsigned& registers, unsigned& predicates);
+
+private:
+
+  struct Block {
+    unsigned              first;
+    unsigned              last;         ///< One past the last instruction
+    std::vector<unsigned> successors;
+    BitSet                uses;         ///< Read before written in the block
+    BitSet                definitions;
+    BitSet                liveIn;
+    BitSet                liveOut;
+  };
+
+  bool isTracked(unsigned reg) const {
+    return reg != kNoRegister && reg >= NUM_SPECIAL_REGISTERS &&
+      reg < function_.numRegisters;
+  }
+
+  void buildBlocks();
+  void transfer(const Instruction& inst, BitSet& live) const;
+  void measure(const BitSet& live, unsigned& registers,
+               unsigned& predicates) const;
+
+  const Function&    function_;
+  size_t             words_;
+  BitSet             narrow_;
+  BitSet             wide_;
+  BitSet             predicates_;
+  std::vector<Block> blocks_;
+};
+
+void LivenessAnalysis::buildBlocks() {
+  const std::vector<Instruction>& code = function_.instructions;
+
+  std::vector<bool> leader(code.size() + 1, false);
+  leader[0] = true;
+  for(size_t i = 0; i < code.size(); ++i) {
+    const Instruction& inst = code[i];
+    if(inst.opcode == OP_BRA) {
+      leader[inst.operands[0].value] = true;
+    }
+    if(inst.opcode == OP_BRA || inst.opcode == OP_RET ||
+       inst.opcode == OP_EXIT) {
+      leader[i + 1] = true;
+    }
+  }
+
+  std::vector<unsigned> blockOf(code.size(), 0);
+  for(size_t i = 0; i < code.size(); ++i) {
+    if(leader[i]) {
+      Block block;
+      block.first = (unsigned)i;
+      block.uses.assign(words_, 0);
+      block.definitions.assign(words_, 0);
+      block.liveIn.assign(words_, 0);
+      block.liveOut.assign(words_, 0);
+      blocks_.push_back(block);
+    }
+    blockOf[i]            = (unsigned)blocks_.size() - 1;
+    blocks_.back().last   = (unsigned)i + 1;
+  }
+
+  for(size_t b = 0; b < blocks_.size(); ++b) {
+    Block&             block = blocks_[b];
+    const Instruction& tail  = code[block.last - 1];
+    bool               falls = true;
+
+    if(tail.opcode == OP_BRA) {
+      block.successors.push_back(blockOf[tail.operands[0].value]);
+      falls = tail.guard != kNoRegister;
+    } else if(tail.opcode == OP_RET || tail.opcode == OP_EXIT) {
+      falls = tail.guard != kNoRegister;
+    }
+    if(falls && block.last < code.size()) {
+      block.successors.push_back(blockOf[block.last]);
+    }
+
+    // Summarize the block: registers read before any write, and registers
+    // written unconditionally
+    for(unsigned i = block.last; i-- > block.first;) {
+      transfer(code[i], block.uses);
+      const Instruction& inst = code[i];
+      if(inst.guard == kNoRegister) {
+        unsigned numDefs = getNumDefinitions(inst);
+        for(unsigned j = 0; j < numDefs && j < inst.numOperands; ++j) {
+          if(inst.operands[j].kind == OPERAND_REGISTER &&
+             isTracked(inst.operands[j].reg)) {
+            setBit(block.definitions, inst.operands[j].reg);
+          }
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Updates live, the registers live after inst, to those live before it.
+ */
+void LivenessAnalysis::transfer(const Instruction& inst, BitSet& live) const {
+  unsigned numDefs = getNumDefinitions(inst);
+
+  // A guarded write may not happen, so it does not end the old value
+  if(inst.guard == kNoRegister) {
+    for(unsigned i = 0; i < numDefs && i < inst.numOperands; ++i) {
+      if(inst.operands[i].kind == OPERAND_REGISTER &&
+         isTracked(inst.operands[i].reg)) {
+        clearBit(live, inst.operands[i].reg);
+      }
+    }
+  }
+
+  for(unsigned i = 0; i < inst.numOperands; ++i) {
+    const Operand& operand = inst.operands[i];
+    bool isSource = i >= numDefs || operand.kind == OPERAND_ADDRESS;
+    if(isSource && (operand.kind == OPERAND_REGISTER ||
+                    operand.kind == OPERAND_ADDRESS) &&
+       isTracked(operand.reg)) {
+      setBit(live, operand.reg);
+    }
+  }
+  if(isTracked(inst.guard)) {
+    setBit(live, inst.guard);
+  }
+}
+
+void LivenessAnalysis::measure(const BitSet& live, unsigned& registers,
+                               unsigned& predicates) const {
+  unsigned count = 0;
+  unsigned preds = 0;
+  for(size_t w = 0; w < words_; ++w) {
+    count += __builtin_popcountll(live[w] & narrow_[w]) +
+      2 * __builtin_popcountll(live[w] & wide_[w]);
+    preds += __builtin_popcountll(live[w] & predicates_[w]);
+  }
+  registers  = std::max(registers, count);
+  predicates = std::max(predicates, preds);
+}
+
+void LivenessAnalysis::run(unsigned& registers, unsigned& predicates) {
+  const std::vector<Instruction>& code = function_.instructions;
+
+  registers  = 0;
+  predicates = 0;
+  if(code.empty()) {
+    return;
+  }
+  buildBlocks();
+
+  // Iterate to a fixed point, visiting blocks in reverse order since
+  // liveness flows backwards
+  for(bool changed = true; changed;) {
+    changed = false;
+    for(size_t b = blocks_.size(); b-- > 0;) {
+      Block& block = blocks_[b];
+
+      for(size_t s = 0; s < block.successors.size(); ++s) {
+        const BitSet& in = blocks_[block.successors[s]].liveIn;
+        for(size_t w = 0; w < words_; ++w) {
+          block.liveOut[w] |= in[w];
+        }
+      }
+      for(size_t w = 0; w < words_; ++w) {
+        uint64_t in = block.uses[w] |
+          (block.liveOut[w] & ~block.definitions[w]);
+        if(in != block.liveIn[w]) {
+          block.liveIn[w] = in;
+          changed         = true;
+        }
+      }
+    }
+  }
+
+  // Peak pressure: every value live across an instruction, plus the values
+  // it defines, which need registers even if never read
+  for(size_t b = 0; b < blocks_.size(); ++b) {
+    const Block& block = blocks_[b];
+    BitSet       live  = block.liveOut;
+
+    for(unsigned i = block.last; i-- > block.first;) {
+      const Instruction& inst    = code[i];
+      BitSet             defined = live;
+      unsigned           numDefs = getNumDefinitions(inst);
+
+      for(unsigned j = 0; j < numDefs && j < inst.numOperands; ++j) {
+        if(inst.operands[j].kind == OPERAND_REGISTER &&
+           isTracked(inst.operands[j].reg)) {
+          setBit(defined, inst.operands[j].reg);
+        }
+      }
+      measure(defined, registers, predicates);
+      transfer(inst, live);
+      measure(live, registers, predicates);
+    }
+  }
+}
+
+}
+
+//==--- Public Interface ---------------------------------------------------== //
+
+KernelStats::KernelStats()
+: estimatedRegisters(0), estimatedPredicates(0), sharedSize(0), localSize(0),
+  usesDynamicShared(false), maxThreadsPerBlock(0), instructions(0), fma(0),
+  branches(0), barriers(0), atomics(0) {
+  for(unsigned i = 0; i < NUM_SPACES; ++i) {
+    loads[i][0]  = loads[i][1]  = 0;
+    stores[i][0] = stores[i][1] = 0;
+  }
+}
+
+void analyzeFunction(const Function& function, KernelStats& stats) {
+  stats = KernelStats();
+
+  for(size_t i = 0; i < function.registers.size(); ++i) {
+    const RegisterDeclaration& decl = function.registers[i];
+    RegisterClass              regClass;
+    regClass.name  = decl.name;
+    regClass.type  = decl.type;
+    regClass.count = decl.count;
+    stats.registerClasses.push_back(regClass);
+  }
+
+  stats.sharedSize        = function.sharedSize;
+  stats.localSize         = function.localSize;
+  stats.usesDynamicShared = function.usesDynamicShared;
+
+  unsigned threads[2] = { 1, 1 };
+  for(unsigned i = 0; i < 3; ++i) {
+    threads[0] *= function.reqntid[i] ? function.reqntid[i] : 1;
+    threads[1] *= function.maxntid[i] ? function.maxntid[i] : 1;
+  }
+  if(function.reqntid[0] != 0) {
+    stats.maxThreadsPerBlock = threads[0];
+  } else if(function.maxntid[0] != 0) {
+    stats.maxThreadsPerBlock = threads[1];
+  }
+
+  // The parser ends every body with a ret of its own; leave it out of the
+  // mix
+  const std::vector<Instruction>& code  = function.instructions;
+  size_t                          count = code.empty() ? 0 : code.size() - 1;
+  stats.instructions = (unsigned)count;
+
+  for(size_t i = 0; i < count; ++i) {
+    const Instruction& inst   = code[i];
+    unsigned           vector = inst.vector > 1 ? 1 : 0;
+
+    switch(inst.opcode) {
+    case OP_LD:
+      ++stats.loads[inst.space][vector];
+      break;
+    case OP_ST:
+      ++stats.stores[inst.space][vector];
+      break;
+    case OP_FMA:
+      ++stats.fma;
+      break;
+    case OP_MAD:
+      if(isFloatType(inst.type)) {
+        ++stats.fma;
+      }
+      break;
+    case OP_BRA:
+      ++stats.branches;
+      break;
+    case OP_BAR:
+      ++stats.barriers;
+      break;
+    case OP_ATOM:
+    case OP_RED:
+      ++stats.atomics;
+      break;
+    default:
+      break;
+    }
+  }
+
+  LivenessAnalysis liveness(function);
+  liveness.run(stats.estimatedRegisters, stats.estimatedPredicates);
+}
+
+Occupancy estimateOccupancy(const SMModel& model, const KernelStats& stats,
+                            unsigned blockSize, size_t dynamicShared) {
+  Occupancy result;
+
+  // ptxas spills anything beyond the per-thread limit to local memory
+  unsigned registers = std::min(stats.estimatedRegisters,
+                                model.maxRegistersPerThread);
+  result.registersPerThread = std::max(registers, 1u);
+
+  unsigned warpsPerBlock = (std::max(blockSize, 1u) + 31) / 32;
+
+  unsigned byWarps  = model.maxWarps / warpsPerBlock;
+  unsigned byBlocks = model.maxBlocks;
+
+  unsigned unit         = model.registerUnit;
+  unsigned regsPerWarp  = (result.registersPerThread * 32 + unit - 1) /
+    unit * unit;
+  unsigned byRegisters  = model.registers / regsPerWarp / warpsPerBlock;
+
+  size_t   shared   = stats.sharedSize + dynamicShared;
+  unsigned byShared = byBlocks;
+  if(shared > model.maxSharedPerBlock) {
+    byShared = 0;
+  } else if(shared > 0) {
+    size_t allocated = (shared + model.sharedUnit - 1) / model.sharedUnit *
+      model.sharedUnit;
+    byShared = (unsigned)(model.sharedMemory / allocated);
+  }
+
+  result.blocksPerSM = byWarps;
+  result.limiter     = "warps";
+  if(byBlocks < result.blocksPerSM) {
+    result.blocksPerSM = byBlocks;
+    result.limiter     = "blocks";
+  }
+  if(byRegisters < result.blocksPerSM) {
+    result.blocksPerSM = byRegisters;
+    result.limiter     = "registers";
+  }
+  if(byShared < result.blocksPerSM) {
+    result.blocksPerSM = byShared;
+    result.limiter     = "shared";
+  }
+
+  result.activeWarps = result.blocksPerSM * warpsPerBlock;
+  result.occupancy   = (double)result.activeWarps / model.maxWarps;
+  return result;
+}
+
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#if !defined(PTX_ANALYSIS_HPP_INC)
+#define PTX_ANALYSIS_HPP_INC 1
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "common/PTXModule.hpp"
+
+/**
+ * Static analysis of parsed PTX: register pressure, instruction mix and an
+ * occupancy estimate, without a device.
+ *
+ * The PTX that llc emits uses virtual registers; ptxas allocates the real
+ * ones.  The register estimate is the largest number of 32-bit registers
+ * live at any one instruction (64-bit values take two, predicates live in
+ * their own file), which tracks what ptxas reports closely enough to spot
+ * code-quality regressions.
+ */
+namespace ptx {
+
+/**
+ * Per-SM resource limits of a GPU generation.
+ */
+struct SMModel {
+  const char* name;
+  unsigned    maxWarps;       ///< Resident warps per SM
+  unsigned    maxBlocks;      ///< Resident CTAs per SM
+  unsigned    registers;      ///< 32-bit registers per SM
+  unsigned    registerUnit;   ///< Per-warp register allocation granularity
+  unsigned    maxRegistersPerThread;
+  unsigned    sharedMemory;   ///< Bytes of shared memory per SM
+  unsigned    sharedUnit;     ///< Shared memory allocation granularity
+  unsigned    maxSharedPerBlock;
+};
+
+/**
+ * Returns the model with the given name (e.g. "sm_20"), or NULL.
+ */
+const SMModel* findSMModel(const std::string& name);
+
+/**
+ * Returns the known models, terminated by an entry with a NULL name.
+ */
+const SMModel* getSMModels();
+
+struct RegisterClass {
+  std::string name;         ///< Declared prefix, e.g. "%rd"
+  DataType    type;
+  unsigned    count;
+};
+
+struct KernelStats {
+
+  KernelStats();
+
+  std::vector<RegisterClass> registerClasses;
+  unsigned                   estimatedRegisters;  ///< Peak live 32-bit values
+  unsigned                   estimatedPredicates; ///< Peak live predicates
+  size_t                     sharedSize;
+  size_t                     localSize;
+  bool                       usesDynamicShared;
+  unsigned                   maxThreadsPerBlock;  ///< .reqntid/.maxntid, or 0
+  unsigned                   instructions;
+  unsigned                   loads[NUM_SPACES][2];  ///< [space][scalar, vector]
+  unsigned                   stores[NUM_SPACES][2];
+  unsigned                   fma;                 ///< fma and floating mad
+  unsigned                   branches;
+  unsigned                   barriers;
+  unsigned                   atomics;
+};
+
+/**
+ * Computes the statistics of one function.
+ */
+void analyzeFunction(const Function& function, KernelStats& stats);
+
+struct Occupancy {
+  unsigned    registersPerThread;
+  unsigned    blocksPerSM;
+  unsigned    activeWarps;
+  double      occupancy;    ///< Active warps over the model's maximum
+  const char* limiter;      ///< "warps", "blocks", "registers" or "shared"
+};
+
+/**
+ * Estimates how many CTAs of blockSize threads fit on one SM of the given
+ * model.
+ */
+Occupancy estimateOccupancy(const SMModel& model, const KernelStats& stats,
+                            unsigned blockSize, size_t dynamicShared);
+
+}
+
+#endif
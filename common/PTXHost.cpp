@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <unistd.h>
+#include "common/PTXHost.hpp"
+#include "common/WorkerPool.hpp"
+
+#if !defined(__x86_64__)
+#include <ucontext.h>
+#endif
+
+namespace ptxhost {
+
+__thread ThreadState currentThread;
+
+namespace {
+
+const size_t kFiberStackSize = 64 * 1024;
+
+/// Fiber stacks of the calling worker, kept from one launch to the next
+__thread char*  workerStacks    = NULL;
+__thread size_t workerStackSize = 0;
+
+char* getWorkerStacks(size_t size) {
+  if(size > workerStackSize) {
+    free(workerStacks);
+    workerStacks = static_cast<char*>(malloc(size));
+    assert(workerStacks != NULL && "Failed to allocate fiber stacks");
+    workerStackSize = size;
+  }
+  return workerStacks;
+}
+
+//==--- Fiber Contexts -----------------------------------------------------== //
+
+#if defined(__x86_64__)
+
+// swapcontext() saves and restores the signal mask with a system call on
+// every switch, which dominates barrier-heavy kernels.  On x86-64 we switch
+// stacks directly, saving only the callee-saved registers.
+extern "C" void ptxhost_switch_context(void** from, void* to);
+
+asm(".pushsection .text\n"
+    ".globl ptxhost_switch_context\n"
+    ".hidden ptxhost_switch_context\n"
+    ".type ptxhost_switch_context, @function\n"
+    "ptxhost_switch_context:\n"
+    "  pushq %rbp\n"
+    "  pushq %rbx\n"
+    "  pushq %r12\n"
+    "  pushq %r13\n"
+    "  pushq %r14\n"
+    "  pushq %r15\n"
+    "  movq %rsp, (%rdi)\n"
+    "  movq %rsi, %rsp\n"
+    "  popq %r15\n"
+    "  popq %r14\n"
+    "  popq %r13\n"
+    "  popq %r12\n"
+    "  popq %rbx\n"
+    "  popq %rbp\n"
+    "  ret\n"
+    ".size ptxhost_switch_context, .-ptxhost_switch_context\n"
+    ".popsection\n");
+
+struct Context {
+  void* sp;
+};
+
+void makeContext(Context& context, char* stack, size_t size,
+                 void (*entry)()) {
+  // Lay out the frame ptxhost_switch_context expects: six saved registers
+  // and a return address, leaving the stack aligned as if entry had been
+  // called.
+  void** top = (void**)(((size_t)(stack + size)) & ~(size_t)15);
+  *--top = NULL;
+  *--top = (void*)entry;
+  for(unsigned i = 0; i < 6; ++i) {
+    *--top = NULL;
+  }
+  context.sp = top;
+}
+
+inline void switchContext(Context& from, Context& to) {
+  ptxhost_switch_context(&from.sp, to.sp);
+}
+
+#else
+
+struct Context {
+  ucontext_t uc;
+};
+
+void makeContext(Context& context, char* stack, size_t size,
+                 void (*entry)()) {
+  getcontext(&context.uc);
+  context.uc.uc_stack.ss_sp   = stack;
+  context.uc.uc_stack.ss_size = size;
+  context.uc.uc_link          = NULL;
+  makecontext(&context.uc, entry, 0);
+}
+
+inline void switchContext(Context& from, Context& to) {
+  swapcontext(&from.uc, &to.uc);
+}
+
+#endif
+
+//==--- CTA Execution ------------------------------------------------------== //
+
+/**
+ * Runs the threads of one CTA at a time as fibers on the calling worker.
+ * Each thread runs until it reaches a barrier or exits; once every thread
+ * has done so, the waiting threads are resumed in turn.
+ */
+class FiberCTA {
+public:
+
+  FiberCTA(KernelBody& body, const Dim3& grid, const Dim3& block)
+  : body_(body), grid_(grid), block_(block), current_(0) {
+    unsigned numThreads = block.x * block.y * block.z;
+    fibers_.resize(numThreads);
+    stacks_ = getWorkerStacks(numThreads * kFiberStackSize);
+  }
+
+  void run(const Dim3& ctaid);
+
+  void yield() {
+    switchContext(fibers_[current_].context, scheduler_);
+  }
+
+private:
+
+  struct Fiber {
+    Context     context;
+    ThreadState state;
+    bool        finished;
+  };
+
+  static void entry();
+
+  KernelBody&        body_;
+  Dim3               grid_;
+  Dim3               block_;
+  std::vector<Fiber> fibers_;
+  char*              stacks_;
+  Context            scheduler_;
+  unsigned           current_;
+};
+
+__thread FiberCTA* currentCTA = NULL;
+
+void FiberCTA::entry() {
+  FiberCTA* cta = currentCTA;
+
+  cta->body_.invoke();
+  cta->fibers_[cta->current_].finished = true;
+  switchContext(cta->fibers_[cta->current_].context, cta->scheduler_);
+
+  // A finished fiber is never resumed
+  abort();
+}
+
+void FiberCTA::run(const Dim3& ctaid) {
+  unsigned i = 0;
+
+  for(unsigned z = 0; z < block_.z; ++z) {
+    for(unsigned y = 0; y < block_.y; ++y) {
+      for(unsigned x = 0; x < block_.x; ++x, ++i) {
+        Fiber& fiber = fibers_[i];
+        fiber.state.tid    = makeDim3(x, y, z);
+        fiber.state.ntid   = block_;
+        fiber.state.ctaid  = ctaid;
+        fiber.state.nctaid = grid_;
+        fiber.finished     = false;
+        makeContext(fiber.context, &stacks_[i * kFiberStackSize],
+                    kFiberStackSize, &FiberCTA::entry);
+      }
+    }
+  }
+
+  currentCTA = this;
+
+  unsigned active;
+  do {
+    active = 0;
+    for(current_ = 0; current_ < fibers_.size(); ++current_) {
+      Fiber& fiber = fibers_[current_];
+      if(fiber.finished) {
+        continue;
+      }
+      currentThread = fiber.state;
+      switchContext(scheduler_, fiber.context);
+      if(!fiber.finished) {
+        ++active;
+      }
+    }
+  } while(active > 0);
+
+  currentCTA = NULL;
+}
+
+/**
+ * Runs the threads of a barrier-free CTA back to back.
+ */
+void runSequentialCTA(KernelBody& body, const Dim3& ctaid, const Dim3& grid,
+                      const Dim3& block) {
+  currentThread.ntid   = block;
+  currentThread.ctaid  = ctaid;
+  currentThread.nctaid = grid;
+
+  for(unsigned z = 0; z < block.z; ++z) {
+    for(unsigned y = 0; y < block.y; ++y) {
+      for(unsigned x = 0; x < block.x; ++x) {
+        currentThread.tid = makeDim3(x, y, z);
+        body.invoke();
+      }
+    }
+  }
+}
+
+struct LaunchState {
+  KernelBody*       body;
+  Dim3              grid;
+  Dim3              block;
+  bool              usesBarriers;
+  unsigned          numCTAs;
+  volatile unsigned nextCTA;
+};
+
+void workerMain(void* arg) {
+  LaunchState& launch = *static_cast<LaunchState*>(arg);
+  FiberCTA*    fibers = NULL;
+
+  if(launch.usesBarriers) {
+    fibers = new FiberCTA(*launch.body, launch.grid, launch.block);
+  }
+
+  // CTAs are handed out dynamically, so uneven CTAs balance across workers
+  for(;;) {
+    unsigned cta = __sync_fetch_and_add(&launch.nextCTA, 1);
+    if(cta >= launch.numCTAs) {
+      break;
+    }
+
+    Dim3 ctaid = makeDim3(cta % launch.grid.x,
+                          (cta / launch.grid.x) % launch.grid.y,
+                          cta / (launch.grid.x * launch.grid.y));
+    if(fibers != NULL) {
+      fibers->run(ctaid);
+    } else {
+      runSequentialCTA(*launch.body, ctaid, launch.grid, launch.block);
+    }
+  }
+
+  delete fibers;
+}
+
+}
+
+void barrierSync() {
+  if(currentCTA == NULL) {
+    std::cerr << "ERROR: __builtin_ptx_bar_sync called from a kernel "
+              << "launched without barrier support\n";
+    abort();
+  }
+  currentCTA->yield();
+}
+
+unsigned getDefaultWorkerCount() {
+  const char* env = getenv("PTXHOST_THREADS");
+  if(env != NULL && atoi(env) > 0) {
+    return atoi(env);
+  }
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return cpus > 0 ? (unsigned)cpus : 1;
+}
+
+void launchGrid(KernelBody& body, Dim3 grid, Dim3 block, bool usesBarriers,
+                unsigned numWorkers) {
+  LaunchState launch;
+  launch.body         = &body;
+  launch.grid         = grid;
+  launch.block        = block;
+  launch.usesBarriers = usesBarriers;
+  launch.numCTAs      = grid.x * grid.y * grid.z;
+  launch.nextCTA      = 0;
+
+  if(numWorkers == 0) {
+    numWorkers = getDefaultWorkerCount();
+  }
+  if(numWorkers > launch.numCTAs) {
+    numWorkers = launch.numCTAs;
+  }
+
+  WorkerPool::get().run(workerMain, &launch, numWorkers);
+}
+
+}
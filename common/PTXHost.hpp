@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#if !defined(PTX_HOST_HPP_INC)
+#define PTX_HOST_HPP_INC 1
+
+/**
+ * Host execution backend for the C++ kernels in kernels/.
+ *
+ * Including this header before a .kernel.cpp file provides host versions of
+ * the __builtin_ptx_* intrinsics, so the unmodified kernel source compiles
+ * for the host.  ptxhost::launchGrid() then runs a grid on the persistent
+ * WorkerPool, one CTA per worker at a time.  Kernels that synchronize with
+ * __builtin_ptx_bar_sync run each CTA thread as a fiber, switching fibers at
+ * every barrier; other kernels run CTA threads back to back.
+ *
+ * Shared-memory arrays must be declared PTX_SHARED.  On the host they are
+ * thread-local, giving each worker (and so each CTA in flight) a private
+ * copy.
+ */
+
+#define PTX_SHARED __thread
+
+namespace ptxhost {
+
+/**
+ * Grid, block or thread coordinates.  This is kept a POD so that it can live
+ * in thread-local storage; use makeDim3() to construct one.
+ */
+struct Dim3 {
+  unsigned x;
+  unsigned y;
+  unsigned z;
+};
+
+inline Dim3 makeDim3(unsigned x, unsigned y = 1, unsigned z = 1) {
+  Dim3 result = { x, y, z };
+  return result;
+}
+
+/**
+ * Special registers of the CTA thread currently executing on this worker.
+ */
+struct ThreadState {
+  Dim3 tid;
+  Dim3 ntid;
+  Dim3 ctaid;
+  Dim3 nctaid;
+};
+
+extern __thread ThreadState currentThread;
+
+/**
+ * Suspends the calling CTA thread until every thread in its CTA has reached
+ * the barrier.
+ */
+void barrierSync();
+
+/**
+ * A kernel invocation with its arguments bound.  Samples derive from this
+ * and call their kernel from invoke().
+ */
+class KernelBody {
+public:
+
+  virtual ~KernelBody() {
+  }
+
+  virtual void invoke() = 0;
+};
+
+/**
+ * Runs body over the given grid and returns once every CTA has completed.
+ * usesBarriers must be set for kernels that call __builtin_ptx_bar_sync.
+ * A numWorkers of 0 uses the PTXHOST_THREADS environment variable, or one
+ * worker per online processor.
+ */
+void launchGrid(KernelBody& body, Dim3 grid, Dim3 block, bool usesBarriers,
+                unsigned numWorkers = 0);
+
+/**
+ * Returns the number of workers launchGrid() uses by default.
+ */
+unsigned getDefaultWorkerCount();
+
+}
+
+//==--- PTX Intrinsic Shims ------------------------------------------------== //
+
+#define PTX_HOST_SREG(name, field)                  \
+  static inline int __builtin_ptx_read_##name() {   \
+    return (int)ptxhost::currentThread.field;       \
+  }
+
+PTX_HOST_SREG(tid_x,    tid.x)
+PTX_HOST_SREG(tid_y,    tid.y)
+PTX_HOST_SREG(tid_z,    tid.z)
+PTX_HOST_SREG(ntid_x,   ntid.x)
+PTX_HOST_SREG(ntid_y,   ntid.y)
+PTX_HOST_SREG(ntid_z,   ntid.z)
+PTX_HOST_SREG(ctaid_x,  ctaid.x)
+PTX_HOST_SREG(ctaid_y,  ctaid.y)
+PTX_HOST_SREG(ctaid_z,  ctaid.z)
+PTX_HOST_SREG(nctaid_x, nctaid.x)
+PTX_HOST_SREG(nctaid_y, nctaid.y)
+PTX_HOST_SREG(nctaid_z, nctaid.z)
+
+#undef PTX_HOST_SREG
+
+static inline void __builtin_ptx_bar_sync(int) {
+  ptxhost::barrierSync();
+}
+
+#endif
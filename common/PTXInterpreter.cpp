@@ -0,0 +1,2251 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <limits>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "common/PTXInterpreter.hpp"
+#include "common/WorkerPool.hpp"
+
+namespace ptx {
+
+namespace {
+
+/// Generic addresses of the shared and local windows.  Global addresses
+/// must stay below both.
+const uint64_t kSharedWindow32 = 0xFE000000u;
+const uint64_t kLocalWindow32  = 0xFF000000u;
+const uint64_t kSharedWindow64 = (uint64_t)1 << 56;
+const uint64_t kLocalWindow64  = (uint64_t)2 << 56;
+const uint64_t kWindowSize     = 0x01000000u;
+
+const unsigned kMaxThreadsPerBlock = 1024;
+
+/// Global allocations each CTAExecutor remembers, most recently used first,
+/// so that kernels streaming through a few buffers are checked without
+/// locking the memory's map
+const unsigned kNumWindows = 4;
+
+/// Allocation granularity of ArenaMemory; address 0 is never handed out
+const size_t kArenaAlignment = 256;
+
+size_t roundToArena(size_t size) {
+  size = (size + kArenaAlignment - 1) / kArenaAlignment * kArenaAlignment;
+  return size > 0 ? size : kArenaAlignment;
+}
+
+/**
+ * Looks up address in a map from block start to block size.
+ */
+bool findBlock(const std::map<uint64_t, size_t>& blocks, uint64_t address,
+               uint64_t& start, size_t& size) {
+  std::map<uint64_t, size_t>::const_iterator block =
+    blocks.upper_bound(address);
+  if(block == blocks.begin()) {
+    return false;
+  }
+  --block;
+  if(address - block->first >= block->second) {
+    return false;
+  }
+  start = block->first;
+  size  = block->second;
+  return true;
+}
+
+class Lock {
+public:
+
+  explicit Lock(pthread_mutex_t& mutex)
+  : mutex_(mutex) {
+    pthread_mutex_lock(&mutex_);
+  }
+
+  ~Lock() {
+    pthread_mutex_unlock(&mutex_);
+  }
+
+private:
+
+  pthread_mutex_t& mutex_;
+};
+
+}
+
+//==--- Memory -------------------------------------------------------------== //
+
+HostMemory::HostMemory() {
+  pthread_mutex_init(&lock_, NULL);
+}
+
+HostMemory::~HostMemory() {
+  pthread_mutex_destroy(&lock_);
+}
+
+uint64_t HostMemory::allocate(size_t size) {
+  void* data = NULL;
+  if(posix_memalign(&data, kArenaAlignment, size > 0 ? size : 1) != 0) {
+    return 0;
+  }
+
+  Lock guard(lock_);
+  used_[(uint64_t)(size_t)data] = size;
+  return (uint64_t)(size_t)data;
+}
+
+void HostMemory::release(uint64_t address) {
+  Lock guard(lock_);
+  if(used_.erase(address) > 0) {
+    free((void*)(size_t)address);
+  }
+}
+
+bool HostMemory::findAllocation(uint64_t address, uint64_t& start,
+                                size_t& size) const {
+  Lock guard(lock_);
+  return findBlock(used_, address, start, size);
+}
+
+ArenaMemory::ArenaMemory(size_t capacity)
+: base_(NULL), capacity_(capacity) {
+  pthread_mutex_init(&lock_, NULL);
+
+  void* data = mmap(NULL, capacity, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  assert(data != MAP_FAILED && "Failed to reserve device memory arena");
+
+  base_ = static_cast<unsigned char*>(data);
+  free_[kArenaAlignment] = capacity - kArenaAlignment;
+}
+
+ArenaMemory::~ArenaMemory() {
+  munmap(base_, capacity_);
+  pthread_mutex_destroy(&lock_);
+}
+
+uint64_t ArenaMemory::allocate(size_t size) {
+  Lock   guard(lock_);
+  size_t rounded = roundToArena(size);
+
+  // First fit
+  for(std::map<uint64_t, size_t>::iterator block = free_.begin();
+      block != free_.end(); ++block) {
+    if(block->second >= rounded) {
+      uint64_t address = block->first;
+      size_t   rest    = block->second - rounded;
+      free_.erase(block);
+      if(rest > 0) {
+        free_[address + rounded] = rest;
+      }
+      used_[address] = size;
+      return address;
+    }
+  }
+  return 0;
+}
+
+void ArenaMemory::release(uint64_t address) {
+  Lock guard(lock_);
+  std::map<uint64_t, size_t>::iterator block = used_.find(address);
+  if(block == used_.end()) {
+    return;
+  }
+
+  uint64_t start = block->first;
+  size_t   size  = roundToArena(block->second);
+  used_.erase(block);
+
+  // Give the pages back and coalesce with neighbouring free blocks
+  madvise(base_ + start, size, MADV_DONTNEED);
+
+  std::map<uint64_t, size_t>::iterator next = free_.lower_bound(start);
+  if(next != free_.end() && start + size == next->first) {
+    size += next->second;
+    free_.erase(next++);
+  }
+  if(next != free_.begin()) {
+    std::map<uint64_t, size_t>::iterator prev = next;
+    --prev;
+    if(prev->first + prev->second == start) {
+      prev->second += size;
+      return;
+    }
+  }
+  free_[start] = size;
+}
+
+bool ArenaMemory::findAllocation(uint64_t address, uint64_t& start,
+                                 size_t& size) const {
+  Lock guard(lock_);
+  return findBlock(used_, address, start, size);
+}
+
+//==--- Value Helpers ------------------------------------------------------== //
+
+namespace {
+
+template <class T>
+inline T as(uint64_t bits) {
+  T value;
+  memcpy(&value, &bits, sizeof(T));
+  return value;
+}
+
+template <class T>
+inline uint64_t bitsOf(T value) {
+  uint64_t bits = 0;
+  memcpy(&bits, &value, sizeof(T));
+  return bits;
+}
+
+inline unsigned nextLane(uint32_t& mask) {
+  unsigned lane = __builtin_ctz(mask);
+  mask &= mask - 1;
+  return lane;
+}
+
+/// Sign- or zero-extends the low size bytes of bits.
+inline uint64_t extend(uint64_t bits, unsigned size, bool isSigned) {
+  if(size >= 8) {
+    return bits;
+  }
+  unsigned shift = 64 - size * 8;
+  return isSigned ? (uint64_t)((int64_t)(bits << shift) >> shift)
+    : (bits << shift) >> shift;
+}
+
+inline uint64_t loadValue(const unsigned char* data, unsigned size,
+                          bool isSigned) {
+  // Fixed-size copies compile to single moves
+  switch(size) {
+  case 1:
+    return isSigned ? (uint64_t)(int64_t)*(const int8_t*)data : *data;
+  case 2: {
+    uint16_t value;
+    memcpy(&value, data, 2);
+    return isSigned ? (uint64_t)(int64_t)(int16_t)value : value;
+  }
+  case 4: {
+    uint32_t value;
+    memcpy(&value, data, 4);
+    return isSigned ? (uint64_t)(int64_t)(int32_t)value : value;
+  }
+  default: {
+    uint64_t value;
+    memcpy(&value, data, 8);
+    return value;
+  }
+  }
+}
+
+inline void storeValue(unsigned char* data, unsigned size, uint64_t bits) {
+  switch(size) {
+  case 1: {
+    *data = (unsigned char)bits;
+    break;
+  }
+  case 2: {
+    uint16_t value = (uint16_t)bits;
+    memcpy(data, &value, 2);
+    break;
+  }
+  case 4: {
+    uint32_t value = (uint32_t)bits;
+    memcpy(data, &value, 4);
+    break;
+  }
+  default:
+    memcpy(data, &bits, 8);
+    break;
+  }
+}
+
+float halfToFloat(uint16_t half) {
+  uint32_t sign     = (uint32_t)(half & 0x8000) << 16;
+  uint32_t exponent = (half >> 10) & 0x1f;
+  uint32_t mantissa = half & 0x3ff;
+
+  if(exponent == 0x1f) {
+    return as<float>(sign | 0x7f800000 | (mantissa << 13));
+  }
+  if(exponent == 0) {
+    float value = ldexpf((float)mantissa, -24);
+    return sign ? -value : value;
+  }
+  return as<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+uint16_t floatToHalf(float value) {
+  uint32_t bits     = (uint32_t)bitsOf(value);
+  uint16_t sign     = (uint16_t)((bits >> 16) & 0x8000);
+  float    absolute = fabsf(value);
+
+  if(value != value) {
+    return sign | 0x7e00;
+  }
+  if(absolute >= 65520.0f) {
+    return sign | 0x7c00;
+  }
+  if(absolute < 6.103515625e-05f) {
+    // Subnormal: round to a multiple of 2^-24
+    return sign | (uint16_t)nearbyintf(absolute * 16777216.0f);
+  }
+
+  // Round to nearest even on the 13 dropped mantissa bits
+  uint32_t magnitude = bits & 0x7fffffff;
+  uint32_t rounded   = magnitude + 0xfff + ((magnitude >> 13) & 1);
+  return sign | (uint16_t)((rounded >> 13) - (112 << 10));
+}
+
+//==--- Arithmetic ---------------------------------------------------------== //
+
+struct AddOp {
+  template <class T> static T apply(T a, T b) { return a + b; }
+};
+
+struct SubOp {
+  template <class T> static T apply(T a, T b) { return a - b; }
+};
+
+struct MulOp {
+  template <class T> static T apply(T a, T b) { return a * b; }
+};
+
+struct DivOp {
+  template <class T> static T apply(T a, T b) {
+    // Division by zero yields all ones, as on the device, and the one
+    // overflowing signed quotient wraps instead of trapping
+    if(b == 0) {
+      return (T)~(T)0;
+    }
+    if(std::numeric_limits<T>::is_signed && b == (T)-1) {
+      return (T)(0 - (uint64_t)a);
+    }
+    return a / b;
+  }
+};
+
+template <> inline float DivOp::apply<float>(float a, float b) {
+  return a / b;
+}
+
+template <> inline double DivOp::apply<double>(double a, double b) {
+  return a / b;
+}
+
+struct RemOp {
+  template <class T> static T apply(T a, T b) {
+    if(b == 0) {
+      return a;
+    }
+    if(std::numeric_limits<T>::is_signed && b == (T)-1) {
+      return 0;
+    }
+    return a % b;
+  }
+};
+
+struct MinOp {
+  template <class T> static T apply(T a, T b) { return b < a ? b : a; }
+};
+
+struct MaxOp {
+  template <class T> static T apply(T a, T b) { return a < b ? b : a; }
+};
+
+template <> inline float MinOp::apply<float>(float a, float b) {
+  return fminf(a, b);
+}
+
+template <> inline double MinOp::apply<double>(double a, double b) {
+  return fmin(a, b);
+}
+
+template <> inline float MaxOp::apply<float>(float a, float b) {
+  return fmaxf(a, b);
+}
+
+template <> inline double MaxOp::apply<double>(double a, double b) {
+  return fmax(a, b);
+}
+
+struct AndOp {
+  template <class T> static T apply(T a, T b) { return a & b; }
+};
+
+struct OrOp {
+  template <class T> static T apply(T a, T b) { return a | b; }
+};
+
+struct XorOp {
+  template <class T> static T apply(T a, T b) { return a ^ b; }
+};
+
+struct CopySignOp {
+  template <class T> static T apply(T a, T b) {
+    return (T)copysign((double)b, (double)a);
+  }
+};
+
+struct NegOp {
+  template <class T> static T apply(T a) { return (T)(0 - a); }
+};
+
+template <> inline float NegOp::apply<float>(float a) {
+  return -a;
+}
+
+template <> inline double NegOp::apply<double>(double a) {
+  return -a;
+}
+
+struct AbsOp {
+  template <class T> static T apply(T a) { return a < 0 ? (T)(0 - a) : a; }
+};
+
+template <> inline float AbsOp::apply<float>(float a) {
+  return fabsf(a);
+}
+
+template <> inline double AbsOp::apply<double>(double a) {
+  return fabs(a);
+}
+
+struct SqrtOp {
+  template <class T> static T apply(T a) { return (T)sqrt((double)a); }
+};
+
+template <> inline float SqrtOp::apply<float>(float a) {
+  return sqrtf(a);
+}
+
+struct RsqrtOp {
+  template <class T> static T apply(T a) { return (T)(1.0 / sqrt((double)a)); }
+};
+
+struct RcpOp {
+  template <class T> static T apply(T a) { return (T)1 / a; }
+};
+
+struct SinOp {
+  template <class T> static T apply(T a) { return (T)sin((double)a); }
+};
+
+struct CosOp {
+  template <class T> static T apply(T a) { return (T)cos((double)a); }
+};
+
+struct Lg2Op {
+  template <class T> static T apply(T a) { return (T)log2((double)a); }
+};
+
+struct Ex2Op {
+  template <class T> static T apply(T a) { return (T)exp2((double)a); }
+};
+
+struct FmaOp {
+  template <class T> static T apply(T a, T b, T c) { return a * b + c; }
+};
+
+template <> inline float FmaOp::apply<float>(float a, float b, float c) {
+  return fmaf(a, b, c);
+}
+
+template <> inline double FmaOp::apply<double>(double a, double b, double c) {
+  return fma(a, b, c);
+}
+
+template <class T, class Op>
+void unaryLoop(uint64_t* d, const uint64_t* a, uint32_t mask) {
+  for(uint32_t m = mask; m != 0;) {
+    unsigned lane = nextLane(m);
+    d[lane] = bitsOf<T>(Op::apply(as<T>(a[lane])));
+  }
+}
+
+template <class T, class Op>
+void binaryLoop(uint64_t* d, const uint64_t* a, const uint64_t* b,
+                uint32_t mask) {
+  if(mask == ~0u) {
+    for(unsigned lane = 0; lane < kWarpSize; ++lane) {
+      d[lane] = bitsOf<T>(Op::apply(as<T>(a[lane]), as<T>(b[lane])));
+    }
+    return;
+  }
+  for(uint32_t m = mask; m != 0;) {
+    unsigned lane = nextLane(m);
+    d[lane] = bitsOf<T>(Op::apply(as<T>(a[lane]), as<T>(b[lane])));
+  }
+}
+
+template <class T, class Op>
+void ternaryLoop(uint64_t* d, const uint64_t* a, const uint64_t* b,
+                 const uint64_t* c, uint32_t mask) {
+  for(uint32_t m = mask; m != 0;) {
+    unsigned lane = nextLane(m);
+    d[lane] = bitsOf<T>(Op::apply(as<T>(a[lane]), as<T>(b[lane]),
+                                  as<T>(c[lane])));
+  }
+}
+
+/// Integer operations whose result does not depend on signedness, and
+/// floating-point operations.
+template <class Op>
+bool binaryBits(unsigned type, uint64_t* d, const uint64_t* a,
+                const uint64_t* b, uint32_t mask) {
+  switch(type) {
+  case TYPE_B64:
+  case TYPE_U64:
+  case TYPE_S64: binaryLoop<uint64_t, Op>(d, a, b, mask); return true;
+  case TYPE_B32:
+  case TYPE_U32:
+  case TYPE_S32: binaryLoop<uint32_t, Op>(d, a, b, mask); return true;
+  case TYPE_B16:
+  case TYPE_U16:
+  case TYPE_S16: binaryLoop<uint16_t, Op>(d, a, b, mask); return true;
+  case TYPE_F32: binaryLoop<float, Op>(d, a, b, mask);    return true;
+  case TYPE_F64: binaryLoop<double, Op>(d, a, b, mask);   return true;
+  default:       return false;
+  }
+}
+
+/// Bitwise operations, including those on predicates.
+template <class Op>
+bool binaryLogic(unsigned type, uint64_t* d, const uint64_t* a,
+                 const uint64_t* b, uint32_t mask) {
+  switch(type) {
+  case TYPE_PRED:
+  case TYPE_B64:
+  case TYPE_U64:
+  case TYPE_S64: binaryLoop<uint64_t, Op>(d, a, b, mask); return true;
+  case TYPE_B32:
+  case TYPE_U32:
+  case TYPE_S32: binaryLoop<uint32_t, Op>(d, a, b, mask); return true;
+  case TYPE_B16:
+  case TYPE_U16:
+  case TYPE_S16: binaryLoop<uint16_t, Op>(d, a, b, mask); return true;
+  default:       return false;
+  }
+}
+
+/// Integer operations whose result depends on signedness.
+template <class Op>
+bool binaryInt(unsigned type, uint64_t* d, const uint64_t* a,
+               const uint64_t* b, uint32_t mask) {
+  switch(type) {
+  case TYPE_U16: binaryLoop<uint16_t, Op>(d, a, b, mask); return true;
+  case TYPE_S16: binaryLoop<int16_t, Op>(d, a, b, mask);  return true;
+  case TYPE_U32: binaryLoop<uint32_t, Op>(d, a, b, mask); return true;
+  case TYPE_S32: binaryLoop<int32_t, Op>(d, a, b, mask);  return true;
+  case TYPE_U64: binaryLoop<uint64_t, Op>(d, a, b, mask); return true;
+  case TYPE_S64: binaryLoop<int64_t, Op>(d, a, b, mask);  return true;
+  default:       return false;
+  }
+}
+
+/// Operations whose result depends on signedness.
+template <class Op>
+bool binarySigned(unsigned type, uint64_t* d, const uint64_t* a,
+                  const uint64_t* b, uint32_t mask) {
+  switch(type) {
+  case TYPE_U16: binaryLoop<uint16_t, Op>(d, a, b, mask); return true;
+  case TYPE_S16: binaryLoop<int16_t, Op>(d, a, b, mask);  return true;
+  case TYPE_U32: binaryLoop<uint32_t, Op>(d, a, b, mask); return true;
+  case TYPE_S32: binaryLoop<int32_t, Op>(d, a, b, mask);  return true;
+  case TYPE_U64: binaryLoop<uint64_t, Op>(d, a, b, mask); return true;
+  case TYPE_S64: binaryLoop<int64_t, Op>(d, a, b, mask);  return true;
+  case TYPE_F32: binaryLoop<float, Op>(d, a, b, mask);    return true;
+  case TYPE_F64: binaryLoop<double, Op>(d, a, b, mask);   return true;
+  default:       return false;
+  }
+}
+
+template <class Op>
+bool unarySigned(unsigned type, uint64_t* d, const uint64_t* a,
+                 uint32_t mask) {
+  switch(type) {
+  case TYPE_B16:
+  case TYPE_U16: unaryLoop<uint16_t, Op>(d, a, mask); return true;
+  case TYPE_S16: unaryLoop<int16_t, Op>(d, a, mask);  return true;
+  case TYPE_B32:
+  case TYPE_U32: unaryLoop<uint32_t, Op>(d, a, mask); return true;
+  case TYPE_S32: unaryLoop<int32_t, Op>(d, a, mask);  return true;
+  case TYPE_B64:
+  case TYPE_U64: unaryLoop<uint64_t, Op>(d, a, mask); return true;
+  case TYPE_S64: unaryLoop<int64_t, Op>(d, a, mask);  return true;
+  case TYPE_F32: unaryLoop<float, Op>(d, a, mask);    return true;
+  case TYPE_F64: unaryLoop<double, Op>(d, a, mask);   return true;
+  default:       return false;
+  }
+}
+
+template <class Op>
+bool unaryFloat(unsigned type, uint64_t* d, const uint64_t* a,
+                uint32_t mask) {
+  switch(type) {
+  case TYPE_F32: unaryLoop<float, Op>(d, a, mask);  return true;
+  case TYPE_F64: unaryLoop<double, Op>(d, a, mask); return true;
+  default:       return false;
+  }
+}
+
+template <class T>
+bool compare(unsigned op, T a, T b) {
+  bool unordered = a != a || b != b;
+
+  switch(op) {
+  case CMP_EQ:  return !unordered && a == b;
+  case CMP_NE:  return !unordered && a != b;
+  case CMP_LT:
+  case CMP_LO:  return !unordered && a < b;
+  case CMP_LE:
+  case CMP_LS:  return !unordered && a <= b;
+  case CMP_GT:
+  case CMP_HI:  return !unordered && a > b;
+  case CMP_GE:
+  case CMP_HS:  return !unordered && a >= b;
+  case CMP_EQU: return unordered || a == b;
+  case CMP_NEU: return unordered || a != b;
+  case CMP_LTU: return unordered || a < b;
+  case CMP_LEU: return unordered || a <= b;
+  case CMP_GTU: return unordered || a > b;
+  case CMP_GEU: return unordered || a >= b;
+  case CMP_NUM: return !unordered;
+  case CMP_NAN: return unordered;
+  default:      return false;
+  }
+}
+
+template <class T>
+void setpLoop(const ExecInstruction& in, uint64_t* regs, uint32_t mask) {
+  uint64_t*       p = regs + in.r[0] * kWarpSize;
+  uint64_t*       q = regs + in.r[1] * kWarpSize;
+  const uint64_t* a = regs + in.r[2] * kWarpSize;
+  const uint64_t* b = regs + in.r[3] * kWarpSize;
+  const uint64_t* c = regs + in.r[4] * kWarpSize;
+  bool negate = (in.flags & FLAG_NEG_SOURCE) != 0;
+
+  for(uint32_t m = mask; m != 0;) {
+    unsigned lane   = nextLane(m);
+    bool     result = compare<T>(in.mode, as<T>(a[lane]), as<T>(b[lane]));
+    bool     other  = !result;
+
+    if(in.boolOp != BOOL_NONE) {
+      bool input = (c[lane] != 0) != negate;
+      switch(in.boolOp) {
+      case BOOL_AND: result = result && input; other = other && input; break;
+      case BOOL_OR:  result = result || input; other = other || input; break;
+      default:       result = result != input; other = other != input; break;
+      }
+    }
+
+    p[lane] = result;
+    q[lane] = other;
+  }
+}
+
+template <class T>
+void selpLoop(const ExecInstruction& in, uint64_t* regs, uint32_t mask) {
+  uint64_t*       d = regs + in.r[0] * kWarpSize;
+  const uint64_t* a = regs + in.r[1] * kWarpSize;
+  const uint64_t* b = regs + in.r[2] * kWarpSize;
+  const uint64_t* c = regs + in.r[3] * kWarpSize;
+
+  for(uint32_t m = mask; m != 0;) {
+    unsigned lane = nextLane(m);
+    d[lane] = c[lane] != 0 ? a[lane] : b[lane];
+  }
+}
+
+/// Multiplication variants of mul and mad on integers of type T, whose
+/// double-width type is W.
+template <class T, class W>
+void mulLoop(const ExecInstruction& in, uint64_t* regs, bool add,
+             uint32_t mask) {
+  uint64_t*       d = regs + in.r[0] * kWarpSize;
+  const uint64_t* a = regs + in.r[1] * kWarpSize;
+  const uint64_t* b = regs + in.r[2] * kWarpSize;
+  const uint64_t* c = regs + in.r[3] * kWarpSize;
+  unsigned        bits = sizeof(T) * 8;
+
+  for(uint32_t m = mask; m != 0;) {
+    unsigned lane    = nextLane(m);
+    W        product = (W)as<T>(a[lane]) * (W)as<T>(b[lane]);
+
+    switch(in.mode) {
+    case MUL_WIDE: {
+      W addend = add ? (W)(std::numeric_limits<T>::is_signed
+                           ? (W)(int64_t)c[lane] : (W)c[lane]) : 0;
+      d[lane] = extend((uint64_t)(product + addend), sizeof(W), false);
+      break;
+    }
+    case MUL_HI:
+      d[lane] = bitsOf<T>((T)((T)(product >> bits) +
+                              (add ? as<T>(c[lane]) : 0)));
+      break;
+    default:
+      d[lane] = bitsOf<T>((T)((T)product + (add ? as<T>(c[lane]) : 0)));
+      break;
+    }
+  }
+}
+
+template <class T>
+void mul24Loop(const ExecInstruction& in, uint64_t* regs, bool add,
+               uint32_t mask) {
+  uint64_t*       d = regs + in.r[0] * kWarpSize;
+  const uint64_t* a = regs + in.r[1] * kWarpSize;
+  const uint64_t* b = regs + in.r[2] * kWarpSize;
+  const uint64_t* c = regs + in.r[3] * kWarpSize;
+  bool            isSigned = std::numeric_limits<T>::is_signed;
+
+  for(uint32_t m = mask; m != 0;) {
+    unsigned lane = nextLane(m);
+    int64_t  x = (int64_t)extend(a[lane] & 0xffffff, 3, isSigned);
+    int64_t  y = (int64_t)extend(b[lane] & 0xffffff, 3, isSigned);
+    uint64_t product = (uint64_t)(x * y);
+    uint32_t result  = in.mode == MUL_HI ? (uint32_t)(product >> 16)
+      : (uint32_t)product;
+    d[lane] = result + (add ? (uint32_t)c[lane] : 0);
+  }
+}
+
+template <class T>
+void shiftLoop(const ExecInstruction& in, uint64_t* regs, bool left,
+               uint32_t mask) {
+  uint64_t*       d = regs + in.r[0] * kWarpSize;
+  const uint64_t* a = regs + in.r[1] * kWarpSize;
+  const uint64_t* b = regs + in.r[2] * kWarpSize;
+  const unsigned  bits = sizeof(T) * 8;
+
+  for(uint32_t m = mask; m != 0;) {
+    unsigned lane   = nextLane(m);
+    uint32_t amount = (uint32_t)b[lane];
+    T        value  = as<T>(a[lane]);
+
+    if(left) {
+      d[lane] = bitsOf<T>(amount >= bits ? (T)0 : (T)(value << amount));
+    } else if(amount >= bits) {
+      d[lane] = bitsOf<T>(value < 0 ? (T)-1 : (T)0);
+    } else {
+      d[lane] = bitsOf<T>((T)(value >> amount));
+    }
+  }
+}
+
+/// Rounds a real to an integral value as the given cvt rounding mode asks.
+double roundIntegral(double value, unsigned rounding) {
+  switch(rounding) {
+  case ROUND_RNI: return nearbyint(value);
+  case ROUND_RMI: return floor(value);
+  case ROUND_RPI: return ceil(value);
+  default:        return trunc(value);
+  }
+}
+
+/// Converts a value between any two PTX types, following cvt.
+uint64_t convert(const ExecInstruction& in, uint64_t bits) {
+  DataType dst      = (DataType)in.type;
+  DataType src      = (DataType)in.srcType;
+  unsigned dstSize  = getTypeSize(dst);
+  unsigned srcSize  = getTypeSize(src);
+  bool     saturate = (in.flags & FLAG_SAT) != 0;
+
+  if(isFloatType(src)) {
+    double value = src == TYPE_F64 ? as<double>(bits)
+      : src == TYPE_F32 ? (double)as<float>(bits)
+      : (double)halfToFloat((uint16_t)bits);
+
+    if(isFloatType(dst)) {
+      if(in.rounding >= ROUND_RNI) {
+        value = roundIntegral(value, in.rounding);
+      }
+      if(saturate) {
+        value = value != value ? 0.0 : value < 0.0 ? 0.0 :
+          value > 1.0 ? 1.0 : value;
+      }
+      return dst == TYPE_F64 ? bitsOf(value)
+        : dst == TYPE_F32 ? bitsOf((float)value)
+        : floatToHalf((float)value);
+    }
+
+    // Float to integer conversions clamp to the destination range
+    if(value != value) {
+      return 0;
+    }
+    value = roundIntegral(value, in.rounding);
+    if(isSignedType(dst)) {
+      double limit = ldexp(1.0, dstSize * 8 - 1);
+      int64_t result = value >= limit ? (int64_t)(limit - 1.0) :
+        value < -limit ? -(int64_t)(limit - 1.0) - 1 : (int64_t)value;
+      if(dstSize == 8 && value >= limit) {
+        result = std::numeric_limits<int64_t>::max();
+      }
+      return extend((uint64_t)result, dstSize, false);
+    }
+    double limit = ldexp(1.0, dstSize * 8);
+    if(value <= 0.0) {
+      return 0;
+    }
+    if(value >= limit) {
+      return extend(~(uint64_t)0, dstSize, false);
+    }
+    return (uint64_t)value;
+  }
+
+  // Integer source
+  bool     srcSigned = isSignedType(src);
+  uint64_t value     = extend(bits, srcSize, srcSigned);
+
+  if(isFloatType(dst)) {
+    double real = srcSigned ? (double)(int64_t)value : (double)value;
+    if(dst == TYPE_F32) {
+      float single = srcSigned ? (float)(int64_t)value : (float)value;
+      return bitsOf(single);
+    }
+    return dst == TYPE_F64 ? bitsOf(real) : floatToHalf((float)real);
+  }
+
+  if(saturate && dstSize < 8) {
+    if(isSignedType(dst)) {
+      int64_t high = ((int64_t)1 << (dstSize * 8 - 1)) - 1;
+      int64_t low  = -high - 1;
+      int64_t v    = srcSigned ? (int64_t)value
+        : (value > (uint64_t)high ? high : (int64_t)value);
+      value = (uint64_t)(v > high ? high : v < low ? low : v);
+    } else {
+      uint64_t high = ((uint64_t)1 << (dstSize * 8)) - 1;
+      if(srcSigned && (int64_t)value < 0) {
+        value = 0;
+      } else if(value > high) {
+        value = high;
+      }
+    }
+  }
+  return extend(value, dstSize, isSignedType(dst));
+}
+
+template <class T>
+T atomicResult(unsigned op, T old, T b, T c) {
+  switch(op) {
+  case ATOMIC_ADD:  return old + b;
+  case ATOMIC_MIN:  return b < old ? b : old;
+  case ATOMIC_MAX:  return old < b ? b : old;
+  case ATOMIC_EXCH: return b;
+  case ATOMIC_CAS:  return old == b ? c : old;
+  default:          return old;
+  }
+}
+
+template <class T>
+T atomicBits(unsigned op, T old, T b) {
+  switch(op) {
+  case ATOMIC_AND: return old & b;
+  case ATOMIC_OR:  return old | b;
+  case ATOMIC_XOR: return old ^ b;
+  case ATOMIC_INC: return old >= b ? 0 : old + 1;
+  case ATOMIC_DEC: return (old == 0 || old > b) ? b : old - 1;
+  default:         return old;
+  }
+}
+
+/// Computes the new value of an atomic operation on raw bits.
+uint64_t atomicUpdate(const ExecInstruction& in, uint64_t old, uint64_t b,
+                      uint64_t c) {
+  bool bitwise = in.mode == ATOMIC_AND || in.mode == ATOMIC_OR ||
+    in.mode == ATOMIC_XOR || in.mode == ATOMIC_INC || in.mode == ATOMIC_DEC;
+
+  switch(in.type) {
+  case TYPE_S32:
+    if(!bitwise) {
+      return bitsOf(atomicResult<int32_t>(in.mode, as<int32_t>(old),
+                                          as<int32_t>(b), as<int32_t>(c)));
+    }
+    // Fall through
+  case TYPE_B32:
+  case TYPE_U32:
+    return bitwise ? bitsOf(atomicBits<uint32_t>(in.mode, (uint32_t)old,
+                                                 (uint32_t)b))
+      : bitsOf(atomicResult<uint32_t>(in.mode, (uint32_t)old, (uint32_t)b,
+                                      (uint32_t)c));
+  case TYPE_S64:
+    if(!bitwise) {
+      return bitsOf(atomicResult<int64_t>(in.mode, (int64_t)old, (int64_t)b,
+                                          (int64_t)c));
+    }
+    // Fall through
+  case TYPE_B64:
+  case TYPE_U64:
+    return bitwise ? atomicBits<uint64_t>(in.mode, old, b)
+      : atomicResult<uint64_t>(in.mode, old, b, c);
+  case TYPE_F32:
+    return bitsOf(atomicResult<float>(in.mode, as<float>(old), as<float>(b),
+                                      as<float>(c)));
+  case TYPE_F64:
+    return bitsOf(atomicResult<double>(in.mode, as<double>(old),
+                                       as<double>(b), as<double>(c)));
+  default:
+    return old;
+  }
+}
+
+}
+
+//==--- CTA Execution ------------------------------------------------------== //
+
+/**
+ * Executes CTAs of one launch on one worker.  Register files, shared and
+ * local memory are allocated once and reused for every CTA the worker runs.
+ */
+class CTAExecutor {
+public:
+
+  CTAExecutor(const Kernel& kernel, Memory& memory, const unsigned grid[3],
+              const unsigned block[3], const void* params, size_t paramSize,
+              size_t dynamicShared, unsigned worker, unsigned numWorkers);
+
+  bool run(unsigned cta);
+
+  const std::string& getError() const {
+    return error_;
+  }
+
+private:
+
+  struct Warp {
+    uint32_t runnable;
+    uint32_t waiting;
+    bool     divergent;
+    unsigned pc;
+    unsigned lanePC[kWarpSize];
+  };
+
+  uint64_t* getRegisters(unsigned warp) {
+    return &registers_[(size_t)warp * numRegisters_ * kWarpSize];
+  }
+
+  bool runWarp(unsigned index);
+  bool execute(const ExecInstruction& in, uint32_t mask, uint64_t* regs,
+               unsigned warp);
+  bool load(const ExecInstruction& in, uint32_t mask, uint64_t* regs,
+            unsigned warp);
+  template <typename T>
+  bool loadScalar(const ExecInstruction& in, uint32_t mask, uint64_t* regs,
+                  unsigned warp);
+  bool store(const ExecInstruction& in, uint32_t mask, uint64_t* regs,
+             unsigned warp);
+  bool atomic(const ExecInstruction& in, uint32_t mask, uint64_t* regs,
+              unsigned warp);
+  void vote(const ExecInstruction& in, uint32_t mask, uint64_t* regs);
+  void shuffle(const ExecInstruction& in, uint32_t mask, uint64_t* regs);
+  bool cvt(const ExecInstruction& in, uint32_t mask, uint64_t* regs);
+  bool bitField(const ExecInstruction& in, uint32_t mask, uint64_t* regs);
+
+  /**
+   * Returns the host address of a device access, or NULL after reporting a
+   * fault.  Shared accesses and global accesses inside the last allocation
+   * used take the inline path.
+   */
+  unsigned char* translate(const ExecInstruction& in, unsigned space,
+                           uint64_t address, unsigned size, unsigned thread) {
+    if(space == SPACE_SHARED) {
+      if(address + size <= shared_.size()) {
+        return &shared_[address];
+      }
+    } else if(space == SPACE_GLOBAL || space == SPACE_CONST) {
+      uint64_t offset = address - windowStart_[0];
+      if(offset < windowSize_[0] && size <= windowSize_[0] - offset) {
+        return globalBase_ + address;
+      }
+    }
+    return translateSlow(in, space, address, size, thread);
+  }
+
+  unsigned char* translateSlow(const ExecInstruction& in, unsigned space,
+                               uint64_t address, unsigned size,
+                               unsigned thread);
+  bool findGlobal(uint64_t address, unsigned size);
+  bool fault(const ExecInstruction& in, const std::string& message);
+
+  const Kernel&              kernel_;
+  const ExecInstruction*     code_;
+  const Memory&              memory_;
+  unsigned char*             globalBase_;
+  uint64_t                   windowStart_[kNumWindows];
+  size_t                     windowSize_[kNumWindows];
+  unsigned                   grid_[3];
+  unsigned                   block_[3];
+  unsigned                   numThreads_;
+  unsigned                   numWarps_;
+  unsigned                   numRegisters_;
+  std::vector<uint64_t>      registers_;
+  std::vector<Warp>          warps_;
+  std::vector<unsigned char> params_;
+  std::vector<unsigned char> shared_;
+  std::vector<unsigned char> local_;
+  size_t                     localSize_;
+  std::string                error_;
+};
+
+CTAExecutor::CTAExecutor(const Kernel& kernel, Memory& memory,
+                         const unsigned grid[3], const unsigned block[3],
+                         const void* params, size_t paramSize,
+                         size_t dynamicShared, unsigned worker,
+                         unsigned numWorkers)
+: kernel_(kernel), code_(&kernel.code_[0]), memory_(memory),
+  globalBase_(memory.getBase()), numRegisters_(kernel.numRegisters_), localSize_(kernel.getLocalSize()) {
+  for(unsigned i = 0; i < 3; ++i) {
+    grid_[i]  = grid[i];
+    block_[i] = block[i];
+  }
+  for(unsigned i = 0; i < kNumWindows; ++i) {
+    windowStart_[i] = 0;
+    windowSize_[i]  = 0;
+  }
+  numThreads_ = block[0] * block[1] * block[2];
+  numWarps_   = (numThreads_ + kWarpSize - 1) / kWarpSize;
+
+  registers_.resize((size_t)numWarps_ * numRegisters_ * kWarpSize);
+  warps_.resize(numWarps_);
+  params_.assign(static_cast<const unsigned char*>(params),
+                 static_cast<const unsigned char*>(params) + paramSize);
+  shared_.resize(kernel.getSharedSize() + dynamicShared + 16);
+  local_.resize(localSize_ * numThreads_);
+
+  // Registers that do not change between CTAs: constants and the launch
+  // shape
+  for(unsigned w = 0; w < numWarps_; ++w) {
+    uint64_t* regs = getRegisters(w);
+
+    for(size_t i = 0; i < kernel.constants_.size(); ++i) {
+      uint64_t* reg = regs + kernel.constants_[i].first * kWarpSize;
+      for(unsigned lane = 0; lane < kWarpSize; ++lane) {
+        reg[lane] = kernel.constants_[i].second;
+      }
+    }
+
+    for(unsigned lane = 0; lane < kWarpSize; ++lane) {
+      unsigned thread = w * kWarpSize + lane;
+      regs[SREG_TID_X * kWarpSize + lane]    = thread % block[0];
+      regs[SREG_TID_Y * kWarpSize + lane]    = thread / block[0] % block[1];
+      regs[SREG_TID_Z * kWarpSize + lane]    = thread / (block[0] * block[1]);
+      regs[SREG_NTID_X * kWarpSize + lane]   = block[0];
+      regs[SREG_NTID_Y * kWarpSize + lane]   = block[1];
+      regs[SREG_NTID_Z * kWarpSize + lane]   = block[2];
+      regs[SREG_NCTAID_X * kWarpSize + lane] = grid[0];
+      regs[SREG_NCTAID_Y * kWarpSize + lane] = grid[1];
+      regs[SREG_NCTAID_Z * kWarpSize + lane] = grid[2];
+      regs[SREG_LANEID * kWarpSize + lane]   = lane;
+      regs[SREG_WARPID * kWarpSize + lane]   = w;
+      regs[SREG_NWARPID * kWarpSize + lane]  = numWarps_;
+      regs[SREG_SMID * kWarpSize + lane]     = worker;
+      regs[SREG_NSMID * kWarpSize + lane]    = numWorkers;
+      regs[SREG_GRIDID * kWarpSize + lane]   = 0;
+    }
+  }
+}
+
+bool CTAExecutor::fault(const ExecInstruction& in, const std::string& message) {
+  std::ostringstream stream;
+  stream << kernel_.getName() << ", line " << kernel_.lines_[&in - code_]
+         << ": " << message;
+  error_ = stream.str();
+  return false;
+}
+
+unsigned char* CTAExecutor::translateSlow(const ExecInstruction& in,
+                                          unsigned space, uint64_t address,
+                                          unsigned size, unsigned thread) {
+  if(space == SPACE_GENERIC) {
+    if(address - kernel_.sharedWindow_ < kWindowSize) {
+      space    = SPACE_SHARED;
+      address -= kernel_.sharedWindow_;
+    } else if(address - kernel_.localWindow_ < kWindowSize) {
+      space    = SPACE_LOCAL;
+      address -= kernel_.localWindow_;
+    } else {
+      space = SPACE_GLOBAL;
+    }
+  }
+
+  const char* name = NULL;
+  switch(space) {
+  case SPACE_SHARED:
+    if(address + size <= shared_.size()) {
+      return &shared_[address];
+    }
+    name = "shared";
+    break;
+  case SPACE_LOCAL:
+    if(address + size <= localSize_) {
+      return &local_[thread * localSize_ + address];
+    }
+    name = "local";
+    break;
+  case SPACE_PARAM:
+    if(address + size <= params_.size()) {
+      return &params_[address];
+    }
+    name = "param";
+    break;
+  default:
+    if(findGlobal(address, size)) {
+      return globalBase_ + address;
+    }
+    name = "global";
+    break;
+  }
+
+  std::ostringstream message;
+  message << "invalid " << name << " address 0x" << std::hex << address;
+  fault(in, message.str());
+  return NULL;
+}
+
+/**
+ * Checks that [address, address + size) lies inside one global allocation,
+ * and if so moves the allocation to the front of the windows.
+ */
+bool CTAExecutor::findGlobal(uint64_t address, unsigned size) {
+  unsigned hit = 1;
+  while(hit < kNumWindows && address - windowStart_[hit] >= windowSize_[hit]) {
+    ++hit;
+  }
+
+  uint64_t start;
+  size_t   length;
+  if(hit < kNumWindows) {
+    start  = windowStart_[hit];
+    length = windowSize_[hit];
+  } else if(memory_.findAllocation(address, start, length)) {
+    hit = kNumWindows - 1;
+  } else {
+    return false;
+  }
+  if(size > length - (address - start)) {
+    return false;
+  }
+
+  for(; hit > 0; --hit) {
+    windowStart_[hit] = windowStart_[hit - 1];
+    windowSize_[hit]  = windowSize_[hit - 1];
+  }
+  windowStart_[0] = start;
+  windowSize_[0]  = length;
+  return true;
+}
+
+template <typename T>
+bool CTAExecutor::loadScalar(const ExecInstruction& in, uint32_t mask,
+                             uint64_t* regs, unsigned warp) {
+  const unsigned char* base;
+  uint64_t             lower;
+  uint64_t             span;
+  uint64_t*            d       = regs + in.r[0] * kWarpSize;
+  const uint64_t*      address = regs + in.r[1] * kWarpSize;
+
+  if(in.space == SPACE_SHARED) {
+    base  = &shared_[0];
+    lower = 0;
+    span  = shared_.size();
+  } else {
+    base  = globalBase_;
+    lower = windowStart_[0];
+    span  = windowSize_[0];
+  }
+
+  for(uint32_t m = mask; m != 0;) {
+    unsigned             lane   = nextLane(m);
+    uint64_t             where  = address[lane] + in.offset;
+    uint64_t             offset = where - lower;
+    const unsigned char* data   = base + where;
+    T                    value;
+
+    if(offset >= span || sizeof(T) > span - offset) {
+      // Let the general path check the access, then pick up the window it
+      // found
+      data = translate(in, in.space, where, sizeof(T),
+                       warp * kWarpSize + lane);
+      if(data == NULL) {
+        return false;
+      }
+      if(in.space != SPACE_SHARED) {
+        lower = windowStart_[0];
+        span  = windowSize_[0];
+      }
+    }
+    memcpy(&value, data, sizeof(T));
+    d[lane] = (uint64_t)(int64_t)value;
+  }
+  return true;
+}
+
+bool CTAExecutor::load(const ExecInstruction& in, uint32_t mask,
+                       uint64_t* regs, unsigned warp) {
+  if(in.vector == 1 && (in.space == SPACE_SHARED ||
+                        in.space == SPACE_GLOBAL ||
+                        in.space == SPACE_CONST)) {
+    switch(in.type) {
+    case TYPE_S8:  return loadScalar<int8_t>(in, mask, regs, warp);
+    case TYPE_S16: return loadScalar<int16_t>(in, mask, regs, warp);
+    case TYPE_S32: return loadScalar<int32_t>(in, mask, regs, warp);
+    case TYPE_B8:
+    case TYPE_U8:  return loadScalar<uint8_t>(in, mask, regs, warp);
+    case TYPE_B16:
+    case TYPE_U16:
+    case TYPE_F16: return loadScalar<uint16_t>(in, mask, regs, warp);
+    case TYPE_B32:
+    case TYPE_U32:
+    case TYPE_F32: return loadScalar<uint32_t>(in, mask, regs, warp);
+    case TYPE_B64:
+    case TYPE_U64:
+    case TYPE_S64:
+    case TYPE_F64: return loadScalar<uint64_t>(in, mask, regs, warp);
+    default:       break;
+    }
+  }
+
+  unsigned        size     = getTypeSize((DataType)in.type);
+  bool            isSigned = isSignedType((DataType)in.type);
+  const uint64_t* address  = regs + in.r[in.vector] * kWarpSize;
+
+  for(uint32_t m = mask; m != 0;) {
+    unsigned             lane = nextLane(m);
+    const unsigned char* data = translate(in, in.space,
+                                          address[lane] + in.offset,
+                                          size * in.vector,
+                                          warp * kWarpSize + lane);
+    if(data == NULL) {
+      return false;
+    }
+    for(unsigned i = 0; i < in.vector; ++i) {
+      regs[in.r[i] * kWarpSize + lane] = loadValue(data + i * size, size,
+                                                   isSigned);
+    }
+  }
+  return true;
+}
+
+bool CTAExecutor::store(const ExecInstruction& in, uint32_t mask,
+                        uint64_t* regs, unsigned warp) {
+  unsigned        size    = getTypeSize((DataType)in.type);
+  const uint64_t* address = regs + in.r[in.vector] * kWarpSize;
+
+  for(uint32_t m = mask; m != 0;) {
+    unsigned       lane = nextLane(m);
+    unsigned char* data = translate(in, in.space, address[lane] + in.offset,
+                                    size * in.vector,
+                                    warp * kWarpSize + lane);
+    if(data == NULL) {
+      return false;
+    }
+    for(unsigned i = 0; i < in.vector; ++i) {
+      storeValue(data + i * size, size, regs[in.r[i] * kWarpSize + lane]);
+    }
+  }
+  return true;
+}
+
+bool CTAExecutor::atomic(const ExecInstruction& in, uint32_t mask,
+                         uint64_t* regs, unsigned warp) {
+  // atom d, [a], b[, c]; red [a], b
+  bool            isReduction = in.opcode == OP_RED;
+  unsigned        size        = getTypeSize((DataType)in.type);
+  const uint64_t* address     = regs + in.r[isReduction ? 0 : 1] * kWarpSize;
+  const uint64_t* b           = regs + in.r[isReduction ? 1 : 2] * kWarpSize;
+  const uint64_t* c           = regs + in.r[isReduction ? 1 : 3] * kWarpSize;
+  uint64_t*       d           = regs + in.r[0] * kWarpSize;
+
+  if(size != 4 && size != 8) {
+    return fault(in, "unsupported atomic type");
+  }
+
+  // Lanes update in order; other workers may be updating global memory at
+  // the same time, so every update is a compare-and-swap
+  for(uint32_t m = mask; m != 0;) {
+    unsigned       lane = nextLane(m);
+    unsigned char* data = translate(in, in.space, address[lane] + in.offset,
+                                    size, warp * kWarpSize + lane);
+    if(data == NULL) {
+      return false;
+    }
+
+    uint64_t old;
+    if(size == 4) {
+      uint32_t* word = reinterpret_cast<uint32_t*>(data);
+      uint32_t  expected;
+      do {
+        expected = *word;
+        old      = expected;
+      } while(!__sync_bool_compare_and_swap(word, expected,
+                (uint32_t)atomicUpdate(in, old, b[lane], c[lane])));
+    } else {
+      uint64_t* word = reinterpret_cast<uint64_t*>(data);
+      do {
+        old = *word;
+      } while(!__sync_bool_compare_and_swap(word, old,
+                atomicUpdate(in, old, b[lane], c[lane])));
+    }
+
+    if(!isReduction) {
+      d[lane] = old;
+    }
+  }
+  return true;
+}
+
+void CTAExecutor::vote(const ExecInstruction& in, uint32_t mask,
+                       uint64_t* regs) {
+  uint64_t*       d      = regs + in.r[0] * kWarpSize;
+  const uint64_t* p      = regs + in.r[1] * kWarpSize;
+  bool            negate = (in.flags & FLAG_NEG_SOURCE) != 0;
+  uint32_t        ballot = 0;
+
+  for(uint32_t m = mask; m != 0;) {
+    unsigned lane = nextLane(m);
+    if((p[lane] != 0) != negate) {
+      ballot |= 1u << lane;
+    }
+  }
+
+  uint64_t result;
+  switch(in.mode) {
+  case VOTE_ALL: result = ballot == mask;                break;
+  case VOTE_ANY: result = ballot != 0;                   break;
+  case VOTE_UNI: result = ballot == 0 || ballot == mask; break;
+  default:       result = ballot;                        break;
+  }
+
+  for(uint32_t m = mask; m != 0;) {
+    d[nextLane(m)] = result;
+  }
+}
+
+void CTAExecutor::shuffle(const ExecInstruction& in, uint32_t mask,
+                          uint64_t* regs) {
+  // shfl d|p, a, b, c
+  uint64_t*       d = regs + in.r[0] * kWarpSize;
+  uint64_t*       p = regs + in.r[1] * kWarpSize;
+  const uint64_t* a = regs + in.r[2] * kWarpSize;
+  const uint64_t* b = regs + in.r[3] * kWarpSize;
+  const uint64_t* c = regs + in.r[4] * kWarpSize;
+  uint64_t        source[kWarpSize];
+
+  memcpy(source, a, sizeof(source));
+
+  for(uint32_t m = mask; m != 0;) {
+    unsigned lane    = nextLane(m);
+    uint32_t bval    = (uint32_t)b[lane] & 0x1f;
+    uint32_t cval    = (uint32_t)c[lane];
+    uint32_t segmask = (cval >> 8) & 0x1f;
+    uint32_t maxLane = (lane & segmask) | (cval & 0x1f & ~segmask);
+    uint32_t minLane = lane & segmask;
+    int      j;
+    bool     valid;
+
+    switch(in.mode) {
+    case SHFL_UP:
+      j     = (int)lane - (int)bval;
+      valid = j >= (int)maxLane;
+      break;
+    case SHFL_DOWN:
+      j     = (int)(lane + bval);
+      valid = j <= (int)maxLane;
+      break;
+    case SHFL_BFLY:
+      j     = (int)(lane ^ bval);
+      valid = j <= (int)maxLane;
+      break;
+    default:
+      j     = (int)(minLane | (bval & ~segmask));
+      valid = j <= (int)maxLane;
+      break;
+    }
+
+    d[lane] = source[valid ? j : lane];
+    p[lane] = valid;
+  }
+}
+
+bool CTAExecutor::cvt(const ExecInstruction& in, uint32_t mask,
+                      uint64_t* regs) {
+  uint64_t*       d = regs + in.r[0] * kWarpSize;
+  const uint64_t* a = regs + in.r[1] * kWarpSize;
+
+  if(getTypeSize((DataType)in.type) == 0 ||
+     getTypeSize((DataType)in.srcType) == 0) {
+    return fault(in, "unsupported conversion");
+  }
+
+  for(uint32_t m = mask; m != 0;) {
+    unsigned lane = nextLane(m);
+    d[lane] = convert(in, a[lane]);
+  }
+  return true;
+}
+
+bool CTAExecutor::bitField(const ExecInstruction& in, uint32_t mask,
+                           uint64_t* regs) {
+  uint64_t*       d    = regs + in.r[0] * kWarpSize;
+  const uint64_t* a    = regs + in.r[1] * kWarpSize;
+  const uint64_t* b    = regs + in.r[2] * kWarpSize;
+  const uint64_t* c    = regs + in.r[3] * kWarpSize;
+  const uint64_t* e    = regs + in.r[4] * kWarpSize;
+  unsigned        bits = getTypeSize((DataType)in.type) * 8;
+
+  for(uint32_t m = mask; m != 0;) {
+    unsigned lane = nextLane(m);
+
+    switch(in.opcode) {
+    case OP_CLZ:
+      d[lane] = a[lane] == 0 ? bits : (bits == 64 ? __builtin_clzll(a[lane])
+        : __builtin_clz((uint32_t)a[lane]));
+      break;
+    case OP_POPC:
+      d[lane] = __builtin_popcountll(extend(a[lane], bits / 8, false));
+      break;
+    case OP_BREV: {
+      uint64_t value  = a[lane];
+      uint64_t result = 0;
+      for(unsigned i = 0; i < bits; ++i) {
+        result = (result << 1) | ((value >> i) & 1);
+      }
+      d[lane] = result;
+      break;
+    }
+    case OP_BFE: {
+      // bfe d, a, pos, len
+      unsigned pos = (unsigned)b[lane] & 0xff;
+      unsigned len = (unsigned)c[lane] & 0xff;
+      uint64_t value = extend(a[lane], bits / 8, isSignedType(
+                                (DataType)in.type));
+      uint64_t field = pos >= 64 ? (isSignedType((DataType)in.type) &&
+                                    (int64_t)value < 0 ? ~(uint64_t)0 : 0)
+        : (uint64_t)(isSignedType((DataType)in.type)
+                     ? (uint64_t)((int64_t)value >> pos) : value >> pos);
+      if(len == 0) {
+        field = 0;
+      } else if(len < bits) {
+        field = extend(field & (((uint64_t)1 << len) - 1), 8, false);
+        if(isSignedType((DataType)in.type) && (field >> (len - 1)) & 1) {
+          field |= ~(uint64_t)0 << len;
+        }
+      }
+      d[lane] = extend(field, bits / 8, false);
+      break;
+    }
+    case OP_BFI: {
+      // bfi d, a, b, pos, len: insert a into b
+      unsigned pos = (unsigned)c[lane] & 0xff;
+      unsigned len = (unsigned)e[lane] & 0xff;
+      uint64_t result = b[lane];
+      for(unsigned i = 0; i < len && pos + i < bits; ++i) {
+        uint64_t bit = (uint64_t)1 << (pos + i);
+        result = ((a[lane] >> i) & 1) ? (result | bit) : (result & ~bit);
+      }
+      d[lane] = extend(result, bits / 8, false);
+      break;
+    }
+    case OP_PRMT: {
+      // Default byte permute: select bytes of {b, a} by the nibbles of c
+      uint64_t bytes    = (a[lane] & 0xffffffffu) | (b[lane] << 32);
+      uint32_t selector = (uint32_t)c[lane];
+      uint32_t result   = 0;
+      for(unsigned i = 0; i < 4; ++i) {
+        unsigned nibble = (selector >> (4 * i)) & 0xf;
+        uint32_t byte   = (uint32_t)(bytes >> (8 * (nibble & 7))) & 0xff;
+        if(nibble & 8) {
+          byte = (byte & 0x80) ? 0xff : 0;
+        }
+        result |= byte << (8 * i);
+      }
+      d[lane] = result;
+      break;
+    }
+    default:
+      return fault(in, "unsupported bit operation");
+    }
+  }
+  return true;
+}
+
+bool CTAExecutor::execute(const ExecInstruction& in, uint32_t mask,
+                          uint64_t* regs, unsigned warp) {
+  uint64_t*       d    = regs + in.r[0] * kWarpSize;
+  const uint64_t* a    = regs + in.r[1] * kWarpSize;
+  const uint64_t* b    = regs + in.r[2] * kWarpSize;
+  const uint64_t* c    = regs + in.r[3] * kWarpSize;
+  unsigned        type = in.type;
+  bool            ok   = true;
+
+  switch(in.opcode) {
+  case OP_MOV: {
+    unsigned size = getTypeSize((DataType)type);
+    for(uint32_t m = mask; m != 0;) {
+      unsigned lane = nextLane(m);
+      d[lane] = extend(a[lane], size, false);
+    }
+    break;
+  }
+
+  case OP_PACK:
+  case OP_UNPACK: {
+    unsigned bits   = getTypeSize((DataType)type) * 8 / in.vector;
+    uint64_t low    = bits >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << bits) - 1;
+    for(uint32_t m = mask; m != 0;) {
+      unsigned lane = nextLane(m);
+      if(in.opcode == OP_PACK) {
+        uint64_t value = 0;
+        for(unsigned i = 0; i < in.vector; ++i) {
+          value |= (regs[in.r[1 + i] * kWarpSize + lane] & low) << (i * bits);
+        }
+        d[lane] = value;
+      } else {
+        uint64_t value = regs[in.r[in.vector] * kWarpSize + lane];
+        for(unsigned i = 0; i < in.vector; ++i) {
+          regs[in.r[i] * kWarpSize + lane] = (value >> (i * bits)) & low;
+        }
+      }
+    }
+    break;
+  }
+
+  case OP_LD:
+    return load(in, mask, regs, warp);
+
+  case OP_ST:
+    return store(in, mask, regs, warp);
+
+  case OP_CVTA: {
+    uint64_t window = in.space == SPACE_SHARED ? kernel_.sharedWindow_
+      : in.space == SPACE_LOCAL ? kernel_.localWindow_ : 0;
+    unsigned size = getTypeSize((DataType)type);
+    for(uint32_t m = mask; m != 0;) {
+      unsigned lane = nextLane(m);
+      uint64_t value = (in.flags & FLAG_TO) ? a[lane] - window
+        : a[lane] + window;
+      d[lane] = extend(value, size, false);
+    }
+    break;
+  }
+
+  case OP_CVT:
+    return cvt(in, mask, regs);
+
+  case OP_ADD:
+  case OP_SUB:
+    if(in.flags & FLAG_SAT) {
+      // Saturating s32, or f32/f64 clamped to [0, 1]
+      for(uint32_t m = mask; m != 0;) {
+        unsigned lane = nextLane(m);
+        if(isFloatType((DataType)type)) {
+          double x = type == TYPE_F64 ? as<double>(a[lane]) : as<float>(a[lane]);
+          double y = type == TYPE_F64 ? as<double>(b[lane]) : as<float>(b[lane]);
+          double r = in.opcode == OP_ADD ? x + y : x - y;
+          r = r != r ? 0.0 : r < 0.0 ? 0.0 : r > 1.0 ? 1.0 : r;
+          d[lane] = type == TYPE_F64 ? bitsOf(r) : bitsOf((float)r);
+        } else {
+          int64_t r = in.opcode == OP_ADD
+            ? (int64_t)as<int32_t>(a[lane]) + as<int32_t>(b[lane])
+            : (int64_t)as<int32_t>(a[lane]) - as<int32_t>(b[lane]);
+          r = r > 0x7fffffff ? 0x7fffffff : r < -0x7fffffffll - 1
+            ? -0x7fffffffll - 1 : r;
+          d[lane] = bitsOf((int32_t)r);
+        }
+      }
+    } else if(in.opcode == OP_ADD) {
+      ok = binaryBits<AddOp>(type, d, a, b, mask);
+    } else {
+      ok = binaryBits<SubOp>(type, d, a, b, mask);
+    }
+    break;
+
+  case OP_MUL:
+  case OP_MAD: {
+    bool add = in.opcode == OP_MAD;
+    if(isFloatType((DataType)type)) {
+      // mad.f32 is a fused multiply-add from sm_20 on
+      if(add && type == TYPE_F32) {
+        ternaryLoop<float, FmaOp>(d, a, b, c, mask);
+      } else if(add) {
+        ternaryLoop<double, FmaOp>(d, a, b, c, mask);
+      } else {
+        ok = binaryBits<MulOp>(type, d, a, b, mask);
+      }
+      break;
+    }
+    switch(type) {
+    case TYPE_U16: mulLoop<uint16_t, uint32_t>(in, regs, add, mask); break;
+    case TYPE_S16: mulLoop<int16_t, int32_t>(in, regs, add, mask);   break;
+    case TYPE_U32: mulLoop<uint32_t, uint64_t>(in, regs, add, mask); break;
+    case TYPE_S32: mulLoop<int32_t, int64_t>(in, regs, add, mask);   break;
+    case TYPE_U64:
+      mulLoop<uint64_t, unsigned __int128>(in, regs, add, mask);
+      break;
+    case TYPE_S64: mulLoop<int64_t, __int128>(in, regs, add, mask);  break;
+    default:       ok = false;                                       break;
+    }
+    break;
+  }
+
+  case OP_MUL24:
+  case OP_MAD24:
+    if(type == TYPE_S32) {
+      mul24Loop<int32_t>(in, regs, in.opcode == OP_MAD24, mask);
+    } else {
+      mul24Loop<uint32_t>(in, regs, in.opcode == OP_MAD24, mask);
+    }
+    break;
+
+  case OP_FMA:
+    if(type == TYPE_F32) {
+      ternaryLoop<float, FmaOp>(d, a, b, c, mask);
+    } else if(type == TYPE_F64) {
+      ternaryLoop<double, FmaOp>(d, a, b, c, mask);
+    } else {
+      ok = false;
+    }
+    break;
+
+  case OP_DIV:      ok = binarySigned<DivOp>(type, d, a, b, mask);      break;
+  case OP_MIN:      ok = binarySigned<MinOp>(type, d, a, b, mask);      break;
+  case OP_MAX:      ok = binarySigned<MaxOp>(type, d, a, b, mask);      break;
+  case OP_AND:      ok = binaryLogic<AndOp>(type, d, a, b, mask);       break;
+  case OP_OR:       ok = binaryLogic<OrOp>(type, d, a, b, mask);        break;
+  case OP_XOR:      ok = binaryLogic<XorOp>(type, d, a, b, mask);       break;
+  case OP_ABS:      ok = unarySigned<AbsOp>(type, d, a, mask);          break;
+  case OP_NEG:      ok = unarySigned<NegOp>(type, d, a, mask);          break;
+  case OP_SQRT:     ok = unaryFloat<SqrtOp>(type, d, a, mask);          break;
+  case OP_RSQRT:    ok = unaryFloat<RsqrtOp>(type, d, a, mask);         break;
+  case OP_RCP:      ok = unaryFloat<RcpOp>(type, d, a, mask);           break;
+  case OP_SIN:      ok = unaryFloat<SinOp>(type, d, a, mask);           break;
+  case OP_COS:      ok = unaryFloat<CosOp>(type, d, a, mask);           break;
+  case OP_LG2:      ok = unaryFloat<Lg2Op>(type, d, a, mask);           break;
+  case OP_EX2:      ok = unaryFloat<Ex2Op>(type, d, a, mask);           break;
+
+  case OP_REM:      ok = binaryInt<RemOp>(type, d, a, b, mask);         break;
+
+  case OP_COPYSIGN:
+    if(type == TYPE_F32) {
+      binaryLoop<float, CopySignOp>(d, a, b, mask);
+    } else {
+      binaryLoop<double, CopySignOp>(d, a, b, mask);
+    }
+    break;
+
+  case OP_NOT:
+  case OP_CNOT:
+    if(type == TYPE_PRED || in.opcode == OP_CNOT) {
+      for(uint32_t m = mask; m != 0;) {
+        unsigned lane = nextLane(m);
+        d[lane] = extend(a[lane], getTypeSize((DataType)type), false) == 0;
+      }
+    } else {
+      unsigned size = getTypeSize((DataType)type);
+      for(uint32_t m = mask; m != 0;) {
+        unsigned lane = nextLane(m);
+        d[lane] = extend(~a[lane], size, false);
+      }
+    }
+    break;
+
+  case OP_SHL:
+  case OP_SHR: {
+    bool left = in.opcode == OP_SHL;
+    switch(type) {
+    case TYPE_S16: shiftLoop<int16_t>(in, regs, left, mask);  break;
+    case TYPE_S32: shiftLoop<int32_t>(in, regs, left, mask);  break;
+    case TYPE_S64: shiftLoop<int64_t>(in, regs, left, mask);  break;
+    case TYPE_B16:
+    case TYPE_U16: shiftLoop<uint16_t>(in, regs, left, mask); break;
+    case TYPE_B32:
+    case TYPE_U32: shiftLoop<uint32_t>(in, regs, left, mask); break;
+    case TYPE_B64:
+    case TYPE_U64: shiftLoop<uint64_t>(in, regs, left, mask); break;
+    default:       ok = false;                                break;
+    }
+    break;
+  }
+
+  case OP_SETP:
+    switch(type) {
+    case TYPE_B16:
+    case TYPE_U16: setpLoop<uint16_t>(in, regs, mask); break;
+    case TYPE_S16: setpLoop<int16_t>(in, regs, mask);  break;
+    case TYPE_B32:
+    case TYPE_U32: setpLoop<uint32_t>(in, regs, mask); break;
+    case TYPE_S32: setpLoop<int32_t>(in, regs, mask);  break;
+    case TYPE_B64:
+    case TYPE_U64: setpLoop<uint64_t>(in, regs, mask); break;
+    case TYPE_S64: setpLoop<int64_t>(in, regs, mask);  break;
+    case TYPE_F32: setpLoop<float>(in, regs, mask);    break;
+    case TYPE_F64: setpLoop<double>(in, regs, mask);   break;
+    default:       ok = false;                         break;
+    }
+    break;
+
+  case OP_SELP:
+    selpLoop<uint64_t>(in, regs, mask);
+    break;
+
+  case OP_SLCT:
+    for(uint32_t m = mask; m != 0;) {
+      unsigned lane = nextLane(m);
+      bool     positive = in.srcType == TYPE_F32 ? as<float>(c[lane]) >= 0.0f
+        : as<int32_t>(c[lane]) >= 0;
+      d[lane] = positive ? a[lane] : b[lane];
+    }
+    break;
+
+  case OP_TESTP:
+    for(uint32_t m = mask; m != 0;) {
+      unsigned lane  = nextLane(m);
+      double   value = type == TYPE_F64 ? as<double>(a[lane])
+        : as<float>(a[lane]);
+      int      kind  = type == TYPE_F64 ? std::fpclassify(value)
+        : std::fpclassify(as<float>(a[lane]));
+      bool     result;
+      switch(in.mode) {
+      case TEST_FINITE:     result = kind != FP_INFINITE && kind != FP_NAN; break;
+      case TEST_INFINITE:   result = kind == FP_INFINITE;                   break;
+      case TEST_NUMBER:     result = kind != FP_NAN;                        break;
+      case TEST_NOTANUMBER: result = kind == FP_NAN;                        break;
+      case TEST_NORMAL:     result = kind == FP_NORMAL;                     break;
+      default:              result = kind == FP_SUBNORMAL;                  break;
+      }
+      d[lane] = result;
+    }
+    break;
+
+  case OP_CLZ:
+  case OP_POPC:
+  case OP_BREV:
+  case OP_BFE:
+  case OP_BFI:
+  case OP_PRMT:
+    return bitField(in, mask, regs);
+
+  case OP_ATOM:
+  case OP_RED:
+    return atomic(in, mask, regs, warp);
+
+  case OP_VOTE:
+    vote(in, mask, regs);
+    break;
+
+  case OP_SHFL:
+    shuffle(in, mask, regs);
+    break;
+
+  case OP_MEMBAR:
+  case OP_NOP:
+    break;
+
+  default:
+    ok = false;
+    break;
+  }
+
+  if(!ok) {
+    return fault(in, std::string("unsupported type .") +
+                 getTypeName((DataType)type) + " for " +
+                 getOpcodeName((Opcode)in.opcode));
+  }
+  return true;
+}
+
+bool CTAExecutor::runWarp(unsigned index) {
+  Warp&     warp = warps_[index];
+  uint64_t* regs = getRegisters(index);
+
+  while(warp.runnable != 0) {
+    uint32_t mask;
+    unsigned pc;
+
+    if(!warp.divergent) {
+      mask = warp.runnable;
+      pc   = warp.pc;
+    } else {
+      // Run the lanes furthest behind; structured control flow makes the
+      // others wait at the reconvergence point
+      pc = ~0u;
+      for(uint32_t m = warp.runnable; m != 0;) {
+        unsigned lane = nextLane(m);
+        if(warp.lanePC[lane] < pc) {
+          pc = warp.lanePC[lane];
+        }
+      }
+      mask = 0;
+      for(uint32_t m = warp.runnable; m != 0;) {
+        unsigned lane = nextLane(m);
+        if(warp.lanePC[lane] == pc) {
+          mask |= 1u << lane;
+        }
+      }
+      if(mask == warp.runnable) {
+        warp.divergent = false;
+        warp.pc        = pc;
+      }
+    }
+
+    const ExecInstruction& in     = code_[pc];
+    uint32_t               active = mask;
+
+    if(in.guard != kNoRegister) {
+      const uint64_t* guard  = regs + in.guard * kWarpSize;
+      bool            negate = (in.flags & FLAG_NEG_GUARD) != 0;
+      active = 0;
+      for(uint32_t m = mask; m != 0;) {
+        unsigned lane = nextLane(m);
+        if((guard[lane] != 0) != negate) {
+          active |= 1u << lane;
+        }
+      }
+    }
+
+    unsigned next = pc + 1;
+
+    switch(in.opcode) {
+    case OP_BRA:
+      if(active == mask) {
+        next = in.target;
+      } else if(active != 0) {
+        if(!warp.divergent) {
+          for(uint32_t m = warp.runnable; m != 0;) {
+            warp.lanePC[nextLane(m)] = pc;
+          }
+          warp.divergent = true;
+        }
+        for(uint32_t m = mask; m != 0;) {
+          unsigned lane = nextLane(m);
+          warp.lanePC[lane] = (active & (1u << lane)) ? in.target : pc + 1;
+        }
+        continue;
+      }
+      break;
+
+    case OP_BAR:
+      // Waiting lanes resume after the barrier once every warp has arrived
+      for(uint32_t m = active; m != 0;) {
+        warp.lanePC[nextLane(m)] = pc + 1;
+      }
+      warp.runnable &= ~active;
+      warp.waiting  |= active;
+      mask          &= ~active;
+      break;
+
+    case OP_RET:
+    case OP_EXIT:
+      warp.runnable &= ~active;
+      mask          &= ~active;
+      break;
+
+    default:
+      if(active != 0 && !execute(in, active, regs, index)) {
+        return false;
+      }
+      break;
+    }
+
+    if(!warp.divergent) {
+      warp.pc = next;
+    } else {
+      for(uint32_t m = mask; m != 0;) {
+        warp.lanePC[nextLane(m)] = next;
+      }
+    }
+  }
+  return true;
+}
+
+bool CTAExecutor::run(unsigned cta) {
+  unsigned ctaid[3] = { cta % grid_[0], cta / grid_[0] % grid_[1],
+                        cta / (grid_[0] * grid_[1]) };
+
+  memset(&shared_[0], 0, shared_.size());
+  if(!local_.empty()) {
+    memset(&local_[0], 0, local_.size());
+  }
+
+  for(unsigned w = 0; w < numWarps_; ++w) {
+    Warp&     warp = warps_[w];
+    uint64_t* regs = getRegisters(w);
+    unsigned  lanes = numThreads_ - w * kWarpSize;
+
+    warp.runnable  = lanes >= kWarpSize ? ~0u : (1u << lanes) - 1;
+    warp.waiting   = 0;
+    warp.divergent = false;
+    warp.pc        = 0;
+
+    for(unsigned lane = 0; lane < kWarpSize; ++lane) {
+      regs[SREG_CTAID_X * kWarpSize + lane] = ctaid[0];
+      regs[SREG_CTAID_Y * kWarpSize + lane] = ctaid[1];
+      regs[SREG_CTAID_Z * kWarpSize + lane] = ctaid[2];
+    }
+  }
+
+  // Run every warp up to the next barrier, then release them all
+  for(;;) {
+    bool waiting = false;
+    for(unsigned w = 0; w < numWarps_; ++w) {
+      if(!runWarp(w)) {
+        return false;
+      }
+      waiting = waiting || warps_[w].waiting != 0;
+    }
+    if(!waiting) {
+      break;
+    }
+
+    for(unsigned w = 0; w < numWarps_; ++w) {
+      Warp& warp = warps_[w];
+      if(warp.waiting != 0) {
+        warp.runnable  = warp.waiting;
+        warp.waiting   = 0;
+        warp.divergent = true;
+      }
+    }
+  }
+  return true;
+}
+
+//==--- Program ------------------------------------------------------------== //
+
+namespace {
+
+struct LaunchState {
+  const Kernel*     kernel;
+  Memory*           memory;
+  const unsigned*   grid;
+  const unsigned*   block;
+  const void*       params;
+  size_t            paramSize;
+  size_t            dynamicShared;
+  unsigned          numWorkers;
+  unsigned          numCTAs;
+  volatile unsigned nextCTA;
+  volatile unsigned nextWorker;
+  volatile int      failed;
+  pthread_mutex_t   lock;
+  std::string       error;
+};
+
+void workerMain(void* arg) {
+  LaunchState& launch = *static_cast<LaunchState*>(arg);
+  unsigned     worker = __sync_fetch_and_add(&launch.nextWorker, 1);
+
+  CTAExecutor executor(*launch.kernel, *launch.memory, launch.grid,
+                       launch.block, launch.params, launch.paramSize,
+                       launch.dynamicShared, worker, launch.numWorkers);
+
+  // CTAs are handed out dynamically, so uneven CTAs balance across workers
+  while(!launch.failed) {
+    unsigned cta = __sync_fetch_and_add(&launch.nextCTA, 1);
+    if(cta >= launch.numCTAs) {
+      break;
+    }
+
+    if(!executor.run(cta)) {
+      pthread_mutex_lock(&launch.lock);
+      if(!launch.failed) {
+        launch.error  = executor.getError();
+        launch.failed = 1;
+      }
+      pthread_mutex_unlock(&launch.lock);
+    }
+  }
+}
+
+}
+
+unsigned Kernel::getMaxThreadsPerBlock() const {
+  unsigned limit = kMaxThreadsPerBlock;
+  if(function_->maxntid[0] != 0) {
+    limit = function_->maxntid[0] * function_->maxntid[1] *
+      function_->maxntid[2];
+  }
+  return limit;
+}
+
+Program::Program()
+: memory_(NULL) {
+}
+
+Program::~Program() {
+  for(size_t i = 0; i < addresses_.size(); ++i) {
+    if(addresses_[i] != 0) {
+      memory_->release(addresses_[i]);
+    }
+  }
+}
+
+bool Program::load(const std::string& source, Memory& memory,
+                   std::string& log) {
+  assert(memory_ == NULL && "Program already loaded");
+
+  if(!parseModule(source, module_, log)) {
+    return false;
+  }
+  memory_ = &memory;
+
+  if(module_.addressSize == 32 && memory.getLimit() > kSharedWindow32) {
+    log = "32-bit PTX needs device memory below 0xFE000000; use an "
+      "ArenaMemory";
+    return false;
+  }
+
+  // Place module-scope global and const variables in device memory
+  addresses_.resize(module_.variables.size(), 0);
+  for(size_t i = 0; i < module_.variables.size(); ++i) {
+    const Variable& variable = module_.variables[i];
+    if(variable.space != SPACE_GLOBAL && variable.space != SPACE_CONST) {
+      continue;
+    }
+    if(variable.isExtern) {
+      log = "unresolved external variable " + variable.name;
+      return false;
+    }
+
+    addresses_[i] = memory.allocate(variable.size);
+    if(addresses_[i] == 0) {
+      log = "out of device memory for " + variable.name;
+      return false;
+    }
+
+    unsigned char* data = memory.getBase() + addresses_[i];
+    memset(data, 0, variable.size);
+    if(!variable.data.empty()) {
+      memcpy(data, &variable.data[0], variable.data.size());
+    }
+  }
+
+  for(size_t i = 0; i < module_.functions.size(); ++i) {
+    if(!module_.functions[i].isEntry) {
+      continue;
+    }
+    kernels_.push_back(Kernel());
+    if(!link(kernels_.back(), module_.functions[i], log)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Program::link(Kernel& kernel, const Function& function,
+                   std::string& log) {
+  std::map<uint64_t, unsigned> constants;
+
+  kernel.function_     = &function;
+  kernel.numRegisters_ = function.numRegisters + 1;
+  kernel.sharedWindow_ = module_.addressSize == 64 ? kSharedWindow64
+    : kSharedWindow32;
+  kernel.localWindow_  = module_.addressSize == 64 ? kLocalWindow64
+    : kLocalWindow32;
+
+  // Writes to the sink operand "_" land in the register after the declared
+  // ones; immediates get constant registers after that
+  unsigned sink = function.numRegisters;
+
+  kernel.code_.resize(function.instructions.size());
+  kernel.lines_.resize(function.instructions.size());
+
+  for(size_t i = 0; i < function.instructions.size(); ++i) {
+    const Instruction& inst = function.instructions[i];
+    ExecInstruction&   exec = kernel.code_[i];
+
+    exec.opcode   = (unsigned short)inst.opcode;
+    exec.type     = (unsigned char)inst.type;
+    exec.srcType  = (unsigned char)inst.srcType;
+    exec.space    = (unsigned char)inst.space;
+    exec.vector   = inst.vector;
+    exec.mode     = inst.mode;
+    exec.rounding = inst.rounding;
+    exec.boolOp   = inst.boolOp;
+    exec.flags    = inst.flags;
+    exec.guard    = inst.guard;
+    exec.target   = 0;
+    exec.offset   = 0;
+    kernel.lines_[i] = inst.line;
+
+    if(inst.opcode == OP_CVT && (inst.type == TYPE_F16 ||
+                                 inst.srcType == TYPE_F16)) {
+      // Handled by convert()
+    } else if(inst.type == TYPE_F16) {
+      std::ostringstream message;
+      message << function.name << ", line " << inst.line
+              << ": .f16 arithmetic is not supported";
+      log = message.str();
+      return false;
+    }
+
+    for(unsigned k = 0; k < kMaxOperands; ++k) {
+      const Operand& operand = inst.operands[k];
+      uint64_t       value   = (uint64_t)operand.value;
+      unsigned       reg     = kNoRegister;
+
+      if(operand.symbol != kNoSymbol) {
+        value += addresses_[operand.symbol];
+      }
+
+      switch(operand.kind) {
+      case OPERAND_REGISTER:
+        reg = operand.reg == kNoRegister ? sink : operand.reg;
+        break;
+      case OPERAND_ADDRESS:
+        exec.offset = (int64_t)value;
+        value       = 0;
+        if(operand.reg != kNoRegister) {
+          reg = operand.reg;
+          break;
+        }
+        // An absolute address is an offset from a zero register
+        // Fall through
+      case OPERAND_IMMEDIATE:
+      case OPERAND_SYMBOL: {
+        std::map<uint64_t, unsigned>::iterator constant =
+          constants.find(value);
+        if(constant == constants.end()) {
+          constant = constants.insert(
+            std::make_pair(value, kernel.numRegisters_++)).first;
+          kernel.constants_.push_back(std::make_pair(constant->second,
+                                                     value));
+        }
+        reg = constant->second;
+        break;
+      }
+      case OPERAND_LABEL:
+        exec.target = (unsigned)operand.value;
+        break;
+      default:
+        // Absent operands read the sink register
+        reg = sink;
+        break;
+      }
+
+      exec.r[k] = reg == kNoRegister ? sink : reg;
+    }
+  }
+
+  return true;
+}
+
+const Kernel* Program::getKernel(const std::string& name) const {
+  for(size_t i = 0; i < kernels_.size(); ++i) {
+    if(kernels_[i].getName() == name) {
+      return &kernels_[i];
+    }
+  }
+  return NULL;
+}
+
+bool Program::getGlobal(const std::string& name, uint64_t& address,
+                        size_t& size) const {
+  for(size_t i = 0; i < module_.variables.size(); ++i) {
+    if(module_.variables[i].name == name && addresses_[i] != 0) {
+      address = addresses_[i];
+      size    = module_.variables[i].size;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Program::launch(const Kernel& kernel, const unsigned grid[3],
+                     const unsigned block[3], const void* params,
+                     size_t paramSize, size_t dynamicShared,
+                     std::string& error, unsigned numWorkers) const {
+  unsigned numThreads = block[0] * block[1] * block[2];
+  unsigned numCTAs    = grid[0] * grid[1] * grid[2];
+  const Function& function = kernel.getFunction();
+
+  if(numThreads == 0 || numCTAs == 0 ||
+     numThreads > kernel.getMaxThreadsPerBlock()) {
+    error = "invalid launch configuration for " + kernel.getName();
+    return false;
+  }
+  if(function.reqntid[0] != 0 && (block[0] != function.reqntid[0] ||
+                                  block[1] != function.reqntid[1] ||
+                                  block[2] != function.reqntid[2])) {
+    error = "block shape does not match .reqntid of " + kernel.getName();
+    return false;
+  }
+  if(paramSize < kernel.getParamSize()) {
+    error = "too few parameter bytes for " + kernel.getName();
+    return false;
+  }
+  if(kernel.getSharedSize() + dynamicShared > kWindowSize) {
+    error = "too much shared memory for " + kernel.getName();
+    return false;
+  }
+
+  LaunchState launch;
+  launch.kernel        = &kernel;
+  launch.memory        = memory_;
+  launch.grid          = grid;
+  launch.block         = block;
+  launch.params        = params;
+  launch.paramSize     = paramSize;
+  launch.dynamicShared = dynamicShared;
+  launch.numCTAs       = numCTAs;
+  launch.nextCTA       = 0;
+  launch.nextWorker    = 0;
+  launch.failed        = 0;
+  pthread_mutex_init(&launch.lock, NULL);
+
+  if(numWorkers == 0) {
+    numWorkers = getDefaultWorkerCount();
+  }
+  if(numWorkers > numCTAs) {
+    numWorkers = numCTAs;
+  }
+  launch.numWorkers = numWorkers;
+
+  WorkerPool::get().run(workerMain, &launch, numWorkers);
+  pthread_mutex_destroy(&launch.lock);
+
+  if(launch.failed) {
+    error = launch.error;
+    return false;
+  }
+  return true;
+}
+
+unsigned getDefaultWorkerCount() {
+  const char* env = getenv("PTXEMU_THREADS");
+  if(env != NULL && atoi(env) > 0) {
+    return atoi(env);
+  }
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return cpus > 0 ? (unsigned)cpus : 1;
+}
+
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#if !defined(PTX_INTERPRETER_HPP_INC)
+#define PTX_INTERPRETER_HPP_INC 1
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <pthread.h>
+#include "common/PTXModule.hpp"
+
+/**
+ * Interpreter for the PTX that llc generates, so binary kernels can be
+ * checked and profiled on machines without a CUDA device.
+ *
+ * Program::load() parses a module and links each entry into an array of
+ * executable instructions in which every operand is a register index;
+ * immediates and symbol addresses are pooled into constant registers, so
+ * the inner loop never decodes anything.  launch() runs the CTAs of a grid
+ * on the persistent WorkerPool.  Within a CTA, each warp of 32 threads
+ * executes in lockstep, one instruction for all converged lanes at a time;
+ * divergent lanes reconverge by always running the lanes with the lowest
+ * program counter.  Warps run in turn until they reach a barrier, which
+ * gives bar.sync its CTA-wide semantics and keeps warp-synchronous code
+ * working.
+ */
+namespace ptx {
+
+/**
+ * Device global memory as seen by kernels: device address a refers to host
+ * address getBase() + a.  Kernels may only touch memory inside a block that
+ * allocate() returned, which is checked through findAllocation().
+ */
+class Memory {
+public:
+
+  virtual ~Memory() {
+  }
+
+  virtual unsigned char* getBase() = 0;
+
+  /**
+   * Returns the device address of a new block of size bytes, or 0 if the
+   * memory is exhausted.
+   */
+  virtual uint64_t allocate(size_t size) = 0;
+
+  virtual void release(uint64_t address) = 0;
+
+  /**
+   * Returns one past the largest valid device address.
+   */
+  virtual uint64_t getLimit() const = 0;
+
+  /**
+   * Finds the allocated block that contains address and returns its first
+   * device address and its size as requested from allocate().  Returns false
+   * if address is not inside any block.  Safe to call from several threads,
+   * and while other threads allocate or release.
+   */
+  virtual bool findAllocation(uint64_t address, uint64_t& start,
+                              size_t& size) const = 0;
+};
+
+/**
+ * Memory in which device addresses are host pointers.  Only 64-bit PTX can
+ * address it.
+ */
+class HostMemory : public Memory {
+public:
+
+  HostMemory();
+
+  virtual ~HostMemory();
+
+  virtual unsigned char* getBase() {
+    return NULL;
+  }
+
+  virtual uint64_t allocate(size_t size);
+
+  virtual void release(uint64_t address);
+
+  virtual uint64_t getLimit() const {
+    return ~(uint64_t)0;
+  }
+
+  virtual bool findAllocation(uint64_t address, uint64_t& start,
+                              size_t& size) const;
+
+private:
+
+  HostMemory(const HostMemory&);
+
+  HostMemory& operator=(const HostMemory&);
+
+  mutable pthread_mutex_t    lock_;
+  std::map<uint64_t, size_t> used_;
+};
+
+/**
+ * A reserved range of host address space in which device addresses are
+ * offsets, so that 32-bit PTX can address it too.  Pages are only committed
+ * as they are touched.
+ */
+class ArenaMemory : public Memory {
+public:
+
+  explicit ArenaMemory(size_t capacity);
+
+  virtual ~ArenaMemory();
+
+  virtual unsigned char* getBase() {
+    return base_;
+  }
+
+  virtual uint64_t allocate(size_t size);
+
+  virtual void release(uint64_t address);
+
+  virtual uint64_t getLimit() const {
+    return capacity_;
+  }
+
+  virtual bool findAllocation(uint64_t address, uint64_t& start,
+                              size_t& size) const;
+
+private:
+
+  ArenaMemory(const ArenaMemory&);
+
+  ArenaMemory& operator=(const ArenaMemory&);
+
+  unsigned char*             base_;
+  size_t                     capacity_;
+  mutable pthread_mutex_t    lock_;
+  std::map<uint64_t, size_t> free_;
+  std::map<uint64_t, size_t> used_;     ///< Requested sizes
+};
+
+const unsigned kWarpSize = 32;
+
+/**
+ * An instruction ready for execution.  r holds one register per operand of
+ * the parsed instruction; the base register of an address operand is paired
+ * with offset.
+ */
+struct ExecInstruction {
+  unsigned short opcode;
+  unsigned char  type;
+  unsigned char  srcType;
+  unsigned char  space;
+  unsigned char  vector;
+  unsigned char  mode;
+  unsigned char  rounding;
+  unsigned char  boolOp;
+  unsigned char  flags;
+  unsigned       guard;
+  unsigned       target;
+  int64_t        offset;
+  unsigned       r[kMaxOperands];
+};
+
+/**
+ * A linked kernel entry point.
+ */
+class Kernel {
+public:
+
+  const std::string& getName() const {
+    return function_->name;
+  }
+
+  const Function& getFunction() const {
+    return *function_;
+  }
+
+  size_t getParamSize() const {
+    return function_->paramSize;
+  }
+
+  size_t getSharedSize() const {
+    return function_->sharedSize;
+  }
+
+  size_t getLocalSize() const {
+    return function_->localSize;
+  }
+
+  /**
+   * Registers declared by the kernel, excluding special registers.
+   */
+  unsigned getNumRegisters() const {
+    return function_->numRegisters - NUM_SPECIAL_REGISTERS;
+  }
+
+  /**
+   * Largest CTA this kernel can be launched with.
+   */
+  unsigned getMaxThreadsPerBlock() const;
+
+private:
+
+  friend class Program;
+  friend class CTAExecutor;
+
+  typedef std::vector<std::pair<unsigned, uint64_t> > ConstantList;
+
+  const Function*              function_;
+  std::vector<ExecInstruction> code_;
+  std::vector<unsigned>        lines_;
+  unsigned                     numRegisters_;
+  ConstantList                 constants_;
+  uint64_t                     sharedWindow_;
+  uint64_t                     localWindow_;
+};
+
+class Program {
+public:
+
+  Program();
+
+  /**
+   * Releases the module variables.
+   */
+  ~Program();
+
+  /**
+   * Parses source and links its entry points.  Module-scope global and const
+   * variables are allocated in memory, which must outlive the program.
+   * Returns false and describes the problem in log on failure.
+   */
+  bool load(const std::string& source, Memory& memory, std::string& log);
+
+  const Kernel* getKernel(const std::string& name) const;
+
+  /**
+   * Looks up a module-scope global or const variable.
+   */
+  bool getGlobal(const std::string& name, uint64_t& address,
+                 size_t& size) const;
+
+  const Module& getModule() const {
+    return module_;
+  }
+
+  /**
+   * Runs kernel over a grid of grid[0] x grid[1] x grid[2] CTAs of
+   * block[0] x block[1] x block[2] threads.  params holds the parameter
+   * buffer laid out as the kernel declares it.  A numWorkers of 0 uses the
+   * PTXEMU_THREADS environment variable, or one worker per online processor.
+   * Returns false and describes the fault in error if the kernel makes an
+   * invalid access or the launch configuration is invalid.
+   */
+  bool launch(const Kernel& kernel, const unsigned grid[3],
+              const unsigned block[3], const void* params, size_t paramSize,
+              size_t dynamicShared, std::string& error,
+              unsigned numWorkers = 0) const;
+
+private:
+
+  Program(const Program&);
+
+  Program& operator=(const Program&);
+
+  bool link(Kernel& kernel, const Function& function, std::string& log);
+
+  Module                  module_;
+  Memory*                 memory_;
+  std::vector<uint64_t>   addresses_;   ///< Of module_.variables
+  std::vector<Kernel>     kernels_;
+};
+
+/**
+ * Returns the number of workers launch() uses by default.
+ */
+unsigned getDefaultWorkerCount();
+
+}
+
+#endif
@@ -0,0 +1,1550 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include "common/PTXModule.hpp"
+
+namespace ptx {
+
+//==--- Type Information ---------------------------------------------------== //
+
+unsigned getTypeSize(DataType type) {
+  switch(type) {
+  case TYPE_PRED:
+  case TYPE_B8:
+  case TYPE_U8:
+  case TYPE_S8:
+    return 1;
+  case TYPE_B16:
+  case TYPE_U16:
+  case TYPE_S16:
+  case TYPE_F16:
+    return 2;
+  case TYPE_B32:
+  case TYPE_U32:
+  case TYPE_S32:
+  case TYPE_F32:
+    return 4;
+  case TYPE_B64:
+  case TYPE_U64:
+  case TYPE_S64:
+  case TYPE_F64:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
+bool isSignedType(DataType type) {
+  return type == TYPE_S8 || type == TYPE_S16 || type == TYPE_S32 ||
+    type == TYPE_S64;
+}
+
+bool isFloatType(DataType type) {
+  return type == TYPE_F16 || type == TYPE_F32 || type == TYPE_F64;
+}
+
+namespace {
+
+struct NameEntry {
+  const char* name;
+  int         value;
+};
+
+const NameEntry kTypes[] = {
+  { "pred", TYPE_PRED },
+  { "b8",  TYPE_B8 },  { "b16", TYPE_B16 }, { "b32", TYPE_B32 },
+  { "b64", TYPE_B64 },
+  { "u8",  TYPE_U8 },  { "u16", TYPE_U16 }, { "u32", TYPE_U32 },
+  { "u64", TYPE_U64 },
+  { "s8",  TYPE_S8 },  { "s16", TYPE_S16 }, { "s32", TYPE_S32 },
+  { "s64", TYPE_S64 },
+  { "f16", TYPE_F16 }, { "f32", TYPE_F32 }, { "f64", TYPE_F64 },
+  { NULL, 0 }
+};
+
+const NameEntry kSpaces[] = {
+  { "global", SPACE_GLOBAL }, { "shared", SPACE_SHARED },
+  { "local",  SPACE_LOCAL },  { "param",  SPACE_PARAM },
+  { "const",  SPACE_CONST },
+  { NULL, 0 }
+};
+
+const NameEntry kOpcodes[] = {
+  { "mov",   OP_MOV },   { "ld",    OP_LD },    { "ldu",   OP_LD },
+  { "st",    OP_ST },    { "cvta",  OP_CVTA },  { "cvt",   OP_CVT },
+  { "add",   OP_ADD },   { "sub",   OP_SUB },   { "mul",   OP_MUL },
+  { "mad",   OP_MAD },   { "mul24", OP_MUL24 }, { "mad24", OP_MAD24 },
+  { "fma",   OP_FMA },   { "div",   OP_DIV },   { "rem",   OP_REM },
+  { "abs",   OP_ABS },   { "neg",   OP_NEG },   { "min",   OP_MIN },
+  { "max",   OP_MAX },   { "and",   OP_AND },   { "or",    OP_OR },
+  { "xor",   OP_XOR },   { "not",   OP_NOT },   { "cnot",  OP_CNOT },
+  { "shl",   OP_SHL },   { "shr",   OP_SHR },   { "setp",  OP_SETP },
+  { "selp",  OP_SELP },  { "slct",  OP_SLCT },  { "sqrt",  OP_SQRT },
+  { "rsqrt", OP_RSQRT }, { "rcp",   OP_RCP },   { "sin",   OP_SIN },
+  { "cos",   OP_COS },   { "lg2",   OP_LG2 },   { "ex2",   OP_EX2 },
+  { "clz",   OP_CLZ },   { "popc",  OP_POPC },  { "brev",  OP_BREV },
+  { "bfe",   OP_BFE },   { "bfi",   OP_BFI },   { "prmt",  OP_PRMT },
+  { "copysign", OP_COPYSIGN },                  { "testp", OP_TESTP },
+  { "atom",  OP_ATOM },  { "red",   OP_RED },   { "vote",  OP_VOTE },
+  { "shfl",  OP_SHFL },  { "bra",   OP_BRA },   { "bar",   OP_BAR },
+  { "barrier", OP_BAR }, { "membar", OP_MEMBAR }, { "fence", OP_MEMBAR },
+  { "ret",   OP_RET },   { "exit",  OP_EXIT },  { "prefetch", OP_NOP },
+  { "prefetchu", OP_NOP },
+  { NULL, 0 }
+};
+
+const NameEntry kCompareOps[] = {
+  { "eq",  CMP_EQ },  { "ne",  CMP_NE },  { "lt",  CMP_LT },
+  { "le",  CMP_LE },  { "gt",  CMP_GT },  { "ge",  CMP_GE },
+  { "lo",  CMP_LO },  { "ls",  CMP_LS },  { "hi",  CMP_HI },
+  { "hs",  CMP_HS },  { "equ", CMP_EQU }, { "neu", CMP_NEU },
+  { "ltu", CMP_LTU }, { "leu", CMP_LEU }, { "gtu", CMP_GTU },
+  { "geu", CMP_GEU }, { "num", CMP_NUM }, { "nan", CMP_NAN },
+  { NULL, 0 }
+};
+
+const NameEntry kTestOps[] = {
+  { "finite", TEST_FINITE },       { "infinite", TEST_INFINITE },
+  { "number", TEST_NUMBER },       { "notanumber", TEST_NOTANUMBER },
+  { "normal", TEST_NORMAL },       { "subnormal", TEST_SUBNORMAL },
+  { NULL, 0 }
+};
+
+const NameEntry kBoolOps[] = {
+  { "and", BOOL_AND }, { "or", BOOL_OR }, { "xor", BOOL_XOR },
+  { NULL, 0 }
+};
+
+const NameEntry kAtomicOps[] = {
+  { "add",  ATOMIC_ADD },  { "min", ATOMIC_MIN }, { "max", ATOMIC_MAX },
+  { "inc",  ATOMIC_INC },  { "dec", ATOMIC_DEC }, { "cas", ATOMIC_CAS },
+  { "exch", ATOMIC_EXCH }, { "and", ATOMIC_AND }, { "or",  ATOMIC_OR },
+  { "xor",  ATOMIC_XOR },
+  { NULL, 0 }
+};
+
+const NameEntry kMulModes[] = {
+  { "lo", MUL_LO }, { "hi", MUL_HI }, { "wide", MUL_WIDE },
+  { NULL, 0 }
+};
+
+const NameEntry kRoundModes[] = {
+  { "rn",  ROUND_RN },  { "rz",  ROUND_RZ },  { "rm",  ROUND_RM },
+  { "rp",  ROUND_RP },  { "rni", ROUND_RNI }, { "rzi", ROUND_RZI },
+  { "rmi", ROUND_RMI }, { "rpi", ROUND_RPI },
+  { NULL, 0 }
+};
+
+const NameEntry kVoteOps[] = {
+  { "all", VOTE_ALL }, { "any", VOTE_ANY }, { "uni", VOTE_UNI },
+  { "ballot", VOTE_BALLOT },
+  { NULL, 0 }
+};
+
+const NameEntry kShuffleOps[] = {
+  { "idx", SHFL_IDX }, { "up", SHFL_UP }, { "down", SHFL_DOWN },
+  { "bfly", SHFL_BFLY },
+  { NULL, 0 }
+};
+
+/// Modifiers that do not change the result of an instruction on a
+/// sequentially consistent host: cache operators, memory scopes and the
+/// like.
+const char* const kIgnoredModifiers[] = {
+  "nc", "ca", "cg", "cs", "lu", "cv", "wb", "wt", "sync", "aligned",
+  "relaxed", "acquire", "release", "acq_rel", "sc", "cta", "gpu", "sys",
+  "gl", "full", "noftz", "L1", "L2",
+  NULL
+};
+
+const char* const kSpecialRegisterNames[NUM_SPECIAL_REGISTERS] = {
+  "%tid.x",    "%tid.y",    "%tid.z",
+  "%ntid.x",   "%ntid.y",   "%ntid.z",
+  "%ctaid.x",  "%ctaid.y",  "%ctaid.z",
+  "%nctaid.x", "%nctaid.y", "%nctaid.z",
+  "%laneid",   "%warpid",   "%nwarpid",
+  "%smid",     "%nsmid",    "%gridid",
+  "%clock",    "%clock64"
+};
+
+const char* const kOpcodeNames[NUM_OPCODES] = {
+  "mov",   "mov",   "mov",
+  "ld",    "st",    "cvta",  "cvt",
+  "add",   "sub",   "mul",   "mad",   "mul24", "mad24",
+  "fma",   "div",   "rem",   "abs",   "neg",   "min",
+  "max",   "and",   "or",    "xor",   "not",   "cnot",
+  "shl",   "shr",   "setp",  "selp",  "slct",  "sqrt",
+  "rsqrt", "rcp",   "sin",   "cos",   "lg2",   "ex2",
+  "clz",   "popc",  "brev",  "bfe",   "bfi",   "prmt",
+  "copysign", "testp", "atom", "red", "vote",  "shfl",
+  "bra",   "bar",   "membar", "ret",  "exit",  "nop"
+};
+
+int lookup(const NameEntry* table, const std::string& name) {
+  for(; table->name != NULL; ++table) {
+    if(name == table->name) {
+      return table->value;
+    }
+  }
+  return -1;
+}
+
+bool isIgnoredModifier(const std::string& name) {
+  for(const char* const* m = kIgnoredModifiers; *m != NULL; ++m) {
+    if(name == *m) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t alignUp(size_t value, size_t align) {
+  return align > 1 ? (value + align - 1) / align * align : value;
+}
+
+//==--- Lexer --------------------------------------------------------------== //
+
+enum TokenKind {
+  TOKEN_END,
+  TOKEN_IDENT,
+  TOKEN_NUMBER,
+  TOKEN_STRING,
+  TOKEN_PUNCT
+};
+
+struct Token {
+  TokenKind   kind;
+  std::string text;
+  unsigned    line;
+};
+
+bool isIdentStart(char c) {
+  return isalpha((unsigned char)c) || c == '_' || c == '$' || c == '%' ||
+    c == '.';
+}
+
+bool isIdentChar(char c) {
+  return isalnum((unsigned char)c) || c == '_' || c == '$' || c == '.';
+}
+
+void tokenize(const std::string& source, std::vector<Token>& tokens) {
+  size_t   i    = 0;
+  size_t   n    = source.size();
+  unsigned line = 1;
+
+  while(i < n) {
+    char c = source[i];
+
+    if(c == '\n') {
+      ++line;
+      ++i;
+      continue;
+    }
+    if(isspace((unsigned char)c)) {
+      ++i;
+      continue;
+    }
+    if(c == '/' && i + 1 < n && source[i + 1] == '/') {
+      while(i < n && source[i] != '\n') {
+        ++i;
+      }
+      continue;
+    }
+    if(c == '/' && i + 1 < n && source[i + 1] == '*') {
+      i += 2;
+      while(i + 1 < n && !(source[i] == '*' && source[i + 1] == '/')) {
+        if(source[i] == '\n') {
+          ++line;
+        }
+        ++i;
+      }
+      i += 2;
+      continue;
+    }
+
+    Token  token;
+    size_t start = i;
+    token.line   = line;
+
+    if(isIdentStart(c)) {
+      token.kind = TOKEN_IDENT;
+      for(++i; i < n && isIdentChar(source[i]); ++i) {
+      }
+    } else if(isdigit((unsigned char)c)) {
+      token.kind = TOKEN_NUMBER;
+      for(++i; i < n && (isalnum((unsigned char)source[i]) ||
+                         source[i] == '.'); ++i) {
+      }
+    } else if(c == '"') {
+      token.kind = TOKEN_STRING;
+      for(++i; i < n && source[i] != '"'; ++i) {
+      }
+      ++i;
+    } else {
+      token.kind = TOKEN_PUNCT;
+      ++i;
+    }
+
+    token.text = source.substr(start, i - start);
+    tokens.push_back(token);
+  }
+
+  Token end;
+  end.kind = TOKEN_END;
+  end.line = line;
+  tokens.push_back(end);
+}
+
+/**
+ * Converts a PTX literal to the bits of a value of the given type.  Hex
+ * float literals (0f/0d) and decimal reals are converted between single and
+ * double precision as needed.
+ */
+bool parseLiteral(const std::string& text, DataType type, int64_t& bits) {
+  bool        negative = !text.empty() && text[0] == '-';
+  std::string body     = negative ? text.substr(1) : text;
+  double      real     = 0.0;
+  bool        isReal   = false;
+
+  if(body.size() > 2 && body[0] == '0' &&
+     (body[1] == 'f' || body[1] == 'F')) {
+    union { uint32_t u; float f; } value;
+    value.u = (uint32_t)strtoul(body.c_str() + 2, NULL, 16);
+    real    = value.f;
+    isReal  = true;
+  } else if(body.size() > 2 && body[0] == '0' &&
+            (body[1] == 'd' || body[1] == 'D')) {
+    union { uint64_t u; double f; } value;
+    value.u = strtoull(body.c_str() + 2, NULL, 16);
+    real    = value.f;
+    isReal  = true;
+  } else if(body.find_first_of(".eE") != std::string::npos &&
+            !(body.size() > 1 && (body[1] == 'x' || body[1] == 'X'))) {
+    real   = strtod(body.c_str(), NULL);
+    isReal = true;
+  }
+
+  if(isReal) {
+    if(negative) {
+      real = -real;
+    }
+    if(type == TYPE_F64) {
+      union { double f; int64_t i; } value;
+      value.f = real;
+      bits    = value.i;
+    } else if(type == TYPE_F32 || !isFloatType(type)) {
+      union { float f; uint32_t u; } value;
+      value.f = (float)real;
+      bits    = isFloatType(type) ? value.u : (int64_t)real;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  // Integers: decimal, hex (0x), binary (0b) or octal (leading 0), with an
+  // optional U suffix.
+  while(!body.empty() && (body[body.size() - 1] == 'U' ||
+                          body[body.size() - 1] == 'u')) {
+    body.erase(body.size() - 1);
+  }
+
+  char*    end   = NULL;
+  uint64_t value = 0;
+  if(body.size() > 2 && body[0] == '0' && (body[1] == 'b' || body[1] == 'B')) {
+    value = strtoull(body.c_str() + 2, &end, 2);
+  } else {
+    value = strtoull(body.c_str(), &end, 0);
+  }
+  if(end == NULL || *end != '\0' || body.empty()) {
+    return false;
+  }
+
+  if(negative) {
+    value = (uint64_t)0 - value;
+  }
+
+  if(type == TYPE_F64) {
+    union { double f; int64_t i; } conv;
+    conv.f = (double)(int64_t)value;
+    bits   = conv.i;
+  } else if(type == TYPE_F32) {
+    union { float f; uint32_t u; } conv;
+    conv.f = (float)(int64_t)value;
+    bits   = conv.u;
+  } else {
+    bits = (int64_t)value;
+  }
+  return true;
+}
+
+//==--- Parser -------------------------------------------------------------== //
+
+/// An operand as written, before names are resolved.
+struct RawOperand {
+
+  enum Kind {
+    RAW_NAME,
+    RAW_NUMBER,
+    RAW_ADDRESS,
+    RAW_VECTOR
+  };
+
+  RawOperand()
+  : kind(RAW_NAME), offset(0), negated(false) {
+  }
+
+  Kind                     kind;
+  std::string              text;      ///< Name, literal or address base
+  int64_t                  offset;    ///< Address displacement
+  std::vector<std::string> elements;  ///< Vector elements
+  bool                     negated;
+};
+
+class Parser {
+public:
+
+  Parser(const std::vector<Token>& tokens, Module& module, std::string& log)
+  : tokens_(tokens), pos_(0), module_(module), log_(log),
+    moduleSharedSize_(0) {
+  }
+
+  bool parse();
+
+private:
+
+  struct RegisterRange {
+    unsigned first;
+    unsigned count;
+  };
+
+  struct LabelFixup {
+    unsigned    instruction;
+    unsigned    operand;
+    std::string label;
+    unsigned    line;
+  };
+
+  const Token& peek(unsigned ahead = 0) const {
+    size_t index = pos_ + ahead;
+    return tokens_[index < tokens_.size() ? index : tokens_.size() - 1];
+  }
+
+  const Token& next() {
+    const Token& token = peek();
+    if(pos_ + 1 < tokens_.size()) {
+      ++pos_;
+    }
+    return token;
+  }
+
+  bool is(const char* text, unsigned ahead = 0) const {
+    return peek(ahead).kind != TOKEN_END && peek(ahead).text == text;
+  }
+
+  bool accept(const char* text) {
+    if(is(text)) {
+      next();
+      return true;
+    }
+    return false;
+  }
+
+  bool expect(const char* text) {
+    if(!accept(text)) {
+      return error(std::string("expected '") + text + "' but found '" +
+                   peek().text + "'");
+    }
+    return true;
+  }
+
+  bool error(const std::string& message) {
+    return errorAt(peek().line, message);
+  }
+
+  bool errorAt(unsigned line, const std::string& message) {
+    std::ostringstream stream;
+    stream << "line " << line << ": " << message;
+    log_ = stream.str();
+    return false;
+  }
+
+  bool parseUnsigned(unsigned& value);
+  bool skipStatement();
+  bool skipDebugDirective();
+  bool parseFunction(bool isEntry);
+  bool parseParameters(Function& function);
+  bool parseVariable(StateSpace space, bool isExtern, Variable& variable);
+  bool parseInitializer(Variable& variable, size_t numElements);
+  bool parseRegisters(Function& function);
+  bool parseBody(Function& function);
+  bool parseStatement(Function& function);
+  bool parseOperand(RawOperand& operand);
+  bool decodeInstruction(Function& function, const std::string& mnemonic,
+                         std::vector<RawOperand>& raw, bool piped,
+                         Instruction& inst);
+  bool resolveOperand(Function& function, const RawOperand& raw,
+                      DataType immType, Instruction& inst, unsigned index);
+  bool resolveName(Function& function, const std::string& name,
+                   Operand& operand);
+  bool lookupRegister(const std::string& name, unsigned& reg) const;
+  void placeVariable(Function* function, Variable& variable);
+
+  const std::vector<Token>& tokens_;
+  size_t                    pos_;
+  Module&                   module_;
+  std::string&              log_;
+  size_t                    moduleSharedSize_;
+
+  // Per-function state
+  std::map<std::string, unsigned> registerNames_;
+  std::map<std::string, RegisterRange> registerRanges_;
+  std::map<std::string, unsigned> labels_;
+  std::vector<LabelFixup>         fixups_;
+};
+
+bool Parser::parseUnsigned(unsigned& value) {
+  if(peek().kind != TOKEN_NUMBER) {
+    return error("expected a number but found '" + peek().text + "'");
+  }
+  int64_t bits;
+  if(!parseLiteral(next().text, TYPE_U32, bits)) {
+    return error("malformed number");
+  }
+  value = (unsigned)bits;
+  return true;
+}
+
+bool Parser::skipStatement() {
+  while(peek().kind != TOKEN_END && !is(";")) {
+    next();
+  }
+  return expect(";");
+}
+
+bool Parser::skipDebugDirective() {
+  // .file and .loc are not terminated; they take numbers, strings and
+  // comma-separated extras on one line.
+  unsigned line = next().line;
+  while(peek().kind != TOKEN_END && peek().line == line) {
+    next();
+  }
+  return true;
+}
+
+bool Parser::parse() {
+  while(peek().kind != TOKEN_END) {
+    const Token& token = peek();
+    bool         isExtern = false;
+
+    if(token.text == ".version") {
+      next();
+      module_.version = next().text;
+    } else if(token.text == ".target") {
+      next();
+      module_.target = next().text;
+      while(accept(",")) {
+        module_.target += "," + next().text;
+      }
+    } else if(token.text == ".address_size") {
+      next();
+      if(!parseUnsigned(module_.addressSize)) {
+        return false;
+      }
+      if(module_.addressSize != 32 && module_.addressSize != 64) {
+        return error("unsupported address size");
+      }
+    } else if(token.text == ".file" || token.text == ".loc") {
+      skipDebugDirective();
+    } else if(token.text == ".pragma") {
+      if(!skipStatement()) {
+        return false;
+      }
+    } else if(token.text == ".section") {
+      // Debug sections: skip the braced block
+      while(peek().kind != TOKEN_END && !is("{")) {
+        next();
+      }
+      unsigned depth = 0;
+      do {
+        if(is("{")) {
+          ++depth;
+        } else if(is("}")) {
+          --depth;
+        }
+        next();
+      } while(depth > 0 && peek().kind != TOKEN_END);
+    } else {
+      // Linkage, then a function or a variable
+      while(is(".visible") || is(".extern") || is(".weak") ||
+            is(".common")) {
+        isExtern = isExtern || is(".extern");
+        next();
+      }
+
+      if(accept(".entry")) {
+        if(!parseFunction(true)) {
+          return false;
+        }
+      } else if(accept(".func")) {
+        if(!parseFunction(false)) {
+          return false;
+        }
+      } else {
+        int space = lookup(kSpaces, peek().text.substr(1));
+        if(peek().text[0] != '.' || space < 0 || space == SPACE_PARAM ||
+           space == SPACE_LOCAL) {
+          return error("unexpected '" + peek().text + "' at module scope");
+        }
+        next();
+
+        Variable variable;
+        if(!parseVariable((StateSpace)space, isExtern, variable)) {
+          return false;
+        }
+        placeVariable(NULL, variable);
+        module_.variables.push_back(variable);
+      }
+    }
+  }
+
+  return true;
+}
+
+void Parser::placeVariable(Function* function, Variable& variable) {
+  variable.offset = 0;
+  if(variable.isExtern) {
+    return;
+  }
+
+  if(variable.space == SPACE_SHARED) {
+    if(function == NULL) {
+      // Module-scope shared variables come first in every CTA's window.
+      // llc emits them ahead of the functions that use them.
+      variable.offset  = alignUp(moduleSharedSize_, variable.align);
+      moduleSharedSize_ = variable.offset + variable.size;
+    } else {
+      variable.offset      = alignUp(function->sharedSize, variable.align);
+      function->sharedSize = variable.offset + variable.size;
+    }
+  } else if(variable.space == SPACE_LOCAL && function != NULL) {
+    variable.offset     = alignUp(function->localSize, variable.align);
+    function->localSize = variable.offset + variable.size;
+  }
+}
+
+bool Parser::parseVariable(StateSpace space, bool isExtern,
+                           Variable& variable) {
+  variable.space    = space;
+  variable.type     = TYPE_NONE;
+  variable.align    = 0;
+  variable.size     = 0;
+  variable.offset   = 0;
+  variable.isExtern = isExtern;
+
+  unsigned vector = 1;
+  for(;;) {
+    if(accept(".align")) {
+      if(!parseUnsigned(variable.align)) {
+        return false;
+      }
+    } else if(accept(".v2")) {
+      vector = 2;
+    } else if(accept(".v4")) {
+      vector = 4;
+    } else if(peek().text[0] == '.' && lookup(kTypes,
+                                              peek().text.substr(1)) >= 0) {
+      variable.type = (DataType)lookup(kTypes, next().text.substr(1));
+    } else {
+      break;
+    }
+  }
+
+  if(variable.type == TYPE_NONE || peek().kind != TOKEN_IDENT) {
+    return error("malformed variable declaration");
+  }
+  variable.name = next().text;
+
+  size_t elementSize = getTypeSize(variable.type) * vector;
+  size_t numElements = 1;
+  while(accept("[")) {
+    if(accept("]")) {
+      // Unsized array: dynamically sized shared memory, or sized by its
+      // initializer
+      variable.isExtern = variable.isExtern || space == SPACE_SHARED;
+      numElements = 0;
+      continue;
+    }
+    unsigned extent;
+    if(!parseUnsigned(extent) || !expect("]")) {
+      return false;
+    }
+    numElements *= extent;
+  }
+
+  if(variable.align == 0) {
+    variable.align = (unsigned)elementSize;
+  }
+
+  if(accept("=")) {
+    if(!parseInitializer(variable, numElements)) {
+      return false;
+    }
+    if(numElements == 0) {
+      numElements = variable.data.size() / elementSize;
+      variable.isExtern = false;
+    }
+  }
+
+  variable.size = elementSize * numElements;
+  return expect(";");
+}
+
+bool Parser::parseInitializer(Variable& variable, size_t numElements) {
+  size_t   elementSize = getTypeSize(variable.type);
+  unsigned depth       = 0;
+
+  do {
+    if(accept("{")) {
+      ++depth;
+      continue;
+    }
+    if(accept("}")) {
+      --depth;
+      accept(",");
+      continue;
+    }
+
+    std::string text;
+    if(accept("-")) {
+      text = "-";
+    }
+    if(peek().kind != TOKEN_NUMBER) {
+      return error("unsupported initializer '" + peek().text + "' for " +
+                   variable.name);
+    }
+    text += next().text;
+
+    int64_t bits;
+    if(!parseLiteral(text, variable.type, bits)) {
+      return error("malformed initializer for " + variable.name);
+    }
+    for(size_t i = 0; i < elementSize; ++i) {
+      variable.data.push_back((unsigned char)(bits >> (8 * i)));
+    }
+    accept(",");
+  } while(depth > 0 && peek().kind != TOKEN_END);
+
+  if(numElements != 0 && variable.data.size() > numElements * elementSize) {
+    return error("too many initializers for " + variable.name);
+  }
+  variable.data.resize(numElements * elementSize, 0);
+  return true;
+}
+
+bool Parser::parseFunction(bool isEntry) {
+  Function function;
+  function.isEntry    = isEntry;
+  function.sharedSize = moduleSharedSize_;
+
+  // Return parameters of .func
+  if(!isEntry && accept("(")) {
+    while(peek().kind != TOKEN_END && !is(")")) {
+      next();
+    }
+    if(!expect(")")) {
+      return false;
+    }
+  }
+
+  if(peek().kind != TOKEN_IDENT) {
+    return error("expected a function name");
+  }
+  function.name = next().text;
+
+  if(accept("(") && !parseParameters(function)) {
+    return false;
+  }
+
+  // Performance tuning directives
+  for(;;) {
+    unsigned* dims = NULL;
+    if(accept(".maxntid")) {
+      dims = function.maxntid;
+    } else if(accept(".reqntid")) {
+      dims = function.reqntid;
+    } else if(accept(".minnctapersm") || accept(".maxnreg") ||
+              accept(".maxnctapersm")) {
+      unsigned ignored;
+      if(!parseUnsigned(ignored)) {
+        return false;
+      }
+      continue;
+    } else {
+      break;
+    }
+
+    dims[1] = dims[2] = 1;
+    for(unsigned i = 0; i < 3; ++i) {
+      if(!parseUnsigned(dims[i]) || !accept(",")) {
+        break;
+      }
+    }
+  }
+
+  // A prototype without a body
+  if(accept(";")) {
+    return true;
+  }
+
+  if(!parseBody(function)) {
+    return false;
+  }
+
+  module_.functions.push_back(function);
+  return true;
+}
+
+bool Parser::parseParameters(Function& function) {
+  while(!accept(")")) {
+    if(!expect(".param")) {
+      return false;
+    }
+
+    Parameter param;
+    param.type  = TYPE_NONE;
+    param.align = 0;
+
+    for(;;) {
+      if(accept(".align")) {
+        if(!parseUnsigned(param.align)) {
+          return false;
+        }
+      } else if(accept(".ptr")) {
+        // Pointer attributes: .ptr [.space] [.align N]
+        if(peek().text[0] == '.' &&
+           lookup(kSpaces, peek().text.substr(1)) >= 0) {
+          next();
+        }
+      } else if(peek().text[0] == '.' &&
+                lookup(kTypes, peek().text.substr(1)) >= 0) {
+        param.type = (DataType)lookup(kTypes, next().text.substr(1));
+      } else {
+        break;
+      }
+    }
+
+    if(param.type == TYPE_NONE || peek().kind != TOKEN_IDENT) {
+      return error("malformed parameter declaration");
+    }
+    param.name = next().text;
+    param.size = getTypeSize(param.type);
+
+    if(accept("[")) {
+      unsigned count;
+      if(!parseUnsigned(count) || !expect("]")) {
+        return false;
+      }
+      param.size *= count;
+    }
+
+    if(param.align == 0) {
+      param.align = getTypeSize(param.type);
+    }
+
+    param.offset       = (unsigned)alignUp(function.paramSize, param.align);
+    function.paramSize = param.offset + param.size;
+    function.params.push_back(param);
+
+    if(!is(")") && !expect(",")) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Parser::parseRegisters(Function& function) {
+  if(peek().text.empty() || peek().text[0] != '.' ||
+     lookup(kTypes, peek().text.substr(1)) < 0) {
+    return error("unsupported register type '" + peek().text + "'");
+  }
+  DataType type = (DataType)lookup(kTypes, next().text.substr(1));
+
+  do {
+    if(peek().kind != TOKEN_IDENT) {
+      return error("expected a register name");
+    }
+
+    RegisterDeclaration decl;
+    decl.name  = next().text;
+    decl.type  = type;
+    decl.count = 1;
+    decl.first = function.numRegisters;
+
+    if(accept("<")) {
+      if(!parseUnsigned(decl.count) || !expect(">")) {
+        return false;
+      }
+      RegisterRange range = { decl.first, decl.count };
+      registerRanges_[decl.name] = range;
+    } else {
+      registerNames_[decl.name] = decl.first;
+    }
+
+    function.numRegisters += decl.count;
+    function.registers.push_back(decl);
+  } while(accept(","));
+
+  return expect(";");
+}
+
+bool Parser::parseBody(Function& function) {
+  registerNames_.clear();
+  registerRanges_.clear();
+  labels_.clear();
+  fixups_.clear();
+
+  if(!expect("{")) {
+    return false;
+  }
+
+  unsigned depth = 1;
+  while(depth > 0) {
+    if(peek().kind == TOKEN_END) {
+      return error("unterminated function body");
+    }
+    if(accept("{")) {
+      ++depth;
+    } else if(accept("}")) {
+      --depth;
+    } else if(!parseStatement(function)) {
+      return false;
+    }
+  }
+
+  for(size_t i = 0; i < fixups_.size(); ++i) {
+    const LabelFixup& fixup = fixups_[i];
+    std::map<std::string, unsigned>::const_iterator label =
+      labels_.find(fixup.label);
+    if(label == labels_.end()) {
+      return errorAt(fixup.line, "undefined label '" + fixup.label + "'");
+    }
+    function.instructions[fixup.instruction].operands[fixup.operand].value =
+      label->second;
+  }
+
+  // Falling off the end of a kernel exits
+  Instruction ret;
+  ret.opcode = OP_RET;
+  ret.line   = peek().line;
+  function.instructions.push_back(ret);
+  return true;
+}
+
+bool Parser::parseStatement(Function& function) {
+  const Token& token = peek();
+
+  if(token.text == ".reg") {
+    next();
+    return parseRegisters(function);
+  }
+  if(token.text == ".loc" || token.text == ".file") {
+    return skipDebugDirective();
+  }
+  if(token.text == ".pragma") {
+    return skipStatement();
+  }
+  if(token.text == ".shared" || token.text == ".local" ||
+     token.text == ".global" || token.text == ".const" ||
+     token.text == ".extern") {
+    bool isExtern = accept(".extern");
+    int  space    = lookup(kSpaces, next().text.substr(1));
+    if(space < 0) {
+      return error("malformed variable declaration");
+    }
+
+    Variable variable;
+    if(!parseVariable((StateSpace)space, isExtern, variable)) {
+      return false;
+    }
+    if(space == SPACE_GLOBAL || space == SPACE_CONST) {
+      module_.variables.push_back(variable);
+    } else {
+      placeVariable(&function, variable);
+      function.variables.push_back(variable);
+    }
+    return true;
+  }
+
+  // Labels
+  if(token.kind == TOKEN_IDENT && is(":", 1)) {
+    labels_[token.text] = (unsigned)function.instructions.size();
+    next();
+    next();
+    return true;
+  }
+
+  // Instructions, with an optional guard predicate
+  Instruction inst;
+  inst.line = token.line;
+
+  if(accept("@")) {
+    if(accept("!")) {
+      inst.flags |= FLAG_NEG_GUARD;
+    }
+    if(!lookupRegister(peek().text, inst.guard)) {
+      return error("unknown guard predicate '" + peek().text + "'");
+    }
+    next();
+  }
+
+  if(peek().kind != TOKEN_IDENT) {
+    return error("expected an instruction but found '" + peek().text + "'");
+  }
+  std::string mnemonic = next().text;
+
+  std::vector<RawOperand> raw;
+  bool                    piped = false;
+  while(!is(";")) {
+    RawOperand operand;
+    if(!parseOperand(operand)) {
+      return false;
+    }
+    raw.push_back(operand);
+
+    if(accept("|")) {
+      piped = piped || raw.size() == 1;
+    } else if(!is(";") && !expect(",")) {
+      return false;
+    }
+  }
+  next();
+
+  if(!decodeInstruction(function, mnemonic, raw, piped, inst)) {
+    return false;
+  }
+  function.instructions.push_back(inst);
+  return true;
+}
+
+bool Parser::parseOperand(RawOperand& operand) {
+  if(accept("[")) {
+    operand.kind = RawOperand::RAW_ADDRESS;
+    if(peek().kind == TOKEN_IDENT) {
+      operand.text = next().text;
+    }
+    while(!accept("]")) {
+      bool negative = false;
+      if(accept("-")) {
+        negative = true;
+      } else if(accept("+")) {
+        negative = accept("-");
+      }
+      if(peek().kind != TOKEN_NUMBER) {
+        return error("malformed address");
+      }
+      int64_t bits;
+      if(!parseLiteral(next().text, TYPE_S64, bits)) {
+        return error("malformed address offset");
+      }
+      operand.offset += negative ? -bits : bits;
+    }
+    return true;
+  }
+
+  if(accept("{")) {
+    operand.kind = RawOperand::RAW_VECTOR;
+    do {
+      if(peek().kind != TOKEN_IDENT) {
+        return error("malformed vector operand");
+      }
+      operand.elements.push_back(next().text);
+    } while(accept(","));
+    return expect("}");
+  }
+
+  if(accept("!")) {
+    operand.negated = true;
+  }
+
+  if(is("-") && peek(1).kind == TOKEN_NUMBER) {
+    next();
+    operand.kind = RawOperand::RAW_NUMBER;
+    operand.text = "-" + next().text;
+    return true;
+  }
+
+  if(peek().kind == TOKEN_NUMBER) {
+    operand.kind = RawOperand::RAW_NUMBER;
+    operand.text = next().text;
+    return true;
+  }
+
+  if(peek().kind == TOKEN_IDENT) {
+    operand.kind = RawOperand::RAW_NAME;
+    operand.text = next().text;
+    return true;
+  }
+
+  return error("unexpected '" + peek().text + "' in operand list");
+}
+
+bool Parser::lookupRegister(const std::string& name, unsigned& reg) const {
+  std::map<std::string, unsigned>::const_iterator single =
+    registerNames_.find(name);
+  if(single != registerNames_.end()) {
+    reg = single->second;
+    return true;
+  }
+
+  // Ranged declarations: split the trailing digits from the prefix
+  size_t digits = name.size();
+  while(digits > 0 && isdigit((unsigned char)name[digits - 1])) {
+    --digits;
+  }
+  if(digits < name.size()) {
+    std::map<std::string, RegisterRange>::const_iterator range =
+      registerRanges_.find(name.substr(0, digits));
+    unsigned index = (unsigned)atoi(name.c_str() + digits);
+    if(range != registerRanges_.end() && index < range->second.count) {
+      reg = range->second.first + index;
+      return true;
+    }
+  }
+
+  for(unsigned i = 0; i < NUM_SPECIAL_REGISTERS; ++i) {
+    if(name == kSpecialRegisterNames[i]) {
+      reg = i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+bool Parser::resolveName(Function& function, const std::string& name,
+                         Operand& operand) {
+  for(size_t i = 0; i < function.params.size(); ++i) {
+    if(function.params[i].name == name) {
+      operand.kind  = OPERAND_IMMEDIATE;
+      operand.value = function.params[i].offset;
+      return true;
+    }
+  }
+
+  const Variable* variable = NULL;
+  unsigned        symbol   = kNoSymbol;
+  for(size_t i = 0; i < function.variables.size() && !variable; ++i) {
+    if(function.variables[i].name == name) {
+      variable = &function.variables[i];
+    }
+  }
+  for(size_t i = 0; i < module_.variables.size() && !variable; ++i) {
+    if(module_.variables[i].name == name) {
+      variable = &module_.variables[i];
+      symbol   = (unsigned)i;
+    }
+  }
+  if(variable == NULL) {
+    return false;
+  }
+
+  if(variable->space == SPACE_GLOBAL || variable->space == SPACE_CONST) {
+    operand.kind   = OPERAND_SYMBOL;
+    operand.symbol = symbol;
+    operand.value  = 0;
+  } else if(variable->isExtern) {
+    // Dynamic shared memory starts after all static shared variables, which
+    // are declared before any instruction refers to them
+    operand.kind               = OPERAND_IMMEDIATE;
+    operand.value              = alignUp(function.sharedSize, 16);
+    function.usesDynamicShared = true;
+  } else {
+    operand.kind  = OPERAND_IMMEDIATE;
+    operand.value = variable->offset;
+  }
+  return true;
+}
+
+bool Parser::resolveOperand(Function& function, const RawOperand& raw,
+                            DataType immType, Instruction& inst,
+                            unsigned index) {
+  Operand& operand = inst.operands[index];
+
+  switch(raw.kind) {
+  case RawOperand::RAW_NAME:
+    if(raw.text == "_") {
+      operand.kind = OPERAND_REGISTER;
+      return true;
+    }
+    if(lookupRegister(raw.text, operand.reg)) {
+      operand.kind = OPERAND_REGISTER;
+      return true;
+    }
+    if(resolveName(function, raw.text, operand)) {
+      return true;
+    }
+    return errorAt(inst.line, "unknown operand '" + raw.text + "'");
+
+  case RawOperand::RAW_NUMBER:
+    operand.kind = OPERAND_IMMEDIATE;
+    if(!parseLiteral(raw.text, immType, operand.value)) {
+      return errorAt(inst.line, "malformed literal '" + raw.text + "'");
+    }
+    return true;
+
+  case RawOperand::RAW_ADDRESS:
+    operand.kind = OPERAND_ADDRESS;
+    if(!raw.text.empty() && !lookupRegister(raw.text, operand.reg)) {
+      if(!resolveName(function, raw.text, operand)) {
+        return errorAt(inst.line, "unknown address '" + raw.text + "'");
+      }
+      operand.kind = OPERAND_ADDRESS;
+    }
+    operand.value += raw.offset;
+    return true;
+
+  default:
+    return errorAt(inst.line, "unexpected vector operand");
+  }
+}
+
+bool Parser::decodeInstruction(Function& function,
+                               const std::string& mnemonic,
+                               std::vector<RawOperand>& raw, bool piped,
+                               Instruction& inst) {
+  std::vector<std::string> parts;
+  size_t start = 0;
+  for(;;) {
+    size_t dot = mnemonic.find('.', start);
+    parts.push_back(mnemonic.substr(start, dot - start));
+    if(dot == std::string::npos) {
+      break;
+    }
+    start = dot + 1;
+  }
+
+  int opcode = lookup(kOpcodes, parts[0]);
+  if(opcode < 0) {
+    return errorAt(inst.line, "unsupported instruction '" + mnemonic + "'");
+  }
+  inst.opcode = (Opcode)opcode;
+
+  std::vector<DataType> types;
+  for(size_t i = 1; i < parts.size(); ++i) {
+    const std::string& m = parts[i];
+    int value;
+
+    if((value = lookup(kTypes, m)) >= 0) {
+      types.push_back((DataType)value);
+    } else if((value = lookup(kSpaces, m)) >= 0) {
+      inst.space = (StateSpace)value;
+    } else if(m == "v2" || m == "v4") {
+      inst.vector = (unsigned char)(m[1] - '0');
+    } else if(m == "to") {
+      inst.flags |= FLAG_TO;
+    } else if(m == "ftz") {
+      inst.flags |= FLAG_FTZ;
+    } else if(m == "sat") {
+      inst.flags |= FLAG_SAT;
+    } else if(m == "approx") {
+      inst.flags |= FLAG_APPROX;
+    } else if(m == "volatile") {
+      inst.flags |= FLAG_VOLATILE;
+    } else if(m == "uni") {
+      inst.flags |= FLAG_UNIFORM;
+    } else if(inst.opcode == OP_SETP &&
+              (value = lookup(kCompareOps, m)) >= 0) {
+      inst.mode = (unsigned char)value;
+    } else if(inst.opcode == OP_SETP &&
+              (value = lookup(kBoolOps, m)) >= 0) {
+      inst.boolOp = (unsigned char)value;
+    } else if(inst.opcode == OP_TESTP &&
+              (value = lookup(kTestOps, m)) >= 0) {
+      inst.mode = (unsigned char)value;
+    } else if((inst.opcode == OP_ATOM || inst.opcode == OP_RED) &&
+              (value = lookup(kAtomicOps, m)) >= 0) {
+      inst.mode = (unsigned char)value;
+    } else if((inst.opcode == OP_MUL || inst.opcode == OP_MAD ||
+               inst.opcode == OP_MUL24 || inst.opcode == OP_MAD24) &&
+              (value = lookup(kMulModes, m)) >= 0) {
+      inst.mode = (unsigned char)value;
+    } else if(inst.opcode == OP_VOTE &&
+              (value = lookup(kVoteOps, m)) >= 0) {
+      inst.mode = (unsigned char)value;
+    } else if(inst.opcode == OP_SHFL &&
+              (value = lookup(kShuffleOps, m)) >= 0) {
+      inst.mode = (unsigned char)value;
+    } else if((value = lookup(kRoundModes, m)) >= 0) {
+      inst.rounding = (unsigned char)value;
+    } else if(inst.opcode == OP_BAR && (m == "arrive" || m == "red")) {
+      return errorAt(inst.line, "unsupported barrier '" + mnemonic + "'");
+    } else if(!isIgnoredModifier(m)) {
+      return errorAt(inst.line, "unsupported modifier '." + m + "' in '" +
+                     mnemonic + "'");
+    }
+  }
+
+  if(types.size() > 2) {
+    return errorAt(inst.line, "too many types in '" + mnemonic + "'");
+  }
+  if(!types.empty()) {
+    inst.type    = types[0];
+    inst.srcType = types.size() > 1 ? types[1] : types[0];
+  }
+
+  bool untyped = inst.opcode == OP_BRA || inst.opcode == OP_BAR ||
+    inst.opcode == OP_MEMBAR || inst.opcode == OP_RET ||
+    inst.opcode == OP_EXIT || inst.opcode == OP_NOP;
+  if(untyped) {
+    if(inst.opcode == OP_BRA) {
+      if(raw.size() != 1 || raw[0].kind != RawOperand::RAW_NAME) {
+        return errorAt(inst.line, "malformed branch");
+      }
+      LabelFixup fixup = { (unsigned)function.instructions.size(), 0,
+                           raw[0].text, inst.line };
+      fixups_.push_back(fixup);
+      inst.operands[0].kind = OPERAND_LABEL;
+      inst.numOperands      = 1;
+    }
+    return true;
+  }
+  if(inst.type == TYPE_NONE) {
+    return errorAt(inst.line, "missing type in '" + mnemonic + "'");
+  }
+
+  DataType immType = inst.opcode == OP_CVT ? inst.srcType : inst.type;
+
+  // Memory accesses and register packing carry vector operands
+  if(inst.opcode == OP_LD || inst.opcode == OP_ST ||
+     (inst.opcode == OP_MOV && raw.size() == 2 &&
+      (raw[0].kind == RawOperand::RAW_VECTOR ||
+       raw[1].kind == RawOperand::RAW_VECTOR))) {
+    if(raw.size() != 2) {
+      return errorAt(inst.line, "malformed '" + mnemonic + "'");
+    }
+
+    unsigned elementsIndex = inst.opcode == OP_ST ? 1 : 0;
+    unsigned otherIndex    = 1 - elementsIndex;
+
+    if(inst.opcode == OP_MOV) {
+      bool pack        = raw[1].kind == RawOperand::RAW_VECTOR;
+      inst.opcode      = pack ? OP_PACK : OP_UNPACK;
+      elementsIndex    = pack ? 1 : 0;
+      otherIndex       = 1 - elementsIndex;
+    } else if(raw[1 - elementsIndex].kind != RawOperand::RAW_ADDRESS) {
+      return errorAt(inst.line, "expected an address in '" + mnemonic + "'");
+    }
+
+    RawOperand& elements = raw[elementsIndex];
+    std::vector<RawOperand> list;
+    if(elements.kind == RawOperand::RAW_VECTOR) {
+      for(size_t i = 0; i < elements.elements.size(); ++i) {
+        RawOperand element;
+        element.text = elements.elements[i];
+        list.push_back(element);
+      }
+    } else {
+      list.push_back(elements);
+    }
+
+    if(inst.opcode == OP_PACK || inst.opcode == OP_UNPACK) {
+      inst.vector = (unsigned char)list.size();
+    }
+    if(list.size() != inst.vector || list.size() + 1 > kMaxOperands) {
+      return errorAt(inst.line, "operand count mismatch in '" + mnemonic +
+                     "'");
+    }
+
+    // Element registers first; the single operand (address, or the packed
+    // register) last
+    unsigned index = 0;
+    if(inst.opcode == OP_PACK) {
+      if(!resolveOperand(function, raw[otherIndex], immType, inst, index++)) {
+        return false;
+      }
+    }
+    for(size_t i = 0; i < list.size(); ++i) {
+      if(!resolveOperand(function, list[i], immType, inst, index++)) {
+        return false;
+      }
+    }
+    if(inst.opcode != OP_PACK) {
+      if(!resolveOperand(function, raw[otherIndex], immType, inst, index++)) {
+        return false;
+      }
+    }
+    inst.numOperands = (unsigned char)index;
+    return true;
+  }
+
+  // Normalize optional predicate outputs: setp p[|q], a, b[, c] and
+  // shfl d[|p], a, b, c become five operands with absent ones left empty
+  std::vector<const RawOperand*> list;
+  for(size_t i = 0; i < raw.size(); ++i) {
+    if(raw[i].kind == RawOperand::RAW_VECTOR) {
+      return errorAt(inst.line, "unexpected vector operand in '" +
+                     mnemonic + "'");
+    }
+    if(raw[i].negated) {
+      if(i + 1 != raw.size() || (inst.opcode != OP_SETP &&
+                                 inst.opcode != OP_VOTE)) {
+        return errorAt(inst.line, "unsupported negated operand in '" +
+                       mnemonic + "'");
+      }
+      inst.flags |= FLAG_NEG_SOURCE;
+    }
+    list.push_back(&raw[i]);
+  }
+
+  if(inst.opcode == OP_SETP || inst.opcode == OP_SHFL) {
+    if(!piped) {
+      list.insert(list.begin() + 1, (const RawOperand*)NULL);
+    }
+    if(inst.opcode == OP_SHFL && list.size() == 6) {
+      // shfl.sync member mask; every lane of a warp runs in lockstep here
+      list.pop_back();
+    }
+    while(list.size() < 5) {
+      list.push_back(NULL);
+    }
+  }
+
+  static const unsigned char kOperandCounts[NUM_OPCODES] = {
+    2, 0, 0,                // mov, pack, unpack
+    0, 0, 2, 2,             // ld, st, cvta, cvt
+    3, 3, 3, 4, 3, 4,       // add, sub, mul, mad, mul24, mad24
+    4, 3, 3, 2, 2, 3,       // fma, div, rem, abs, neg, min
+    3, 3, 3, 3, 2, 2,       // max, and, or, xor, not, cnot
+    3, 3, 5, 4, 4, 2,       // shl, shr, setp, selp, slct, sqrt
+    2, 2, 2, 2, 2, 2,       // rsqrt, rcp, sin, cos, lg2, ex2
+    2, 2, 2, 4, 5, 4,       // clz, popc, brev, bfe, bfi, prmt
+    3, 2, 0, 2, 2, 5,       // copysign, testp, atom, red, vote, shfl
+    0, 0, 0, 0, 0, 0        // bra, bar, membar, ret, exit, nop
+  };
+
+  unsigned expected = kOperandCounts[inst.opcode];
+  if(inst.opcode == OP_ATOM) {
+    expected = inst.mode == ATOMIC_CAS ? 4 : 3;
+  }
+  if(list.size() != expected) {
+    return errorAt(inst.line, "wrong number of operands for '" + mnemonic +
+                   "'");
+  }
+
+  for(size_t i = 0; i < list.size(); ++i) {
+    if(list[i] == NULL) {
+      continue;
+    }
+
+    // Shift amounts, bit positions and shuffle lanes are always u32; the
+    // predicate of selp and the selector of slct have their own types
+    DataType type = immType;
+    if((inst.opcode == OP_SHL || inst.opcode == OP_SHR) && i == 2) {
+      type = TYPE_U32;
+    } else if(inst.opcode == OP_SLCT && i == 3) {
+      type = inst.srcType;
+    } else if((inst.opcode == OP_BFE || inst.opcode == OP_BFI ||
+               inst.opcode == OP_SHFL) && i >= 2) {
+      type = TYPE_U32;
+    }
+
+    if(!resolveOperand(function, *list[i], type, inst, (unsigned)i)) {
+      return false;
+    }
+  }
+  inst.numOperands = (unsigned char)list.size();
+  return true;
+}
+
+}
+
+//==--- Public Interface ---------------------------------------------------== //
+
+const char* getTypeName(DataType type) {
+  for(const NameEntry* entry = kTypes; entry->name != NULL; ++entry) {
+    if(entry->value == type) {
+      return entry->name;
+    }
+  }
+  return "none";
+}
+
+const char* getSpaceName(StateSpace space) {
+  for(const NameEntry* entry = kSpaces; entry->name != NULL; ++entry) {
+    if(entry->value == space) {
+      return entry->name;
+    }
+  }
+  return "generic";
+}
+
+const char* getOpcodeName(Opcode opcode) {
+  return opcode < NUM_OPCODES ? kOpcodeNames[opcode] : "unknown";
+}
+
+std::string Function::getRegisterName(unsigned reg) const {
+  if(reg < NUM_SPECIAL_REGISTERS) {
+    return kSpecialRegisterNames[reg];
+  }
+
+  for(size_t i = 0; i < registers.size(); ++i) {
+    const RegisterDeclaration& decl = registers[i];
+    if(reg >= decl.first && reg < decl.first + decl.count) {
+      if(decl.count == 1) {
+        return decl.name;
+      }
+      std::ostringstream name;
+      name << decl.name << (reg - decl.first);
+      return name.str();
+    }
+  }
+  return "_";
+}
+
+const Function* Module::findFunction(const std::string& name) const {
+  for(size_t i = 0; i < functions.size(); ++i) {
+    if(functions[i].name == name) {
+      return &functions[i];
+    }
+  }
+  return NULL;
+}
+
+bool parseModule(const std::string& source, Module& module,
+                 std::string& log) {
+  std::vector<Token> tokens;
+  tokenize(source, tokens);
+
+  Parser parser(tokens, module, log);
+  return parser.parse();
+}
+
+}
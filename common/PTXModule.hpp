@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#if !defined(PTX_MODULE_HPP_INC)
+#define PTX_MODULE_HPP_INC 1
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * In-memory form of a PTX module, as produced by llc.
+ *
+ * parseModule() reads PTX assembly into functions holding a flat array of
+ * pre-decoded instructions: opcodes, types and modifiers are resolved to
+ * enumerations, registers to indices and labels to instruction indices, so
+ * consumers never look at text again.  Both the PTX interpreter and the
+ * static analyzer work from this form.
+ */
+namespace ptx {
+
+enum DataType {
+  TYPE_NONE,
+  TYPE_PRED,
+  TYPE_B8,  TYPE_B16, TYPE_B32, TYPE_B64,
+  TYPE_U8,  TYPE_U16, TYPE_U32, TYPE_U64,
+  TYPE_S8,  TYPE_S16, TYPE_S32, TYPE_S64,
+  TYPE_F16, TYPE_F32, TYPE_F64
+};
+
+/// Size of a value of the given type in bytes; predicates count as one.
+unsigned getTypeSize(DataType type);
+
+bool isSignedType(DataType type);
+
+bool isFloatType(DataType type);
+
+const char* getTypeName(DataType type);
+
+enum StateSpace {
+  SPACE_GENERIC,
+  SPACE_GLOBAL,
+  SPACE_SHARED,
+  SPACE_LOCAL,
+  SPACE_PARAM,
+  SPACE_CONST,
+  NUM_SPACES
+};
+
+const char* getSpaceName(StateSpace space);
+
+enum Opcode {
+  OP_MOV,     OP_PACK,    OP_UNPACK,
+  OP_LD,      OP_ST,      OP_CVTA,    OP_CVT,
+  OP_ADD,     OP_SUB,     OP_MUL,     OP_MAD,     OP_MUL24,   OP_MAD24,
+  OP_FMA,     OP_DIV,     OP_REM,     OP_ABS,     OP_NEG,     OP_MIN,
+  OP_MAX,     OP_AND,     OP_OR,      OP_XOR,     OP_NOT,     OP_CNOT,
+  OP_SHL,     OP_SHR,     OP_SETP,    OP_SELP,    OP_SLCT,    OP_SQRT,
+  OP_RSQRT,   OP_RCP,     OP_SIN,     OP_COS,     OP_LG2,     OP_EX2,
+  OP_CLZ,     OP_POPC,    OP_BREV,    OP_BFE,     OP_BFI,     OP_PRMT,
+  OP_COPYSIGN, OP_TESTP,  OP_ATOM,    OP_RED,     OP_VOTE,    OP_SHFL,
+  OP_BRA,     OP_BAR,     OP_MEMBAR,  OP_RET,     OP_EXIT,    OP_NOP,
+  NUM_OPCODES
+};
+
+const char* getOpcodeName(Opcode opcode);
+
+/// Comparison of setp, and the property tested by testp.
+enum CompareOp {
+  CMP_EQ,  CMP_NE,  CMP_LT,  CMP_LE,  CMP_GT,  CMP_GE,
+  CMP_LO,  CMP_LS,  CMP_HI,  CMP_HS,
+  CMP_EQU, CMP_NEU, CMP_LTU, CMP_LEU, CMP_GTU, CMP_GEU,
+  CMP_NUM, CMP_NAN
+};
+
+enum TestOp {
+  TEST_FINITE, TEST_INFINITE, TEST_NUMBER, TEST_NOTANUMBER, TEST_NORMAL,
+  TEST_SUBNORMAL
+};
+
+enum BoolOp {
+  BOOL_NONE, BOOL_AND, BOOL_OR, BOOL_XOR
+};
+
+enum AtomicOp {
+  ATOMIC_ADD, ATOMIC_MIN, ATOMIC_MAX, ATOMIC_INC, ATOMIC_DEC, ATOMIC_CAS,
+  ATOMIC_EXCH, ATOMIC_AND, ATOMIC_OR, ATOMIC_XOR
+};
+
+/// Width modifier of mul and mad on integers.
+enum MulMode {
+  MUL_LO, MUL_HI, MUL_WIDE
+};
+
+enum RoundMode {
+  ROUND_DEFAULT, ROUND_RN, ROUND_RZ, ROUND_RM, ROUND_RP,
+  ROUND_RNI, ROUND_RZI, ROUND_RMI, ROUND_RPI
+};
+
+enum VoteOp {
+  VOTE_ALL, VOTE_ANY, VOTE_UNI, VOTE_BALLOT
+};
+
+enum ShuffleOp {
+  SHFL_IDX, SHFL_UP, SHFL_DOWN, SHFL_BFLY
+};
+
+enum InstructionFlags {
+  FLAG_SAT        = 1 << 0,
+  FLAG_FTZ        = 1 << 1,
+  FLAG_APPROX     = 1 << 2,
+  FLAG_TO         = 1 << 3,   ///< cvta.to: generic to space-specific
+  FLAG_NEG_GUARD  = 1 << 4,   ///< @!%p guard
+  FLAG_VOLATILE   = 1 << 5,
+  FLAG_UNIFORM    = 1 << 6,   ///< bra.uni
+  FLAG_NEG_SOURCE = 1 << 7    ///< Last (predicate) source is negated
+};
+
+/// Register index used for absent operands.
+const unsigned kNoRegister = ~0u;
+
+/// Symbol index used for operands that do not name a module variable.
+const unsigned kNoSymbol = ~0u;
+
+/**
+ * Special registers occupy the first register indices of every function.
+ */
+enum SpecialRegister {
+  SREG_TID_X,    SREG_TID_Y,    SREG_TID_Z,
+  SREG_NTID_X,   SREG_NTID_Y,   SREG_NTID_Z,
+  SREG_CTAID_X,  SREG_CTAID_Y,  SREG_CTAID_Z,
+  SREG_NCTAID_X, SREG_NCTAID_Y, SREG_NCTAID_Z,
+  SREG_LANEID,   SREG_WARPID,   SREG_NWARPID,
+  SREG_SMID,     SREG_NSMID,    SREG_GRIDID,
+  SREG_CLOCK,    SREG_CLOCK64,
+  NUM_SPECIAL_REGISTERS
+};
+
+enum OperandKind {
+  OPERAND_NONE,
+  OPERAND_REGISTER,   ///< reg
+  OPERAND_IMMEDIATE,  ///< value holds the raw bits
+  OPERAND_ADDRESS,    ///< [reg + symbol + value]; reg and symbol optional
+  OPERAND_SYMBOL,     ///< address of a module variable, plus value
+  OPERAND_LABEL       ///< value is an instruction index
+};
+
+struct Operand {
+
+  Operand()
+  : kind(OPERAND_NONE), reg(kNoRegister), symbol(kNoSymbol), value(0) {
+  }
+
+  OperandKind kind;
+  unsigned    reg;
+  unsigned    symbol;
+  int64_t     value;
+};
+
+/// Maximum number of operands of one instruction (bfi, setp with a
+/// predicate combination and vector loads and stores use five).
+const unsigned kMaxOperands = 6;
+
+/**
+ * One pre-decoded instruction.  Vector loads and stores list their element
+ * registers first, followed by the address; every other instruction lists
+ * its destinations first, as in the assembly.
+ */
+struct Instruction {
+
+  Instruction()
+  : opcode(OP_NOP), type(TYPE_NONE), srcType(TYPE_NONE), space(SPACE_GENERIC),
+    vector(1), mode(0), rounding(ROUND_DEFAULT), boolOp(BOOL_NONE), flags(0),
+    numOperands(0), guard(kNoRegister), line(0) {
+  }
+
+  Opcode        opcode;
+  DataType      type;       ///< Instruction type; the destination for cvt
+  DataType      srcType;    ///< Source type of cvt
+  StateSpace    space;
+  unsigned char vector;     ///< Elements of .v2/.v4 accesses, otherwise 1
+  unsigned char mode;       ///< CompareOp, TestOp, AtomicOp, MulMode, ...
+  unsigned char rounding;   ///< RoundMode
+  unsigned char boolOp;     ///< BoolOp of setp
+  unsigned char flags;      ///< InstructionFlags
+  unsigned char numOperands;
+  unsigned      guard;      ///< Guard predicate register, or kNoRegister
+  unsigned      line;       ///< Source line, for diagnostics
+  Operand       operands[kMaxOperands];
+};
+
+/// A .reg declaration, e.g. ".reg .b32 %r<6>;" declares %r0 to %r5.
+struct RegisterDeclaration {
+  std::string name;
+  DataType    type;
+  unsigned    count;
+  unsigned    first;        ///< Register index of the first register
+};
+
+struct Parameter {
+  std::string name;
+  DataType    type;
+  unsigned    size;
+  unsigned    align;
+  unsigned    offset;       ///< Offset within the parameter buffer
+};
+
+/**
+ * A variable in the global, const, shared or local space.  Shared and local
+ * variables are assigned offsets within their space at parse time; global
+ * and const variables are placed by whoever loads the module.
+ */
+struct Variable {
+  std::string                name;
+  StateSpace                 space;
+  DataType                   type;
+  unsigned                   align;
+  size_t                     size;
+  size_t                     offset;
+  bool                       isExtern;   ///< Dynamically sized shared array
+  std::vector<unsigned char> data;       ///< Initializer, if any
+};
+
+class Function {
+public:
+
+  Function()
+  : isEntry(false), paramSize(0), numRegisters(NUM_SPECIAL_REGISTERS),
+    sharedSize(0), localSize(0), usesDynamicShared(false) {
+    for(unsigned i = 0; i < 3; ++i) {
+      maxntid[i] = reqntid[i] = 0;
+    }
+  }
+
+  std::string                      name;
+  bool                             isEntry;
+  std::vector<Parameter>           params;
+  unsigned                         paramSize;
+  std::vector<RegisterDeclaration> registers;
+  unsigned                         numRegisters;
+  std::vector<Instruction>         instructions;
+  std::vector<Variable>            variables;   ///< Function-scope .shared/.local
+  size_t                           sharedSize;  ///< Static shared, incl. module-scope
+  size_t                           localSize;
+  bool                             usesDynamicShared;
+  unsigned                         maxntid[3];
+  unsigned                         reqntid[3];
+
+  /**
+   * Returns the name of the given register, for diagnostics.
+   */
+  std::string getRegisterName(unsigned reg) const;
+};
+
+class Module {
+public:
+
+  Module()
+  : addressSize(32) {
+  }
+
+  std::string           version;
+  std::string           target;
+  unsigned              addressSize;
+  std::vector<Variable> variables;    ///< Module-scope variables
+  std::vector<Function> functions;
+
+  const Function* findFunction(const std::string& name) const;
+};
+
+/**
+ * Parses PTX assembly into module.  Returns false and describes the first
+ * problem in log if the source cannot be parsed or uses instructions the
+ * decoder does not know.
+ */
+bool parseModule(const std::string& source, Module& module, std::string& log);
+
+}
+
+#endif
@@ -23,10 +23,23 @@
 #if !defined(SAMPLE_HPP_INC)
 #define SAMPLE_HPP_INC 1
 
+#include <cstddef>
+#include <sys/time.h>
+
 /**
  * Base class from which all samples inherit.
  */
 class Sample {
+public:
+
+  /**
+   * Returns the current wall-clock time, in seconds.
+   */
+  static double getTimeStamp() {
+    struct timeval tp;
+    gettimeofday(&tp, NULL);
+    return tp.tv_sec + tp.tv_usec * 1.0e-6;
+  }
 };
 
 #endif
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "common/WorkerPool.hpp"
+
+namespace {
+
+pthread_once_t poolOnce = PTHREAD_ONCE_INIT;
+WorkerPool*    pool     = NULL;
+
+}
+
+WorkerPool& WorkerPool::get() {
+  pthread_once(&poolOnce, &WorkerPool::create);
+  return *pool;
+}
+
+void WorkerPool::create() {
+  pool = new WorkerPool();
+}
+
+WorkerPool::WorkerPool()
+: numThreads_(0), nextIndex_(0), generation_(0), numHelpers_(0), pending_(0),
+  job_(NULL), arg_(NULL) {
+  pthread_mutex_init(&runLock_, NULL);
+  pthread_mutex_init(&lock_, NULL);
+  pthread_cond_init(&start_, NULL);
+  pthread_cond_init(&done_, NULL);
+}
+
+void WorkerPool::run(Job job, void* arg, unsigned numWorkers) {
+  unsigned helpers = numWorkers > 1 ? numWorkers - 1 : 0;
+
+  pthread_mutex_lock(&runLock_);
+  pthread_mutex_lock(&lock_);
+
+  while(numThreads_ < helpers) {
+    pthread_t thread;
+    if(pthread_create(&thread, NULL, &WorkerPool::threadMain, this) != 0) {
+      break;
+    }
+    pthread_detach(thread);
+    ++numThreads_;
+  }
+  if(helpers > numThreads_) {
+    helpers = numThreads_;
+  }
+
+  job_        = job;
+  arg_        = arg;
+  numHelpers_ = helpers;
+  pending_    = helpers;
+  ++generation_;
+  pthread_cond_broadcast(&start_);
+  pthread_mutex_unlock(&lock_);
+
+  // The calling thread acts as the first worker
+  job(arg);
+
+  pthread_mutex_lock(&lock_);
+  while(pending_ > 0) {
+    pthread_cond_wait(&done_, &lock_);
+  }
+  pthread_mutex_unlock(&lock_);
+  pthread_mutex_unlock(&runLock_);
+}
+
+void* WorkerPool::threadMain(void* arg) {
+  static_cast<WorkerPool*>(arg)->work();
+  return NULL;
+}
+
+void WorkerPool::work() {
+  pthread_mutex_lock(&lock_);
+
+  // A thread created for a run() joins it: run() cannot return until every
+  // helper it counted has finished
+  unsigned index = nextIndex_++;
+  unsigned seen  = 0;
+
+  for(;;) {
+    while(generation_ == seen) {
+      pthread_cond_wait(&start_, &lock_);
+    }
+    seen = generation_;
+    if(index >= numHelpers_) {
+      continue;
+    }
+
+    Job   job = job_;
+    void* arg = arg_;
+    pthread_mutex_unlock(&lock_);
+    job(arg);
+    pthread_mutex_lock(&lock_);
+
+    if(--pending_ == 0) {
+      pthread_cond_signal(&done_);
+    }
+  }
+}
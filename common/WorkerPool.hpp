@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#if !defined(WORKER_POOL_HPP_INC)
+#define WORKER_POOL_HPP_INC 1
+
+#include <pthread.h>
+
+/**
+ * Threads kept alive from one parallel launch to the next, so that a launch
+ * costs a wake-up per worker rather than a pthread_create and pthread_join.
+ * The host backends run every grid on the process-wide pool, which matters
+ * for benchmarks made of many short launches.
+ */
+class WorkerPool {
+public:
+
+  typedef void (*Job)(void* arg);
+
+  /**
+   * Returns the process-wide pool.  It is never destroyed, since its threads
+   * may still be waiting for work when the process exits.
+   */
+  static WorkerPool& get();
+
+  /**
+   * Calls job(arg) on numWorkers threads, the calling thread among them, and
+   * returns once every call has returned.  The pool grows to numWorkers - 1
+   * threads on demand; if a thread cannot be created, the job runs on fewer.
+   * Calls from several threads run one at a time.
+   */
+  void run(Job job, void* arg, unsigned numWorkers);
+
+private:
+
+  WorkerPool();
+
+  WorkerPool(const WorkerPool&);
+
+  WorkerPool& operator=(const WorkerPool&);
+
+  static void create();
+
+  static void* threadMain(void* arg);
+
+  void work();
+
+  pthread_mutex_t runLock_;     ///< Held for the whole of run()
+  pthread_mutex_t lock_;        ///< Guards everything below
+  pthread_cond_t  start_;
+  pthread_cond_t  done_;
+  unsigned        numThreads_;
+  unsigned        nextIndex_;
+  unsigned        generation_;  ///< Bumped once per run()
+  unsigned        numHelpers_;  ///< Threads with a lower index take part
+  unsigned        pending_;     ///< Helpers yet to finish
+  Job             job_;
+  void*           arg_;
+};
+
+#endif
@@ -0,0 +1,1481 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "cuda.h"
+#include "cudaemu.h"
+#include "common/PTXAnalysis.hpp"
+#include "common/PTXHost.hpp"
+#include "common/PTXInterpreter.hpp"
+
+/**
+ * Stand-in CUDA driver.
+ *
+ * There is one device, the host CPU.  Device memory is host memory: with
+ * 64-bit PTX a CUdeviceptr is simply a host pointer, otherwise it is an
+ * offset into a reserved arena.  Every call completes before it returns, so
+ * streams, asynchronous copies and launches are ordered trivially and an
+ * event records the time at which cuEventRecord was called.
+ */
+
+//==--- Call Counters ------------------------------------------------------== //
+
+#define CUDAEMU_CALLS(X)                                                      \
+  X(cuInit) X(cuDriverGetVersion) X(cuDeviceGet) X(cuDeviceGetCount)          \
+  X(cuDeviceGetName) X(cuDeviceComputeCapability) X(cuDeviceGetAttribute)     \
+  X(cuDeviceTotalMem) X(cuCtxCreate) X(cuCtxDestroy) X(cuCtxSynchronize)      \
+  X(cuModuleLoad) X(cuModuleLoadData) X(cuModuleLoadDataEx)                   \
+  X(cuModuleUnload) X(cuModuleGetFunction) X(cuModuleGetGlobal)               \
+  X(cuFuncGetAttribute) X(cuFuncSetBlockShape) X(cuFuncSetSharedSize)         \
+  X(cuMemGetInfo) X(cuMemAlloc) X(cuMemFree) X(cuMemAllocHost)                \
+  X(cuMemHostAlloc) X(cuMemFreeHost) X(cuMemHostGetDevicePointer)             \
+  X(cuMemcpyHtoD) X(cuMemcpyDtoH) X(cuMemcpyDtoD) X(cuMemcpyHtoDAsync)        \
+  X(cuMemcpyDtoHAsync) X(cuMemsetD8) X(cuMemsetD32) X(cuParamSetSize)         \
+  X(cuParamSeti) X(cuParamSetf) X(cuParamSetv) X(cuLaunch) X(cuLaunchGrid)    \
+  X(cuLaunchGridAsync) X(cuLaunchKernel) X(cuStreamCreate)                    \
+  X(cuStreamDestroy) X(cuStreamQuery) X(cuStreamSynchronize)                  \
+  X(cuEventCreate) X(cuEventDestroy) X(cuEventRecord) X(cuEventQuery)         \
+  X(cuEventSynchronize) X(cuEventElapsedTime)
+
+namespace {
+
+enum CallId {
+#define CUDAEMU_CALL_ID(name) CALL_##name,
+  CUDAEMU_CALLS(CUDAEMU_CALL_ID)
+#undef CUDAEMU_CALL_ID
+  NUM_CALLS
+};
+
+const char* const kCallNames[NUM_CALLS] = {
+#define CUDAEMU_CALL_NAME(name) #name,
+  CUDAEMU_CALLS(CUDAEMU_CALL_NAME)
+#undef CUDAEMU_CALL_NAME
+};
+
+struct CallCounter {
+  uint64_t calls;
+  uint64_t nanoseconds;
+};
+
+CallCounter counters[NUM_CALLS];
+
+uint64_t getNanoseconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+/**
+ * Charges the lifetime of the enclosing scope to one entry point.
+ */
+class CallTimer {
+public:
+
+  explicit CallTimer(CallId id)
+  : id_(id), start_(getNanoseconds()) {
+  }
+
+  ~CallTimer() {
+    __sync_fetch_and_add(&counters[id_].calls, 1);
+    __sync_fetch_and_add(&counters[id_].nanoseconds,
+                         getNanoseconds() - start_);
+  }
+
+private:
+
+  CallId   id_;
+  uint64_t start_;
+};
+
+#define CUDAEMU_ENTRY(name) CallTimer callTimer(CALL_##name)
+
+/**
+ * Prints the counters at exit if CUDAEMU_PROFILE is set.
+ */
+class ProfileReport {
+public:
+
+  ~ProfileReport() {
+    const char* target = getenv("CUDAEMU_PROFILE");
+    if(target == NULL || *target == '\0') {
+      return;
+    }
+
+    FILE* out = strcmp(target, "1") == 0 ? stderr : fopen(target, "w");
+    if(out == NULL) {
+      return;
+    }
+
+    fprintf(out, "%-28s %10s %14s %12s\n", "Call", "Count", "Total (ms)",
+            "Mean (us)");
+    for(unsigned i = 0; i < NUM_CALLS; ++i) {
+      if(counters[i].calls == 0) {
+        continue;
+      }
+      double total = counters[i].nanoseconds * 1e-6;
+      fprintf(out, "%-28s %10llu %14.3f %12.3f\n", kCallNames[i],
+              (unsigned long long)counters[i].calls, total,
+              total * 1e3 / counters[i].calls);
+    }
+    if(out != stderr) {
+      fclose(out);
+    }
+  }
+};
+
+ProfileReport profileReport;
+
+}
+
+//==--- Driver State -------------------------------------------------------== //
+
+struct CUctx_st {
+
+  CUctx_st();
+
+  ~CUctx_st();
+
+  /**
+   * Returns the host address of the device range [address, address +
+   * bytes), or NULL if it is not within one block of memory.  Kernels run
+   * by the PTX interpreter are held to the same check.
+   */
+  unsigned char* translate(CUdeviceptr address, size_t bytes);
+
+  ptx::Memory*               memory;
+  std::map<uint64_t, size_t> allocations;   ///< Made by cuMemAlloc
+  size_t                     allocatedBytes;
+  std::vector<CUmod_st*>     modules;
+  pthread_mutex_t            lock;
+};
+
+struct CUmod_st {
+  CUctx_st*                         context;
+  ptx::Program                      program;
+  std::map<std::string, CUfunc_st*> functions;
+};
+
+struct CUfunc_st {
+  CUmod_st*                  module;
+  const ptx::Kernel*         kernel;
+  CUemuHostKernel            hostKernel;
+  bool                       usesBarriers;
+  unsigned                   numRegisters;
+  unsigned                   block[3];
+  unsigned                   sharedBytes;
+  std::vector<unsigned char> params;      ///< Set by cuParamSet*
+  size_t                     paramSize;
+};
+
+struct CUstream_st {
+  unsigned flags;
+};
+
+struct CUevent_st {
+  unsigned flags;
+  bool     recorded;
+  uint64_t time;
+};
+
+namespace {
+
+/// Address space reserved for device memory when PTX pointers cannot be host
+/// pointers.
+const size_t kArenaSize = (size_t)1 << 30;
+
+const int kNumDevices = 1;
+
+enum Backend {
+  BACKEND_AUTO,
+  BACKEND_PTX,
+  BACKEND_HOST
+};
+
+bool      initialized = false;
+CUcontext current     = NULL;
+
+Backend getBackend() {
+  static int backend = -1;
+  if(backend < 0) {
+    const char* value = getenv("CUDAEMU_BACKEND");
+    if(value != NULL && strcmp(value, "ptx") == 0) {
+      backend = BACKEND_PTX;
+    } else if(value != NULL && strcmp(value, "host") == 0) {
+      backend = BACKEND_HOST;
+    } else {
+      backend = BACKEND_AUTO;
+    }
+  }
+  return (Backend)backend;
+}
+
+typedef std::map<std::string, CUemuHostKernel> HostKernelMap;
+
+/**
+ * Kernels register from static initializers, possibly before this file's
+ * own statics exist, so the registry is created on first use.
+ */
+HostKernelMap& getHostKernels() {
+  static HostKernelMap* kernels = new HostKernelMap();
+  return *kernels;
+}
+
+class Lock {
+public:
+
+  explicit Lock(pthread_mutex_t& mutex)
+  : mutex_(mutex) {
+    pthread_mutex_lock(&mutex_);
+  }
+
+  ~Lock() {
+    pthread_mutex_unlock(&mutex_);
+  }
+
+private:
+
+  pthread_mutex_t& mutex_;
+};
+
+CUresult checkContext() {
+  if(!initialized) {
+    return CUDA_ERROR_NOT_INITIALIZED;
+  }
+  return current != NULL ? CUDA_SUCCESS : CUDA_ERROR_INVALID_CONTEXT;
+}
+
+/**
+ * Copies message into a JIT log buffer of the given capacity and returns
+ * the number of bytes written, including the terminator.
+ */
+size_t writeLog(char* buffer, size_t capacity, const std::string& message) {
+  if(buffer == NULL || capacity == 0) {
+    return 0;
+  }
+  size_t length = std::min(message.size(), capacity - 1);
+  memcpy(buffer, message.data(), length);
+  buffer[length] = '\0';
+  return length + 1;
+}
+
+/**
+ * Calls a registered host kernel for each CTA thread.
+ */
+class HostLaunch : public ptxhost::KernelBody {
+public:
+
+  HostLaunch(CUemuHostKernel kernel, const void* params)
+  : kernel_(kernel), params_(params) {
+  }
+
+  virtual void invoke() {
+    kernel_(params_);
+  }
+
+private:
+
+  CUemuHostKernel kernel_;
+  const void*     params_;
+};
+
+CUresult launch(CUfunction function, const unsigned grid[3],
+                const unsigned block[3], unsigned sharedBytes,
+                const void* params, size_t paramSize) {
+  const ptx::Kernel& kernel = *function->kernel;
+
+  if(grid[0] == 0 || grid[1] == 0 || grid[2] == 0 ||
+     block[0] * block[1] * block[2] == 0 ||
+     block[0] * block[1] * block[2] > kernel.getMaxThreadsPerBlock() ||
+     paramSize < kernel.getParamSize()) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  // Native kernels dereference device pointers directly, so they need
+  // device addresses to be host addresses
+  if(function->hostKernel != NULL && getBackend() != BACKEND_PTX &&
+     current->memory->getBase() == NULL) {
+    // The parameter buffer may be shorter than the host's view of it,
+    // which is padded to the alignment of its largest member
+    std::vector<unsigned char> buffer(paramSize + 16, 0);
+    if(paramSize > 0) {
+      memcpy(&buffer[0], params, paramSize);
+    }
+
+    HostLaunch body(function->hostKernel, &buffer[0]);
+    ptxhost::launchGrid(body, ptxhost::makeDim3(grid[0], grid[1], grid[2]),
+                        ptxhost::makeDim3(block[0], block[1], block[2]),
+                        function->usesBarriers);
+    return CUDA_SUCCESS;
+  }
+
+  std::string error;
+  if(!function->module->program.launch(kernel, grid, block, params,
+                                       paramSize, sharedBytes, error)) {
+    fprintf(stderr, "cudaemu: %s\n", error.c_str());
+    return CUDA_ERROR_LAUNCH_FAILED;
+  }
+  return CUDA_SUCCESS;
+}
+
+CUresult allocate(CUdeviceptr* address, size_t bytes) {
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+  if(address == NULL || bytes == 0) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  Lock     guard(current->lock);
+  uint64_t where = current->memory->allocate(bytes);
+  if(where == 0) {
+    return CUDA_ERROR_OUT_OF_MEMORY;
+  }
+  current->allocations[where] = bytes;
+  current->allocatedBytes    += bytes;
+  *address = (CUdeviceptr)where;
+  return CUDA_SUCCESS;
+}
+
+CUresult release(CUdeviceptr address) {
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+
+  Lock guard(current->lock);
+  std::map<uint64_t, size_t>::iterator block =
+    current->allocations.find(address);
+  if(block == current->allocations.end()) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  current->allocatedBytes -= block->second;
+  current->memory->release(block->first);
+  current->allocations.erase(block);
+  return CUDA_SUCCESS;
+}
+
+CUresult allocateHost(void** pointer, size_t bytes) {
+  if(pointer == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  // Host memory is allocated as device memory, which makes every host
+  // allocation mapped
+  CUdeviceptr address;
+  CUresult    status = allocate(&address, bytes);
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+  *pointer = current->memory->getBase() + address;
+  return CUDA_SUCCESS;
+}
+
+CUresult copyToDevice(CUdeviceptr destination, const void* source,
+                      size_t bytes) {
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+
+  unsigned char* target = current->translate(destination, bytes);
+  if(target == NULL || source == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  memcpy(target, source, bytes);
+  return CUDA_SUCCESS;
+}
+
+CUresult copyToHost(void* destination, CUdeviceptr source, size_t bytes) {
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+
+  const unsigned char* data = current->translate(source, bytes);
+  if(data == NULL || destination == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  memcpy(destination, data, bytes);
+  return CUDA_SUCCESS;
+}
+
+CUresult setParams(CUfunction function, int offset, const void* data,
+                   unsigned bytes) {
+  if(function == NULL || offset < 0 || (data == NULL && bytes > 0)) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  if(function->params.size() < offset + bytes) {
+    function->params.resize(offset + bytes, 0);
+  }
+  memcpy(&function->params[offset], data, bytes);
+  return CUDA_SUCCESS;
+}
+
+CUresult launchGrid(CUfunction function, int width, int height) {
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+  if(function == NULL || width <= 0 || height <= 0) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  unsigned grid[3] = { (unsigned)width, (unsigned)height, 1 };
+  return launch(function, grid, function->block, function->sharedBytes,
+                function->params.empty() ? NULL : &function->params[0],
+                function->paramSize);
+}
+
+CUresult loadModule(CUmodule* module, const void* image,
+                    unsigned numOptions, CUjit_option* options,
+                    void** optionValues) {
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+  if(module == NULL || image == NULL ||
+     (numOptions > 0 && (options == NULL || optionValues == NULL))) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  uint64_t start = getNanoseconds();
+
+  std::string log;
+  CUmod_st*   result = new CUmod_st();
+  result->context = current;
+
+  const char* text = static_cast<const char*>(image);
+  if(memcmp(text, "\177ELF", 4) == 0) {
+    log    = "cudaemu: only PTX images are supported";
+    status = CUDA_ERROR_NO_BINARY_FOR_GPU;
+  } else if(!result->program.load(text, *current->memory, log)) {
+    status = CUDA_ERROR_INVALID_IMAGE;
+  }
+
+  std::ostringstream info;
+  if(status == CUDA_SUCCESS) {
+    const ptx::Module& parsed = result->program.getModule();
+    info << "cudaemu: loaded " << parsed.functions.size()
+         << " functions for " << parsed.target << " (" << parsed.addressSize
+         << "-bit)";
+  }
+
+  // Log buffers and their sizes may come in either order
+  char*  errorLog  = NULL;
+  char*  infoLog   = NULL;
+  size_t errorSize = 0;
+  size_t infoSize  = 0;
+  for(unsigned i = 0; i < numOptions; ++i) {
+    switch(options[i]) {
+    case CU_JIT_ERROR_LOG_BUFFER:
+      errorLog = static_cast<char*>(optionValues[i]);
+      break;
+    case CU_JIT_ERROR_LOG_BUFFER_SIZE_BYTES:
+      errorSize = (size_t)optionValues[i];
+      break;
+    case CU_JIT_INFO_LOG_BUFFER:
+      infoLog = static_cast<char*>(optionValues[i]);
+      break;
+    case CU_JIT_INFO_LOG_BUFFER_SIZE_BYTES:
+      infoSize = (size_t)optionValues[i];
+      break;
+    default:
+      break;
+    }
+  }
+  errorSize = writeLog(errorLog, errorSize, log);
+  infoSize  = writeLog(infoLog, infoSize, info.str());
+
+  float wallTime = (getNanoseconds() - start) * 1e-6f;
+  for(unsigned i = 0; i < numOptions; ++i) {
+    switch(options[i]) {
+    case CU_JIT_ERROR_LOG_BUFFER_SIZE_BYTES:
+      optionValues[i] = (void*)errorSize;
+      break;
+    case CU_JIT_INFO_LOG_BUFFER_SIZE_BYTES:
+      optionValues[i] = (void*)infoSize;
+      break;
+    case CU_JIT_WALL_TIME:
+      memcpy(&optionValues[i], &wallTime, sizeof(wallTime));
+      break;
+    default:
+      break;
+    }
+  }
+
+  if(status != CUDA_SUCCESS) {
+    delete result;
+    return status;
+  }
+
+  current->modules.push_back(result);
+  *module = result;
+  return CUDA_SUCCESS;
+}
+
+
+}
+
+CUctx_st::CUctx_st()
+: allocatedBytes(0) {
+  // Device pointers can be host pointers when they fit in a CUdeviceptr.
+  // Both memories track their blocks, so a wild pointer in a PTX kernel
+  // still fails the launch rather than touching the host.
+  if(sizeof(void*) == 8) {
+    memory = new ptx::HostMemory();
+  } else {
+    memory = new ptx::ArenaMemory(kArenaSize);
+  }
+  pthread_mutex_init(&lock, NULL);
+}
+
+CUctx_st::~CUctx_st() {
+  for(size_t i = 0; i < modules.size(); ++i) {
+    std::map<std::string, CUfunc_st*>& functions = modules[i]->functions;
+    for(std::map<std::string, CUfunc_st*>::iterator f = functions.begin();
+        f != functions.end(); ++f) {
+      delete f->second;
+    }
+    delete modules[i];
+  }
+  for(std::map<uint64_t, size_t>::iterator block = allocations.begin();
+      block != allocations.end(); ++block) {
+    memory->release(block->first);
+  }
+  delete memory;
+  pthread_mutex_destroy(&lock);
+}
+
+unsigned char* CUctx_st::translate(CUdeviceptr address, size_t bytes) {
+  uint64_t start;
+  size_t   size;
+
+  if(!memory->findAllocation(address, start, size)
+     || bytes > size - (address - start)) {
+    return NULL;
+  }
+  return memory->getBase() + address;
+}
+
+//==--- Initialization and Devices -----------------------------------------== //
+
+CUresult cuInit(unsigned int flags) {
+  CUDAEMU_ENTRY(cuInit);
+  if(flags != 0) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  initialized = true;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuDriverGetVersion(int* version) {
+  CUDAEMU_ENTRY(cuDriverGetVersion);
+  if(version == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  *version = CUDA_VERSION;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuDeviceGet(CUdevice* device, int ordinal) {
+  CUDAEMU_ENTRY(cuDeviceGet);
+  if(!initialized) {
+    return CUDA_ERROR_NOT_INITIALIZED;
+  }
+  if(device == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  if(ordinal < 0 || ordinal >= kNumDevices) {
+    return CUDA_ERROR_INVALID_DEVICE;
+  }
+  *device = ordinal;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuDeviceGetCount(int* count) {
+  CUDAEMU_ENTRY(cuDeviceGetCount);
+  if(!initialized) {
+    return CUDA_ERROR_NOT_INITIALIZED;
+  }
+  if(count == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  *count = kNumDevices;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuDeviceGetName(char* name, int length, CUdevice device) {
+  CUDAEMU_ENTRY(cuDeviceGetName);
+  if(!initialized) {
+    return CUDA_ERROR_NOT_INITIALIZED;
+  }
+  if(device < 0 || device >= kNumDevices) {
+    return CUDA_ERROR_INVALID_DEVICE;
+  }
+  if(name == NULL || length <= 0) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  writeLog(name, length, "cudaemu CPU device");
+  return CUDA_SUCCESS;
+}
+
+CUresult cuDeviceComputeCapability(int* major, int* minor, CUdevice device) {
+  CUDAEMU_ENTRY(cuDeviceComputeCapability);
+  if(!initialized) {
+    return CUDA_ERROR_NOT_INITIALIZED;
+  }
+  if(device < 0 || device >= kNumDevices) {
+    return CUDA_ERROR_INVALID_DEVICE;
+  }
+  if(major == NULL || minor == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  // The samples are compiled for sm_20
+  *major = 2;
+  *minor = 0;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuDeviceGetAttribute(int* value, CUdevice_attribute attribute,
+                              CUdevice device) {
+  CUDAEMU_ENTRY(cuDeviceGetAttribute);
+  if(!initialized) {
+    return CUDA_ERROR_NOT_INITIALIZED;
+  }
+  if(device < 0 || device >= kNumDevices) {
+    return CUDA_ERROR_INVALID_DEVICE;
+  }
+  if(value == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  const ptx::SMModel& model = *ptx::findSMModel("sm_20");
+  switch(attribute) {
+  case CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_BLOCK:
+  case CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_X:
+  case CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_Y:
+    *value = 1024;
+    break;
+  case CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_Z:
+    *value = 64;
+    break;
+  case CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_X:
+  case CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_Y:
+  case CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_Z:
+    *value = 65535;
+    break;
+  case CU_DEVICE_ATTRIBUTE_MAX_SHARED_MEMORY_PER_BLOCK:
+    *value = (int)model.maxSharedPerBlock;
+    break;
+  case CU_DEVICE_ATTRIBUTE_TOTAL_CONSTANT_MEMORY:
+    *value = 65536;
+    break;
+  case CU_DEVICE_ATTRIBUTE_WARP_SIZE:
+    *value = (int)ptx::kWarpSize;
+    break;
+  case CU_DEVICE_ATTRIBUTE_MAX_REGISTERS_PER_BLOCK:
+    *value = (int)model.registers;
+    break;
+  case CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT:
+    *value = (int)ptx::getDefaultWorkerCount();
+    break;
+  case CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_MULTIPROCESSOR:
+    *value = (int)(model.maxWarps * ptx::kWarpSize);
+    break;
+  case CU_DEVICE_ATTRIBUTE_CAN_MAP_HOST_MEMORY:
+  case CU_DEVICE_ATTRIBUTE_INTEGRATED:
+  case CU_DEVICE_ATTRIBUTE_UNIFIED_ADDRESSING:
+    *value = sizeof(void*) == 8 ? 1 : 0;
+    break;
+  case CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MAJOR:
+    *value = 2;
+    break;
+  case CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MINOR:
+  case CU_DEVICE_ATTRIBUTE_GPU_OVERLAP:
+  case CU_DEVICE_ATTRIBUTE_KERNEL_EXEC_TIMEOUT:
+  case CU_DEVICE_ATTRIBUTE_COMPUTE_MODE:
+  case CU_DEVICE_ATTRIBUTE_CONCURRENT_KERNELS:
+  case CU_DEVICE_ATTRIBUTE_ECC_ENABLED:
+  case CU_DEVICE_ATTRIBUTE_ASYNC_ENGINE_COUNT:
+    *value = 0;
+    break;
+  default:
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  return CUDA_SUCCESS;
+}
+
+CUresult cuDeviceTotalMem(size_t* bytes, CUdevice device) {
+  CUDAEMU_ENTRY(cuDeviceTotalMem);
+  if(!initialized) {
+    return CUDA_ERROR_NOT_INITIALIZED;
+  }
+  if(device < 0 || device >= kNumDevices) {
+    return CUDA_ERROR_INVALID_DEVICE;
+  }
+  if(bytes == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  if(sizeof(void*) == 8) {
+    *bytes = (size_t)sysconf(_SC_PHYS_PAGES) * (size_t)sysconf(_SC_PAGESIZE);
+  } else {
+    *bytes = kArenaSize;
+  }
+  return CUDA_SUCCESS;
+}
+
+//==--- Contexts -----------------------------------------------------------== //
+
+CUresult cuCtxCreate(CUcontext* context, unsigned int, CUdevice device) {
+  CUDAEMU_ENTRY(cuCtxCreate);
+  if(!initialized) {
+    return CUDA_ERROR_NOT_INITIALIZED;
+  }
+  if(device < 0 || device >= kNumDevices) {
+    return CUDA_ERROR_INVALID_DEVICE;
+  }
+  if(context == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  *context = current = new CUctx_st();
+  return CUDA_SUCCESS;
+}
+
+CUresult cuCtxDestroy(CUcontext context) {
+  CUDAEMU_ENTRY(cuCtxDestroy);
+  if(!initialized) {
+    return CUDA_ERROR_NOT_INITIALIZED;
+  }
+  if(context == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  if(context == current) {
+    current = NULL;
+  }
+  delete context;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuCtxSynchronize(void) {
+  CUDAEMU_ENTRY(cuCtxSynchronize);
+  return checkContext();
+}
+
+//==--- Modules and Functions ----------------------------------------------== //
+
+CUresult cuModuleLoadDataEx(CUmodule* module, const void* image,
+                            unsigned int numOptions, CUjit_option* options,
+                            void** optionValues) {
+  CUDAEMU_ENTRY(cuModuleLoadDataEx);
+  return loadModule(module, image, numOptions, options, optionValues);
+}
+
+CUresult cuModuleLoadData(CUmodule* module, const void* image) {
+  CUDAEMU_ENTRY(cuModuleLoadData);
+  return loadModule(module, image, 0, NULL, NULL);
+}
+
+CUresult cuModuleLoad(CUmodule* module, const char* filename) {
+  CUDAEMU_ENTRY(cuModuleLoad);
+  if(filename == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  std::ifstream file(filename);
+  if(!file.is_open()) {
+    return CUDA_ERROR_FILE_NOT_FOUND;
+  }
+  std::string source(std::istreambuf_iterator<char>(file),
+                     (std::istreambuf_iterator<char>()));
+  return loadModule(module, source.c_str(), 0, NULL, NULL);
+}
+
+CUresult cuModuleUnload(CUmodule module) {
+  CUDAEMU_ENTRY(cuModuleUnload);
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+
+  std::vector<CUmod_st*>& modules = module->context->modules;
+  std::vector<CUmod_st*>::iterator entry = std::find(modules.begin(),
+                                                     modules.end(), module);
+  if(entry == modules.end()) {
+    return CUDA_ERROR_INVALID_HANDLE;
+  }
+  modules.erase(entry);
+
+  for(std::map<std::string, CUfunc_st*>::iterator f =
+        module->functions.begin(); f != module->functions.end(); ++f) {
+    delete f->second;
+  }
+  delete module;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuModuleGetFunction(CUfunction* function, CUmodule module,
+                             const char* name) {
+  CUDAEMU_ENTRY(cuModuleGetFunction);
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+  if(function == NULL || module == NULL || name == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  std::map<std::string, CUfunc_st*>::iterator cached =
+    module->functions.find(name);
+  if(cached != module->functions.end()) {
+    *function = cached->second;
+    return CUDA_SUCCESS;
+  }
+
+  const ptx::Kernel* kernel = module->program.getKernel(name);
+  if(kernel == NULL) {
+    return CUDA_ERROR_NOT_FOUND;
+  }
+
+  HostKernelMap::const_iterator host = getHostKernels().find(name);
+  if(getBackend() == BACKEND_HOST && host == getHostKernels().end()) {
+    fprintf(stderr, "cudaemu: no host implementation of %s registered\n",
+            name);
+    return CUDA_ERROR_NOT_FOUND;
+  }
+
+  CUfunc_st* result   = new CUfunc_st();
+  result->module      = module;
+  result->kernel      = kernel;
+  result->hostKernel  = host != getHostKernels().end() ? host->second : NULL;
+  result->sharedBytes = 0;
+  result->paramSize   = 0;
+  for(unsigned i = 0; i < 3; ++i) {
+    result->block[i] = 1;
+  }
+
+  // Host kernels only need fibers if they synchronize
+  const ptx::Function& parsed = kernel->getFunction();
+  result->usesBarriers = false;
+  for(size_t i = 0; i < parsed.instructions.size(); ++i) {
+    if(parsed.instructions[i].opcode == ptx::OP_BAR) {
+      result->usesBarriers = true;
+    }
+  }
+
+  ptx::KernelStats stats;
+  ptx::analyzeFunction(parsed, stats);
+  result->numRegisters = stats.estimatedRegisters;
+
+  module->functions[name] = result;
+  *function = result;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuModuleGetGlobal(CUdeviceptr* address, size_t* bytes,
+                           CUmodule module, const char* name) {
+  CUDAEMU_ENTRY(cuModuleGetGlobal);
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+  if(module == NULL || name == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  uint64_t where;
+  size_t   size;
+  if(!module->program.getGlobal(name, where, size)) {
+    return CUDA_ERROR_NOT_FOUND;
+  }
+  if(address != NULL) {
+    *address = (CUdeviceptr)where;
+  }
+  if(bytes != NULL) {
+    *bytes = size;
+  }
+  return CUDA_SUCCESS;
+}
+
+CUresult cuFuncGetAttribute(int* value, CUfunction_attribute attribute,
+                            CUfunction function) {
+  CUDAEMU_ENTRY(cuFuncGetAttribute);
+  if(value == NULL || function == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  const ptx::Kernel& kernel = *function->kernel;
+  switch(attribute) {
+  case CU_FUNC_ATTRIBUTE_MAX_THREADS_PER_BLOCK:
+    *value = (int)kernel.getMaxThreadsPerBlock();
+    break;
+  case CU_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES:
+    *value = (int)kernel.getSharedSize();
+    break;
+  case CU_FUNC_ATTRIBUTE_CONST_SIZE_BYTES:
+    *value = 0;
+    break;
+  case CU_FUNC_ATTRIBUTE_LOCAL_SIZE_BYTES:
+    *value = (int)kernel.getLocalSize();
+    break;
+  case CU_FUNC_ATTRIBUTE_NUM_REGS:
+    *value = (int)function->numRegisters;
+    break;
+  case CU_FUNC_ATTRIBUTE_PTX_VERSION:
+  case CU_FUNC_ATTRIBUTE_BINARY_VERSION:
+    *value = 20;
+    break;
+  default:
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  return CUDA_SUCCESS;
+}
+
+CUresult cuFuncSetBlockShape(CUfunction function, int x, int y, int z) {
+  CUDAEMU_ENTRY(cuFuncSetBlockShape);
+  if(function == NULL || x <= 0 || y <= 0 || z <= 0) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  function->block[0] = (unsigned)x;
+  function->block[1] = (unsigned)y;
+  function->block[2] = (unsigned)z;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuFuncSetSharedSize(CUfunction function, unsigned int bytes) {
+  CUDAEMU_ENTRY(cuFuncSetSharedSize);
+  if(function == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  function->sharedBytes = bytes;
+  return CUDA_SUCCESS;
+}
+
+//==--- Memory -------------------------------------------------------------== //
+
+CUresult cuMemGetInfo(size_t* free, size_t* total) {
+  CUDAEMU_ENTRY(cuMemGetInfo);
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+  if(free == NULL || total == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  cuDeviceTotalMem(total, 0);
+  Lock guard(current->lock);
+  *free = *total > current->allocatedBytes ?
+    *total - current->allocatedBytes : 0;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuMemAlloc(CUdeviceptr* address, size_t bytes) {
+  CUDAEMU_ENTRY(cuMemAlloc);
+  return allocate(address, bytes);
+}
+
+CUresult cuMemFree(CUdeviceptr address) {
+  CUDAEMU_ENTRY(cuMemFree);
+  return release(address);
+}
+
+CUresult cuMemHostAlloc(void** pointer, size_t bytes, unsigned int) {
+  CUDAEMU_ENTRY(cuMemHostAlloc);
+  return allocateHost(pointer, bytes);
+}
+
+CUresult cuMemAllocHost(void** pointer, size_t bytes) {
+  CUDAEMU_ENTRY(cuMemAllocHost);
+  return allocateHost(pointer, bytes);
+}
+
+CUresult cuMemFreeHost(void* pointer) {
+  CUDAEMU_ENTRY(cuMemFreeHost);
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+  return release((CUdeviceptr)(static_cast<unsigned char*>(pointer) -
+                               current->memory->getBase()));
+}
+
+CUresult cuMemHostGetDevicePointer(CUdeviceptr* address, void* pointer,
+                                   unsigned int flags) {
+  CUDAEMU_ENTRY(cuMemHostGetDevicePointer);
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+  if(address == NULL || pointer == NULL || flags != 0) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  CUdeviceptr where = (CUdeviceptr)(static_cast<unsigned char*>(pointer) -
+                                    current->memory->getBase());
+  if(current->translate(where, 1) == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  *address = where;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuMemcpyHtoD(CUdeviceptr destination, const void* source,
+                      size_t bytes) {
+  CUDAEMU_ENTRY(cuMemcpyHtoD);
+  return copyToDevice(destination, source, bytes);
+}
+
+CUresult cuMemcpyDtoH(void* destination, CUdeviceptr source, size_t bytes) {
+  CUDAEMU_ENTRY(cuMemcpyDtoH);
+  return copyToHost(destination, source, bytes);
+}
+
+CUresult cuMemcpyDtoD(CUdeviceptr destination, CUdeviceptr source,
+                      size_t bytes) {
+  CUDAEMU_ENTRY(cuMemcpyDtoD);
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+
+  unsigned char*       target = current->translate(destination, bytes);
+  const unsigned char* data   = current->translate(source, bytes);
+  if(target == NULL || data == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  memmove(target, data, bytes);
+  return CUDA_SUCCESS;
+}
+
+CUresult cuMemcpyHtoDAsync(CUdeviceptr destination, const void* source,
+                           size_t bytes, CUstream) {
+  CUDAEMU_ENTRY(cuMemcpyHtoDAsync);
+  return copyToDevice(destination, source, bytes);
+}
+
+CUresult cuMemcpyDtoHAsync(void* destination, CUdeviceptr source,
+                           size_t bytes, CUstream) {
+  CUDAEMU_ENTRY(cuMemcpyDtoHAsync);
+  return copyToHost(destination, source, bytes);
+}
+
+CUresult cuMemsetD8(CUdeviceptr destination, unsigned char value,
+                    size_t count) {
+  CUDAEMU_ENTRY(cuMemsetD8);
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+
+  unsigned char* target = current->translate(destination, count);
+  if(target == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  memset(target, value, count);
+  return CUDA_SUCCESS;
+}
+
+CUresult cuMemsetD32(CUdeviceptr destination, unsigned int value,
+                     size_t count) {
+  CUDAEMU_ENTRY(cuMemsetD32);
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+
+  unsigned char* target = current->translate(destination, count * 4);
+  if(target == NULL || destination % 4 != 0) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  for(size_t i = 0; i < count; ++i) {
+    memcpy(target + i * 4, &value, 4);
+  }
+  return CUDA_SUCCESS;
+}
+
+//==--- Execution ----------------------------------------------------------== //
+
+CUresult cuParamSetSize(CUfunction function, unsigned int bytes) {
+  CUDAEMU_ENTRY(cuParamSetSize);
+  if(function == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  function->paramSize = bytes;
+  if(function->params.size() < bytes) {
+    function->params.resize(bytes, 0);
+  }
+  return CUDA_SUCCESS;
+}
+
+CUresult cuParamSetv(CUfunction function, int offset, void* data,
+                     unsigned int bytes) {
+  CUDAEMU_ENTRY(cuParamSetv);
+  return setParams(function, offset, data, bytes);
+}
+
+CUresult cuParamSeti(CUfunction function, int offset, unsigned int value) {
+  CUDAEMU_ENTRY(cuParamSeti);
+  return setParams(function, offset, &value, sizeof(value));
+}
+
+CUresult cuParamSetf(CUfunction function, int offset, float value) {
+  CUDAEMU_ENTRY(cuParamSetf);
+  return setParams(function, offset, &value, sizeof(value));
+}
+
+CUresult cuLaunchGrid(CUfunction function, int width, int height) {
+  CUDAEMU_ENTRY(cuLaunchGrid);
+  return launchGrid(function, width, height);
+}
+
+CUresult cuLaunch(CUfunction function) {
+  CUDAEMU_ENTRY(cuLaunch);
+  return launchGrid(function, 1, 1);
+}
+
+CUresult cuLaunchGridAsync(CUfunction function, int width, int height,
+                           CUstream) {
+  CUDAEMU_ENTRY(cuLaunchGridAsync);
+  return launchGrid(function, width, height);
+}
+
+CUresult cuLaunchKernel(CUfunction function,
+                        unsigned int gridX, unsigned int gridY,
+                        unsigned int gridZ,
+                        unsigned int blockX, unsigned int blockY,
+                        unsigned int blockZ,
+                        unsigned int sharedBytes, CUstream,
+                        void** kernelParams, void** extra) {
+  CUDAEMU_ENTRY(cuLaunchKernel);
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+  if(function == NULL || (kernelParams != NULL && extra != NULL)) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  const ptx::Function&       parsed = function->kernel->getFunction();
+  std::vector<unsigned char> buffer(parsed.paramSize + 1, 0);
+  const void*                params = &buffer[0];
+  size_t                     size   = parsed.paramSize;
+
+  if(kernelParams != NULL) {
+    // One pointer per declared parameter
+    for(size_t i = 0; i < parsed.params.size(); ++i) {
+      const ptx::Parameter& param = parsed.params[i];
+      if(kernelParams[i] == NULL) {
+        return CUDA_ERROR_INVALID_VALUE;
+      }
+      memcpy(&buffer[param.offset], kernelParams[i], param.size);
+    }
+  } else if(extra != NULL) {
+    params = NULL;
+    for(size_t i = 0; extra[i] != CU_LAUNCH_PARAM_END; i += 2) {
+      if(extra[i] == CU_LAUNCH_PARAM_BUFFER_POINTER) {
+        params = extra[i + 1];
+      } else if(extra[i] == CU_LAUNCH_PARAM_BUFFER_SIZE) {
+        size = *static_cast<size_t*>(extra[i + 1]);
+      } else {
+        return CUDA_ERROR_INVALID_VALUE;
+      }
+    }
+    if(params == NULL) {
+      return CUDA_ERROR_INVALID_VALUE;
+    }
+  } else if(parsed.paramSize > 0) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+
+  unsigned grid[3]  = { gridX, gridY, gridZ };
+  unsigned block[3] = { blockX, blockY, blockZ };
+  return launch(function, grid, block, sharedBytes, params, size);
+}
+
+//==--- Streams and Events -------------------------------------------------== //
+
+CUresult cuStreamCreate(CUstream* stream, unsigned int flags) {
+  CUDAEMU_ENTRY(cuStreamCreate);
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+  if(stream == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  *stream          = new CUstream_st();
+  (*stream)->flags = flags;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuStreamDestroy(CUstream stream) {
+  CUDAEMU_ENTRY(cuStreamDestroy);
+  if(stream == NULL) {
+    return CUDA_ERROR_INVALID_HANDLE;
+  }
+  delete stream;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuStreamQuery(CUstream) {
+  CUDAEMU_ENTRY(cuStreamQuery);
+  return checkContext();
+}
+
+CUresult cuStreamSynchronize(CUstream) {
+  CUDAEMU_ENTRY(cuStreamSynchronize);
+  return checkContext();
+}
+
+CUresult cuEventCreate(CUevent* event, unsigned int flags) {
+  CUDAEMU_ENTRY(cuEventCreate);
+  CUresult status = checkContext();
+  if(status != CUDA_SUCCESS) {
+    return status;
+  }
+  if(event == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  *event             = new CUevent_st();
+  (*event)->flags    = flags;
+  (*event)->recorded = false;
+  (*event)->time     = 0;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuEventDestroy(CUevent event) {
+  CUDAEMU_ENTRY(cuEventDestroy);
+  if(event == NULL) {
+    return CUDA_ERROR_INVALID_HANDLE;
+  }
+  delete event;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuEventRecord(CUevent event, CUstream) {
+  CUDAEMU_ENTRY(cuEventRecord);
+  if(event == NULL) {
+    return CUDA_ERROR_INVALID_HANDLE;
+  }
+
+  // All earlier work has completed by now
+  event->time     = getNanoseconds();
+  event->recorded = true;
+  return CUDA_SUCCESS;
+}
+
+CUresult cuEventQuery(CUevent event) {
+  CUDAEMU_ENTRY(cuEventQuery);
+  return event != NULL ? CUDA_SUCCESS : CUDA_ERROR_INVALID_HANDLE;
+}
+
+CUresult cuEventSynchronize(CUevent event) {
+  CUDAEMU_ENTRY(cuEventSynchronize);
+  return event != NULL ? CUDA_SUCCESS : CUDA_ERROR_INVALID_HANDLE;
+}
+
+CUresult cuEventElapsedTime(float* milliseconds, CUevent start, CUevent end) {
+  CUDAEMU_ENTRY(cuEventElapsedTime);
+  if(milliseconds == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  if(start == NULL || end == NULL ||
+     ((start->flags | end->flags) & CU_EVENT_DISABLE_TIMING) != 0) {
+    return CUDA_ERROR_INVALID_HANDLE;
+  }
+  if(!start->recorded || !end->recorded) {
+    return CUDA_ERROR_NOT_READY;
+  }
+  *milliseconds = (float)(((int64_t)end->time - (int64_t)start->time) * 1e-6);
+  return CUDA_SUCCESS;
+}
+
+//==--- Errors -------------------------------------------------------------== //
+
+CUresult cuGetErrorString(CUresult error, const char** string) {
+  static const struct {
+    CUresult    error;
+    const char* string;
+  } kErrors[] = {
+    { CUDA_SUCCESS,                       "no error" },
+    { CUDA_ERROR_INVALID_VALUE,           "invalid argument" },
+    { CUDA_ERROR_OUT_OF_MEMORY,           "out of memory" },
+    { CUDA_ERROR_NOT_INITIALIZED,         "initialization error" },
+    { CUDA_ERROR_DEINITIALIZED,           "driver shutting down" },
+    { CUDA_ERROR_NO_DEVICE,               "no CUDA-capable device" },
+    { CUDA_ERROR_INVALID_DEVICE,          "invalid device ordinal" },
+    { CUDA_ERROR_INVALID_IMAGE,           "device kernel image is invalid" },
+    { CUDA_ERROR_INVALID_CONTEXT,         "invalid device context" },
+    { CUDA_ERROR_NO_BINARY_FOR_GPU,       "no kernel image for the device" },
+    { CUDA_ERROR_FILE_NOT_FOUND,          "file not found" },
+    { CUDA_ERROR_INVALID_HANDLE,          "invalid resource handle" },
+    { CUDA_ERROR_NOT_FOUND,               "named symbol not found" },
+    { CUDA_ERROR_NOT_READY,               "device not ready" },
+    { CUDA_ERROR_LAUNCH_FAILED,           "unspecified launch failure" },
+    { CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES, "too many resources requested" },
+    { CUDA_ERROR_NOT_SUPPORTED,           "operation not supported" }
+  };
+
+  if(string == NULL) {
+    return CUDA_ERROR_INVALID_VALUE;
+  }
+  for(size_t i = 0; i < sizeof(kErrors) / sizeof(kErrors[0]); ++i) {
+    if(kErrors[i].error == error) {
+      *string = kErrors[i].string;
+      return CUDA_SUCCESS;
+    }
+  }
+  *string = "unknown error";
+  return CUDA_SUCCESS;
+}
+
+//==--- Extensions ---------------------------------------------------------== //
+
+void cuemuRegisterHostKernel(const char* name, CUemuHostKernel kernel) {
+  getHostKernels()[name] = kernel;
+}
+
+unsigned int cuemuGetCallStats(CUemuCallStats* stats, unsigned int maxStats) {
+  unsigned count = 0;
+  for(unsigned i = 0; i < NUM_CALLS; ++i) {
+    if(counters[i].calls == 0) {
+      continue;
+    }
+    if(stats != NULL && count < maxStats) {
+      stats[count].name    = kCallNames[i];
+      stats[count].calls   = counters[i].calls;
+      stats[count].seconds = counters[i].nanoseconds * 1e-9;
+    }
+    ++count;
+  }
+  return count;
+}
+
+void cuemuResetCallStats(void) {
+  memset(counters, 0, sizeof(counters));
+}
+
+//==--- Versioned Entry Points ---------------------------------------------== //
+
+// Programs built against the NVidia header since CUDA 3.2 call these names
+extern "C" {
+
+CUresult cuCtxCreate_v2(CUcontext* context, unsigned int flags,
+                        CUdevice device) {
+  return cuCtxCreate(context, flags, device);
+}
+
+CUresult cuCtxDestroy_v2(CUcontext context) {
+  return cuCtxDestroy(context);
+}
+
+CUresult cuDeviceTotalMem_v2(size_t* bytes, CUdevice device) {
+  return cuDeviceTotalMem(bytes, device);
+}
+
+CUresult cuModuleGetGlobal_v2(CUdeviceptr* address, size_t* bytes,
+                              CUmodule module, const char* name) {
+  return cuModuleGetGlobal(address, bytes, module, name);
+}
+
+CUresult cuMemGetInfo_v2(size_t* free, size_t* total) {
+  return cuMemGetInfo(free, total);
+}
+
+CUresult cuMemAlloc_v2(CUdeviceptr* address, size_t bytes) {
+  return cuMemAlloc(address, bytes);
+}
+
+CUresult cuMemFree_v2(CUdeviceptr address) {
+  return cuMemFree(address);
+}
+
+CUresult cuMemAllocHost_v2(void** pointer, size_t bytes) {
+  return cuMemAllocHost(pointer, bytes);
+}
+
+CUresult cuMemHostGetDevicePointer_v2(CUdeviceptr* address, void* pointer,
+                                      unsigned int flags) {
+  return cuMemHostGetDevicePointer(address, pointer, flags);
+}
+
+CUresult cuMemcpyHtoD_v2(CUdeviceptr destination, const void* source,
+                         size_t bytes) {
+  return cuMemcpyHtoD(destination, source, bytes);
+}
+
+CUresult cuMemcpyDtoH_v2(void* destination, CUdeviceptr source,
+                         size_t bytes) {
+  return cuMemcpyDtoH(destination, source, bytes);
+}
+
+CUresult cuMemcpyDtoD_v2(CUdeviceptr destination, CUdeviceptr source,
+                         size_t bytes) {
+  return cuMemcpyDtoD(destination, source, bytes);
+}
+
+CUresult cuMemcpyHtoDAsync_v2(CUdeviceptr destination, const void* source,
+                              size_t bytes, CUstream stream) {
+  return cuMemcpyHtoDAsync(destination, source, bytes, stream);
+}
+
+CUresult cuMemcpyDtoHAsync_v2(void* destination, CUdeviceptr source,
+                              size_t bytes, CUstream stream) {
+  return cuMemcpyDtoHAsync(destination, source, bytes, stream);
+}
+
+CUresult cuMemsetD8_v2(CUdeviceptr destination, unsigned char value,
+                       size_t count) {
+  return cuMemsetD8(destination, value, count);
+}
+
+CUresult cuMemsetD32_v2(CUdeviceptr destination, unsigned int value,
+                        size_t count) {
+  return cuMemsetD32(destination, value, count);
+}
+
+CUresult cuStreamDestroy_v2(CUstream stream) {
+  return cuStreamDestroy(stream);
+}
+
+CUresult cuEventDestroy_v2(CUevent event) {
+  return cuEventDestroy(event);
+}
+
+}
@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#if !defined(CUDAEMU_CUDA_H_INC)
+#define CUDAEMU_CUDA_H_INC 1
+
+#include <stddef.h>
+
+/**
+ * Stand-in for the CUDA driver API header.
+ *
+ * This declares the subset of the driver API that the samples use, with the
+ * names, types and values of the NVidia header, so that the samples build
+ * unchanged against the stand-in libcuda in cudaemu/.  Entry points that
+ * were versioned in CUDA 3.2 take the 64-bit _v2 signatures; the library
+ * exports both spellings.
+ */
+
+#define CUDA_VERSION 4000
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#if defined(__LP64__) || defined(_WIN64)
+typedef unsigned long long CUdeviceptr;
+#else
+typedef unsigned int CUdeviceptr;
+#endif
+
+typedef int                 CUdevice;
+typedef struct CUctx_st*    CUcontext;
+typedef struct CUmod_st*    CUmodule;
+typedef struct CUfunc_st*   CUfunction;
+typedef struct CUevent_st*  CUevent;
+typedef struct CUstream_st* CUstream;
+
+typedef enum cudaError_enum {
+  CUDA_SUCCESS                              = 0,
+  CUDA_ERROR_INVALID_VALUE                  = 1,
+  CUDA_ERROR_OUT_OF_MEMORY                  = 2,
+  CUDA_ERROR_NOT_INITIALIZED                = 3,
+  CUDA_ERROR_DEINITIALIZED                  = 4,
+  CUDA_ERROR_NO_DEVICE                      = 100,
+  CUDA_ERROR_INVALID_DEVICE                 = 101,
+  CUDA_ERROR_INVALID_IMAGE                  = 200,
+  CUDA_ERROR_INVALID_CONTEXT                = 201,
+  CUDA_ERROR_CONTEXT_ALREADY_CURRENT        = 202,
+  CUDA_ERROR_MAP_FAILED                     = 205,
+  CUDA_ERROR_UNMAP_FAILED                   = 206,
+  CUDA_ERROR_ARRAY_IS_MAPPED                = 207,
+  CUDA_ERROR_ALREADY_MAPPED                 = 208,
+  CUDA_ERROR_NO_BINARY_FOR_GPU              = 209,
+  CUDA_ERROR_ALREADY_ACQUIRED               = 210,
+  CUDA_ERROR_NOT_MAPPED                     = 211,
+  CUDA_ERROR_INVALID_SOURCE                 = 300,
+  CUDA_ERROR_FILE_NOT_FOUND                 = 301,
+  CUDA_ERROR_INVALID_HANDLE                 = 400,
+  CUDA_ERROR_NOT_FOUND                      = 500,
+  CUDA_ERROR_NOT_READY                      = 600,
+  CUDA_ERROR_LAUNCH_FAILED                  = 700,
+  CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES        = 701,
+  CUDA_ERROR_LAUNCH_TIMEOUT                 = 702,
+  CUDA_ERROR_LAUNCH_INCOMPATIBLE_TEXTURING  = 703,
+  CUDA_ERROR_NOT_SUPPORTED                  = 801,
+  CUDA_ERROR_UNKNOWN                        = 999
+} CUresult;
+
+typedef enum CUjit_option_enum {
+  CU_JIT_MAX_REGISTERS                      = 0,
+  CU_JIT_THREADS_PER_BLOCK                  = 1,
+  CU_JIT_WALL_TIME                          = 2,
+  CU_JIT_INFO_LOG_BUFFER                    = 3,
+  CU_JIT_INFO_LOG_BUFFER_SIZE_BYTES         = 4,
+  CU_JIT_ERROR_LOG_BUFFER                   = 5,
+  CU_JIT_ERROR_LOG_BUFFER_SIZE_BYTES        = 6,
+  CU_JIT_OPTIMIZATION_LEVEL                 = 7,
+  CU_JIT_TARGET_FROM_CUCONTEXT              = 8,
+  CU_JIT_TARGET                             = 9,
+  CU_JIT_FALLBACK_STRATEGY                  = 10
+} CUjit_option;
+
+typedef enum CUfunction_attribute_enum {
+  CU_FUNC_ATTRIBUTE_MAX_THREADS_PER_BLOCK   = 0,
+  CU_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES       = 1,
+  CU_FUNC_ATTRIBUTE_CONST_SIZE_BYTES        = 2,
+  CU_FUNC_ATTRIBUTE_LOCAL_SIZE_BYTES        = 3,
+  CU_FUNC_ATTRIBUTE_NUM_REGS                = 4,
+  CU_FUNC_ATTRIBUTE_PTX_VERSION             = 5,
+  CU_FUNC_ATTRIBUTE_BINARY_VERSION          = 6
+} CUfunction_attribute;
+
+typedef enum CUdevice_attribute_enum {
+  CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_BLOCK           = 1,
+  CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_X                 = 2,
+  CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_Y                 = 3,
+  CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_Z                 = 4,
+  CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_X                  = 5,
+  CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_Y                  = 6,
+  CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_Z                  = 7,
+  CU_DEVICE_ATTRIBUTE_MAX_SHARED_MEMORY_PER_BLOCK     = 8,
+  CU_DEVICE_ATTRIBUTE_TOTAL_CONSTANT_MEMORY           = 9,
+  CU_DEVICE_ATTRIBUTE_WARP_SIZE                       = 10,
+  CU_DEVICE_ATTRIBUTE_MAX_PITCH                       = 11,
+  CU_DEVICE_ATTRIBUTE_MAX_REGISTERS_PER_BLOCK         = 12,
+  CU_DEVICE_ATTRIBUTE_CLOCK_RATE                      = 13,
+  CU_DEVICE_ATTRIBUTE_TEXTURE_ALIGNMENT               = 14,
+  CU_DEVICE_ATTRIBUTE_GPU_OVERLAP                     = 15,
+  CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT            = 16,
+  CU_DEVICE_ATTRIBUTE_KERNEL_EXEC_TIMEOUT             = 17,
+  CU_DEVICE_ATTRIBUTE_INTEGRATED                      = 18,
+  CU_DEVICE_ATTRIBUTE_CAN_MAP_HOST_MEMORY             = 19,
+  CU_DEVICE_ATTRIBUTE_COMPUTE_MODE                    = 20,
+  CU_DEVICE_ATTRIBUTE_CONCURRENT_KERNELS              = 31,
+  CU_DEVICE_ATTRIBUTE_ECC_ENABLED                     = 32,
+  CU_DEVICE_ATTRIBUTE_MEMORY_CLOCK_RATE               = 36,
+  CU_DEVICE_ATTRIBUTE_GLOBAL_MEMORY_BUS_WIDTH         = 37,
+  CU_DEVICE_ATTRIBUTE_L2_CACHE_SIZE                   = 38,
+  CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_MULTIPROCESSOR  = 39,
+  CU_DEVICE_ATTRIBUTE_ASYNC_ENGINE_COUNT              = 40,
+  CU_DEVICE_ATTRIBUTE_UNIFIED_ADDRESSING              = 41,
+  CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MAJOR        = 75,
+  CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MINOR        = 76
+} CUdevice_attribute;
+
+#define CU_MEMHOSTALLOC_PORTABLE        0x01
+#define CU_MEMHOSTALLOC_DEVICEMAP       0x02
+#define CU_MEMHOSTALLOC_WRITECOMBINED   0x04
+
+#define CU_STREAM_DEFAULT               0x0
+#define CU_STREAM_NON_BLOCKING          0x1
+
+#define CU_EVENT_DEFAULT                0x0
+#define CU_EVENT_BLOCKING_SYNC          0x1
+#define CU_EVENT_DISABLE_TIMING         0x2
+
+#define CU_LAUNCH_PARAM_END             ((void*)0x00)
+#define CU_LAUNCH_PARAM_BUFFER_POINTER  ((void*)0x01)
+#define CU_LAUNCH_PARAM_BUFFER_SIZE     ((void*)0x02)
+
+//==--- Initialization and Devices -----------------------------------------== //
+
+CUresult cuInit(unsigned int flags);
+CUresult cuDriverGetVersion(int* version);
+CUresult cuDeviceGet(CUdevice* device, int ordinal);
+CUresult cuDeviceGetCount(int* count);
+CUresult cuDeviceGetName(char* name, int length, CUdevice device);
+CUresult cuDeviceComputeCapability(int* major, int* minor, CUdevice device);
+CUresult cuDeviceGetAttribute(int* value, CUdevice_attribute attribute,
+                              CUdevice device);
+CUresult cuDeviceTotalMem(size_t* bytes, CUdevice device);
+
+//==--- Contexts -----------------------------------------------------------== //
+
+CUresult cuCtxCreate(CUcontext* context, unsigned int flags, CUdevice device);
+CUresult cuCtxDestroy(CUcontext context);
+CUresult cuCtxSynchronize(void);
+
+//==--- Modules and Functions ----------------------------------------------== //
+
+CUresult cuModuleLoad(CUmodule* module, const char* filename);
+CUresult cuModuleLoadData(CUmodule* module, const void* image);
+CUresult cuModuleLoadDataEx(CUmodule* module, const void* image,
+                            unsigned int numOptions, CUjit_option* options,
+                            void** optionValues);
+CUresult cuModuleUnload(CUmodule module);
+CUresult cuModuleGetFunction(CUfunction* function, CUmodule module,
+                             const char* name);
+CUresult cuModuleGetGlobal(CUdeviceptr* address, size_t* bytes,
+                           CUmodule module, const char* name);
+
+CUresult cuFuncGetAttribute(int* value, CUfunction_attribute attribute,
+                            CUfunction function);
+CUresult cuFuncSetBlockShape(CUfunction function, int x, int y, int z);
+CUresult cuFuncSetSharedSize(CUfunction function, unsigned int bytes);
+
+//==--- Memory -------------------------------------------------------------== //
+
+CUresult cuMemGetInfo(size_t* free, size_t* total);
+CUresult cuMemAlloc(CUdeviceptr* address, size_t bytes);
+CUresult cuMemFree(CUdeviceptr address);
+CUresult cuMemAllocHost(void** pointer, size_t bytes);
+CUresult cuMemHostAlloc(void** pointer, size_t bytes, unsigned int flags);
+CUresult cuMemFreeHost(void* pointer);
+CUresult cuMemHostGetDevicePointer(CUdeviceptr* address, void* pointer,
+                                   unsigned int flags);
+
+CUresult cuMemcpyHtoD(CUdeviceptr destination, const void* source,
+                      size_t bytes);
+CUresult cuMemcpyDtoH(void* destination, CUdeviceptr source, size_t bytes);
+CUresult cuMemcpyDtoD(CUdeviceptr destination, CUdeviceptr source,
+                      size_t bytes);
+CUresult cuMemcpyHtoDAsync(CUdeviceptr destination, const void* source,
+                           size_t bytes, CUstream stream);
+CUresult cuMemcpyDtoHAsync(void* destination, CUdeviceptr source,
+                           size_t bytes, CUstream stream);
+CUresult cuMemsetD8(CUdeviceptr destination, unsigned char value,
+                    size_t count);
+CUresult cuMemsetD32(CUdeviceptr destination, unsigned int value,
+                     size_t count);
+
+//==--- Execution ----------------------------------------------------------== //
+
+CUresult cuParamSetSize(CUfunction function, unsigned int bytes);
+CUresult cuParamSeti(CUfunction function, int offset, unsigned int value);
+CUresult cuParamSetf(CUfunction function, int offset, float value);
+CUresult cuParamSetv(CUfunction function, int offset, void* data,
+                     unsigned int bytes);
+CUresult cuLaunch(CUfunction function);
+CUresult cuLaunchGrid(CUfunction function, int width, int height);
+CUresult cuLaunchGridAsync(CUfunction function, int width, int height,
+                           CUstream stream);
+CUresult cuLaunchKernel(CUfunction function,
+                        unsigned int gridX, unsigned int gridY,
+                        unsigned int gridZ,
+                        unsigned int blockX, unsigned int blockY,
+                        unsigned int blockZ,
+                        unsigned int sharedBytes, CUstream stream,
+                        void** kernelParams, void** extra);
+
+//==--- Streams and Events -------------------------------------------------== //
+
+CUresult cuStreamCreate(CUstream* stream, unsigned int flags);
+CUresult cuStreamDestroy(CUstream stream);
+CUresult cuStreamQuery(CUstream stream);
+CUresult cuStreamSynchronize(CUstream stream);
+
+CUresult cuEventCreate(CUevent* event, unsigned int flags);
+CUresult cuEventDestroy(CUevent event);
+CUresult cuEventRecord(CUevent event, CUstream stream);
+CUresult cuEventQuery(CUevent event);
+CUresult cuEventSynchronize(CUevent event);
+CUresult cuEventElapsedTime(float* milliseconds, CUevent start, CUevent end);
+
+//==--- Errors -------------------------------------------------------------== //
+
+CUresult cuGetErrorString(CUresult error, const char** string);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
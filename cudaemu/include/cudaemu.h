@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#if !defined(CUDAEMU_H_INC)
+#define CUDAEMU_H_INC 1
+
+#include <stddef.h>
+#include "cuda.h"
+
+/**
+ * Extensions of the stand-in CUDA driver.
+ *
+ * Launches run on one of two backends.  The PTX backend interprets the PTX
+ * passed to cuModuleLoadData*.  The host backend calls a native build of
+ * the same kernel that the program registered under the kernel's name, and
+ * is much faster.  CUDAEMU_BACKEND=ptx or host forces one backend; by
+ * default registered kernels run natively and the rest are interpreted.
+ *
+ * Every driver entry point counts its calls and the wall time spent in
+ * them.  Setting CUDAEMU_PROFILE prints the counters when the program
+ * exits, to stderr for "1" and otherwise to the named file.
+ */
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Native kernel entry point.  params is the parameter buffer, laid out as
+ * the PTX entry declares it.
+ */
+typedef void (*CUemuHostKernel)(const void* params);
+
+/**
+ * Registers kernel as the host implementation of the PTX entry name.  The
+ * host backend runs each CTA thread of a launch through it, with the
+ * ptxhost special registers set (see common/PTXHost.hpp).
+ */
+void cuemuRegisterHostKernel(const char* name, CUemuHostKernel kernel);
+
+typedef struct CUemuCallStats {
+  const char*        name;
+  unsigned long long calls;
+  double             seconds;
+} CUemuCallStats;
+
+/**
+ * Copies up to maxStats counters, of entry points called at least once,
+ * into stats and returns how many there are.
+ */
+unsigned int cuemuGetCallStats(CUemuCallStats* stats, unsigned int maxStats);
+
+void cuemuResetCallStats(void);
+
+#if defined(__cplusplus)
+}
+
+/**
+ * Registers a host kernel from a static initializer:
+ *
+ *   static CUemuHostKernelRegistration reg("vector_add", vectorAddThunk);
+ */
+class CUemuHostKernelRegistration {
+public:
+
+  CUemuHostKernelRegistration(const char* name, CUemuHostKernel kernel) {
+    cuemuRegisterHostKernel(name, kernel);
+  }
+};
+#endif
+
+#endif
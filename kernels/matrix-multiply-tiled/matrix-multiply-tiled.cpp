@@ -20,229 +20,141 @@
  * THE SOFTWARE.
  */
 
+
 #include <iostream>
-#include <fstream>
 #include <cmath>
+#include <cstdlib>
+#include <ctime>
 
-#include <sys/time.h>
-
-#include "cuda.h"
+#include "common/CUDASample.hpp"
 
 
 typedef float Real;
 
 
-//==--- Utility Functions --------------------------------------------------== //
-const char * statusToString(CUresult error)
-{
-  switch (error) {
-    case CUDA_SUCCESS: return "No errors";
-    case CUDA_ERROR_INVALID_VALUE: return "Invalid value";
-    case CUDA_ERROR_OUT_OF_MEMORY: return "Out of memory";
-    case CUDA_ERROR_NOT_INITIALIZED: return "Driver not initialized";
-    case CUDA_ERROR_DEINITIALIZED: return "Driver deinitialized";
+//==--- Sample -------------------------------------------------------------== //
 
-    case CUDA_ERROR_NO_DEVICE: return "No CUDA-capable device available";
-    case CUDA_ERROR_INVALID_DEVICE: return "Invalid device";
+class MatrixMultiplyTiledSample : public CUDASample {
+public:
 
-    case CUDA_ERROR_INVALID_IMAGE: return "Invalid kernel image";
-    case CUDA_ERROR_INVALID_CONTEXT: return "Invalid context";
-    case CUDA_ERROR_CONTEXT_ALREADY_CURRENT: return "Context already current";
-    case CUDA_ERROR_MAP_FAILED: return "Map failed";
-    case CUDA_ERROR_UNMAP_FAILED: return "Unmap failed";
-    case CUDA_ERROR_ARRAY_IS_MAPPED: return "Array is mapped";
-    case CUDA_ERROR_ALREADY_MAPPED: return "Already mapped";
-    case CUDA_ERROR_NO_BINARY_FOR_GPU: return "No binary for GPU";
-    case CUDA_ERROR_ALREADY_ACQUIRED: return "Already acquired";
-    case CUDA_ERROR_NOT_MAPPED: return "Not mapped";
+  MatrixMultiplyTiledSample();
 
-    case CUDA_ERROR_INVALID_SOURCE: return "Invalid source";
-    case CUDA_ERROR_FILE_NOT_FOUND: return "File not found";
+  virtual ~MatrixMultiplyTiledSample();
 
-    case CUDA_ERROR_INVALID_HANDLE: return "Invalid handle";
+protected:
 
-    case CUDA_ERROR_NOT_FOUND: return "Not found";
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+  virtual void setupKernel(CUfunction kernel);
+  virtual void finishKernel(CUfunction kernel);
+  virtual void runKernel(CUfunction kernel, CUstream stream);
+  virtual void reportPerformance(const Timing& timing);
 
-    case CUDA_ERROR_NOT_READY: return "CUDA not ready";
+private:
 
-    case CUDA_ERROR_LAUNCH_FAILED: return "Launch failed";
-    case CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES: return "Launch exceeded resources";
-    case CUDA_ERROR_LAUNCH_TIMEOUT: return "Launch exceeded timeout";
-    case CUDA_ERROR_LAUNCH_INCOMPATIBLE_TEXTURING: return "Launch with incompatible texturing";
+  CUmodule    module_;
 
-    case CUDA_ERROR_UNKNOWN: return "Unknown error";
-    default: return "Unknown error ID";
-  }
-}
+  CUdeviceptr deviceA_;
+  CUdeviceptr deviceB_;
+  CUdeviceptr deviceC_;
 
-void checkSuccess(CUresult    status,
-                  const char *func,
-                  const char *errorBuffer = 0)
-{
-  if (status != CUDA_SUCCESS) {
-    if (errorBuffer != 0) {
-      std::cerr << "ERROR LOG:" << std::endl
-                << errorBuffer << std::endl;
-    }
+  Real*       hostA_;
+  Real*       hostB_;
+  Real*       cmpC_;
 
-    std::cerr << "ERROR: Could not execute '" << func << "', error ("
-              << status << ") " << statusToString(status) << std::endl;
-    exit(1);
-  }
-}
+  int         blockSizeX_;
+  int         blockSizeY_;
+  int         blockSizeMultiple_;
+  int         problemSizeX_;
+  int         problemSizeY_;
+};
 
-double getTimeStamp()
-{
-  struct timezone Tzp;
-  struct timeval  Tp;
-  int             stat;
-  stat = gettimeofday (&Tp, &Tzp);
-  if (stat != 0)
-    std::cerr << "Error return from gettimeofday: " << stat << "\n";
-  return (Tp.tv_sec + Tp.tv_usec * 1.0e-6);
-}
 
+MatrixMultiplyTiledSample::MatrixMultiplyTiledSample()
+: hostA_(0), hostB_(0), cmpC_(0) {
+  blockSizeX_        = 16;
+  blockSizeY_        = 16;
+  blockSizeMultiple_ = 100;
+  problemSizeX_      = blockSizeX_ * blockSizeMultiple_;
+  problemSizeY_      = blockSizeY_ * blockSizeMultiple_;
+}
 
-
-//==--- Entry Point --------------------------------------------------------== //
-
-int main(int argc,
-         char** argv) {
-
-  CUcontext  context;
-  CUdevice   device;
-  CUmodule   module;
-  CUresult   status;
-  CUfunction function;
-  
-  const int kLogSize = 1024;
-  char      logBuffer[kLogSize];
-
-  int blockSizeX        = 16;
-  int blockSizeY        = 16;
-  int blockSizeMultiple = 100;
-  int problemSizeX      = blockSizeX * blockSizeMultiple;
-  int problemSizeY      = blockSizeY * blockSizeMultiple;
-
-  // Seed random number generator
-  srand(time(NULL));
-  
-  // Initialize CUDA
-  std::cout << "Initializing CUDA\n";
-  checkSuccess(cuInit(0), "cuInit");
-  std::cout << "Selecting first compute device\n";
-  checkSuccess(cuDeviceGet(&device, 0), "cuDeviceGet");
-  std::cout << "Creating CUDA context\n";
-  checkSuccess(cuCtxCreate(&context, 0, device), "cuCtxCreate");
-
-  // Read the PTX kernel from disk
-  std::ifstream kernelFile("matrix-multiply-tiled.kernel.ptx");
-  if (!kernelFile.is_open()) {
-    std::cerr << "Failed to open matrix-multiply.kernel.ptx\n";
-    return 1;
+MatrixMultiplyTiledSample::~MatrixMultiplyTiledSample() {
+  if(hostA_ != 0) {
+    cuMemFree(deviceA_);
+    cuMemFree(deviceB_);
+    cuMemFree(deviceC_);
   }
 
-  // Load entire kernel into a string
-  std::string source(std::istreambuf_iterator<char>(kernelFile),
-                     (std::istreambuf_iterator<char>()));
-
-  // Configure JIT options
-  CUjit_option jitOptions[] = { CU_JIT_ERROR_LOG_BUFFER_SIZE_BYTES,
-                                CU_JIT_ERROR_LOG_BUFFER };
-  void* jitOptionValues[]   = { reinterpret_cast<void*>(kLogSize), logBuffer };
-
-  // Load the kernel onto the device
-  status = cuModuleLoadDataEx(&module, source.c_str(),
-                              sizeof(jitOptions)/sizeof(jitOptions[0]),
-                              jitOptions, jitOptionValues);
-  checkSuccess(status, "cuModuleLoadDataEx", logBuffer);
-
-  status = cuModuleGetFunction(&function, module, "matrix_multiply_tiled");
-  checkSuccess(status, "cuModuleGetFunction");
+  delete [] hostA_;
+  delete [] hostB_;
+  delete [] cmpC_;
+}
 
+void MatrixMultiplyTiledSample::initialize() {
+  module_ = loadModule("matrix-multiply-tiled.kernel.ptx");
+  setKernel(getFunction(module_, "matrix_multiply_tiled"));
 
-  // Print some diagnostics about the kernel compilation
-  int numRegisters;
-  cuFuncGetAttribute(&numRegisters, CU_FUNC_ATTRIBUTE_NUM_REGS, function);
-  std::cout << "Register Usage:  " << numRegisters << "\n";
-  
+  // Report the median of several launches rather than one cold launch
+  setNumberOfIterations(8);
 
-  // Setup buffers
-  Real* hostA = new Real[problemSizeX * problemSizeY];
-  Real* hostB = new Real[problemSizeX * problemSizeY];
-  Real* refC  = new Real[problemSizeX * problemSizeY];
-  Real* cmpC  = new Real[problemSizeX * problemSizeY];
+  std::cout << "Problem Size:         " << problemSizeX_ << " x "
+            << problemSizeY_ << "\n";
+}
 
-  std::cout << "Problem Size:  " << problemSizeX << " x " << problemSizeY
-            << "\n";
-  
-  CUdeviceptr deviceA;
-  CUdeviceptr deviceB;
-  CUdeviceptr deviceC;
+void MatrixMultiplyTiledSample::createMemoryBuffers() {
+  int    size  = problemSizeX_ * problemSizeY_;
+  size_t bytes = size * sizeof(Real);
 
-  status = cuMemAlloc(&deviceA, problemSizeX * problemSizeY * sizeof(Real));
-  checkSuccess(status, "cuMemAlloc");
-  status = cuMemAlloc(&deviceB, problemSizeX * problemSizeY * sizeof(Real));
-  checkSuccess(status, "cuMemAlloc");
-  status = cuMemAlloc(&deviceC, problemSizeX * problemSizeY * sizeof(Real));
-  checkSuccess(status, "cuMemAlloc");
+  hostA_ = new Real[size];
+  hostB_ = new Real[size];
+  cmpC_  = new Real[size];
 
+  checkSuccess(cuMemAlloc(&deviceA_, bytes), "cuMemAlloc");
+  checkSuccess(cuMemAlloc(&deviceB_, bytes), "cuMemAlloc");
+  checkSuccess(cuMemAlloc(&deviceC_, bytes), "cuMemAlloc");
 
   // Populate arrays with test data
-  for (int i = 0; i < problemSizeX*problemSizeY; ++i) {
-    hostA[i] = hostB[i] = (Real)rand() / ((Real)RAND_MAX + (Real)1.0);
-    refC[i]  = cmpC[i] = (Real)0.0;
-  }
-
-
-  // Copy buffers to device
-  status = cuMemcpyHtoD(deviceA, hostA, problemSizeX * problemSizeY * sizeof(Real));
-  checkSuccess(status, "cuMemcpyHtoD");
-  status = cuMemcpyHtoD(deviceB, hostB, problemSizeX * problemSizeY * sizeof(Real));
-  checkSuccess(status, "cuMemcpyHtoD");
-  status = cuMemcpyHtoD(deviceC, cmpC, problemSizeX * problemSizeY * sizeof(Real));
-  checkSuccess(status, "cuMemcpyHtoD");
-
-  // Setup block shape
-  status = cuFuncSetBlockShape(function, blockSizeX, blockSizeY, 1);
-  checkSuccess(status, "cuFuncSetBlockShape");
-
-
-  // Bind kernel paramters
-  status = cuParamSetv(function, 0, &deviceA, sizeof(CUdeviceptr));
-  checkSuccess(status, "cuParamSetv");
-  status = cuParamSetv(function, sizeof(CUdeviceptr), &deviceB, sizeof(CUdeviceptr));
-  checkSuccess(status, "cuParamSetv");
-  status = cuParamSetv(function, 2*sizeof(CUdeviceptr), &deviceC, sizeof(CUdeviceptr));
-  checkSuccess(status, "cuParamSetv");
+  srand(time(NULL));
 
-  status = cuParamSetSize(function, 3*sizeof(CUdeviceptr));
-  checkSuccess(status, "cuParamSetSize");
+  for (int i = 0; i < size; ++i) {
+    hostA_[i] = hostB_[i] = (Real)rand() / ((Real)RAND_MAX + (Real)1.0);
+    cmpC_[i]  = (Real)0.0;
+  }
+}
 
+void MatrixMultiplyTiledSample::setupKernel(CUfunction kernel) {
+  size_t bytes = problemSizeX_ * problemSizeY_ * sizeof(Real);
 
-  // Launch the kernel
-  double deviceStart = getTimeStamp();
-  
-  status = cuLaunchGrid(function, blockSizeMultiple, blockSizeMultiple);
-  checkSuccess(status, "cuLaunchGrid");
-  cuCtxSynchronize();
+  checkSuccess(cuMemcpyHtoD(deviceA_, hostA_, bytes), "cuMemcpyHtoD");
+  checkSuccess(cuMemcpyHtoD(deviceB_, hostB_, bytes), "cuMemcpyHtoD");
+  checkSuccess(cuMemcpyHtoD(deviceC_, cmpC_, bytes), "cuMemcpyHtoD");
+}
 
-  double deviceEnd = getTimeStamp();
-  
+void MatrixMultiplyTiledSample::runKernel(CUfunction kernel, CUstream stream) {
+  launch(kernel, Dim3(blockSizeMultiple_, blockSizeMultiple_),
+         Dim3(blockSizeX_, blockSizeY_), deviceA_, deviceB_, deviceC_);
+}
 
-  // Copy results back to the host
-  status = cuMemcpyDtoH(cmpC, deviceC, problemSizeX * problemSizeY * sizeof(Real));
-  checkSuccess(status, "cuMemoryDtoH");
+void MatrixMultiplyTiledSample::finishKernel(CUfunction kernel) {
+  int size = problemSizeX_ * problemSizeY_;
 
+  checkSuccess(cuMemcpyDtoH(cmpC_, deviceC_, size * sizeof(Real)),
+               "cuMemcpyDtoH");
 
   // Compute the reference solution
+  Real* refC = new Real[size];
+  for (int i = 0; i < size; ++i) {
+    refC[i] = (Real)0.0;
+  }
+
   double hostStart = getTimeStamp();
 
-  for (int k = 0; k < problemSizeX; ++k) {
-    for (int i = 0; i < problemSizeY; ++i) {
-      for (int j = 0; j < problemSizeX; ++j) {
-        refC[i*problemSizeX+j] += hostA[i*problemSizeX+k]
-          * hostB[k*problemSizeX+j];
+  for (int k = 0; k < problemSizeX_; ++k) {
+    for (int i = 0; i < problemSizeY_; ++i) {
+      for (int j = 0; j < problemSizeX_; ++j) {
+        refC[i*problemSizeX_+j] += hostA_[i*problemSizeX_+k]
+          * hostB_[k*problemSizeX_+j];
       }
     }
   }
@@ -253,13 +165,13 @@ int main(int argc,
   // Compare the results
   Real errorNorm = (Real)0.0;
   Real refNorm   = (Real)0.0;
-  
-  for (int i = 0; i < problemSizeX*problemSizeY; ++i) {
-    
-    Real diff = refC[i] - cmpC[i];
+
+  for (int i = 0; i < size; ++i) {
+
+    Real diff = refC[i] - cmpC_[i];
 
     errorNorm += diff * diff;
-    
+
     refNorm += refC[i] * refC[i];
   }
 
@@ -276,21 +188,41 @@ int main(int argc,
   }
 
 #if defined(DEBUG)
-  for (int i = 0; i < problemSizeY; ++i) {
-    for (int j = 0; j < problemSizeX; ++j) {
-      std::cout << refC[i*problemSizeX+j] << ", " << cmpC[i*problemSizeX+j] << "\n";
+  for (int i = 0; i < problemSizeY_; ++i) {
+    for (int j = 0; j < problemSizeX_; ++j) {
+      std::cout << refC[i*problemSizeX_+j] << ", "
+                << cmpC_[i*problemSizeX_+j] << "\n";
     }
   }
 #endif
 
-  double gflopsDevice = ((double)problemSizeX * problemSizeY * problemSizeX * 2) / (deviceEnd - deviceStart) / 1e9;
-  double gflopsHost   = ((double)problemSizeX * problemSizeY * problemSizeX * 2) / (hostEnd - hostStart) / 1e9;
-  
-  std::cout << "Device Time:     " << (deviceEnd - deviceStart) << "s\n";
-  std::cout << "Device GFlop/s:  " << gflopsDevice << "\n";
-  std::cout << "Host Time:       " << (hostEnd - hostStart) << "s\n";
-  std::cout << "Host GFlop/s:    " << gflopsHost << "\n";
-  
-  return 0;
+  delete [] refC;
+
+  double flops = (double)problemSizeX_ * problemSizeY_ * problemSizeX_ * 2;
+
+  std::cout << "Host Time:            " << (hostEnd - hostStart) << " sec\n";
+  std::cout << "Host GFlop/s:         " << flops / (hostEnd - hostStart) / 1e9
+            << "\n";
+}
+
+void MatrixMultiplyTiledSample::reportPerformance(const Timing& timing) {
+  double flops = (double)problemSizeX_ * problemSizeY_ * problemSizeX_ * 2;
+
+  std::cout << "Median GFlop/s:       " << flops / timing.median / 1e9
+            << "\n";
+  std::cout << "Peak GFlop/s:         " << flops / timing.minimum / 1e9
+            << "\n";
 }
 
+
+
+//==--- Entry Point --------------------------------------------------------== //
+
+int main(int argc,
+         char** argv) {
+  MatrixMultiplyTiledSample sample;
+
+  sample.run();
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+
+#include "common/PTXHost.hpp"
+#include "common/Sample.hpp"
+
+// Compile the device kernel for the host
+#include "matrix-multiply-tiled.kernel.cpp"
+
+
+typedef float Real;
+
+
+//==--- Kernel Binding -----------------------------------------------------== //
+
+class MatrixMultiplyTiledBody : public ptxhost::KernelBody {
+public:
+
+  MatrixMultiplyTiledBody(Real* A, Real* B, Real* C)
+  : A_(A), B_(B), C_(C) {
+  }
+
+  virtual void invoke() {
+    matrix_multiply_tiled(A_, B_, C_);
+  }
+
+private:
+
+  Real* A_;
+  Real* B_;
+  Real* C_;
+};
+
+
+
+//==--- Entry Point --------------------------------------------------------== //
+
+int main(int argc,
+         char** argv) {
+
+  int blockSizeX        = 16;
+  int blockSizeY        = 16;
+  int blockSizeMultiple = 100;
+  int problemSizeX      = blockSizeX * blockSizeMultiple;
+  int problemSizeY      = blockSizeY * blockSizeMultiple;
+
+  // Seed random number generator
+  srand(time(NULL));
+
+  std::cout << "Host Workers:  " << ptxhost::getDefaultWorkerCount() << "\n";
+  std::cout << "Problem Size:  " << problemSizeX << " x " << problemSizeY
+            << "\n";
+
+  // Setup buffers
+  Real* hostA = new Real[problemSizeX * problemSizeY];
+  Real* hostB = new Real[problemSizeX * problemSizeY];
+  Real* refC  = new Real[problemSizeX * problemSizeY];
+  Real* cmpC  = new Real[problemSizeX * problemSizeY];
+
+  // Populate arrays with test data
+  for (int i = 0; i < problemSizeX*problemSizeY; ++i) {
+    hostA[i] = hostB[i] = (Real)rand() / ((Real)RAND_MAX + (Real)1.0);
+    refC[i]  = cmpC[i] = (Real)0.0;
+  }
+
+  MatrixMultiplyTiledBody body(hostA, hostB, cmpC);
+
+  // Launch the kernel
+  double kernelStart = Sample::getTimeStamp();
+
+  ptxhost::launchGrid(body,
+                      ptxhost::makeDim3(blockSizeMultiple, blockSizeMultiple),
+                      ptxhost::makeDim3(blockSizeX, blockSizeY), true);
+
+  double kernelEnd = Sample::getTimeStamp();
+
+
+  // Compute the reference solution
+  double hostStart = Sample::getTimeStamp();
+
+  for (int k = 0; k < problemSizeX; ++k) {
+    for (int i = 0; i < problemSizeY; ++i) {
+      for (int j = 0; j < problemSizeX; ++j) {
+        refC[i*problemSizeX+j] += hostA[i*problemSizeX+k]
+          * hostB[k*problemSizeX+j];
+      }
+    }
+  }
+
+  double hostEnd = Sample::getTimeStamp();
+
+
+  // Compare the results
+  Real errorNorm = (Real)0.0;
+  Real refNorm   = (Real)0.0;
+
+  for (int i = 0; i < problemSizeX*problemSizeY; ++i) {
+
+    Real diff = refC[i] - cmpC[i];
+
+    errorNorm += diff * diff;
+
+    refNorm += refC[i] * refC[i];
+  }
+
+  errorNorm = (Real)sqrt((double)errorNorm);
+  refNorm   = (Real)sqrt((double)refNorm);
+
+  if ((errorNorm / refNorm) < (Real)1e-5) {
+    std::cout << "Host reference comparison test PASSED\n";
+  }
+  else {
+    std::cout << "Host reference comparison test FAILED\n";
+    std::cout << "Error Norm:  " << errorNorm << "\n";
+    std::cout << "Ref Norm:    " << refNorm << "\n";
+  }
+
+  double flops        = (double)problemSizeX * problemSizeY * problemSizeX * 2;
+  double gflopsKernel = flops / (kernelEnd - kernelStart) / 1e9;
+  double gflopsHost   = flops / (hostEnd - hostStart) / 1e9;
+
+  std::cout << "Kernel Time:         " << (kernelEnd - kernelStart) << "s\n";
+  std::cout << "Kernel GFlop/s:      " << gflopsKernel << "\n";
+  std::cout << "Reference Time:      " << (hostEnd - hostStart) << "s\n";
+  std::cout << "Reference GFlop/s:   " << gflopsHost << "\n";
+
+  return 0;
+}
@@ -23,10 +23,14 @@
 // This must be changed to reflect changes in matrix-multiply-tiled.cpp
 #define BLOCK_SIZE 16
 
-__attribute__((address_space(4)))
-float g_scratchA[BLOCK_SIZE][BLOCK_SIZE];
-__attribute__((address_space(4)))
-float g_scratchB[BLOCK_SIZE][BLOCK_SIZE];
+// Shared memory.  The host backend (common/PTXHost.hpp) predefines
+// PTX_SHARED to give each host worker its own copy.
+#if !defined(PTX_SHARED)
+#define PTX_SHARED __attribute__((address_space(4)))
+#endif
+
+PTX_SHARED float g_scratchA[BLOCK_SIZE][BLOCK_SIZE];
+PTX_SHARED float g_scratchB[BLOCK_SIZE][BLOCK_SIZE];
 
 extern "C"
 void matrix_multiply_tiled(float* A,
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "common/PTXHost.hpp"
+#include "cudaemu.h"
+
+// Compile the device kernel for the host backend of the stand-in driver
+#include "matrix-multiply.kernel.cpp"
+
+
+//==--- Kernel Binding -----------------------------------------------------== //
+
+namespace {
+
+/// Parameter buffer of matrix_multiply, as cuParamSetv fills it
+struct MatrixMultiplyParams {
+  float* A;
+  float* B;
+  float* C;
+};
+
+void matrixMultiplyThunk(const void* params) {
+  const MatrixMultiplyParams* p =
+    static_cast<const MatrixMultiplyParams*>(params);
+  matrix_multiply(p->A, p->B, p->C);
+}
+
+CUemuHostKernelRegistration registration("matrix_multiply",
+                                         matrixMultiplyThunk);
+
+}
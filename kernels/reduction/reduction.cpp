@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+
+#include "common/CUDASample.hpp"
+
+
+// This must be changed to reflect changes in reduction.kernel.cpp
+#define BLOCK_SIZE 256
+
+
+/**
+ * An algorithm tier of reduction.kernel.cpp.  Grid-stride tiers are launched
+ * with one wave of blocks; the others need a thread per element.
+ */
+struct Tier {
+  const char* name;
+  bool        gridStride;
+  bool        atomicFinish;
+};
+
+const Tier kTiers[] = {
+  { "interleaved", false, false },
+  { "sequential",  false, false },
+  { "unrolled",    false, false },
+  { "multiple",    true,  false },
+  { "atomic",      true,  true  }
+};
+
+const int kNumTiers = sizeof(kTiers) / sizeof(kTiers[0]);
+
+/**
+ * A reduction operator.  partial names the operator that combines the
+ * per-block results, and identity holds the bits of its neutral element.
+ */
+struct Operator {
+  const char*  name;
+  const char*  partial;
+  unsigned int identity;
+  int          numInputs;
+};
+
+const Operator kOperators[] = {
+  { "sum", "sum", 0x00000000, 1 },
+  { "min", "min", 0x7f800000, 1 },    // +inf
+  { "max", "max", 0xff800000, 1 },    // -inf
+  { "dot", "sum", 0x00000000, 2 }
+};
+
+const int kNumOperators = sizeof(kOperators) / sizeof(kOperators[0]);
+
+
+//==--- Sample -------------------------------------------------------------== //
+
+/**
+ * Reduces a vector with every combination of operator and algorithm tier,
+ * checks each result against the host and reports its GB/s next to the
+ * device's copy bandwidth.
+ */
+class ReductionSample : public CUDASample {
+public:
+
+  ReductionSample();
+
+  virtual ~ReductionSample();
+
+  virtual void run();
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+
+private:
+
+  Dim3 getGrid(const Tier& tier, int N);
+  void launchReduction(const Tier& tier, const Operator& op,
+                       CUfunction kernel, CUfunction finish);
+  double reduceHost(const Operator& op, double& magnitude);
+  double measureCopyBandwidth();
+
+  CUmodule    module_;
+
+  CUdeviceptr deviceA_;
+  CUdeviceptr deviceB_;
+  CUdeviceptr devicePartial_;
+  CUdeviceptr deviceResult_;
+
+  std::vector<float> hostA_;
+  std::vector<float> hostB_;
+
+  int         problemSize_;
+  int         maxGridX_;
+  int         waveBlocks_;
+};
+
+
+ReductionSample::ReductionSample()
+: deviceA_(0) {
+  problemSize_ = 1 << 23;
+
+  if (const char* value = getenv("REDUCTION_SIZE")) {
+    problemSize_ = std::max(atoi(value), 1);
+  }
+}
+
+ReductionSample::~ReductionSample() {
+  if (deviceA_ != 0) {
+    cuMemFree(deviceA_);
+    cuMemFree(deviceB_);
+    cuMemFree(devicePartial_);
+    cuMemFree(deviceResult_);
+  }
+}
+
+void ReductionSample::initialize() {
+  module_ = loadModule("reduction.kernel.ptx");
+  setNumberOfIterations(16);
+
+  int numSMs, threadsPerSM;
+  cuDeviceGetAttribute(&maxGridX_, CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_X,
+                       getDevice());
+  cuDeviceGetAttribute(&numSMs, CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT,
+                       getDevice());
+  cuDeviceGetAttribute(&threadsPerSM,
+                       CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_MULTIPROCESSOR,
+                       getDevice());
+  waveBlocks_ = numSMs * std::max(threadsPerSM / BLOCK_SIZE, 1);
+
+  std::cout << "Problem Size:         " << problemSize_ << "\n";
+}
+
+void ReductionSample::createMemoryBuffers() {
+  size_t bytes = problemSize_ * sizeof(float);
+
+  // Signed data, so that min and max are not trivially the first element
+  srand(time(NULL));
+  hostA_.resize(problemSize_);
+  hostB_.resize(problemSize_);
+  for (int i = 0; i < problemSize_; ++i) {
+    hostA_[i] = 2.0f * rand() / ((float)RAND_MAX + 1.0f) - 1.0f;
+    hostB_[i] = 2.0f * rand() / ((float)RAND_MAX + 1.0f) - 1.0f;
+  }
+
+  // One partial per block of the largest grid
+  int maxBlocks = std::max(getGrid(kTiers[0], problemSize_).x,
+                           (unsigned)waveBlocks_);
+
+  checkSuccess(cuMemAlloc(&deviceA_, bytes), "cuMemAlloc");
+  checkSuccess(cuMemAlloc(&deviceB_, bytes), "cuMemAlloc");
+  checkSuccess(cuMemAlloc(&devicePartial_, maxBlocks * sizeof(float)),
+               "cuMemAlloc");
+  checkSuccess(cuMemAlloc(&deviceResult_, sizeof(float)), "cuMemAlloc");
+
+  checkSuccess(cuMemcpyHtoD(deviceA_, &hostA_[0], bytes), "cuMemcpyHtoD");
+  checkSuccess(cuMemcpyHtoD(deviceB_, &hostB_[0], bytes), "cuMemcpyHtoD");
+}
+
+CUDASample::Dim3 ReductionSample::getGrid(const Tier& tier, int N) {
+  int blocks = (N + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+  if (tier.gridStride) {
+    return Dim3(std::min(blocks, waveBlocks_));
+  }
+  if (blocks > maxGridX_) {
+    // Too large for a thread per element
+    return Dim3(0);
+  }
+  return Dim3(blocks);
+}
+
+void ReductionSample::launchReduction(const Tier& tier, const Operator& op,
+                                      CUfunction kernel, CUfunction finish) {
+  Dim3 grid = getGrid(tier, problemSize_);
+
+  if (tier.atomicFinish) {
+    checkSuccess(cuMemsetD32(deviceResult_, op.identity, 1), "cuMemsetD32");
+    launch(kernel, grid, Dim3(BLOCK_SIZE), deviceA_, deviceB_,
+           deviceResult_, problemSize_);
+  }
+  else {
+    // Second pass: one block reduces the per-block partials
+    launch(kernel, grid, Dim3(BLOCK_SIZE), deviceA_, deviceB_,
+           devicePartial_, problemSize_);
+    launch(finish, Dim3(1), Dim3(BLOCK_SIZE), devicePartial_, devicePartial_,
+           deviceResult_, (int)grid.x);
+  }
+}
+
+double ReductionSample::reduceHost(const Operator& op, double& magnitude) {
+  std::string name   = op.name;
+  double      result = (name == "min") ? HUGE_VAL
+                     : (name == "max") ? -HUGE_VAL : 0.0;
+
+  // magnitude bounds the rounding error of a float sum or dot product
+  magnitude = 0.0;
+
+  for (int i = 0; i < problemSize_; ++i) {
+    double a = hostA_[i];
+
+    if (name == "min") {
+      result = std::min(result, a);
+    }
+    else if (name == "max") {
+      result = std::max(result, a);
+    }
+    else {
+      double term = (name == "dot") ? a * hostB_[i] : a;
+      result    += term;
+      magnitude += std::fabs(term);
+    }
+  }
+
+  return result;
+}
+
+double ReductionSample::measureCopyBandwidth() {
+  std::vector<double> times;
+  EventTimer          timer;
+  size_t              bytes = problemSize_ * sizeof(float);
+
+  checkSuccess(cuMemcpyDtoD(deviceB_, deviceA_, bytes), "cuMemcpyDtoD");
+  for (unsigned i = 0; i < getNumberOfIterations(); ++i) {
+    timer.start();
+    checkSuccess(cuMemcpyDtoD(deviceB_, deviceA_, bytes), "cuMemcpyDtoD");
+    times.push_back(timer.stop());
+  }
+
+  // Restore B, which the dot product reads
+  checkSuccess(cuMemcpyHtoD(deviceB_, &hostB_[0], bytes), "cuMemcpyHtoD");
+
+  // A read and a write per element
+  return 2.0 * bytes / summarize(times).median / 1e9;
+}
+
+void ReductionSample::run() {
+  bool passed = true;
+
+  initialize();
+  createMemoryBuffers();
+
+  double copyRate = measureCopyBandwidth();
+
+  std::cout << "Copy GB/s:            " << copyRate << "\n";
+
+  for (int o = 0; o < kNumOperators; ++o) {
+    const Operator& op = kOperators[o];
+    double          magnitude;
+    double          expected = reduceHost(op, magnitude);
+
+    std::cout << "------------------------------\n";
+    std::cout << "* " << op.name << " (host: " << expected << ")\n";
+    std::cout << "------------------------------\n";
+    std::cout << std::setw(12) << "tier" << std::setw(14) << "result"
+              << std::setw(12) << "median ms" << std::setw(9) << "GB/s"
+              << std::setw(9) << "% copy" << "\n";
+
+    for (int t = 0; t < kNumTiers; ++t) {
+      const Tier& tier = kTiers[t];
+
+      std::cout << std::setw(12) << tier.name;
+      if (getGrid(tier, problemSize_).x == 0) {
+        std::cout << std::setw(14) << "-" << "\n";
+        continue;
+      }
+
+      std::string prefix = std::string("reduce_") + tier.name + "_";
+      CUfunction  kernel = getFunction(module_, prefix + op.name);
+      CUfunction  finish = getFunction(module_,
+                                       std::string("reduce_multiple_")
+                                       + op.partial);
+
+      std::vector<double> times;
+      EventTimer          timer;
+      float               result;
+
+      for (unsigned i = 0; i < getNumberOfWarmupIterations(); ++i) {
+        launchReduction(tier, op, kernel, finish);
+      }
+      for (unsigned i = 0; i < getNumberOfIterations(); ++i) {
+        timer.start(getStream());
+        launchReduction(tier, op, kernel, finish);
+        times.push_back(timer.stop(getStream()));
+      }
+
+      checkSuccess(cuMemcpyDtoH(&result, deviceResult_, sizeof(float)),
+                   "cuMemcpyDtoH");
+
+      // Min and max are exact; sums may round differently in any order
+      double error   = std::fabs(result - expected);
+      bool   correct = (magnitude == 0.0) ? error == 0.0
+                                          : error <= 1e-5 * magnitude;
+      passed = passed && correct;
+
+      double median = summarize(times).median;
+      double bytes  = (double)op.numInputs * problemSize_ * sizeof(float);
+      double rate   = bytes / median / 1e9;
+
+      std::cout << std::setw(14) << result << std::fixed
+                << std::setprecision(3) << std::setw(12) << median * 1e3
+                << std::setprecision(2) << std::setw(9) << rate
+                << std::setw(9) << 100.0 * rate / copyRate
+                << (correct ? "" : "  FAILED") << "\n";
+      std::cout.unsetf(std::ios::floatfield);
+      std::cout << std::setprecision(6);
+    }
+  }
+
+  if (passed) {
+    std::cout << "Host reference comparison test PASSED\n";
+  }
+  else {
+    std::cout << "Host reference comparison test FAILED\n";
+  }
+}
+
+
+
+//==--- Entry Point --------------------------------------------------------== //
+
+int main(int argc,
+         char** argv) {
+  ReductionSample sample;
+
+  sample.run();
+
+  return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include "common/PTXHost.hpp"
+#include "cudaemu.h"
+
+// Compile the device kernels for the host backend of the stand-in driver
+#include "reduction.kernel.cpp"
+
+
+//==--- Kernel Binding -----------------------------------------------------== //
+
+namespace {
+
+/// Parameter buffer shared by all reduce_* kernels
+struct ReductionParams {
+  float* A;
+  float* B;
+  float* out;
+  int    N;
+};
+
+// Only the tiers that synchronize with barriers throughout are bound: the
+// host backend does not run the lanes of a warp in lockstep, so the
+// unrolled, multiple and atomic tiers always run on the PTX interpreter.
+#define DEFINE_THUNK(tier, name)                                          \
+  void tier##_##name##_thunk(const void* params) {                        \
+    const ReductionParams* p = static_cast<const ReductionParams*>(params); \
+    reduce_##tier##_##name(p->A, p->B, p->out, p->N);                     \
+  }                                                                       \
+  CUemuHostKernelRegistration                                             \
+    tier##_##name##_registration("reduce_" #tier "_" #name,               \
+                                 tier##_##name##_thunk);
+
+DEFINE_THUNK(interleaved, sum)
+DEFINE_THUNK(interleaved, min)
+DEFINE_THUNK(interleaved, max)
+DEFINE_THUNK(interleaved, dot)
+DEFINE_THUNK(sequential, sum)
+DEFINE_THUNK(sequential, min)
+DEFINE_THUNK(sequential, max)
+DEFINE_THUNK(sequential, dot)
+
+#undef DEFINE_THUNK
+
+}
@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+// This must be changed to reflect changes in reduction.cpp
+#define BLOCK_SIZE 256
+
+// Shared memory.  The host backend (common/PTXHost.hpp) predefines
+// PTX_SHARED to give each host worker its own copy.
+#if !defined(PTX_SHARED)
+#define PTX_SHARED __attribute__((address_space(4)))
+#endif
+
+// Volatile so that the last warp, which runs without barriers, always sees
+// the stores of the other lanes
+PTX_SHARED volatile float g_scratch[BLOCK_SIZE];
+
+
+//==--- Operators ----------------------------------------------------------== //
+
+// load() reads element i of the input, combine() is associative and
+// commutative with identity() as its neutral element, and Partial is the
+// operator that combines per-block results.
+
+struct SumOp {
+  typedef SumOp Partial;
+
+  static inline float identity() {
+    return 0.0f;
+  }
+
+  static inline float load(const float* A, const float* B, int i) {
+    return A[i];
+  }
+
+  static inline float combine(float a, float b) {
+    return a + b;
+  }
+};
+
+struct MinOp {
+  typedef MinOp Partial;
+
+  static inline float identity() {
+    return __builtin_huge_valf();
+  }
+
+  static inline float load(const float* A, const float* B, int i) {
+    return A[i];
+  }
+
+  static inline float combine(float a, float b) {
+    return a < b ? a : b;
+  }
+};
+
+struct MaxOp {
+  typedef MaxOp Partial;
+
+  static inline float identity() {
+    return -__builtin_huge_valf();
+  }
+
+  static inline float load(const float* A, const float* B, int i) {
+    return A[i];
+  }
+
+  static inline float combine(float a, float b) {
+    return a > b ? a : b;
+  }
+};
+
+struct DotOp {
+  typedef SumOp Partial;
+
+  static inline float identity() {
+    return 0.0f;
+  }
+
+  static inline float load(const float* A, const float* B, int i) {
+    return A[i] * B[i];
+  }
+
+  static inline float combine(float a, float b) {
+    return a + b;
+  }
+};
+
+union FloatBits {
+  float f;
+  int   i;
+};
+
+/**
+ * Combines value into *address atomically, with a compare-and-swap loop
+ * since there are no floating-point atomics for most operators.
+ */
+template <typename Op>
+static inline void atomic_combine(float* address, float value) {
+  int*      bits = reinterpret_cast<int*>(address);
+  FloatBits expected;
+  FloatBits desired;
+
+  expected.f = *address;
+  for (;;) {
+    desired.f    = Op::combine(expected.f, value);
+    int previous = __sync_val_compare_and_swap(bits, expected.i, desired.i);
+    if (previous == expected.i) {
+      break;
+    }
+    expected.i = previous;
+  }
+}
+
+
+//==--- Tiers --------------------------------------------------------------== //
+
+// Each tier reduces BLOCK_SIZE-thread blocks to one value per block, written
+// to out[block] (or, for the atomic tier, combined into out[0]).
+
+// Interleaved addressing: the active threads of each step are spread
+// across the block, so every warp diverges and shared memory accesses
+// conflict.
+template <typename Op>
+static inline void reduce_interleaved(float* A, float* B, float* out, int N) {
+  int tid = __builtin_ptx_read_tid_x();
+  int i   = __builtin_ptx_read_ctaid_x() * BLOCK_SIZE + tid;
+
+  g_scratch[tid] = (i < N) ? Op::load(A, B, i) : Op::identity();
+  __builtin_ptx_bar_sync(0);
+
+  for (int s = 1; s < BLOCK_SIZE; s *= 2) {
+    if (tid % (2 * s) == 0) {
+      g_scratch[tid] = Op::combine(g_scratch[tid], g_scratch[tid + s]);
+    }
+    __builtin_ptx_bar_sync(0);
+  }
+
+  if (tid == 0) {
+    out[__builtin_ptx_read_ctaid_x()] = g_scratch[0];
+  }
+}
+
+// Sequential addressing: the active threads are contiguous, so whole warps
+// retire as the step size halves.
+template <typename Op>
+static inline void reduce_block(int tid, float value) {
+  g_scratch[tid] = value;
+  __builtin_ptx_bar_sync(0);
+
+  for (int s = BLOCK_SIZE / 2; s > 0; s >>= 1) {
+    if (tid < s) {
+      g_scratch[tid] = value = Op::combine(value, g_scratch[tid + s]);
+    }
+    __builtin_ptx_bar_sync(0);
+  }
+}
+
+template <typename Op>
+static inline void reduce_sequential(float* A, float* B, float* out, int N) {
+  int tid = __builtin_ptx_read_tid_x();
+  int i   = __builtin_ptx_read_ctaid_x() * BLOCK_SIZE + tid;
+
+  reduce_block<Op>(tid, (i < N) ? Op::load(A, B, i) : Op::identity());
+
+  if (tid == 0) {
+    out[__builtin_ptx_read_ctaid_x()] = g_scratch[0];
+  }
+}
+
+// As reduce_block(), but once a single warp is left it runs without
+// barriers: the lanes of a warp execute in lockstep.
+template <typename Op>
+static inline void reduce_block_unrolled(int tid, float value) {
+  g_scratch[tid] = value;
+  __builtin_ptx_bar_sync(0);
+
+  for (int s = BLOCK_SIZE / 2; s > 32; s >>= 1) {
+    if (tid < s) {
+      g_scratch[tid] = value = Op::combine(value, g_scratch[tid + s]);
+    }
+    __builtin_ptx_bar_sync(0);
+  }
+
+  if (tid < 32) {
+    g_scratch[tid] = value = Op::combine(value, g_scratch[tid + 32]);
+    g_scratch[tid] = value = Op::combine(value, g_scratch[tid + 16]);
+    g_scratch[tid] = value = Op::combine(value, g_scratch[tid + 8]);
+    g_scratch[tid] = value = Op::combine(value, g_scratch[tid + 4]);
+    g_scratch[tid] = value = Op::combine(value, g_scratch[tid + 2]);
+    g_scratch[tid] = value = Op::combine(value, g_scratch[tid + 1]);
+  }
+}
+
+template <typename Op>
+static inline void reduce_unrolled(float* A, float* B, float* out, int N) {
+  int tid = __builtin_ptx_read_tid_x();
+  int i   = __builtin_ptx_read_ctaid_x() * BLOCK_SIZE + tid;
+
+  reduce_block_unrolled<Op>(tid, (i < N) ? Op::load(A, B, i) : Op::identity());
+
+  if (tid == 0) {
+    out[__builtin_ptx_read_ctaid_x()] = g_scratch[0];
+  }
+}
+
+// Multiple elements per thread: each thread first accumulates a grid-stride
+// slice of the input in a register, so the grid only needs to fill the
+// device and the tree runs once per block rather than once per 256
+// elements.
+template <typename Op>
+static inline float accumulate(float* A, float* B, int N) {
+  int   stride = __builtin_ptx_read_nctaid_x() * BLOCK_SIZE;
+  float value  = Op::identity();
+
+  for (int i = __builtin_ptx_read_ctaid_x() * BLOCK_SIZE
+         + __builtin_ptx_read_tid_x(); i < N; i += stride) {
+    value = Op::combine(value, Op::load(A, B, i));
+  }
+
+  return value;
+}
+
+template <typename Op>
+static inline void reduce_multiple(float* A, float* B, float* out, int N) {
+  int tid = __builtin_ptx_read_tid_x();
+
+  reduce_block_unrolled<Op>(tid, accumulate<Op>(A, B, N));
+
+  if (tid == 0) {
+    out[__builtin_ptx_read_ctaid_x()] = g_scratch[0];
+  }
+}
+
+// Single pass: as reduce_multiple(), but each block combines its result
+// into out[0] atomically, which must hold the identity beforehand.
+template <typename Op>
+static inline void reduce_atomic(float* A, float* B, float* out, int N) {
+  int tid = __builtin_ptx_read_tid_x();
+
+  reduce_block_unrolled<Op>(tid, accumulate<Op>(A, B, N));
+
+  if (tid == 0) {
+    atomic_combine<typename Op::Partial>(out, g_scratch[0]);
+  }
+}
+
+
+//==--- Entry Points -------------------------------------------------------== //
+
+// Every kernel takes (A, B, out, N); only the dot product reads B.  The
+// kernels are named reduce_<tier>_<operator>.
+
+#define DEFINE_REDUCTION(tier, name, Op)                        \
+  extern "C"                                                    \
+  void reduce_##tier##_##name(float* A,                         \
+                              float* B,                         \
+                              float* out,                       \
+                              int    N) {                       \
+    reduce_##tier<Op>(A, B, out, N);                            \
+  }
+
+#define DEFINE_REDUCTIONS(name, Op)                             \
+  DEFINE_REDUCTION(interleaved, name, Op)                       \
+  DEFINE_REDUCTION(sequential, name, Op)                        \
+  DEFINE_REDUCTION(unrolled, name, Op)                          \
+  DEFINE_REDUCTION(multiple, name, Op)                          \
+  DEFINE_REDUCTION(atomic, name, Op)
+
+DEFINE_REDUCTIONS(sum, SumOp)
+DEFINE_REDUCTIONS(min, MinOp)
+DEFINE_REDUCTIONS(max, MaxOp)
+DEFINE_REDUCTIONS(dot, DotOp)
+
+#undef DEFINE_REDUCTIONS
+#undef DEFINE_REDUCTION
@@ -20,246 +20,515 @@
  * THE SOFTWARE.
  */
 
+
+#include <algorithm>
+#include <vector>
 #include <iostream>
-#include <fstream>
+#include <iomanip>
 #include <cmath>
+#include <cstdlib>
 
-#include <sys/time.h>
-
-#include "cuda.h"
+#include "common/CUDASample.hpp"
 
 
 typedef float Real;
 
+// Shape of the streamed pipeline: the vectors are split into kNumChunks
+// pieces, assigned round-robin to kNumStreams streams
+const int kNumStreams = 4;
+const int kNumChunks  = 8;
+
+/**
+ * A version of the kernel in vector-add.kernel.cpp compared by the size
+ * sweep.  Grid-stride kernels are launched with at most one full wave of
+ * blocks; the others need a thread per element.
+ */
+struct KernelVariant {
+  const char* name;
+  const char* function;
+  int         elementsPerThread;
+  bool        gridStride;
+};
+
+const KernelVariant kVariants[] = {
+  { "naive",  "vector_add",             1, false },
+  { "stride", "vector_add_grid_stride", 1, true  },
+  { "float4", "vector_add_float4",      4, true  },
+  { "x2",     "vector_add_unroll2",     2, true  },
+  { "x4",     "vector_add_unroll4",     4, true  },
+  { "x8",     "vector_add_unroll8",     8, true  }
+};
+
+const int kNumVariants = sizeof(kVariants) / sizeof(kVariants[0]);
+
+// The sweep starts with vectors that fit in L2 and grows by 4x up to the
+// footprint given by VECTOR_ADD_SWEEP_MB, or kDefaultSweepMB
+const int kMinSweepElements = 1 << 16;
+const int kDefaultSweepMB   = 3072;
+
+
+//==--- Sample -------------------------------------------------------------== //
+
+class VectorAddSample : public CUDASample {
+public:
+
+  VectorAddSample();
+
+  virtual ~VectorAddSample();
+
+  /**
+   * Times the whole copy-in, add, copy-out sequence, first with synchronous
+   * copies from pageable memory and then pipelined across several streams
+   * from page-locked memory, so that copies in one direction, copies in the
+   * other and the kernel can overlap.
+   */
+  void runTransfers();
+
+  /**
+   * Checks every kernel variant, then times each over a range of vector
+   * sizes and prints its GB/s next to that of a device-to-device copy.
+   */
+  void runSweep();
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+  virtual void setupKernel(CUfunction kernel);
+  virtual void finishKernel(CUfunction kernel);
+  virtual void runKernel(CUfunction kernel, CUstream stream);
+  virtual void reportPerformance(const Timing& timing);
+
+private:
+
+  void transferSerial();
+  void transferStreamed(CUstream* streams);
+  double timeTransfers(bool streamed, CUstream* streams);
+  Dim3 getVariantGrid(const KernelVariant& variant, int N);
+  int countErrors(const Real* C, int N);
+
+  CUmodule    module_;
+
+  CUdeviceptr deviceA_;
+  CUdeviceptr deviceB_;
+  CUdeviceptr deviceC_;
+
+  Real*       hostA_;
+  Real*       hostB_;
+  Real*       cmpC_;
+
+  Real*       pinnedA_;
+  Real*       pinnedB_;
+  Real*       pinnedC_;
+
+  int         blockSizeX_;
+  int         blockSizeMultiple_;
+  int         problemSize_;
+};
+
+
+VectorAddSample::VectorAddSample()
+: hostA_(0), hostB_(0), cmpC_(0), pinnedA_(0), pinnedB_(0), pinnedC_(0) {
+  blockSizeX_        = 512;
+  blockSizeMultiple_ = 5000;
+  problemSize_       = blockSizeX_ * blockSizeMultiple_;
+}
+
+VectorAddSample::~VectorAddSample() {
+  if(hostA_ != 0) {
+    cuMemFree(deviceA_);
+    cuMemFree(deviceB_);
+    cuMemFree(deviceC_);
+    cuMemFreeHost(pinnedA_);
+    cuMemFreeHost(pinnedB_);
+    cuMemFreeHost(pinnedC_);
+  }
 
-//==--- Utility Functions --------------------------------------------------== //
-const char * statusToString(CUresult error)
-{
-  switch (error) {
-    case CUDA_SUCCESS: return "No errors";
-    case CUDA_ERROR_INVALID_VALUE: return "Invalid value";
-    case CUDA_ERROR_OUT_OF_MEMORY: return "Out of memory";
-    case CUDA_ERROR_NOT_INITIALIZED: return "Driver not initialized";
-    case CUDA_ERROR_DEINITIALIZED: return "Driver deinitialized";
+  delete [] hostA_;
+  delete [] hostB_;
+  delete [] cmpC_;
+}
 
-    case CUDA_ERROR_NO_DEVICE: return "No CUDA-capable device available";
-    case CUDA_ERROR_INVALID_DEVICE: return "Invalid device";
+void VectorAddSample::initialize() {
+  module_ = loadModule("vector-add.kernel.ptx");
+  setKernel(getFunction(module_, "vector_add"));
 
-    case CUDA_ERROR_INVALID_IMAGE: return "Invalid kernel image";
-    case CUDA_ERROR_INVALID_CONTEXT: return "Invalid context";
-    case CUDA_ERROR_CONTEXT_ALREADY_CURRENT: return "Context already current";
-    case CUDA_ERROR_MAP_FAILED: return "Map failed";
-    case CUDA_ERROR_UNMAP_FAILED: return "Unmap failed";
-    case CUDA_ERROR_ARRAY_IS_MAPPED: return "Array is mapped";
-    case CUDA_ERROR_ALREADY_MAPPED: return "Already mapped";
-    case CUDA_ERROR_NO_BINARY_FOR_GPU: return "No binary for GPU";
-    case CUDA_ERROR_ALREADY_ACQUIRED: return "Already acquired";
-    case CUDA_ERROR_NOT_MAPPED: return "Not mapped";
+  // Report the median of several launches rather than one cold launch
+  setNumberOfIterations(16);
 
-    case CUDA_ERROR_INVALID_SOURCE: return "Invalid source";
-    case CUDA_ERROR_FILE_NOT_FOUND: return "File not found";
+  std::cout << "Problem Size:         " << problemSize_ << "\n";
+}
 
-    case CUDA_ERROR_INVALID_HANDLE: return "Invalid handle";
+void VectorAddSample::createMemoryBuffers() {
+  size_t bytes = problemSize_ * sizeof(Real);
 
-    case CUDA_ERROR_NOT_FOUND: return "Not found";
+  hostA_ = new Real[problemSize_];
+  hostB_ = new Real[problemSize_];
+  cmpC_  = new Real[problemSize_];
 
-    case CUDA_ERROR_NOT_READY: return "CUDA not ready";
+  checkSuccess(cuMemAlloc(&deviceA_, bytes), "cuMemAlloc");
+  checkSuccess(cuMemAlloc(&deviceB_, bytes), "cuMemAlloc");
+  checkSuccess(cuMemAlloc(&deviceC_, bytes), "cuMemAlloc");
 
-    case CUDA_ERROR_LAUNCH_FAILED: return "Launch failed";
-    case CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES: return "Launch exceeded resources";
-    case CUDA_ERROR_LAUNCH_TIMEOUT: return "Launch exceeded timeout";
-    case CUDA_ERROR_LAUNCH_INCOMPATIBLE_TEXTURING: return "Launch with incompatible texturing";
+  // Page-locked copies of the buffers for the streamed pipeline
+  void* pointer;
+  checkSuccess(cuMemHostAlloc(&pointer, bytes, 0), "cuMemHostAlloc");
+  pinnedA_ = static_cast<Real*>(pointer);
+  checkSuccess(cuMemHostAlloc(&pointer, bytes, 0), "cuMemHostAlloc");
+  pinnedB_ = static_cast<Real*>(pointer);
+  checkSuccess(cuMemHostAlloc(&pointer, bytes, 0), "cuMemHostAlloc");
+  pinnedC_ = static_cast<Real*>(pointer);
 
-    case CUDA_ERROR_UNKNOWN: return "Unknown error";
-    default: return "Unknown error ID";
+  // Populate arrays with test data
+  for (int i = 0; i < problemSize_; ++i) {
+    hostA_[i] = hostB_[i] = (Real)i;
+    cmpC_[i]  = (Real)0.0;
   }
+
+  std::copy(hostA_, hostA_ + problemSize_, pinnedA_);
+  std::copy(hostB_, hostB_ + problemSize_, pinnedB_);
 }
 
-void checkSuccess(CUresult    status,
-                  const char *func,
-                  const char *errorBuffer = 0)
-{
-  if (status != CUDA_SUCCESS) {
-    if (errorBuffer != 0) {
-      std::cerr << "ERROR LOG:" << std::endl
-                << errorBuffer << std::endl;
-    }
+void VectorAddSample::setupKernel(CUfunction kernel) {
+  size_t bytes = problemSize_ * sizeof(Real);
 
-    std::cerr << "ERROR: Could not execute '" << func << "', error ("
-              << status << ") " << statusToString(status) << std::endl;
-    exit(1);
-  }
+  checkSuccess(cuMemcpyHtoD(deviceA_, hostA_, bytes), "cuMemcpyHtoD");
+  checkSuccess(cuMemcpyHtoD(deviceB_, hostB_, bytes), "cuMemcpyHtoD");
 }
 
-double getTimeStamp()
-{
-  struct timezone Tzp;
-  struct timeval  Tp;
-  int             stat;
-  stat = gettimeofday (&Tp, &Tzp);
-  if (stat != 0)
-    std::cerr << "Error return from gettimeofday: " << stat << "\n";
-  return (Tp.tv_sec + Tp.tv_usec * 1.0e-6);
+void VectorAddSample::runKernel(CUfunction kernel, CUstream stream) {
+  launch(kernel, Dim3(blockSizeMultiple_), Dim3(blockSizeX_),
+         deviceA_, deviceB_, deviceC_, problemSize_);
 }
 
+void VectorAddSample::finishKernel(CUfunction kernel) {
+  checkSuccess(cuMemcpyDtoH(cmpC_, deviceC_, problemSize_ * sizeof(Real)),
+               "cuMemcpyDtoH");
 
+  // Compute the reference solution and compare the results
+  double hostStart = getTimeStamp();
+  int    numWrong  = countErrors(cmpC_, problemSize_);
+  double hostEnd   = getTimeStamp();
 
-//==--- Entry Point --------------------------------------------------------== //
+  if (numWrong == 0) {
+    std::cout << "Host reference comparison test PASSED\n";
+  }
+  else {
+    std::cout << "Host reference comparison test FAILED\n";
+  }
 
-int main(int argc,
-         char** argv) {
+  std::cout << "Host Time:            " << (hostEnd - hostStart) << " sec\n";
+}
 
-  CUcontext  context;
-  CUdevice   device;
-  CUmodule   module;
-  CUresult   status;
-  CUfunction function;
-  
-  const int kLogSize = 1024;
-  char      logBuffer[kLogSize];
-
-  int blockSizeX        = 512;
-  int blockSizeMultiple = 5000;
-  int problemSize       = blockSizeX * blockSizeMultiple;
-  
-  
-  // Initialize CUDA
-  std::cout << "Initializing CUDA\n";
-  checkSuccess(cuInit(0), "cuInit");
-  std::cout << "Selecting first compute device\n";
-  checkSuccess(cuDeviceGet(&device, 0), "cuDeviceGet");
-  std::cout << "Creating CUDA context\n";
-  checkSuccess(cuCtxCreate(&context, 0, device), "cuCtxCreate");
-
-  // Read the PTX kernel from disk
-  std::ifstream kernelFile("vector-add.kernel.ptx");
-  if (!kernelFile.is_open()) {
-    std::cerr << "Failed to open vector-add.kernel.ptx\n";
-    return 1;
-  }
+void VectorAddSample::reportPerformance(const Timing& timing) {
+  double bytes = 3.0 * problemSize_ * sizeof(Real);
 
-  // Load entire kernel into a string
-  std::string source(std::istreambuf_iterator<char>(kernelFile),
-                     (std::istreambuf_iterator<char>()));
+  std::cout << "Median GB/s:          " << bytes / timing.median / 1e9
+            << "\n";
+  std::cout << "Peak GB/s:            " << bytes / timing.minimum / 1e9
+            << "\n";
+}
 
-  // Configure JIT options
-  CUjit_option jitOptions[] = { CU_JIT_ERROR_LOG_BUFFER_SIZE_BYTES,
-                                CU_JIT_ERROR_LOG_BUFFER };
-  void* jitOptionValues[]   = { reinterpret_cast<void*>(kLogSize), logBuffer };
 
-  // Load the kernel onto the device
-  status = cuModuleLoadDataEx(&module, source.c_str(),
-                              sizeof(jitOptions)/sizeof(jitOptions[0]),
-                              jitOptions, jitOptionValues);
-  checkSuccess(status, "cuModuleLoadDataEx", logBuffer);
 
-  status = cuModuleGetFunction(&function, module, "vector_add");
-  checkSuccess(status, "cuModuleGetFunction");
+int VectorAddSample::countErrors(const Real* C, int N) {
+  int numWrong = 0;
 
+  for (int i = 0; i < N; ++i) {
+    if (std::abs((hostA_[i] + hostB_[i]) - C[i]) > (Real)1e-5) {
+      numWrong++;
+    }
+  }
 
-  // Print some diagnostics about the kernel compilation
-  int numRegisters;
-  cuFuncGetAttribute(&numRegisters, CU_FUNC_ATTRIBUTE_NUM_REGS, function);
-  std::cout << "Register Usage:  " << numRegisters << "\n";
-  
+  return numWrong;
+}
 
-  // Setup buffers
-  Real* hostA = new Real[problemSize];
-  Real* hostB = new Real[problemSize];
-  Real* refC  = new Real[problemSize];
-  Real* cmpC  = new Real[problemSize];
 
-  std::cout << "Problem Size:  " << problemSize << "\n";
-  
-  CUdeviceptr deviceA;
-  CUdeviceptr deviceB;
-  CUdeviceptr deviceC;
 
-  status = cuMemAlloc(&deviceA, problemSize * sizeof(Real));
-  checkSuccess(status, "cuMemAlloc");
-  status = cuMemAlloc(&deviceB, problemSize * sizeof(Real));
-  checkSuccess(status, "cuMemAlloc");
-  status = cuMemAlloc(&deviceC, problemSize * sizeof(Real));
-  checkSuccess(status, "cuMemAlloc");
+//==--- Transfers ----------------------------------------------------------== //
 
+void VectorAddSample::transferSerial() {
+  size_t bytes = problemSize_ * sizeof(Real);
 
-  // Populate arrays with test data
-  for (int i = 0; i < problemSize; ++i) {
-    hostA[i] = hostB[i] = (Real)i;
-    refC[i] = cmpC[i] = (Real)0.0;
+  checkSuccess(cuMemcpyHtoD(deviceA_, hostA_, bytes), "cuMemcpyHtoD");
+  checkSuccess(cuMemcpyHtoD(deviceB_, hostB_, bytes), "cuMemcpyHtoD");
+  runKernel(getKernel(), getStream());
+  checkSuccess(cuMemcpyDtoH(cmpC_, deviceC_, bytes), "cuMemcpyDtoH");
+}
+
+void VectorAddSample::transferStreamed(CUstream* streams) {
+  // Whole blocks per chunk, except for the remainder in the last one
+  int blocksPerChunk = (blockSizeMultiple_ + kNumChunks - 1) / kNumChunks;
+  int chunkSize      = blocksPerChunk * blockSizeX_;
+
+  // Each stream copies its chunk in, adds it and copies it out; the driver
+  // overlaps the copies and kernels of different streams
+  for (int chunk = 0; chunk < kNumChunks; ++chunk) {
+    int first = chunk * chunkSize;
+    if (first >= problemSize_) {
+      break;
+    }
+
+    int         count  = std::min(chunkSize, problemSize_ - first);
+    size_t      offset = first * sizeof(Real);
+    size_t      bytes  = count * sizeof(Real);
+    CUstream    stream = streams[chunk % kNumStreams];
+    CUdeviceptr A      = deviceA_ + offset;
+    CUdeviceptr B      = deviceB_ + offset;
+    CUdeviceptr C      = deviceC_ + offset;
+
+    checkSuccess(cuMemcpyHtoDAsync(A, pinnedA_ + first, bytes, stream),
+                 "cuMemcpyHtoDAsync");
+    checkSuccess(cuMemcpyHtoDAsync(B, pinnedB_ + first, bytes, stream),
+                 "cuMemcpyHtoDAsync");
+
+    void* params[] = { &A, &B, &C, &count };
+    launchKernel(getKernel(), Dim3((count + blockSizeX_ - 1) / blockSizeX_),
+                 Dim3(blockSizeX_), 0, stream, params);
+
+    checkSuccess(cuMemcpyDtoHAsync(pinnedC_ + first, C, bytes, stream),
+                 "cuMemcpyDtoHAsync");
+  }
+}
+
+double VectorAddSample::timeTransfers(bool streamed, CUstream* streams) {
+  std::vector<double> times;
+  EventTimer          timer;
+
+  for (unsigned i = 0; i < getNumberOfWarmupIterations(); ++i) {
+    if (streamed) {
+      transferStreamed(streams);
+    }
+    else {
+      transferSerial();
+    }
+  }
+  checkSuccess(cuCtxSynchronize(), "cuCtxSynchronize");
+
+  // The timer's events are on the default stream, so they also wait for
+  // the work of every other stream
+  for (unsigned i = 0; i < getNumberOfIterations(); ++i) {
+    timer.start();
+    if (streamed) {
+      transferStreamed(streams);
+    }
+    else {
+      transferSerial();
+    }
+    times.push_back(timer.stop());
   }
 
+  return summarize(times).median;
+}
+
+void VectorAddSample::runTransfers() {
+  CUstream streams[kNumStreams];
+
+  for (int i = 0; i < kNumStreams; ++i) {
+    checkSuccess(cuStreamCreate(&streams[i], 0), "cuStreamCreate");
+  }
 
-  // Copy buffers to device
-  status = cuMemcpyHtoD(deviceA, hostA, problemSize * sizeof(Real));
-  checkSuccess(status, "cuMemcpyHtoD");
-  status = cuMemcpyHtoD(deviceB, hostB, problemSize * sizeof(Real));
-  checkSuccess(status, "cuMemcpyHtoD");
+  std::cout << "------------------------------\n";
+  std::cout << "* End-to-End Transfers\n";
+  std::cout << "------------------------------\n";
 
+  std::fill(cmpC_, cmpC_ + problemSize_, (Real)0.0);
+  std::fill(pinnedC_, pinnedC_ + problemSize_, (Real)0.0);
 
-  // Setup block shape
-  status = cuFuncSetBlockShape(function, blockSizeX, 1, 1);
-  checkSuccess(status, "cuFuncSetBlockShape");
+  double serial   = timeTransfers(false, streams);
+  double streamed = timeTransfers(true, streams);
 
+  if (countErrors(cmpC_, problemSize_) == 0 &&
+      countErrors(pinnedC_, problemSize_) == 0) {
+    std::cout << "Host reference comparison test PASSED\n";
+  }
+  else {
+    std::cout << "Host reference comparison test FAILED\n";
+  }
 
-  // Bind kernel paramters
-  status = cuParamSetv(function, 0, &deviceA, sizeof(CUdeviceptr));
-  checkSuccess(status, "cuParamSetv");
-  status = cuParamSetv(function, sizeof(CUdeviceptr), &deviceB, sizeof(CUdeviceptr));
-  checkSuccess(status, "cuParamSetv");
-  status = cuParamSetv(function, 2*sizeof(CUdeviceptr), &deviceC, sizeof(CUdeviceptr));
-  checkSuccess(status, "cuParamSetv");
-  status = cuParamSeti(function, 3*sizeof(CUdeviceptr), problemSize);
-  checkSuccess(status, "cuParamSeti");
+  // Both inputs in and the result out
+  double bytes = 3.0 * problemSize_ * sizeof(Real);
 
-  status = cuParamSetSize(function, 3*sizeof(CUdeviceptr) + sizeof(int));
-  checkSuccess(status, "cuParamSetSize");
+  std::cout << "Streams / Chunks:     " << kNumStreams << " / " << kNumChunks
+            << "\n";
+  std::cout << "Serial Time:          " << serial << " sec\n";
+  std::cout << "Serial GB/s:          " << bytes / serial / 1e9 << "\n";
+  std::cout << "Streamed Time:        " << streamed << " sec\n";
+  std::cout << "Streamed GB/s:        " << bytes / streamed / 1e9 << "\n";
+  std::cout << "Streamed Speedup:     " << serial / streamed << "x\n";
 
+  for (int i = 0; i < kNumStreams; ++i) {
+    cuStreamDestroy(streams[i]);
+  }
+}
 
-  // Launch the kernel
-  double deviceStart = getTimeStamp();
-  
-  status = cuLaunchGrid(function, blockSizeMultiple, 1);
-  checkSuccess(status, "cuLaunchGrid");
-  cuCtxSynchronize();
 
-  double deviceEnd = getTimeStamp();
-  
 
-  // Copy results back to the host
-  status = cuMemcpyDtoH(cmpC, deviceC, problemSize * sizeof(Real));
-  checkSuccess(status, "cuMemoryDtoH");
+//==--- Size Sweep ---------------------------------------------------------== //
 
+CUDASample::Dim3 VectorAddSample::getVariantGrid(const KernelVariant& variant,
+                                                 int N) {
+  int elementsPerBlock = blockSizeX_ * variant.elementsPerThread;
+  int blocks           = (N + elementsPerBlock - 1) / elementsPerBlock;
 
-  // Compute the reference solution
-  double hostStart = getTimeStamp();
+  int maxGridX, numSMs, threadsPerSM;
+  cuDeviceGetAttribute(&maxGridX, CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_X,
+                       getDevice());
+  cuDeviceGetAttribute(&numSMs, CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT,
+                       getDevice());
+  cuDeviceGetAttribute(&threadsPerSM,
+                       CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_MULTIPROCESSOR,
+                       getDevice());
 
-  for (int i = 0; i < problemSize; ++i) {
-    refC[i] = hostA[i] + hostB[i];
+  if (variant.gridStride) {
+    int wave = numSMs * std::max(threadsPerSM / blockSizeX_, 1);
+    blocks   = std::min(blocks, wave);
+  }
+  else if (blocks > maxGridX) {
+    // Too large for a thread per element
+    return Dim3(0);
   }
 
-  double hostEnd = getTimeStamp();
+  return Dim3(blocks);
+}
 
+void VectorAddSample::runSweep() {
+  CUfunction kernels[kNumVariants];
 
-  // Compare the results
-  int numWrong = 0;
-  
-  for (int i = 0; i < problemSize; ++i) {
-    if (std::abs(refC[i] - cmpC[i]) > (Real)1e-5) {
-      numWrong++;
+  for (int v = 0; v < kNumVariants; ++v) {
+    kernels[v] = getFunction(module_, kVariants[v].function);
+  }
+
+  std::cout << "------------------------------\n";
+  std::cout << "* Kernel Variants\n";
+  std::cout << "------------------------------\n";
+
+  // Check each variant on a length that is not a multiple of 4, so the
+  // remainder loops run too
+  int  checkSize = problemSize_ - 3;
+  bool passed    = true;
+
+  for (int v = 0; v < kNumVariants; ++v) {
+    std::fill(cmpC_, cmpC_ + problemSize_, (Real)0.0);
+    checkSuccess(cuMemcpyHtoD(deviceC_, cmpC_, problemSize_ * sizeof(Real)),
+                 "cuMemcpyHtoD");
+    launch(kernels[v], getVariantGrid(kVariants[v], checkSize),
+           Dim3(blockSizeX_), deviceA_, deviceB_, deviceC_, checkSize);
+    checkSuccess(cuMemcpyDtoH(cmpC_, deviceC_, problemSize_ * sizeof(Real)),
+                 "cuMemcpyDtoH");
+
+    if (countErrors(cmpC_, checkSize) != 0 || cmpC_[checkSize] != (Real)0.0) {
+      std::cout << "Variant " << kVariants[v].name << " FAILED\n";
+      passed = false;
     }
   }
 
-  if (numWrong == 0) {
+  if (passed) {
     std::cout << "Host reference comparison test PASSED\n";
   }
   else {
     std::cout << "Host reference comparison test FAILED\n";
   }
 
-  std::cout << "Device Time:  " << (deviceEnd - deviceStart) << "s\n";
-  std::cout << "Host Time:    " << (hostEnd - hostStart) << "s\n";
-  
-  return 0;
+  // Largest footprint of the three vectors, bounded by free device memory
+  size_t maxBytes = (size_t)kDefaultSweepMB << 20;
+  if (const char* value = getenv("VECTOR_ADD_SWEEP_MB")) {
+    maxBytes = (size_t)atoi(value) << 20;
+  }
+
+  size_t freeBytes, totalBytes;
+  checkSuccess(cuMemGetInfo(&freeBytes, &totalBytes), "cuMemGetInfo");
+  maxBytes = std::min(maxBytes, freeBytes / 10 * 9);
+
+  int maxElements = kMinSweepElements;
+  while (maxElements < (1 << 28) &&
+         (size_t)maxElements * 4 * 3 * sizeof(Real) <= maxBytes) {
+    maxElements *= 4;
+  }
+
+  // The contents do not matter for timing; only the small check above
+  // looks at the results
+  CUdeviceptr A, B, C;
+  checkSuccess(cuMemAlloc(&A, maxElements * sizeof(Real)), "cuMemAlloc");
+  checkSuccess(cuMemAlloc(&B, maxElements * sizeof(Real)), "cuMemAlloc");
+  checkSuccess(cuMemAlloc(&C, maxElements * sizeof(Real)), "cuMemAlloc");
+  checkSuccess(cuMemsetD32(A, 0x3f800000, maxElements), "cuMemsetD32");
+  checkSuccess(cuMemsetD32(B, 0x40000000, maxElements), "cuMemsetD32");
+
+  std::cout << "------------------------------\n";
+  std::cout << "* Size Sweep (GB/s)\n";
+  std::cout << "------------------------------\n";
+  std::cout << std::setw(10) << "MB" << std::setw(9) << "copy";
+  for (int v = 0; v < kNumVariants; ++v) {
+    std::cout << std::setw(9) << kVariants[v].name;
+  }
+  std::cout << std::setw(9) << "best %" << "\n";
+  std::cout << std::fixed << std::setprecision(2);
+
+  EventTimer timer;
+
+  for (int N = kMinSweepElements; N <= maxElements; N *= 4) {
+    std::vector<double> times;
+    size_t              bytes = N * sizeof(Real);
+
+    // Device copy of one vector: a read and a write per element
+    checkSuccess(cuMemcpyDtoD(C, A, bytes), "cuMemcpyDtoD");
+    for (unsigned i = 0; i < getNumberOfIterations(); ++i) {
+      timer.start();
+      checkSuccess(cuMemcpyDtoD(C, A, bytes), "cuMemcpyDtoD");
+      times.push_back(timer.stop());
+    }
+    double copyRate = 2.0 * bytes / summarize(times).median / 1e9;
+    double bestRate = 0.0;
+
+    std::cout << std::setw(10) << 3.0 * bytes / (1 << 20)
+              << std::setw(9) << copyRate;
+
+    for (int v = 0; v < kNumVariants; ++v) {
+      Dim3 grid = getVariantGrid(kVariants[v], N);
+      if (grid.x == 0) {
+        std::cout << std::setw(9) << "-";
+        continue;
+      }
+
+      times.clear();
+      for (unsigned i = 0; i < getNumberOfWarmupIterations(); ++i) {
+        launch(kernels[v], grid, Dim3(blockSizeX_), A, B, C, N);
+      }
+      for (unsigned i = 0; i < getNumberOfIterations(); ++i) {
+        timer.start(getStream());
+        launch(kernels[v], grid, Dim3(blockSizeX_), A, B, C, N);
+        times.push_back(timer.stop(getStream()));
+      }
+
+      // Two vectors in, one out
+      double rate = 3.0 * bytes / summarize(times).median / 1e9;
+      bestRate    = std::max(bestRate, rate);
+      std::cout << std::setw(9) << rate;
+    }
+
+    std::cout << std::setw(9) << 100.0 * bestRate / copyRate << "\n";
+  }
+
+  std::cout.unsetf(std::ios::floatfield);
+  std::cout << std::setprecision(6);
+
+  cuMemFree(A);
+  cuMemFree(B);
+  cuMemFree(C);
 }
 
+
+
+//==--- Entry Point --------------------------------------------------------== //
+
+int main(int argc,
+         char** argv) {
+  VectorAddSample sample;
+
+  sample.run();
+  sample.runTransfers();
+  sample.runSweep();
+
+  return 0;
+}
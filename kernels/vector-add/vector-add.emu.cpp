@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "common/PTXHost.hpp"
+#include "cudaemu.h"
+
+// Compile the device kernel for the host backend of the stand-in driver
+#include "vector-add.kernel.cpp"
+
+
+//==--- Kernel Binding -----------------------------------------------------== //
+
+namespace {
+
+/// Parameter buffer of vector_add, as cuParamSetv fills it
+struct VectorAddParams {
+  float* A;
+  float* B;
+  float* C;
+  int    N;
+};
+
+void vectorAddThunk(const void* params) {
+  const VectorAddParams* p = static_cast<const VectorAddParams*>(params);
+  vector_add(p->A, p->B, p->C, p->N);
+}
+
+void vectorAddGridStrideThunk(const void* params) {
+  const VectorAddParams* p = static_cast<const VectorAddParams*>(params);
+  vector_add_grid_stride(p->A, p->B, p->C, p->N);
+}
+
+void vectorAddFloat4Thunk(const void* params) {
+  const VectorAddParams* p = static_cast<const VectorAddParams*>(params);
+  vector_add_float4(p->A, p->B, p->C, p->N);
+}
+
+void vectorAddUnroll2Thunk(const void* params) {
+  const VectorAddParams* p = static_cast<const VectorAddParams*>(params);
+  vector_add_unroll2(p->A, p->B, p->C, p->N);
+}
+
+void vectorAddUnroll4Thunk(const void* params) {
+  const VectorAddParams* p = static_cast<const VectorAddParams*>(params);
+  vector_add_unroll4(p->A, p->B, p->C, p->N);
+}
+
+void vectorAddUnroll8Thunk(const void* params) {
+  const VectorAddParams* p = static_cast<const VectorAddParams*>(params);
+  vector_add_unroll8(p->A, p->B, p->C, p->N);
+}
+
+// The kernels of vector-add.kernel.cpp all take the same parameters
+CUemuHostKernelRegistration registration("vector_add", vectorAddThunk);
+CUemuHostKernelRegistration
+  gridStrideRegistration("vector_add_grid_stride", vectorAddGridStrideThunk);
+CUemuHostKernelRegistration
+  float4Registration("vector_add_float4", vectorAddFloat4Thunk);
+CUemuHostKernelRegistration
+  unroll2Registration("vector_add_unroll2", vectorAddUnroll2Thunk);
+CUemuHostKernelRegistration
+  unroll4Registration("vector_add_unroll4", vectorAddUnroll4Thunk);
+CUemuHostKernelRegistration
+  unroll8Registration("vector_add_unroll8", vectorAddUnroll8Thunk);
+
+}
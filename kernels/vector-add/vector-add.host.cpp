@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+
+#include "common/PTXHost.hpp"
+#include "common/Sample.hpp"
+
+// Compile the device kernel for the host
+#include "vector-add.kernel.cpp"
+
+
+typedef float Real;
+
+
+//==--- Kernel Binding -----------------------------------------------------== //
+
+class VectorAddBody : public ptxhost::KernelBody {
+public:
+
+  VectorAddBody(Real* A, Real* B, Real* C, int N)
+  : A_(A), B_(B), C_(C), N_(N) {
+  }
+
+  virtual void invoke() {
+    vector_add(A_, B_, C_, N_);
+  }
+
+private:
+
+  Real* A_;
+  Real* B_;
+  Real* C_;
+  int   N_;
+};
+
+
+
+//==--- Entry Point --------------------------------------------------------== //
+
+int main(int argc,
+         char** argv) {
+
+  int blockSizeX        = 512;
+  int blockSizeMultiple = 5000;
+  int problemSize       = blockSizeX * blockSizeMultiple;
+
+  std::cout << "Host Workers:  " << ptxhost::getDefaultWorkerCount() << "\n";
+  std::cout << "Problem Size:  " << problemSize << "\n";
+
+  // Setup buffers
+  Real* hostA = new Real[problemSize];
+  Real* hostB = new Real[problemSize];
+  Real* refC  = new Real[problemSize];
+  Real* cmpC  = new Real[problemSize];
+
+  // Populate arrays with test data
+  for (int i = 0; i < problemSize; ++i) {
+    hostA[i] = hostB[i] = (Real)i;
+    refC[i] = cmpC[i] = (Real)0.0;
+  }
+
+  VectorAddBody body(hostA, hostB, cmpC, problemSize);
+  ptxhost::Dim3 grid  = ptxhost::makeDim3(blockSizeMultiple);
+  ptxhost::Dim3 block = ptxhost::makeDim3(blockSizeX);
+
+  // Warm up the worker caches and page in the buffers
+  ptxhost::launchGrid(body, grid, block, false);
+
+  // Launch the kernel
+  double kernelStart = Sample::getTimeStamp();
+  ptxhost::launchGrid(body, grid, block, false);
+  double kernelEnd = Sample::getTimeStamp();
+
+
+  // Compute the reference solution
+  double hostStart = Sample::getTimeStamp();
+
+  for (int i = 0; i < problemSize; ++i) {
+    refC[i] = hostA[i] + hostB[i];
+  }
+
+  double hostEnd = Sample::getTimeStamp();
+
+
+  // Compare the results
+  int numWrong = 0;
+
+  for (int i = 0; i < problemSize; ++i) {
+    if (std::abs(refC[i] - cmpC[i]) > (Real)1e-5) {
+      numWrong++;
+    }
+  }
+
+  if (numWrong == 0) {
+    std::cout << "Host reference comparison test PASSED\n";
+  }
+  else {
+    std::cout << "Host reference comparison test FAILED\n";
+  }
+
+  double bytes = 3.0 * problemSize * sizeof(Real);
+
+  std::cout << "Kernel Time:      " << (kernelEnd - kernelStart) << "s\n";
+  std::cout << "Kernel GB/s:      " << bytes / (kernelEnd - kernelStart) / 1e9
+            << "\n";
+  std::cout << "Reference Time:   " << (hostEnd - hostStart) << "s\n";
+  std::cout << "Reference GB/s:   " << bytes / (hostEnd - hostStart) / 1e9
+            << "\n";
+
+  return 0;
+}
@@ -35,3 +35,111 @@ void vector_add(float* A,
     C[myId] = A[myId] + B[myId];
   }
 }
+
+
+// The variants below cover the vector with a grid-stride loop, so any grid
+// size works and a grid sized to fill the device is launched once for the
+// whole vector.
+
+extern "C"
+void vector_add_grid_stride(float* A,
+                            float* B,
+                            float* C,
+                            int    N) {
+
+  int stride = __builtin_ptx_read_nctaid_x() * __builtin_ptx_read_ntid_x();
+  int myId   = (__builtin_ptx_read_ctaid_x() * __builtin_ptx_read_ntid_x())
+    + __builtin_ptx_read_tid_x();
+
+  for (int i = myId; i < N; i += stride) {
+    C[i] = A[i] + B[i];
+  }
+}
+
+
+// Four floats per access, so each thread issues 128-bit loads and stores
+typedef float VectorFloat4 __attribute__((vector_size(16)));
+
+extern "C"
+void vector_add_float4(float* A,
+                       float* B,
+                       float* C,
+                       int    N) {
+
+  int stride = __builtin_ptx_read_nctaid_x() * __builtin_ptx_read_ntid_x();
+  int myId   = (__builtin_ptx_read_ctaid_x() * __builtin_ptx_read_ntid_x())
+    + __builtin_ptx_read_tid_x();
+
+  // cuMemAlloc aligns allocations well beyond 16 bytes
+  const VectorFloat4* A4 = reinterpret_cast<const VectorFloat4*>(A);
+  const VectorFloat4* B4 = reinterpret_cast<const VectorFloat4*>(B);
+  VectorFloat4*       C4 = reinterpret_cast<VectorFloat4*>(C);
+  int                 N4 = N / 4;
+
+  for (int i = myId; i < N4; i += stride) {
+    C4[i] = A4[i] + B4[i];
+  }
+
+  // The last N % 4 elements
+  int tail = N4 * 4 + myId;
+  if (tail < N) {
+    C[tail] = A[tail] + B[tail];
+  }
+}
+
+
+// Each trip adds UNROLL elements spaced one grid apart, so the accesses of a
+// warp stay coalesced.  All loads are issued before the first store to keep
+// UNROLL requests in flight per thread.
+template <int UNROLL>
+static inline void vector_add_unrolled(float* A,
+                                       float* B,
+                                       float* C,
+                                       int    N) {
+
+  int stride = __builtin_ptx_read_nctaid_x() * __builtin_ptx_read_ntid_x();
+  int i      = (__builtin_ptx_read_ctaid_x() * __builtin_ptx_read_ntid_x())
+    + __builtin_ptx_read_tid_x();
+
+  for (; i + (UNROLL - 1) * stride < N; i += UNROLL * stride) {
+    float a[UNROLL];
+    float b[UNROLL];
+
+    for (int u = 0; u < UNROLL; ++u) {
+      a[u] = A[i + u * stride];
+      b[u] = B[i + u * stride];
+    }
+
+    for (int u = 0; u < UNROLL; ++u) {
+      C[i + u * stride] = a[u] + b[u];
+    }
+  }
+
+  for (; i < N; i += stride) {
+    C[i] = A[i] + B[i];
+  }
+}
+
+extern "C"
+void vector_add_unroll2(float* A,
+                        float* B,
+                        float* C,
+                        int    N) {
+  vector_add_unrolled<2>(A, B, C, N);
+}
+
+extern "C"
+void vector_add_unroll4(float* A,
+                        float* B,
+                        float* C,
+                        int    N) {
+  vector_add_unrolled<4>(A, B, C, N);
+}
+
+extern "C"
+void vector_add_unroll8(float* A,
+                        float* B,
+                        float* C,
+                        int    N) {
+  vector_add_unrolled<8>(A, B, C, N);
+}
@@ -0,0 +1,686 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "common/MappedFile.hpp"
+#include "common/OCLSample.hpp"
+
+// This must be changed to reflect changes in bfs_kernel.cl
+#define BLOCK_SIZE 256
+
+// Direction switching thresholds of Beamer et al.: go bottom-up once the
+// frontier's edges exceed 1/ALPHA of the unexplored edges, and top-down
+// again once the frontier holds fewer than 1/BETA of the vertices
+#define ALPHA 14
+#define BETA  24
+
+/**
+ * An undirected graph in CSR form, every edge stored in both directions,
+ * with the BFS sources and their host reference levels.
+ */
+struct Graph {
+  std::string                     name;
+  cl_uint                         numVertices;
+  std::vector<cl_uint>            offsets;
+  std::vector<cl_uint>            edges;
+  std::vector<cl_uint>            sources;
+  std::vector<std::vector<int> >  levels;
+};
+
+
+//==--- Graphs -------------------------------------------------------------== //
+
+/**
+ * Builds the CSR form of the graph with the given edges, dropping
+ * self-loops and duplicates.
+ */
+static void buildGraph(cl_uint numVertices, const std::vector<cl_uint>& from,
+                       const std::vector<cl_uint>& to, Graph& graph) {
+  std::vector<cl_uint> starts(numVertices + 1, 0);
+  std::vector<cl_uint> scattered;
+
+  for(size_t e = 0; e < from.size(); ++e) {
+    if(from[e] != to[e]) {
+      ++starts[from[e] + 1];
+      ++starts[to[e] + 1];
+    }
+  }
+  for(cl_uint v = 0; v < numVertices; ++v) {
+    starts[v + 1] += starts[v];
+  }
+
+  std::vector<cl_uint> fill(starts.begin(), starts.end() - 1);
+  scattered.resize(starts[numVertices]);
+  for(size_t e = 0; e < from.size(); ++e) {
+    if(from[e] != to[e]) {
+      scattered[fill[from[e]]++] = to[e];
+      scattered[fill[to[e]]++]   = from[e];
+    }
+  }
+
+  graph.numVertices = numVertices;
+  graph.offsets.assign(1, 0);
+  graph.edges.clear();
+  for(cl_uint v = 0; v < numVertices; ++v) {
+    std::vector<cl_uint>::iterator first = scattered.begin() + starts[v];
+    std::vector<cl_uint>::iterator last  = scattered.begin() + starts[v + 1];
+    std::sort(first, last);
+    graph.edges.insert(graph.edges.end(), first, std::unique(first, last));
+    graph.offsets.push_back(graph.edges.size());
+  }
+}
+
+/**
+ * An R-MAT graph of 2^scale vertices and 16 edges per vertex, with the
+ * Graph 500 quadrant probabilities (0.57, 0.19, 0.19, 0.05) and randomly
+ * relabelled vertices: a skewed degree distribution and a small diameter.
+ */
+static void makeRMAT(unsigned scale, Graph& graph) {
+  cl_ulong             state    = 0x9e3779b97f4a7c15ULL;
+  cl_uint              vertices = 1u << scale;
+  size_t               count    = (size_t)vertices * 16;
+  std::vector<cl_uint> from(count), to(count), label(vertices);
+
+  for(size_t e = 0; e < count; ++e) {
+    cl_uint u = 0, v = 0;
+    for(unsigned bit = 0; bit < scale; ++bit) {
+      double p = nextUniform(state);
+      u = (u << 1) | (p >= 0.57 + 0.19 ? 1 : 0);
+      v = (v << 1) | ((p >= 0.57 && p < 0.57 + 0.19) || p >= 0.95 ? 1 : 0);
+    }
+    from[e] = u;
+    to[e]   = v;
+  }
+
+  // Otherwise the hubs would all have small labels
+  for(cl_uint v = 0; v < vertices; ++v) {
+    label[v] = v;
+  }
+  for(cl_uint v = vertices - 1; v > 0; --v) {
+    std::swap(label[v], label[nextRandom(state) % (v + 1)]);
+  }
+  for(size_t e = 0; e < count; ++e) {
+    from[e] = label[from[e]];
+    to[e]   = label[to[e]];
+  }
+
+  buildGraph(vertices, from, to, graph);
+}
+
+/**
+ * A side*side 4-neighbour grid: uniform degrees, but a diameter of
+ * 2 (side - 1), so many levels with small frontiers.
+ */
+static void makeGrid(cl_uint side, Graph& graph) {
+  std::vector<cl_uint> from, to;
+
+  for(cl_uint y = 0; y < side; ++y) {
+    for(cl_uint x = 0; x < side; ++x) {
+      cl_uint v = y * side + x;
+      if(x + 1 < side) {
+        from.push_back(v);
+        to.push_back(v + 1);
+      }
+      if(y + 1 < side) {
+        from.push_back(v);
+        to.push_back(v + side);
+      }
+    }
+  }
+
+  buildGraph(side * side, from, to, graph);
+}
+
+/**
+ * Reads an edge list, one "u v" pair of zero-based vertices per line, as
+ * SNAP distributes graphs.  Lines starting with '#' or '%' are comments,
+ * and anything after the pair (a weight, say) is ignored.  Returns false
+ * if the file cannot be mapped or a line has no pair.
+ */
+static bool loadEdgeList(const std::string& filename, Graph& graph) {
+  MappedFile file;
+
+  if(!file.open(filename)) {
+    return false;
+  }
+
+  const char*          pos      = static_cast<const char*>(file.getData());
+  const char*          end      = pos + file.getSize();
+  cl_ulong             vertices = 0;
+  std::vector<cl_uint> from, to;
+
+  while(pos < end) {
+    cl_ulong pair[2];
+
+    while(pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r')) {
+      ++pos;
+    }
+    if(pos < end && *pos != '\n' && *pos != '#' && *pos != '%') {
+      for(unsigned k = 0; k < 2; ++k) {
+        while(pos < end && (*pos == ' ' || *pos == '\t')) {
+          ++pos;
+        }
+        if(pos == end || *pos < '0' || *pos > '9') {
+          return false;
+        }
+        for(pair[k] = 0; pos < end && *pos >= '0' && *pos <= '9'; ++pos) {
+          pair[k] = pair[k] * 10 + (*pos - '0');
+        }
+        if(pair[k] >= 0xffffffffUL) {
+          return false;
+        }
+      }
+      from.push_back((cl_uint)pair[0]);
+      to.push_back((cl_uint)pair[1]);
+      vertices = std::max(vertices, std::max(pair[0], pair[1]) + 1);
+    }
+    while(pos < end && *pos++ != '\n') {
+    }
+  }
+  if(vertices == 0) {
+    return false;
+  }
+
+  buildGraph((cl_uint)vertices, from, to, graph);
+  return true;
+}
+
+/**
+ * Levels of a BFS from source, -1 for unreached vertices.
+ */
+static void bfsHost(const Graph& graph, cl_uint source,
+                    std::vector<int>& levels) {
+  std::vector<cl_uint> queue(1, source);
+
+  levels.assign(graph.numVertices, -1);
+  levels[source] = 0;
+  for(size_t head = 0; head < queue.size(); ++head) {
+    cl_uint v = queue[head];
+    for(cl_uint e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+      cl_uint u = graph.edges[e];
+      if(levels[u] == -1) {
+        levels[u] = levels[v] + 1;
+        queue.push_back(u);
+      }
+    }
+  }
+}
+
+
+//==--- Sample -------------------------------------------------------------== //
+
+enum Mode {
+  MODE_TOP_DOWN,
+  MODE_DIRECTION_OPTIMIZING,
+  NUM_MODES
+};
+
+const char* kModeNames[NUM_MODES] = { "top-down", "direction-opt" };
+
+/**
+ * Breadth-first search with frontier queues, top-down only and switching
+ * to bottom-up steps while the frontier is large, on R-MAT and grid graphs
+ * and on any edge-list files given.  The host reads the frontier size back
+ * after every step to size the next launch and choose its direction.  The
+ * levels of each search are checked against the host, and the rate is
+ * reported in traversed edges per second, as the harmonic mean over the
+ * sources.
+ */
+class BFSSample : public OCLSample {
+public:
+
+  BFSSample();
+
+  virtual ~BFSSample();
+
+  virtual void run();
+
+  void setRMATScale(unsigned int scale) {
+    assert(scale > 0 && scale < 32 && "R-MAT scale must be in [1, 31]");
+    RMATScale_ = scale;
+  }
+
+  void setGridSide(unsigned int side) {
+    assert(side > 0 && side <= 65535 && "Grid side must be in [1, 65535]");
+    GridSide_ = side;
+  }
+
+  void setNumSources(unsigned int sources) {
+    assert(sources > 0 && "At least one source is needed");
+    NumSources_ = sources;
+  }
+
+  void addGraphFile(const std::string& filename) {
+    GraphFiles_.push_back(filename);
+  }
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+
+private:
+
+  void addGraph(Graph* graph);
+  void enqueue(cl::Kernel& kernel, size_t count);
+  void clearCounters();
+  void readCounters(cl_uint counters[2]);
+  double search(cl::Program& program, const Graph& graph, cl_uint source,
+                Mode mode, unsigned& levels, unsigned& bottomUpSteps);
+  bool runGraph(cl::Program& program, const Graph& graph);
+
+  cl::Program programCL_;
+  cl::Program programPTX_;
+
+  cl::Buffer  deviceOffsets_;
+  cl::Buffer  deviceEdges_;
+  cl::Buffer  deviceLevels_;
+  cl::Buffer  deviceQueues_[2];
+  cl::Buffer  deviceCounters_;
+
+  std::vector<Graph*>      graphs_;
+  std::vector<std::string> GraphFiles_;
+
+  unsigned int RMATScale_;
+  unsigned int GridSide_;
+  unsigned int NumSources_;
+};
+
+
+BFSSample::BFSSample()
+: RMATScale_(20), GridSide_(1024), NumSources_(16) {
+}
+
+BFSSample::~BFSSample() {
+  for(size_t g = 0; g < graphs_.size(); ++g) {
+    delete graphs_[g];
+  }
+}
+
+void BFSSample::initialize() {
+  programCL_ = compileSource("bfs_kernel.cl");
+  programPTX_ = loadBinary("bfs_kernel.ptx");
+}
+
+/**
+ * Picks the sources among the vertices with edges, and runs the host
+ * search from each.
+ */
+void BFSSample::addGraph(Graph* graph) {
+  cl_ulong state = 0x2545f4914f6cdd1dULL;
+
+  for(unsigned s = 0; s < NumSources_ * 1000; ++s) {
+    cl_uint v = nextRandom(state) % graph->numVertices;
+    if(graph->offsets[v + 1] > graph->offsets[v]) {
+      graph->sources.push_back(v);
+      if(graph->sources.size() == NumSources_) {
+        break;
+      }
+    }
+  }
+  if(graph->sources.empty()) {
+    std::cerr << "Skipping " << graph->name << ": no edges\n";
+    delete graph;
+    return;
+  }
+
+  graph->levels.resize(graph->sources.size());
+  for(size_t s = 0; s < graph->sources.size(); ++s) {
+    bfsHost(*graph, graph->sources[s], graph->levels[s]);
+  }
+  graphs_.push_back(graph);
+}
+
+void BFSSample::createMemoryBuffers() {
+  std::stringstream rmat, grid;
+  Graph*            graph;
+
+  rmat << "rmat-" << RMATScale_;
+  graph = new Graph;
+  graph->name = rmat.str();
+  makeRMAT(RMATScale_, *graph);
+  addGraph(graph);
+
+  grid << "grid-" << GridSide_;
+  graph = new Graph;
+  graph->name = grid.str();
+  makeGrid(GridSide_, *graph);
+  addGraph(graph);
+
+  for(size_t f = 0; f < GraphFiles_.size(); ++f) {
+    graph = new Graph;
+    graph->name = GraphFiles_[f];
+    if(loadEdgeList(GraphFiles_[f], *graph)) {
+      addGraph(graph);
+    } else {
+      std::cerr << "Skipping " << GraphFiles_[f]
+                << ": not a readable edge list\n";
+      delete graph;
+    }
+  }
+}
+
+/**
+ * Launches a work-item for each of count elements.
+ */
+void BFSSample::enqueue(cl::Kernel& kernel, size_t count) {
+  cl_int      result;
+  cl::NDRange global((count + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE);
+  cl::NDRange local(BLOCK_SIZE);
+
+  result = getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange,
+                                                  global, local, NULL, NULL);
+  assert(result == CL_SUCCESS && "Failed to launch kernel");
+}
+
+void BFSSample::clearCounters() {
+  static const cl_uint zeros[2] = { 0, 0 };
+  cl_int               result;
+
+  result = getCommandQueue().enqueueWriteBuffer(deviceCounters_, CL_FALSE, 0,
+                                                sizeof(zeros), zeros, NULL,
+                                                NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+}
+
+void BFSSample::readCounters(cl_uint counters[2]) {
+  cl_int result;
+
+  result = getCommandQueue().enqueueReadBuffer(deviceCounters_, CL_TRUE, 0,
+                                               2*sizeof(cl_uint), counters,
+                                               NULL, NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+}
+
+/**
+ * One search from source, leaving the levels in deviceLevels_.  Returns the
+ * wall-clock time, readbacks included, and the number of steps, and of
+ * bottom-up steps, taken.
+ */
+double BFSSample::search(cl::Program& program, const Graph& graph,
+                         cl_uint source, Mode mode, unsigned& levels,
+                         unsigned& bottomUpSteps) {
+  cl_int     result;
+  cl_uint    vertices = graph.numVertices;
+  cl::Kernel init(program, "init_levels", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  cl::Kernel topDown(program, "top_down", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  cl::Kernel bottomUp(program, "bottom_up", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  cl::Kernel buildQueue(program, "build_queue", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+
+  result = init.setArg(0, deviceLevels_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = init.setArg(1, vertices);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = init.setArg(2, source);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+
+  result = topDown.setArg(0, deviceOffsets_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = topDown.setArg(1, deviceEdges_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = topDown.setArg(2, deviceLevels_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = topDown.setArg(6, deviceCounters_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 6");
+
+  result = bottomUp.setArg(0, deviceOffsets_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = bottomUp.setArg(1, deviceEdges_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = bottomUp.setArg(2, deviceLevels_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = bottomUp.setArg(3, vertices);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+  result = bottomUp.setArg(4, deviceCounters_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 4");
+
+  result = buildQueue.setArg(0, deviceLevels_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = buildQueue.setArg(1, vertices);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = buildQueue.setArg(4, deviceCounters_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 4");
+
+  getCommandQueue().finish();
+  double start = getTimeStamp();
+
+  // The first frontier is the source alone
+  enqueue(init, vertices);
+  result = getCommandQueue().enqueueWriteBuffer(deviceQueues_[0], CL_FALSE,
+                                                0, sizeof(cl_uint), &source,
+                                                NULL, NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+
+  cl_ulong frontierSize   = 1;
+  cl_ulong frontierEdges  = graph.offsets[source + 1] - graph.offsets[source];
+  cl_ulong unexplored     = graph.edges.size() - frontierEdges;
+  bool     isBottomUp     = false;
+  int      queue          = 0;
+  cl_int   level;
+
+  bottomUpSteps = 0;
+  for(level = 0; frontierSize > 0; ++level) {
+    if(mode == MODE_DIRECTION_OPTIMIZING) {
+      if(!isBottomUp && frontierEdges > unexplored / ALPHA) {
+        isBottomUp = true;
+      } else if(isBottomUp && frontierSize < vertices / BETA) {
+        // The next top-down step needs the frontier as a queue
+        isBottomUp = false;
+        clearCounters();
+        result = buildQueue.setArg(2, level);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+        result = buildQueue.setArg(3, deviceQueues_[queue]);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+        enqueue(buildQueue, vertices);
+      }
+    }
+
+    clearCounters();
+    if(isBottomUp) {
+      result = bottomUp.setArg(5, level);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument 5");
+      enqueue(bottomUp, vertices);
+      ++bottomUpSteps;
+    } else {
+      result = topDown.setArg(3, deviceQueues_[queue]);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+      result = topDown.setArg(4, (cl_uint)frontierSize);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument 4");
+      result = topDown.setArg(5, deviceQueues_[1 - queue]);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument 5");
+      result = topDown.setArg(7, level);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument 7");
+      enqueue(topDown, frontierSize);
+      queue = 1 - queue;
+    }
+
+    cl_uint counters[2];
+    readCounters(counters);
+    frontierSize  = counters[0];
+    frontierEdges = counters[1];
+    unexplored   -= std::min(unexplored, frontierEdges);
+  }
+
+  levels = level;
+  return getTimeStamp() - start;
+}
+
+bool BFSSample::runGraph(cl::Program& program, const Graph& graph) {
+  cl_int result;
+  bool   passed = true;
+
+  deviceOffsets_ = cl::Buffer(getContext(),
+                              CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                              graph.offsets.size()*sizeof(cl_uint),
+                              (void*)&graph.offsets[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceEdges_ = cl::Buffer(getContext(),
+                            CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                            std::max(graph.edges.size(), (size_t)1)
+                            *sizeof(cl_uint),
+                            graph.edges.empty() ? NULL
+                                                : (void*)&graph.edges[0],
+                            &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceLevels_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                             graph.numVertices*sizeof(cl_int), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  for(unsigned int q = 0; q < 2; ++q) {
+    deviceQueues_[q] = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                                  graph.numVertices*sizeof(cl_uint), NULL,
+                                  &result);
+    assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  }
+  deviceCounters_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                               2*sizeof(cl_uint), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+
+  std::cout << graph.name << ": " << graph.numVertices << " vertices, "
+            << graph.edges.size() / 2 << " edges\n";
+  std::cout << std::setw(16) << "mode" << std::setw(12) << "median ms"
+            << std::setw(9) << "levels" << std::setw(11) << "bottom-up"
+            << std::setw(9) << "MTEPS" << "\n";
+
+  std::vector<int> levels(graph.numVertices);
+
+  for(int m = 0; m < NUM_MODES; ++m) {
+    std::vector<double> times;
+    double              inverseRate = 0.0;
+    unsigned            maxLevels = 0, steps = 0, bottomUpSteps = 0;
+    bool                correct = true;
+
+    for(size_t s = 0; s < graph.sources.size(); ++s) {
+      const std::vector<int>& expected = graph.levels[s];
+      unsigned                numLevels, numBottomUp;
+
+      // Edges of the component reached, each counted once
+      cl_ulong traversed = 0;
+      for(cl_uint v = 0; v < graph.numVertices; ++v) {
+        if(expected[v] >= 0) {
+          traversed += graph.offsets[v + 1] - graph.offsets[v];
+        }
+      }
+      traversed /= 2;
+
+      double time = search(program, graph, graph.sources[s], (Mode)m,
+                           numLevels, numBottomUp);
+      times.push_back(time);
+      inverseRate += time / traversed;
+      maxLevels     = std::max(maxLevels, numLevels);
+      steps        += numLevels;
+      bottomUpSteps += numBottomUp;
+
+      result = getCommandQueue().enqueueReadBuffer(deviceLevels_, CL_TRUE, 0,
+                                                   graph.numVertices
+                                                   *sizeof(cl_int),
+                                                   &levels[0], NULL, NULL);
+      assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+      correct = correct && levels == expected;
+    }
+    passed = passed && correct;
+
+    // Bottom-up steps as a share of all steps; levels is the deepest search
+    std::cout << std::setw(16) << kModeNames[m] << std::fixed
+              << std::setprecision(3) << std::setw(12)
+              << median(times) * 1e3 << std::setw(9) << maxLevels
+              << std::setprecision(1) << std::setw(10)
+              << 100.0 * bottomUpSteps / steps << "%" << std::setw(9)
+              << graph.sources.size() / inverseRate / 1e6
+              << (correct ? "" : "  FAILED") << "\n";
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+  }
+
+  return passed;
+}
+
+void BFSSample::run() {
+  initialize();
+  createMemoryBuffers();
+
+  std::cout << "Sources per Graph:    " << NumSources_ << "\n";
+
+  cl::Program* programs[2] = { &programCL_, &programPTX_ };
+  const char*  names[2]    = { "Source", "Binary" };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    bool passed = true;
+
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernels\n";
+    std::cout << "------------------------------\n";
+
+    for(size_t g = 0; g < graphs_.size(); ++g) {
+      passed = runGraph(*programs[k], *graphs_[g]) && passed;
+    }
+
+    if(passed) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+  }
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options] [edges.txt ...]\n"
+            << "  --rmat N            Scale of the R-MAT graph, 2^N vertices "
+               "(default 20)\n"
+            << "  --grid N            Side of the grid graph (default 1024)\n"
+            << "  --sources N         Searches per graph (default 16)\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  BFSSample sample;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--rmat" && i+1 < argc) {
+      sample.setRMATScale(atoi(argv[++i]));
+    } else if(arg == "--grid" && i+1 < argc) {
+      sample.setGridSide(atoi(argv[++i]));
+    } else if(arg == "--sources" && i+1 < argc) {
+      sample.setNumSources(atoi(argv[++i]));
+    } else if(arg.compare(0, 2, "--") != 0) {
+      sample.addGraphFile(arg);
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sample.run();
+
+  return 0;
+}
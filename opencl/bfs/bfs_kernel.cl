@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+// The graph is in CSR form: the neighbours of vertex v are
+// edges[offsets[v]] to edges[offsets[v+1] - 1], and every edge is stored in
+// both directions.  levels[v] is the BFS level of v, or -1 while v is
+// unvisited.
+//
+// Every step counts the vertices it adds to the next frontier in
+// counters[0], and their edges in counters[1], for the host to choose the
+// direction of the next step.  The counters must be zero beforehand.
+
+__kernel void init_levels(__global int* levels, uint numVertices,
+                          uint source) {
+  uint v = get_global_id(0);
+
+  if(v < numVertices) {
+    levels[v] = (v == source) ? 0 : -1;
+  }
+}
+
+/**
+ * Top-down step: a work-item per frontier vertex claims its unvisited
+ * neighbours and appends them to the next frontier.  Work-items of a warp
+ * loop over as many edges as their vertices have.
+ */
+__kernel void top_down(__global const uint* offsets,
+                       __global const uint* edges, __global int* levels,
+                       __global const uint* frontier, uint frontierSize,
+                       __global uint* next, __global uint* counters,
+                       int level) {
+  uint i = get_global_id(0);
+  uint v, e, end;
+
+  if(i >= frontierSize) {
+    return;
+  }
+
+  v   = frontier[i];
+  end = offsets[v + 1];
+  for(e = offsets[v]; e < end; ++e) {
+    uint u = edges[e];
+
+    // Only one of the frontier vertices sharing a neighbour claims it
+    if(levels[u] == -1 && atomic_cmpxchg(&levels[u], -1, level + 1) == -1) {
+      next[atomic_inc(&counters[0])] = u;
+      atomic_add(&counters[1], offsets[u + 1] - offsets[u]);
+    }
+  }
+}
+
+/**
+ * Bottom-up step: a work-item per unvisited vertex looks for a neighbour in
+ * the frontier and stops at the first one.  The frontier is the set of
+ * vertices at the current level, so no queue is needed.
+ */
+__kernel void bottom_up(__global const uint* offsets,
+                        __global const uint* edges, __global int* levels,
+                        uint numVertices, __global uint* counters,
+                        int level) {
+  uint v = get_global_id(0);
+  uint e, end;
+
+  if(v >= numVertices || levels[v] != -1) {
+    return;
+  }
+
+  end = offsets[v + 1];
+  for(e = offsets[v]; e < end; ++e) {
+    if(levels[edges[e]] == level) {
+      levels[v] = level + 1;
+      atomic_inc(&counters[0]);
+      atomic_add(&counters[1], end - offsets[v]);
+      break;
+    }
+  }
+}
+
+/**
+ * Queues the vertices at the given level, when a bottom-up step hands over
+ * to a top-down one.
+ */
+__kernel void build_queue(__global const int* levels, uint numVertices,
+                          int level, __global uint* queue,
+                          __global uint* counters) {
+  uint v = get_global_id(0);
+
+  if(v < numVertices && levels[v] == level) {
+    queue[atomic_inc(&counters[0])] = v;
+  }
+}
@@ -20,18 +20,142 @@
  * THE SOFTWARE.
  */
 
+
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include "common/MappedFile.hpp"
 #include "common/OCLSample.hpp"
+#include "common/PNMFile.hpp"
 
 #define BLOCK_SIZE 16
 
+/**
+ * Pixel storage formats, each with its own kernel.  All formats are blurred
+ * in float registers; only the storage differs.
+ */
+enum PixelFormat {
+  FORMAT_FLOAT,
+  FORMAT_RGBA8,
+  FORMAT_GRAY16,
+  NUM_FORMATS
+};
+
+struct FormatInfo {
+  const char* name;
+  const char* kernelName;
+  size_t      pixelSize;
+  unsigned    channels;
+};
+
+static const FormatInfo formatInfo[NUM_FORMATS] = {
+  { "float",  "blur2d",        sizeof(cl_float),    1 },
+  { "rgba8",  "blur2d_rgba8",  4*sizeof(cl_uchar),  4 },
+  { "gray16", "blur2d_gray16", sizeof(cl_ushort),   1 }
+};
+
+static void decodePixel(PixelFormat format, const unsigned char* pixel,
+                        float* channels) {
+  switch(format) {
+  case FORMAT_FLOAT:
+    std::memcpy(channels, pixel, sizeof(float));
+    break;
+  case FORMAT_RGBA8:
+    for(unsigned c = 0; c < 4; ++c) {
+      channels[c] = (float)pixel[c];
+    }
+    break;
+  case FORMAT_GRAY16:
+    channels[0] = (float)((pixel[0] << 8) | pixel[1]);
+    break;
+  default:
+    assert(false && "Unknown pixel format");
+  }
+}
+
+static float saturate(float value, float maxval) {
+  value = nearbyintf(value);
+  return std::min(std::max(value, 0.0f), maxval);
+}
+
+static void encodePixel(PixelFormat format, const float* channels,
+                        unsigned char* pixel) {
+  switch(format) {
+  case FORMAT_FLOAT:
+    std::memcpy(pixel, channels, sizeof(float));
+    break;
+  case FORMAT_RGBA8:
+    for(unsigned c = 0; c < 4; ++c) {
+      pixel[c] = (unsigned char)saturate(channels[c], 255.0f);
+    }
+    break;
+  case FORMAT_GRAY16: {
+    unsigned value = (unsigned)saturate(channels[0], 65535.0f);
+    pixel[0] = (unsigned char)(value >> 8);
+    pixel[1] = (unsigned char)(value & 0xFF);
+    break;
+  }
+  default:
+    assert(false && "Unknown pixel format");
+  }
+}
+
+static unsigned roundUp(unsigned value, unsigned multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
 class Blur2DSample : public OCLSample {
 public:
 
   Blur2DSample();
 
+  virtual ~Blur2DSample();
+
+  virtual void run();
+
+  void setProblemSize(unsigned int size) {
+    imageWidth_ = imageHeight_ = size;
+  }
+
+  /**
+   * Restricts a synthetic run to a single storage format.  By default every
+   * format is run in turn.
+   */
+  void setFormat(PixelFormat format) {
+    formatMask_ = 1u << format;
+  }
+
+  /**
+   * Sets the input image.  Files ending in .pgm, .ppm or .pam are read as
+   * Netpbm images; anything else is taken to be a raw, square float image.
+   */
+  void setInputFile(const std::string& filename) {
+    inputFile_ = filename;
+  }
+
+  /**
+   * Sets the output image, written in the same format as the input image.
+   */
+  void setOutputFile(const std::string& filename) {
+    outputFile_ = filename;
+  }
+
+  /**
+   * Enables streaming mode, in which the image is processed in horizontal
+   * bands of bandRows rows that are cycled through numSlots sets of device
+   * buffers, each with its own command queue.
+   */
+  void setStreaming(unsigned int bandRows, unsigned int numSlots) {
+    streaming_ = true;
+    bandRows_  = bandRows;
+    numSlots_  = numSlots;
+  }
+
 protected:
 
   virtual void initialize();
@@ -39,37 +163,105 @@ protected:
   virtual void setupKernel(cl::Kernel kernel);
   virtual void finishKernel(cl::Kernel kernel);
   virtual void runKernel(cl::Kernel kernel, cl::Event* evt);
+  virtual void reportPerformance(double average);
 
 private:
 
+  /**
+   * Device resources for one in-flight band.  All commands for a band are
+   * issued on the slot's queue, so in-order execution guarantees that a
+   * slot's buffers are free again before the next band is written to them.
+   */
+  struct BandSlot {
+    cl::CommandQueue queue;
+    cl::Buffer       deviceIn;
+    cl::Buffer       deviceOut;
+  };
+
+  void loadInput();
+  void createOutput();
+  void writeOutput();
+  void createSyntheticImage();
+  void runStreamed();
+  void createStreamingBuffers();
+  void streamKernel(cl::Kernel kernel, double& kernelTime);
+  bool verifyRows(const std::vector<unsigned int>& rows);
+
+  size_t getPixelSize() const {
+    return formatInfo[format_].pixelSize;
+  }
+
+  size_t getImageBytes() const {
+    return (size_t)imageWidth_ * imageHeight_ * getPixelSize();
+  }
+
   cl::Program programCL_;
   cl::Program programPTX_;
 
   cl::Buffer  deviceIn_;
   cl::Buffer  deviceOut_;
 
-  float*      hostIn_;
-  float*      hostOut_;
+  std::vector<unsigned char> hostIn_;
+  std::vector<unsigned char> hostOut_;
+
+  // Unpadded, row-major source and result images in the current format.
+  // These either point into the mapped files or at imageStorage_ and
+  // resultStorage_.
+  const unsigned char*       image_;
+  unsigned char*             result_;
+  std::vector<unsigned char> imageStorage_;
+  std::vector<unsigned char> resultStorage_;
+
+  PixelFormat  format_;
+  unsigned int formatMask_;
+  unsigned int imageWidth_;
+  unsigned int imageHeight_;
+
+  // The kernel grid is rounded up to whole work-groups and surrounded by a
+  // one pixel zero border; pitch_ is the padded row length in pixels.
+  unsigned int gridWidth_;
+  unsigned int gridHeight_;
+  unsigned int pitch_;
 
-  unsigned int ProblemSize_;
-  unsigned int ArraySize_;
+  std::string  inputFile_;
+  std::string  outputFile_;
+  MappedFile   inputMap_;
+  MappedFile   outputMap_;
+  PNMHeader    inputHeader_;
+  bool         inputIsPNM_;
+  bool         convertedInput_;
+
+  bool                       streaming_;
+  unsigned int               bandRows_;
+  unsigned int               numSlots_;
+  std::vector<BandSlot>      slots_;
+  std::vector<unsigned char> zeroRow_;
 };
 
 
-Blur2DSample::Blur2DSample() {
-  ProblemSize_ = 4096;
-  ArraySize_ = (ProblemSize_+2) * (ProblemSize_+2);
+Blur2DSample::Blur2DSample()
+: image_(NULL), result_(NULL), format_(FORMAT_FLOAT),
+  formatMask_((1u << NUM_FORMATS) - 1), imageWidth_(4096),
+  imageHeight_(4096), gridWidth_(0), gridHeight_(0), pitch_(0),
+  inputIsPNM_(false), convertedInput_(false), streaming_(false),
+  bandRows_(0), numSlots_(0) {
+}
+
+Blur2DSample::~Blur2DSample() {
 }
 
 void Blur2DSample::initialize() {
   cl_int result;
 
-  programCL_ = compileSource("blur2d_kernel.cl");
-  programPTX_ = loadBinary("blur2d_kernel.ptx");
+  if(programCL_() == NULL) {
+    programCL_ = compileSource("blur2d_kernel.cl");
+    programPTX_ = loadBinary("blur2d_kernel.ptx");
+  }
 
-  cl::Kernel kernelCL = cl::Kernel(programCL_, "blur2d", &result);
+  const char* kernelName = formatInfo[format_].kernelName;
+  cl::Kernel kernelCL = cl::Kernel(programCL_, kernelName, &result);
   assert(result == CL_SUCCESS && "Failed to extract kernel");
-  cl::Kernel kernelPTX = cl::Kernel(programPTX_, "blur2d", &result);
+  cl::Kernel kernelPTX = cl::Kernel(programPTX_, kernelName, &result);
   assert(result == CL_SUCCESS && "Failed to extract kernel");
 
   setSourceKernel(kernelCL);
@@ -77,18 +269,193 @@ void Blur2DSample::initialize() {
 
   // For this sample, let's run 16 iterations
   setNumberOfIterations(16);
+
+  gridWidth_  = roundUp(imageWidth_, BLOCK_SIZE);
+  gridHeight_ = roundUp(imageHeight_, BLOCK_SIZE);
+  pitch_      = gridWidth_ + 2;
+
+  if(!inputMap_.isOpen()) {
+    createSyntheticImage();
+  }
+}
+
+void Blur2DSample::loadInput() {
+  std::string extension;
+  size_t      dot = inputFile_.rfind('.');
+
+  if(dot != std::string::npos) {
+    extension = inputFile_.substr(dot);
+  }
+  inputIsPNM_ = (extension == ".pgm" || extension == ".ppm" ||
+                 extension == ".pam");
+
+  if(!inputMap_.open(inputFile_)) {
+    std::cerr << "Unable to map input file " << inputFile_ << "\n";
+    exit(1);
+  }
+
+  const unsigned char* data =
+    static_cast<const unsigned char*>(inputMap_.getData());
+
+  if(!inputIsPNM_) {
+    // Raw inputs are square, unpadded, row-major float images
+    size_t numPixels = inputMap_.getSize() / sizeof(float);
+    unsigned int size = (unsigned int)(std::sqrt((double)numPixels) + 0.5);
+    if((size_t)size * size * sizeof(float) != inputMap_.getSize()) {
+      std::cerr << "Input file " << inputFile_
+                << " does not hold a square float image\n";
+      exit(1);
+    }
+    format_ = FORMAT_FLOAT;
+    imageWidth_ = imageHeight_ = size;
+    image_ = data;
+  } else {
+    if(!parsePNMHeader(inputMap_, inputHeader_)) {
+      std::cerr << "Input file " << inputFile_
+                << " is not a binary PGM, PPM or PAM image\n";
+      exit(1);
+    }
+
+    PNMHeader& header = inputHeader_;
+    imageWidth_  = header.width;
+    imageHeight_ = header.height;
+
+    const unsigned char* samples = data + header.dataOffset;
+    size_t numPixels = (size_t)header.width * header.height;
+
+    // Wide grayscale and 8-bit RGBA images are used in place; narrower
+    // layouts are widened to the nearest storage format on load.
+    if(header.depth == 1 && header.maxval > 255) {
+      format_ = FORMAT_GRAY16;
+      image_  = samples;
+    } else if(header.depth == 4 && header.maxval <= 255) {
+      format_ = FORMAT_RGBA8;
+      image_  = samples;
+    } else if(header.depth == 1) {
+      format_ = FORMAT_GRAY16;
+      imageStorage_.resize(numPixels * 2);
+      for(size_t i = 0; i < numPixels; ++i) {
+        imageStorage_[2*i]   = 0;
+        imageStorage_[2*i+1] = samples[i];
+      }
+      convertedInput_ = true;
+    } else if(header.depth == 3 && header.maxval <= 255) {
+      format_ = FORMAT_RGBA8;
+      imageStorage_.resize(numPixels * 4);
+      for(size_t i = 0; i < numPixels; ++i) {
+        imageStorage_[4*i]   = samples[3*i];
+        imageStorage_[4*i+1] = samples[3*i+1];
+        imageStorage_[4*i+2] = samples[3*i+2];
+        imageStorage_[4*i+3] = 255;
+      }
+      convertedInput_ = true;
+    } else {
+      std::cerr << "Unsupported image layout in " << inputFile_ << "\n";
+      exit(1);
+    }
+
+    if(convertedInput_) {
+      image_ = &imageStorage_[0];
+    }
+  }
+
+  formatMask_ = 1u << format_;
+
+  std::cout << "Input File:           " << inputFile_ << " ("
+            << imageWidth_ << " x " << imageHeight_ << ", "
+            << formatInfo[format_].name << ")\n";
+}
+
+void Blur2DSample::createOutput() {
+  if(outputFile_.empty() || convertedInput_) {
+    // Converted images are narrowed again when the output is written
+    resultStorage_.resize(getImageBytes());
+    result_ = &resultStorage_[0];
+  }
+
+  if(outputFile_.empty()) {
+    return;
+  }
+
+  std::string headerText;
+  size_t      fileSize = getImageBytes();
+  if(inputIsPNM_) {
+    headerText = formatPNMHeader(inputHeader_);
+    fileSize = inputHeader_.getFileSize();
+  }
+
+  if(!outputMap_.create(outputFile_, fileSize)) {
+    std::cerr << "Unable to create output file " << outputFile_ << "\n";
+    exit(1);
+  }
+
+  unsigned char* data = static_cast<unsigned char*>(outputMap_.getData());
+  std::memcpy(data, headerText.data(), headerText.size());
+  if(!convertedInput_) {
+    result_ = data + headerText.size();
+  }
+}
+
+void Blur2DSample::writeOutput() {
+  if(!outputMap_.isOpen()) {
+    return;
+  }
+
+  if(convertedInput_) {
+    unsigned char* samples =
+      static_cast<unsigned char*>(outputMap_.getData()) +
+      inputHeader_.dataOffset;
+    size_t numPixels = (size_t)imageWidth_ * imageHeight_;
+
+    for(size_t i = 0; i < numPixels; ++i) {
+      if(format_ == FORMAT_GRAY16) {
+        unsigned value = (resultStorage_[2*i] << 8) | resultStorage_[2*i+1];
+        samples[i] = (unsigned char)std::min(value, inputHeader_.maxval);
+      } else {
+        samples[3*i]   = resultStorage_[4*i];
+        samples[3*i+1] = resultStorage_[4*i+1];
+        samples[3*i+2] = resultStorage_[4*i+2];
+      }
+    }
+  }
+
+  outputMap_.close();
+  std::cout << "Output File:          " << outputFile_ << "\n";
+}
+
+void Blur2DSample::createSyntheticImage() {
+  size_t numBytes = getImageBytes();
+  size_t numPixels = (size_t)imageWidth_ * imageHeight_;
+
+  imageStorage_.resize(numBytes);
+  for(size_t i = 0; i < numPixels; ++i) {
+    float channels[4];
+    for(unsigned c = 0; c < 4; ++c) {
+      channels[c] = (float)((i * (c + 1)) % 255);
+    }
+    if(format_ == FORMAT_FLOAT) {
+      channels[0] /= 255.0f;
+    } else if(format_ == FORMAT_GRAY16) {
+      channels[0] *= 257.0f;
+    }
+    encodePixel(format_, channels, &imageStorage_[i*getPixelSize()]);
+  }
+  image_ = &imageStorage_[0];
+
+  resultStorage_.resize(numBytes);
+  result_ = &resultStorage_[0];
 }
 
 void Blur2DSample::runKernel(cl::Kernel kernel, cl::Event* evt) {
   cl_int result;
-  cl::NDRange globalSize(ProblemSize_, ProblemSize_);
+  cl::NDRange globalSize(gridHeight_, gridWidth_);
   cl::NDRange localSize(BLOCK_SIZE, BLOCK_SIZE);
 
   result = kernel.setArg(0, deviceIn_);
   assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
   result = kernel.setArg(1, deviceOut_);
   assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
-  result = kernel.setArg(2, ProblemSize_);
+  result = kernel.setArg(2, pitch_);
   assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
 
   result = getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange,
@@ -99,17 +466,30 @@ void Blur2DSample::runKernel(cl::Kernel kernel, cl::Event* evt) {
 
 void Blur2DSample::createMemoryBuffers() {
   cl_int result;
+  size_t pixelSize = getPixelSize();
+  size_t rowBytes  = imageWidth_ * pixelSize;
+  size_t gridBytes = (size_t)(gridHeight_ + 2) * pitch_ * pixelSize;
+
+  if(streaming_) {
+    createStreamingBuffers();
+    return;
+  }
 
-  // Create host buffers
-  hostIn_ = new float[ArraySize_];
-  hostOut_ = new float[ArraySize_];
+  // Create host buffers, copying the image into the interior of the zero
+  // padded grid
+  hostIn_.assign(gridBytes, 0);
+  hostOut_.assign(gridBytes, 0);
+  for(unsigned int i = 0; i < imageHeight_; ++i) {
+    std::memcpy(&hostIn_[((i+1)*pitch_+1)*pixelSize], &image_[i*rowBytes],
+                rowBytes);
+  }
 
   // Create device buffers
   deviceIn_ = cl::Buffer(getContext(), CL_MEM_READ_ONLY,
-                         ArraySize_*sizeof(float), NULL, &result);
+                         gridBytes, NULL, &result);
   assert(result == CL_SUCCESS && "Failed to allocate device buffer");
   deviceOut_ = cl::Buffer(getContext(), CL_MEM_WRITE_ONLY,
-                          ArraySize_*sizeof(float), NULL, &result);
+                          gridBytes, NULL, &result);
   assert(result == CL_SUCCESS && "Failed to allocate device buffer");
 }
 
@@ -118,23 +498,355 @@ void Blur2DSample::setupKernel(cl::Kernel kernel) {
 
   // Copy data to device
   result = getCommandQueue().enqueueWriteBuffer(deviceIn_, CL_TRUE, 0,
-                                                ArraySize_*sizeof(float),
-                                                hostIn_, NULL, NULL);
+                                                hostIn_.size(),
+                                                &hostIn_[0], NULL, NULL);
   assert(result == CL_SUCCESS && "Failed to queue data copy to device");
 }
 
 void Blur2DSample::finishKernel(cl::Kernel kernel) {
   cl_int result;
+  size_t pixelSize = getPixelSize();
+  size_t rowBytes  = imageWidth_ * pixelSize;
 
     // Copy data back to host
   result = getCommandQueue().enqueueReadBuffer(deviceOut_, CL_TRUE, 0,
-                                                ArraySize_*sizeof(float),
-                                                hostOut_, NULL, NULL);
+                                                hostOut_.size(),
+                                                &hostOut_[0], NULL, NULL);
   assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+
+  for(unsigned int i = 0; i < imageHeight_; ++i) {
+    std::memcpy(&result_[i*rowBytes],
+                &hostOut_[((i+1)*pitch_+1)*pixelSize], rowBytes);
+  }
+
+  std::vector<unsigned int> rows;
+  for(unsigned int i = 0; i < imageHeight_; ++i) {
+    rows.push_back(i);
+  }
+  if(verifyRows(rows)) {
+    std::cout << "Host reference comparison test PASSED\n";
+  } else {
+    std::cout << "Host reference comparison test FAILED\n";
+  }
+}
+
+void Blur2DSample::reportPerformance(double average) {
+  double megapixels = (double)imageWidth_ * imageHeight_ * 1e-6;
+  double bytes      = 2.0 * getImageBytes();
+
+  std::cout << "Throughput:           " << megapixels / average
+            << " MPixel/s\n";
+  std::cout << "Bandwidth:            " << bytes / average * 1e-9
+            << " GB/s\n";
+}
+
+void Blur2DSample::createStreamingBuffers() {
+  cl_int result;
+  size_t pixelSize = getPixelSize();
+  size_t bandBytes = (size_t)(bandRows_ + 2) * pitch_ * pixelSize;
+
+  assert(bandRows_ > 0 && bandRows_ % BLOCK_SIZE == 0 &&
+         "Band height must be a multiple of 16");
+  assert(numSlots_ > 0 && "At least one band slot is required");
+
+  zeroRow_.assign(pitch_ * pixelSize, 0);
+  std::vector<unsigned char> zeroBand(bandBytes, 0);
+
+  slots_.clear();
+  slots_.resize(numSlots_);
+  for(unsigned int i = 0; i < numSlots_; ++i) {
+    BandSlot& slot = slots_[i];
+
+    slot.queue = cl::CommandQueue(getContext(), getDevice(),
+                                  CL_QUEUE_PROFILING_ENABLE, &result);
+    assert(result == CL_SUCCESS && "Failed to create command queue");
+
+    slot.deviceIn = cl::Buffer(getContext(), CL_MEM_READ_ONLY,
+                               bandBytes, NULL, &result);
+    assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+    slot.deviceOut = cl::Buffer(getContext(), CL_MEM_WRITE_ONLY,
+                                bandBytes, NULL, &result);
+    assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+
+    // The padding columns are never written by the band uploads, so clear
+    // them once up front.
+    result = slot.queue.enqueueWriteBuffer(slot.deviceIn, CL_TRUE, 0,
+                                           bandBytes, &zeroBand[0],
+                                           NULL, NULL);
+    assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+  }
+
+  std::cout << "Band Height:          " << bandRows_ << " rows\n";
+  std::cout << "Band Slots:           " << numSlots_ << "\n";
+  std::cout << "Device Footprint:     "
+            << (numSlots_ * 2.0 * bandBytes) / (1024*1024) << " MiB\n";
+}
+
+void Blur2DSample::streamKernel(cl::Kernel kernel, double& kernelTime) {
+  cl_int result;
+  size_t   pixelSize = getPixelSize();
+  size_t   rowBytes  = imageWidth_ * pixelSize;
+  size_t   pitch     = pitch_ * pixelSize;
+  unsigned numBands  = (imageHeight_ + bandRows_ - 1) / bandRows_;
+  std::vector<cl::Event> kernelEvents(numBands);
+
+  for(unsigned b = 0; b < numBands; ++b) {
+    BandSlot&    slot  = slots_[b % numSlots_];
+    unsigned int first = b * bandRows_;
+    unsigned int rows  = std::min(bandRows_, imageHeight_ - first);
+
+    // Upload the band plus whichever halo rows lie inside the image.  Halo
+    // rows outside the image are replaced by the zero padding row.
+    unsigned int srcBegin = (first > 0) ? first - 1 : 0;
+    unsigned int srcEnd   = std::min(first + rows + 1, imageHeight_);
+    unsigned int dstRow   = (first > 0) ? 0 : 1;
+
+    cl::size_t<3> bufferOrigin;
+    bufferOrigin[0] = pixelSize;
+    bufferOrigin[1] = dstRow;
+    bufferOrigin[2] = 0;
+    cl::size_t<3> hostOrigin;
+    hostOrigin[0] = 0;
+    hostOrigin[1] = srcBegin;
+    hostOrigin[2] = 0;
+    cl::size_t<3> region;
+    region[0] = rowBytes;
+    region[1] = srcEnd - srcBegin;
+    region[2] = 1;
+
+    if(first == 0) {
+      result = slot.queue.enqueueWriteBuffer(slot.deviceIn, CL_FALSE, 0,
+                                             pitch, &zeroRow_[0],
+                                             NULL, NULL);
+      assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+    }
+    result = slot.queue.enqueueWriteBufferRect(
+      slot.deviceIn, CL_FALSE, bufferOrigin, hostOrigin, region, pitch, 0,
+      rowBytes, 0, const_cast<unsigned char*>(image_), NULL, NULL);
+    assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+    if(first + rows == imageHeight_) {
+      result = slot.queue.enqueueWriteBuffer(slot.deviceIn, CL_FALSE,
+                                             (rows+1)*pitch, pitch,
+                                             &zeroRow_[0], NULL, NULL);
+      assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+    }
+
+    // Kernel arguments are captured at enqueue time, so one kernel object
+    // can safely be shared between the slot queues.
+    result = kernel.setArg(0, slot.deviceIn);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+    result = kernel.setArg(1, slot.deviceOut);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+    result = kernel.setArg(2, pitch_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+
+    result = slot.queue.enqueueNDRangeKernel(
+      kernel, cl::NullRange, cl::NDRange(roundUp(rows, BLOCK_SIZE),
+                                         gridWidth_),
+      cl::NDRange(BLOCK_SIZE, BLOCK_SIZE), 0, &kernelEvents[b]);
+    assert(result == CL_SUCCESS && "Failed to launch kernel");
+
+    // Download the band interior straight into the result image
+    bufferOrigin[1] = 1;
+    hostOrigin[1]   = first;
+    region[1]       = rows;
+    result = slot.queue.enqueueReadBufferRect(
+      slot.deviceOut, CL_FALSE, bufferOrigin, hostOrigin, region, pitch, 0,
+      rowBytes, 0, result_, NULL, NULL);
+    assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+
+    slot.queue.flush();
+  }
+
+  for(unsigned int i = 0; i < numSlots_; ++i) {
+    slots_[i].queue.finish();
+  }
+
+  kernelTime = 0.0;
+  for(unsigned b = 0; b < numBands; ++b) {
+    kernelTime += getElapsed(kernelEvents[b], kernelEvents[b]);
+  }
+}
+
+bool Blur2DSample::verifyRows(const std::vector<unsigned int>& rows) {
+  static const int   offsets[5][2] = { {0,0}, {-1,0}, {1,0}, {0,-1}, {0,1} };
+  static const float weights[5]    = { 0.5f, 0.1f, 0.1f, 0.1f, 0.1f };
+
+  size_t   pixelSize = getPixelSize();
+  unsigned channels  = formatInfo[format_].channels;
+  float    tolerance = (format_ == FORMAT_FLOAT) ? 1e-5f : 1.0f;
+
+  for(size_t r = 0; r < rows.size(); ++r) {
+    int row = rows[r];
+    for(int col = 0; col < (int)imageWidth_; ++col) {
+      float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+      for(unsigned n = 0; n < 5; ++n) {
+        int y = row + offsets[n][0];
+        int x = col + offsets[n][1];
+        if(y < 0 || y >= (int)imageHeight_ || x < 0 ||
+           x >= (int)imageWidth_) {
+          continue;
+        }
+        float value[4];
+        decodePixel(format_, &image_[((size_t)y*imageWidth_+x)*pixelSize],
+                    value);
+        for(unsigned c = 0; c < channels; ++c) {
+          sum[c] += weights[n] * value[c];
+        }
+      }
+
+      unsigned char refPixel[16];
+      float         ref[4], cmp[4];
+      encodePixel(format_, sum, refPixel);
+      decodePixel(format_, refPixel, ref);
+      decodePixel(format_, &result_[((size_t)row*imageWidth_+col)*pixelSize],
+                  cmp);
+      for(unsigned c = 0; c < channels; ++c) {
+        if(std::fabs(ref[c] - cmp[c]) > tolerance) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+void Blur2DSample::runStreamed() {
+  initialize();
+  createMemoryBuffers();
+
+  cl::Kernel  kernels[2] = { getSourceKernel(), getBinaryKernel() };
+  const char* names[2]   = { "Source", "Binary" };
+  double      megapixels = (double)imageWidth_ * imageHeight_ * 1e-6;
+  double      bytes      = 2.0 * getImageBytes();
+
+  // Band seams are where streaming can go wrong, so check the rows on
+  // either side of every seam plus the image borders.
+  std::vector<unsigned int> seamRows;
+  for(unsigned int first = 0; first < imageHeight_; first += bandRows_) {
+    if(first > 0) {
+      seamRows.push_back(first - 1);
+    }
+    seamRows.push_back(first);
+  }
+  seamRows.push_back(imageHeight_ - 1);
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    double kernelTime;
+
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernel (Streamed)\n";
+    std::cout << "------------------------------\n";
+
+    double start = getTimeStamp();
+    streamKernel(kernels[k], kernelTime);
+    double elapsed = getTimeStamp() - start;
+
+    if(verifyRows(seamRows)) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+
+    std::cout << "End-to-End Time:      " << elapsed << " sec\n";
+    std::cout << "Kernel Time:          " << kernelTime << " sec\n";
+    std::cout << "Throughput:           " << megapixels / elapsed
+              << " MPixel/s\n";
+    std::cout << "Transfer Rate:        " << bytes / elapsed * 1e-9
+              << " GB/s\n";
+  }
+}
+
+void Blur2DSample::run() {
+  if(!inputFile_.empty()) {
+    loadInput();
+  }
+  if(!outputFile_.empty() && !inputMap_.isOpen()) {
+    std::cerr << "An output file requires an input file\n";
+    exit(1);
+  }
+
+  for(unsigned f = 0; f < NUM_FORMATS; ++f) {
+    if((formatMask_ & (1u << f)) == 0) {
+      continue;
+    }
+    format_ = (PixelFormat)f;
+
+    std::cout << "==============================\n";
+    std::cout << "Storage Format:       " << formatInfo[format_].name << "\n";
+
+    if(inputMap_.isOpen()) {
+      createOutput();
+    }
+
+    if(streaming_) {
+      runStreamed();
+    } else {
+      OCLSample::run();
+    }
+  }
+
+  writeOutput();
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --size N         Synthetic image width and height "
+               "(default 4096)\n"
+            << "  --format NAME    Synthetic storage format: float, rgba8 "
+               "or gray16\n"
+            << "                   (default: all)\n"
+            << "  --input FILE     Memory-map a PGM, PPM or PAM image, or a "
+               "raw square\n"
+            << "                   float image\n"
+            << "  --output FILE    Write the blurred image through a "
+               "memory-mapped file\n"
+            << "  --stream         Stream the image through the device in "
+               "bands\n"
+            << "  --band-rows N    Rows per streamed band (default 512)\n"
+            << "  --slots N        Bands in flight at once (default 3)\n";
+  exit(1);
 }
 
 int main(int argc, char** argv) {
   Blur2DSample sample;
+  bool         streaming = false;
+  unsigned int bandRows  = 512;
+  unsigned int numSlots  = 3;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--stream") {
+      streaming = true;
+    } else if(arg == "--size" && i+1 < argc) {
+      sample.setProblemSize(atoi(argv[++i]));
+    } else if(arg == "--format" && i+1 < argc) {
+      std::string name(argv[++i]);
+      unsigned    f = 0;
+      while(f < NUM_FORMATS && name != formatInfo[f].name) {
+        ++f;
+      }
+      if(f == NUM_FORMATS) {
+        usage(argv[0]);
+      }
+      sample.setFormat((PixelFormat)f);
+    } else if(arg == "--input" && i+1 < argc) {
+      sample.setInputFile(argv[++i]);
+    } else if(arg == "--output" && i+1 < argc) {
+      sample.setOutputFile(argv[++i]);
+    } else if(arg == "--band-rows" && i+1 < argc) {
+      bandRows = atoi(argv[++i]);
+    } else if(arg == "--slots" && i+1 < argc) {
+      numSlots = atoi(argv[++i]);
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  if(streaming) {
+    sample.setStreaming(bandRows, numSlots);
+  }
 
   sample.run();
 
@@ -38,3 +38,47 @@ void blur2d(__global float* input, __global float* output, uint width) {
 
   ACCESS(output, globalX, globalY) = result;
 }
+
+__kernel
+void blur2d_rgba8(__global uchar4* input, __global uchar4* output,
+                  uint width) {
+
+  // Add 1 to account for padding
+  int   globalX   = get_global_id(0)+1;
+  int   globalY   = get_global_id(1)+1;
+
+  // Channels are widened to float in registers, so only 4 bytes per pixel
+  // cross the bus in each direction
+  float4 result =
+    0.5f * convert_float4(ACCESS(input, globalX,   globalY  )) +
+    0.1f * convert_float4(ACCESS(input, globalX-1, globalY  )) +
+    0.1f * convert_float4(ACCESS(input, globalX+1, globalY  )) +
+    0.1f * convert_float4(ACCESS(input, globalX,   globalY-1)) +
+    0.1f * convert_float4(ACCESS(input, globalX,   globalY+1));
+
+  ACCESS(output, globalX, globalY) = convert_uchar4_sat_rte(result);
+}
+
+// 16-bit samples are stored big-endian, as in PGM files, and byte-swapped
+// in registers
+#define LOAD_BE16(buffer,i,j) \
+  ((float)(ushort)((ACCESS(buffer,i,j) << 8) | (ACCESS(buffer,i,j) >> 8)))
+
+__kernel
+void blur2d_gray16(__global ushort* input, __global ushort* output,
+                   uint width) {
+
+  // Add 1 to account for padding
+  int   globalX   = get_global_id(0)+1;
+  int   globalY   = get_global_id(1)+1;
+
+  float result =
+    0.5f * LOAD_BE16(input, globalX,   globalY  ) +
+    0.1f * LOAD_BE16(input, globalX-1, globalY  ) +
+    0.1f * LOAD_BE16(input, globalX+1, globalY  ) +
+    0.1f * LOAD_BE16(input, globalX,   globalY-1) +
+    0.1f * LOAD_BE16(input, globalX,   globalY+1);
+
+  ushort value = convert_ushort_sat_rte(result);
+  ACCESS(output, globalX, globalY) = (ushort)((value << 8) | (value >> 8));
+}
@@ -0,0 +1,438 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <cassert>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "common/OCLSample.hpp"
+
+// These must be changed to reflect changes in compact_kernel.cl
+#define BLOCK_SIZE       256
+#define ITEMS_PER_THREAD 8
+#define TILE_SIZE        (BLOCK_SIZE * ITEMS_PER_THREAD)
+
+enum Variant {
+  VARIANT_THREE_KERNEL,
+  VARIANT_SINGLE_PASS,
+  NUM_VARIANTS
+};
+
+const char* kVariantNames[NUM_VARIANTS] = {
+  "3-kernel", "single-pass"
+};
+
+// Fractions of the input that pass the filter
+const double kSelectivities[] = { 0.01, 0.5, 0.99 };
+
+#define NUM_SELECTIVITIES \
+  (sizeof(kSelectivities) / sizeof(kSelectivities[0]))
+
+/**
+ * Stream compaction: keeps the elements of a column of floats that are
+ * below a threshold, in order, as a filter of a query engine would.  The
+ * three-kernel version stores a flag per element and a count per tile,
+ * scans the counts, and scatters; the single-pass version evaluates the
+ * predicate, finds each tile's offset by decoupled look-back, and scatters
+ * in one kernel.  Both are checked against the host and timed at several
+ * selectivities, along with the readback of the output size that the host
+ * needs before it can use the result.
+ */
+class CompactSample : public OCLSample {
+public:
+
+  CompactSample();
+
+  virtual void run();
+
+  void setNumElements(unsigned int elements) {
+    assert(elements > 0 && "Number of elements must be positive");
+    NumElements_ = elements;
+  }
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+
+private:
+
+  struct CompactKernels {
+    cl::Kernel evaluate;
+    cl::Kernel scanCounts;
+    cl::Kernel scatter;
+    cl::Kernel lookback;
+  };
+
+  void extractKernels(cl::Program& program, CompactKernels& kernels);
+  void enqueue(cl::Kernel& kernel, size_t groups, cl::Event* event);
+  void compactThreeKernel(CompactKernels& kernels, cl_float threshold,
+                          cl::Event* first, cl::Event* last);
+  void compactSinglePass(CompactKernels& kernels, cl_float threshold,
+                         cl::Event* first, cl::Event* last);
+  double runCompact(CompactKernels& kernels, int variant,
+                    cl_float threshold);
+  double readSize(cl_uint* size);
+  bool checkResult(cl_float threshold, cl_uint size);
+  bool runSelectivities(CompactKernels& kernels);
+
+  cl::Program programCL_;
+  cl::Program programPTX_;
+
+  CompactKernels kernelsCL_;
+  CompactKernels kernelsPTX_;
+
+  cl::Buffer  deviceIn_;
+  cl::Buffer  deviceOut_;
+  cl::Buffer  devicePredicate_;
+  cl::Buffer  deviceCounts_;
+  cl::Buffer  deviceSize_;
+  cl::Buffer  deviceFlags_;
+  cl::Buffer  deviceAggregates_;
+  cl::Buffer  devicePrefixes_;
+  cl::Buffer  deviceCounter_;
+
+  std::vector<cl_float> hostIn_;
+  std::vector<cl_float> hostOut_;
+
+  unsigned int NumElements_;
+  unsigned int NumTiles_;
+
+  // Tickets handed out by the look-back counter, and launches so far
+  cl_uint ticket_;
+  cl_uint epoch_;
+};
+
+
+CompactSample::CompactSample()
+: NumElements_(1 << 24), ticket_(0), epoch_(0) {
+}
+
+void CompactSample::extractKernels(cl::Program& program,
+                                   CompactKernels& kernels) {
+  cl_int result;
+
+  kernels.evaluate = cl::Kernel(program, "evaluate_predicate", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.scanCounts = cl::Kernel(program, "scan_counts", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.scatter = cl::Kernel(program, "scatter", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.lookback = cl::Kernel(program, "compact_lookback", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+}
+
+void CompactSample::initialize() {
+  programCL_ = compileSource("compact_kernel.cl");
+  programPTX_ = loadBinary("compact_kernel.ptx");
+
+  extractKernels(programCL_, kernelsCL_);
+  extractKernels(programPTX_, kernelsPTX_);
+
+  NumTiles_ = (NumElements_ + TILE_SIZE - 1) / TILE_SIZE;
+
+  // For this sample, let's run 16 iterations
+  setNumberOfIterations(16);
+}
+
+void CompactSample::createMemoryBuffers() {
+  cl_int result;
+  size_t bytes = NumElements_*sizeof(cl_float);
+
+  // Uniform in [0, 1), so a threshold of s keeps a fraction s of the input
+  hostIn_.resize(NumElements_);
+  hostOut_.resize(NumElements_);
+  for(unsigned int i = 0; i < NumElements_; ++i) {
+    hostIn_[i] = (cl_float)(rand() / (RAND_MAX + 1.0));
+  }
+
+  deviceIn_ = cl::Buffer(getContext(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                         bytes, &hostIn_[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceOut_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE, bytes, NULL,
+                          &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+
+  // One byte per element, rounded up to whole tiles
+  devicePredicate_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                                NumTiles_*TILE_SIZE, NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceCounts_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                             NumTiles_*sizeof(cl_uint), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceSize_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE, sizeof(cl_uint),
+                           NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+
+  // The look-back flags must start out clear, as must the ticket counter
+  std::vector<cl_uint> zero(NumTiles_, 0);
+
+  deviceFlags_ = cl::Buffer(getContext(),
+                            CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                            NumTiles_*sizeof(cl_uint), &zero[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceAggregates_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                                 NumTiles_*sizeof(cl_uint), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  devicePrefixes_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                               NumTiles_*sizeof(cl_uint), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceCounter_ = cl::Buffer(getContext(),
+                              CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                              sizeof(cl_uint), &zero[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+}
+
+void CompactSample::enqueue(cl::Kernel& kernel, size_t groups,
+                            cl::Event* event) {
+  cl_int      result;
+  cl::NDRange globalSize(groups*BLOCK_SIZE);
+  cl::NDRange localSize(BLOCK_SIZE);
+
+  result = getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange,
+                                                  globalSize, localSize,
+                                                  NULL, event);
+  assert(result == CL_SUCCESS && "Failed to launch kernel");
+}
+
+void CompactSample::compactThreeKernel(CompactKernels& kernels,
+                                       cl_float threshold, cl::Event* first,
+                                       cl::Event* last) {
+  cl_int result;
+
+  result = kernels.evaluate.setArg(0, deviceIn_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernels.evaluate.setArg(1, devicePredicate_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = kernels.evaluate.setArg(2, deviceCounts_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = kernels.evaluate.setArg(3, NumElements_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+  result = kernels.evaluate.setArg(4, threshold);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 4");
+  enqueue(kernels.evaluate, NumTiles_, first);
+
+  result = kernels.scanCounts.setArg(0, deviceCounts_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernels.scanCounts.setArg(1, deviceSize_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = kernels.scanCounts.setArg(2, NumTiles_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  enqueue(kernels.scanCounts, 1, NULL);
+
+  result = kernels.scatter.setArg(0, deviceIn_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernels.scatter.setArg(1, devicePredicate_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = kernels.scatter.setArg(2, deviceCounts_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = kernels.scatter.setArg(3, deviceOut_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+  result = kernels.scatter.setArg(4, NumElements_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 4");
+  enqueue(kernels.scatter, NumTiles_, last);
+}
+
+void CompactSample::compactSinglePass(CompactKernels& kernels,
+                                      cl_float threshold, cl::Event* first,
+                                      cl::Event* last) {
+  cl_int result;
+
+  // Each launch tags its flags with a new epoch, so stale flags of earlier
+  // launches never need clearing
+  ++epoch_;
+
+  result = kernels.lookback.setArg(0, deviceIn_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernels.lookback.setArg(1, deviceOut_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = kernels.lookback.setArg(2, deviceFlags_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = kernels.lookback.setArg(3, deviceAggregates_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+  result = kernels.lookback.setArg(4, devicePrefixes_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 4");
+  result = kernels.lookback.setArg(5, deviceCounter_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 5");
+  result = kernels.lookback.setArg(6, deviceSize_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 6");
+  result = kernels.lookback.setArg(7, NumElements_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 7");
+  result = kernels.lookback.setArg(8, threshold);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 8");
+  result = kernels.lookback.setArg(9, ticket_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 9");
+  result = kernels.lookback.setArg(10, epoch_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 10");
+  enqueue(kernels.lookback, NumTiles_, first);
+
+  ticket_ += NumTiles_;
+  *last = *first;
+}
+
+double CompactSample::runCompact(CompactKernels& kernels, int variant,
+                                 cl_float threshold) {
+  cl::Event first, last;
+
+  if(variant == VARIANT_THREE_KERNEL) {
+    compactThreeKernel(kernels, threshold, &first, &last);
+  } else {
+    compactSinglePass(kernels, threshold, &first, &last);
+  }
+
+  return getElapsed(first, last);
+}
+
+/**
+ * Reads the output size back with a blocking read once the queue is idle,
+ * and returns the wall-clock time the host waited for it: the round trip a
+ * query engine pays before it can size the next operator's input.
+ */
+double CompactSample::readSize(cl_uint* size) {
+  cl_int result;
+  double start;
+
+  getCommandQueue().finish();
+  start = getTimeStamp();
+  result = getCommandQueue().enqueueReadBuffer(deviceSize_, CL_TRUE, 0,
+                                               sizeof(cl_uint), size, NULL,
+                                               NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+  return getTimeStamp() - start;
+}
+
+bool CompactSample::checkResult(cl_float threshold, cl_uint size) {
+  cl_int       result;
+  unsigned int count = 0;
+
+  for(unsigned int i = 0; i < NumElements_; ++i) {
+    if(hostIn_[i] < threshold) {
+      hostOut_[count++] = hostIn_[i];
+    }
+  }
+  if(size != count) {
+    return false;
+  }
+  if(count == 0) {
+    return true;
+  }
+
+  std::vector<cl_float> deviceOut(count);
+  result = getCommandQueue().enqueueReadBuffer(deviceOut_, CL_TRUE, 0,
+                                               count*sizeof(cl_float),
+                                               &deviceOut[0], NULL, NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+
+  return std::equal(deviceOut.begin(), deviceOut.end(), hostOut_.begin());
+}
+
+bool CompactSample::runSelectivities(CompactKernels& kernels) {
+  bool passed = true;
+
+  std::cout << std::setw(12) << "selectivity" << std::setw(13) << "variant"
+            << std::setw(11) << "median ms" << std::setw(10) << "Gelem/s"
+            << std::setw(11) << "survivors" << std::setw(13) << "readback us"
+            << "\n";
+
+  for(unsigned int s = 0; s < NUM_SELECTIVITIES; ++s) {
+    cl_float threshold = (cl_float)kSelectivities[s];
+
+    for(int v = 0; v < NUM_VARIANTS; ++v) {
+      std::vector<double> times, readbacks;
+      cl_uint             size;
+
+      // The first launch is a warm-up
+      runCompact(kernels, v, threshold);
+      readSize(&size);
+      for(unsigned i = 0; i < getNumberOfIterations(); ++i) {
+        times.push_back(runCompact(kernels, v, threshold));
+        readbacks.push_back(readSize(&size));
+      }
+
+      bool correct = checkResult(threshold, size);
+      passed = passed && correct;
+
+      double time = median(times);
+
+      std::cout << std::fixed << std::setprecision(2) << std::setw(11)
+                << kSelectivities[s] * 100.0 << "%" << std::setw(13)
+                << kVariantNames[v] << std::setprecision(3) << std::setw(11)
+                << time * 1e3 << std::setw(10) << NumElements_ / time / 1e9
+                << std::setw(11) << size << std::setprecision(1)
+                << std::setw(13) << median(readbacks) * 1e6
+                << (correct ? "" : "  FAILED") << "\n";
+      std::cout.unsetf(std::ios::floatfield);
+      std::cout << std::setprecision(6);
+    }
+  }
+
+  return passed;
+}
+
+void CompactSample::run() {
+  initialize();
+  createMemoryBuffers();
+
+  std::cout << "Elements:             " << NumElements_ << "\n";
+
+  CompactKernels* kernels[2] = { &kernelsCL_, &kernelsPTX_ };
+  const char*     names[2]   = { "Source", "Binary" };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernels\n";
+    std::cout << "------------------------------\n";
+
+    if(runSelectivities(*kernels[k])) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+  }
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --elements N        Length of the input column "
+               "(default 16777216)\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  CompactSample sample;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--elements" && i+1 < argc) {
+      sample.setNumElements(strtoul(argv[++i], NULL, 10));
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sample.run();
+
+  return 0;
+}
@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+// These must match the definitions in compact.cpp
+#define BLOCK_SIZE       256
+#define ITEMS_PER_THREAD 8
+#define TILE_SIZE        (BLOCK_SIZE * ITEMS_PER_THREAD)
+
+// Local memory has 32 banks; padding every 32nd word keeps the accesses of
+// consecutive elements per work-item below free of bank conflicts
+#define LOG_NUM_BANKS 5
+#define PAD(i) ((i) + ((i) >> LOG_NUM_BANKS))
+
+// Tile states of the look-back, as in scan_kernel.cl
+#define STATUS_AGGREGATE 1
+#define STATUS_PREFIX    2
+#define STATUS_MASK      3
+
+/**
+ * The predicate of the filter: elements below threshold survive.
+ */
+inline uint predicate(float value, float threshold) {
+  return value < threshold;
+}
+
+/**
+ * Number of set bits of mask.  popcount() is only core from OpenCL 1.2.
+ */
+inline uint count_bits(uint mask) {
+  mask = mask - ((mask >> 1) & 0x55555555u);
+  mask = (mask & 0x33333333u) + ((mask >> 2) & 0x33333333u);
+  mask = (mask + (mask >> 4)) & 0x0f0f0f0fu;
+  return (mask * 0x01010101u) >> 24;
+}
+
+/**
+ * Exclusive scan of one value per work-item, as in scan_kernel.cl.  Returns
+ * the prefix of the calling work-item and stores the group total in *total.
+ */
+inline uint group_scan(uint value, __local uint* scratch, uint* total) {
+  int tid = get_local_id(0);
+  int offset;
+  uint prefix;
+
+  scratch[tid] = value;
+
+  for(offset = 1; offset < BLOCK_SIZE; offset <<= 1) {
+    int i = (tid + 1) * 2 * offset - 1;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if(i < BLOCK_SIZE) {
+      scratch[i] += scratch[i - offset];
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  *total = scratch[BLOCK_SIZE - 1];
+  barrier(CLK_LOCAL_MEM_FENCE);
+  if(tid == 0) {
+    scratch[BLOCK_SIZE - 1] = 0;
+  }
+
+  for(offset = BLOCK_SIZE / 2; offset > 0; offset >>= 1) {
+    int i = (tid + 1) * 2 * offset - 1;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if(i < BLOCK_SIZE) {
+      uint t = scratch[i - offset];
+      scratch[i - offset] = scratch[i];
+      scratch[i] += t;
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  prefix = scratch[tid];
+  barrier(CLK_LOCAL_MEM_FENCE);
+  return prefix;
+}
+
+/**
+ * Loads the TILE_SIZE elements of in at base (zero past n) through tile, so
+ * the global loads are coalesced, and hands each work-item its
+ * ITEMS_PER_THREAD consecutive elements in values.
+ */
+inline void load_tile(__global const float* in, uint base, uint n,
+                      float* values, __local float* tile) {
+  int tid   = get_local_id(0);
+  int first = tid * ITEMS_PER_THREAD;
+  int k;
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    uint i = k * BLOCK_SIZE + tid;
+    tile[PAD(i)] = (base + i < n) ? in[base + i] : 0.0f;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    values[k] = tile[PAD(first + k)];
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+/**
+ * Writes the elements of values selected by mask, in order, to out at
+ * offset, where prefix is the number of survivors of the tile before the
+ * calling work-item and count those of the whole tile.  The survivors are
+ * packed in tile first, so the global stores are coalesced.
+ */
+inline void store_survivors(__global float* out, uint offset,
+                            const float* values, uint mask, uint prefix,
+                            uint count, __local float* tile) {
+  uint i;
+  int  k;
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    if(mask & (1u << k)) {
+      tile[PAD(prefix)] = values[k];
+      ++prefix;
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(i = get_local_id(0); i < count; i += BLOCK_SIZE) {
+    out[offset + i] = tile[PAD(i)];
+  }
+}
+
+
+//==--- Three Kernels ------------------------------------------------------== //
+
+/**
+ * First pass: one flag per element, and the number of survivors of each
+ * tile in counts.  flags holds whole tiles; flags past n are cleared.
+ */
+__kernel
+void evaluate_predicate(__global const float* in, __global uchar* flags,
+                        __global uint* counts, uint n, float threshold) {
+
+  __local uint scratch[BLOCK_SIZE];
+
+  int  tid   = get_local_id(0);
+  uint base  = get_group_id(0) * TILE_SIZE;
+  uint count = 0;
+  uint total;
+  int  k;
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    uint i    = base + k * BLOCK_SIZE + tid;
+    uint flag = (i < n) ? predicate(in[i], threshold) : 0;
+    flags[i] = flag;
+    count += flag;
+  }
+
+  group_scan(count, scratch, &total);
+
+  if(tid == 0) {
+    counts[get_group_id(0)] = total;
+  }
+}
+
+/**
+ * Second pass, a single work-group: an exclusive scan of the numTiles tile
+ * counts in place, TILE_SIZE at a time, with the number of survivors left
+ * in *size.
+ */
+__kernel
+void scan_counts(__global uint* counts, __global uint* size, uint numTiles) {
+
+  __local uint scratch[BLOCK_SIZE];
+
+  int  tid   = get_local_id(0);
+  int  first = tid * ITEMS_PER_THREAD;
+  uint carry = 0;
+  uint base;
+
+  for(base = 0; base < numTiles; base += TILE_SIZE) {
+    uint values[ITEMS_PER_THREAD];
+    uint sum = 0;
+    uint prefix, total;
+    int  k;
+
+    for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+      uint i = base + first + k;
+      values[k] = (i < numTiles) ? counts[i] : 0;
+      sum += values[k];
+    }
+
+    prefix = carry + group_scan(sum, scratch, &total);
+
+    for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+      uint i = base + first + k;
+      if(i < numTiles) {
+        counts[i] = prefix;
+      }
+      prefix += values[k];
+    }
+    carry += total;
+  }
+
+  if(tid == 0) {
+    *size = carry;
+  }
+}
+
+/**
+ * Third pass: each tile reads back its flags and scatters its survivors
+ * from the offset scan_counts left for it.
+ */
+__kernel
+void scatter(__global const float* in, __global const uchar* flags,
+             __global const uint* counts, __global float* out, uint n) {
+
+  __local float tile[PAD(TILE_SIZE)];
+  __local uint  scratch[BLOCK_SIZE];
+
+  int   tid  = get_local_id(0);
+  uint  base = get_group_id(0) * TILE_SIZE + tid * ITEMS_PER_THREAD;
+  uint  mask = 0;
+  float values[ITEMS_PER_THREAD];
+  uint  prefix, count;
+  int   k;
+
+  load_tile(in, get_group_id(0) * TILE_SIZE, n, values, tile);
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    mask |= (uint)flags[base + k] << k;
+  }
+
+  prefix = group_scan(count_bits(mask), scratch, &count);
+  store_survivors(out, counts[get_group_id(0)], values, mask, prefix, count,
+                  tile);
+}
+
+
+//==--- Single Pass --------------------------------------------------------== //
+
+/**
+ * Fused compaction with decoupled look-back, as scan_lookback in
+ * scan_kernel.cl: each work-group takes the next tile from counter,
+ * evaluates the predicate on it, publishes its number of survivors, and
+ * walks back over the tiles before it for its output offset.  The flags
+ * never leave registers: each work-item votes on its ITEMS_PER_THREAD
+ * elements into a bit mask, in place of the sub-group ballot OpenCL 1.1
+ * lacks, so only its count goes through local memory.  The last tile
+ * leaves the number of survivors in *size.
+ *
+ * first and epoch are as for scan_lookback.
+ */
+__kernel
+void compact_lookback(__global const float* in, __global float* out,
+                      __global volatile uint* flags,
+                      __global volatile uint* aggregates,
+                      __global volatile uint* prefixes,
+                      __global uint* counter, __global uint* size, uint n,
+                      float threshold, uint first, uint epoch) {
+
+  __local float tile[PAD(TILE_SIZE)];
+  __local uint  scratch[BLOCK_SIZE];
+  __local uint  tileId;
+  __local uint  seed;
+
+  int   tid  = get_local_id(0);
+  uint  tag  = epoch << 2;
+  uint  mask = 0;
+  float values[ITEMS_PER_THREAD];
+  uint  id, base, prefix, total;
+  int   k;
+
+  if(tid == 0) {
+    tileId = atomic_inc(counter) - first;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+  id   = tileId;
+  base = id * TILE_SIZE;
+
+  load_tile(in, base, n, values, tile);
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    uint i = base + tid * ITEMS_PER_THREAD + k;
+    mask |= ((i < n) ? predicate(values[k], threshold) : 0) << k;
+  }
+
+  prefix = group_scan(count_bits(mask), scratch, &total);
+
+  if(tid == 0) {
+    uint exclusive = 0;
+
+    if(id > 0) {
+      uint j = id - 1;
+
+      aggregates[id] = total;
+      write_mem_fence(CLK_GLOBAL_MEM_FENCE);
+      flags[id] = tag | STATUS_AGGREGATE;
+
+      for(;;) {
+        uint flag;
+        do {
+          flag = flags[j];
+        } while((flag & ~STATUS_MASK) != tag);
+        read_mem_fence(CLK_GLOBAL_MEM_FENCE);
+
+        if((flag & STATUS_MASK) == STATUS_PREFIX) {
+          exclusive += prefixes[j];
+          break;
+        }
+        exclusive += aggregates[j];
+        --j;
+      }
+    }
+
+    prefixes[id] = exclusive + total;
+    write_mem_fence(CLK_GLOBAL_MEM_FENCE);
+    flags[id] = tag | STATUS_PREFIX;
+    seed = exclusive;
+
+    if(base + TILE_SIZE >= n) {
+      *size = exclusive + total;
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  store_survivors(out, seed, values, mask, prefix, total, tile);
+}
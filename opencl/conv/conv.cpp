@@ -0,0 +1,565 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "common/OCLSample.hpp"
+
+// This must be changed to reflect changes in conv_kernel.cl
+#define BLOCK_SIZE 16
+
+// Work-items per work-group of the one-dimensional kernels
+#define GROUP_SIZE (BLOCK_SIZE * BLOCK_SIZE)
+
+/**
+ * A 3x3 convolutional layer with stride 1 and padding 1, on C x H x W
+ * images with K filters.
+ */
+struct Layer {
+  const char* name;
+  unsigned    C;
+  unsigned    H;
+  unsigned    W;
+  unsigned    K;
+};
+
+// The first layer of VGG-16, and the 3x3 layers of the ResNet stages
+const Layer kLayers[] = {
+  { "vgg-conv1", 3,   224, 224, 64  },
+  { "res2",      64,  56,  56,  64  },
+  { "res3",      128, 28,  28,  128 },
+  { "res4",      256, 14,  14,  256 },
+  { "res5",      512, 7,   7,   512 }
+};
+
+const int kNumLayers = sizeof(kLayers) / sizeof(kLayers[0]);
+
+enum Layout {
+  LAYOUT_NCHW,
+  LAYOUT_NHWC,
+  NUM_LAYOUTS
+};
+
+const char* kLayoutNames[NUM_LAYOUTS] = { "nchw", "nhwc" };
+
+enum Path {
+  PATH_DIRECT,
+  PATH_IM2COL,
+  PATH_WINOGRAD,
+  NUM_PATHS
+};
+
+const char* kPathNames[NUM_PATHS] = { "direct", "im2col", "winograd" };
+
+/**
+ * Host data of a layer: the batch in NCHW order, the weights, and the
+ * reference output of the first and last images.
+ */
+struct LayerData {
+  std::vector<float>  input;
+  std::vector<float>  weights;
+  std::vector<double> expected;
+  std::vector<double> magnitude;
+};
+
+/**
+ * Convolutional layers computed directly, as im2col followed by a tiled
+ * GEMM, and with Winograd F(2x2, 3x3) transforms around 16 batched GEMMs,
+ * on activations in NCHW and NHWC layout, for both the source and the
+ * binary program.  Each output is checked against the host, and its rate
+ * is reported in images per second and in the GFLOP/s of the direct
+ * convolution.
+ */
+class ConvSample : public OCLSample {
+public:
+
+  ConvSample();
+
+  virtual void run();
+
+  void setBatchSize(unsigned int batch) {
+    assert(batch > 0 && "Batch size must be positive");
+    BatchSize_ = batch;
+  }
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+
+private:
+
+  void enqueue(cl::Kernel& kernel, const cl::NDRange& global,
+               const cl::NDRange& local);
+  void enqueue(cl::Kernel& kernel, size_t count);
+  bool runLayer(cl::Program& program, const Layer& layer,
+                const LayerData& data);
+
+  cl::Program programCL_;
+  cl::Program programPTX_;
+
+  std::vector<LayerData> layers_;
+
+  // Every kernel launch of the convolution being timed
+  std::vector<cl::Event> events_;
+
+  unsigned int BatchSize_;
+};
+
+
+ConvSample::ConvSample()
+: BatchSize_(8) {
+}
+
+void ConvSample::initialize() {
+  programCL_ = compileSource("conv_kernel.cl");
+  programPTX_ = loadBinary("conv_kernel.ptx");
+
+  // For this sample, let's run 16 iterations
+  setNumberOfIterations(16);
+}
+
+/**
+ * Direct convolution of image n in double, with the sum of the absolute
+ * values of the terms of each output, which bounds its rounding error.
+ */
+static void convolveHost(const Layer& layer, const LayerData& data,
+                         unsigned n, double* out, double* magnitude) {
+  const float* image = &data.input[(size_t)n * layer.C * layer.H * layer.W];
+
+  for(unsigned k = 0; k < layer.K; ++k) {
+    for(unsigned y = 0; y < layer.H; ++y) {
+      for(unsigned x = 0; x < layer.W; ++x) {
+        double sum = 0.0, abs = 0.0;
+        for(unsigned c = 0; c < layer.C; ++c) {
+          const float* filter = &data.weights[(k * layer.C + c) * 9];
+          for(int r = 0; r < 3; ++r) {
+            int iy = (int)y + r - 1;
+            if(iy < 0 || iy >= (int)layer.H) {
+              continue;
+            }
+            for(int s = 0; s < 3; ++s) {
+              int ix = (int)x + s - 1;
+              if(ix < 0 || ix >= (int)layer.W) {
+                continue;
+              }
+              double term = (double)filter[r * 3 + s]
+                            * image[((size_t)c * layer.H + iy) * layer.W + ix];
+              sum += term;
+              abs += std::fabs(term);
+            }
+          }
+        }
+        *out++       = sum;
+        *magnitude++ = abs;
+      }
+    }
+  }
+}
+
+void ConvSample::createMemoryBuffers() {
+  srand(time(NULL));
+
+  layers_.resize(kNumLayers);
+  for(int l = 0; l < kNumLayers; ++l) {
+    const Layer& layer = kLayers[l];
+    LayerData&   data  = layers_[l];
+    size_t       image = (size_t)layer.K * layer.H * layer.W;
+
+    data.input.resize((size_t)BatchSize_ * layer.C * layer.H * layer.W);
+    for(size_t i = 0; i < data.input.size(); ++i) {
+      data.input[i] = 2.0f * rand() / ((float)RAND_MAX + 1.0f) - 1.0f;
+    }
+    data.weights.resize((size_t)layer.K * layer.C * 9);
+    for(size_t i = 0; i < data.weights.size(); ++i) {
+      data.weights[i] = 2.0f * rand() / ((float)RAND_MAX + 1.0f) - 1.0f;
+    }
+
+    // The first and last images catch errors in the batch indexing
+    data.expected.resize(2 * image);
+    data.magnitude.resize(2 * image);
+    convolveHost(layer, data, 0, &data.expected[0], &data.magnitude[0]);
+    convolveHost(layer, data, BatchSize_ - 1, &data.expected[image],
+                 &data.magnitude[image]);
+  }
+}
+
+void ConvSample::enqueue(cl::Kernel& kernel, const cl::NDRange& global,
+                         const cl::NDRange& local) {
+  cl_int    result;
+  cl::Event event;
+
+  result = getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange,
+                                                  global, local, NULL,
+                                                  &event);
+  assert(result == CL_SUCCESS && "Failed to launch kernel");
+  events_.push_back(event);
+}
+
+/**
+ * Launches a one-dimensional kernel with a work-item for each of count
+ * elements.
+ */
+void ConvSample::enqueue(cl::Kernel& kernel, size_t count) {
+  enqueue(kernel,
+          cl::NDRange((count + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE),
+          cl::NDRange(GROUP_SIZE));
+}
+
+static size_t roundUp(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+bool ConvSample::runLayer(cl::Program& program, const Layer& layer,
+                          const LayerData& data) {
+  cl_int  result;
+  bool    passed = true;
+  cl_uint N      = BatchSize_;
+  cl_uint C      = layer.C;
+  cl_uint H      = layer.H;
+  cl_uint W      = layer.W;
+  cl_uint K      = layer.K;
+  size_t  pixels = (size_t)N * H * W;
+  size_t  tiles  = (size_t)N * ((H + 1) / 2) * ((W + 1) / 2);
+  size_t  count  = pixels * K;
+
+  // The input in each layout
+  std::vector<float> nhwc(data.input.size());
+  for(size_t p = 0; p < pixels; ++p) {
+    size_t n = p / (H * W);
+    for(cl_uint c = 0; c < C; ++c) {
+      nhwc[p * C + c] = data.input[(n * C + c) * H * W + p % (H * W)];
+    }
+  }
+
+  cl::Buffer deviceIn[NUM_LAYOUTS];
+  deviceIn[LAYOUT_NCHW] = cl::Buffer(getContext(),
+                                     CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                     data.input.size()*sizeof(float),
+                                     (void*)&data.input[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceIn[LAYOUT_NHWC] = cl::Buffer(getContext(),
+                                     CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                     nhwc.size()*sizeof(float), &nhwc[0],
+                                     &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  cl::Buffer deviceWeights(getContext(),
+                           CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                           data.weights.size()*sizeof(float),
+                           (void*)&data.weights[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  cl::Buffer deviceOut(getContext(), CL_MEM_READ_WRITE, count*sizeof(float),
+                       NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+
+  // The im2col matrix, or the transformed input tiles
+  size_t     scratch = std::max((size_t)C * 9 * pixels, 16 * C * tiles);
+  cl::Buffer deviceScratch(getContext(), CL_MEM_READ_WRITE,
+                           scratch*sizeof(float), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  cl::Buffer deviceU(getContext(), CL_MEM_READ_WRITE,
+                     16 * K * C * sizeof(float), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  cl::Buffer deviceM(getContext(), CL_MEM_READ_WRITE,
+                     16 * K * tiles * sizeof(float), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+
+  // The weights are fixed, so their Winograd transform is not timed
+  cl::Kernel filter(program, "winograd_filter", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  cl_uint arg = 0;
+  result = filter.setArg(arg++, deviceWeights);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument");
+  result = filter.setArg(arg++, deviceU);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument");
+  result = filter.setArg(arg++, C);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument");
+  result = filter.setArg(arg++, K);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument");
+  events_.clear();
+  enqueue(filter, (size_t)K * C);
+  getElapsed(events_.front(), events_.back());
+
+  std::cout << layer.name << ": " << C << "x" << H << "x" << W << " -> "
+            << K << " channels, batch " << N << "\n";
+  std::cout << std::setw(8) << "layout" << std::setw(10) << "path"
+            << std::setw(12) << "median ms" << std::setw(10) << "GFLOP/s"
+            << std::setw(10) << "images/s" << "\n";
+
+  for(int l = 0; l < NUM_LAYOUTS; ++l) {
+    std::string suffix = std::string("_") + kLayoutNames[l];
+
+    for(int p = 0; p < NUM_PATHS; ++p) {
+      std::vector<cl::Kernel> kernels;
+      std::vector<size_t>     sizes;
+
+      // Each path is a sequence of kernels, with the work-items each needs;
+      // a size of 0 marks a GEMM, launched on BLOCK_SIZE square tiles
+      if(p == PATH_DIRECT) {
+        cl::Kernel direct(program, ("conv_direct" + suffix).c_str(), &result);
+        assert(result == CL_SUCCESS && "Failed to extract kernel");
+        arg = 0;
+        result = direct.setArg(arg++, deviceIn[l]);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = direct.setArg(arg++, deviceWeights);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = direct.setArg(arg++, deviceOut);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = direct.setArg(arg++, N);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = direct.setArg(arg++, C);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = direct.setArg(arg++, H);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = direct.setArg(arg++, W);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = direct.setArg(arg++, K);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        kernels.push_back(direct);
+        sizes.push_back(count);
+      } else if(p == PATH_IM2COL) {
+        cl::Kernel unroll(program, ("im2col" + suffix).c_str(), &result);
+        assert(result == CL_SUCCESS && "Failed to extract kernel");
+        arg = 0;
+        result = unroll.setArg(arg++, deviceIn[l]);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = unroll.setArg(arg++, deviceScratch);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = unroll.setArg(arg++, N);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = unroll.setArg(arg++, C);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = unroll.setArg(arg++, H);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = unroll.setArg(arg++, W);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        kernels.push_back(unroll);
+        sizes.push_back((size_t)C * 9 * pixels);
+
+        // out (K x NHW) = weights (K x 9C) cols (9C x NHW)
+        cl::Kernel gemm(program, ("gemm" + suffix).c_str(), &result);
+        assert(result == CL_SUCCESS && "Failed to extract kernel");
+        arg = 0;
+        result = gemm.setArg(arg++, deviceWeights);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = gemm.setArg(arg++, deviceScratch);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = gemm.setArg(arg++, deviceOut);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = gemm.setArg(arg++, K);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = gemm.setArg(arg++, (cl_uint)pixels);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = gemm.setArg(arg++, 9 * C);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = gemm.setArg(arg++, H * W);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        kernels.push_back(gemm);
+        sizes.push_back(0);
+      } else {
+        cl::Kernel input(program, ("winograd_input" + suffix).c_str(),
+                         &result);
+        assert(result == CL_SUCCESS && "Failed to extract kernel");
+        arg = 0;
+        result = input.setArg(arg++, deviceIn[l]);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = input.setArg(arg++, deviceScratch);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = input.setArg(arg++, N);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = input.setArg(arg++, C);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = input.setArg(arg++, H);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = input.setArg(arg++, W);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        kernels.push_back(input);
+        sizes.push_back((size_t)C * tiles);
+
+        // M[e] (K x T) = U[e] (K x C) V[e] (C x T), for the 16 elements e
+        cl::Kernel gemm(program, "gemm_plain", &result);
+        assert(result == CL_SUCCESS && "Failed to extract kernel");
+        arg = 0;
+        result = gemm.setArg(arg++, deviceU);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = gemm.setArg(arg++, deviceScratch);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = gemm.setArg(arg++, deviceM);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = gemm.setArg(arg++, K);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = gemm.setArg(arg++, (cl_uint)tiles);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = gemm.setArg(arg++, C);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = gemm.setArg(arg++, (cl_uint)0);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        kernels.push_back(gemm);
+        sizes.push_back(0);
+
+        cl::Kernel output(program, ("winograd_output" + suffix).c_str(),
+                          &result);
+        assert(result == CL_SUCCESS && "Failed to extract kernel");
+        arg = 0;
+        result = output.setArg(arg++, deviceM);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = output.setArg(arg++, deviceOut);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = output.setArg(arg++, N);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = output.setArg(arg++, H);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = output.setArg(arg++, W);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        result = output.setArg(arg++, K);
+        assert(result == CL_SUCCESS && "Failed to set kernel argument");
+        kernels.push_back(output);
+        sizes.push_back((size_t)K * tiles);
+      }
+
+      // Clear the output, so that elements a path misses are caught
+      std::vector<float> hostOut(count,
+                                 std::numeric_limits<float>::quiet_NaN());
+      result = getCommandQueue().enqueueWriteBuffer(deviceOut, CL_TRUE, 0,
+                                                    count*sizeof(float),
+                                                    &hostOut[0], NULL, NULL);
+      assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+
+      // The first run is a warm-up
+      std::vector<double> times;
+      for(unsigned i = 0; i <= getNumberOfIterations(); ++i) {
+        events_.clear();
+        for(size_t k = 0; k < kernels.size(); ++k) {
+          if(sizes[k] > 0) {
+            enqueue(kernels[k], sizes[k]);
+          } else if(p == PATH_IM2COL) {
+            enqueue(kernels[k],
+                    cl::NDRange(roundUp(pixels, BLOCK_SIZE),
+                                roundUp(K, BLOCK_SIZE), 1),
+                    cl::NDRange(BLOCK_SIZE, BLOCK_SIZE, 1));
+          } else {
+            enqueue(kernels[k],
+                    cl::NDRange(roundUp(tiles, BLOCK_SIZE),
+                                roundUp(K, BLOCK_SIZE), 16),
+                    cl::NDRange(BLOCK_SIZE, BLOCK_SIZE, 1));
+          }
+        }
+        double time = getElapsed(events_.front(), events_.back());
+        if(i > 0) {
+          times.push_back(time);
+        }
+      }
+
+      result = getCommandQueue().enqueueReadBuffer(deviceOut, CL_TRUE, 0,
+                                                   count*sizeof(float),
+                                                   &hostOut[0], NULL, NULL);
+      assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+
+      // Loose enough for the extra rounding of Winograd's transforms
+      bool correct = true;
+      for(unsigned e = 0; correct && e < data.expected.size(); ++e) {
+        cl_uint n   = (e < K * H * W) ? 0 : N - 1;
+        cl_uint k   = e / (H * W) % K;
+        cl_uint yx  = e % (H * W);
+        size_t  out = (l == LAYOUT_NCHW)
+                    ? ((size_t)n * K + k) * H * W + yx
+                    : ((size_t)n * H * W + yx) * K + k;
+        correct = std::fabs(hostOut[out] - data.expected[e])
+                  <= 1e-4 * data.magnitude[e];
+      }
+      passed = passed && correct;
+
+      double time  = median(times);
+      double flops = 2.0 * count * C * 9;
+
+      std::cout << std::setw(8) << kLayoutNames[l] << std::setw(10)
+                << kPathNames[p] << std::fixed << std::setprecision(3)
+                << std::setw(12) << time * 1e3 << std::setprecision(1)
+                << std::setw(10) << flops / time / 1e9 << std::setw(10)
+                << N / time << (correct ? "" : "  FAILED") << "\n";
+      std::cout.unsetf(std::ios::floatfield);
+      std::cout << std::setprecision(6);
+    }
+  }
+
+  return passed;
+}
+
+void ConvSample::run() {
+  initialize();
+  createMemoryBuffers();
+
+  std::cout << "Batch Size:           " << BatchSize_ << "\n";
+
+  cl::Program* programs[2] = { &programCL_, &programPTX_ };
+  const char*  names[2]    = { "Source", "Binary" };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    bool passed = true;
+
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernels\n";
+    std::cout << "------------------------------\n";
+
+    for(int l = 0; l < kNumLayers; ++l) {
+      passed = runLayer(*programs[k], kLayers[l], layers_[l]) && passed;
+    }
+
+    if(passed) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+  }
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --batch N           Images per batch (default 8)\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  ConvSample sample;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--batch" && i+1 < argc) {
+      sample.setBatchSize(atoi(argv[++i]));
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sample.run();
+
+  return 0;
+}
@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+// This must match BLOCK_SIZE in conv.cpp
+#define BLOCK_SIZE 16
+
+// Every convolution is 3x3 with stride 1 and a padding of 1, so the output
+// is as large as the input: in is N x C x H x W, weights K x C x 3 x 3 and
+// out N x K x H x W.  Activations are stored in one of two layouts, which
+// each kernel takes as a constant, so the switches below fold away once
+// the helpers are inlined.  Weights are always stored K x C x 3 x 3.
+#define LAYOUT_NCHW 0
+#define LAYOUT_NHWC 1
+
+/**
+ * Offset of element (n, c, y, x) of an N x C x H x W tensor.
+ */
+inline uint offset(int layout, uint n, uint c, uint y, uint x, uint C,
+                   uint H, uint W) {
+  switch(layout) {
+  case LAYOUT_NHWC: return ((n * H + y) * W + x) * C + c;
+  default:          return ((n * C + c) * H + y) * W + x;
+  }
+}
+
+/**
+ * Input element (n, c, y, x), or the zero padding around the image.
+ */
+inline float load_input(int layout, __global const float* in, uint n, uint c,
+                        int y, int x, uint C, uint H, uint W) {
+  if(y < 0 || y >= (int)H || x < 0 || x >= (int)W) {
+    return 0.0f;
+  }
+  return in[offset(layout, n, c, y, x, C, H, W)];
+}
+
+
+//==--- Direct -------------------------------------------------------------== //
+
+/**
+ * A work-item per output element, in the order of the output layout, so
+ * the stores are contiguous.  With NHWC, neighbouring work-items share
+ * their input elements and read different filters.
+ */
+inline void conv_direct(int layout, __global const float* in,
+                        __global const float* weights, __global float* out,
+                        uint N, uint C, uint H, uint W, uint K) {
+  uint  i = get_global_id(0);
+  uint  n, k, y, x, c;
+  int   r, s;
+  float sum = 0.0f;
+
+  if(i >= N * K * H * W) {
+    return;
+  }
+
+  if(layout == LAYOUT_NHWC) {
+    k = i % K;
+    x = (i / K) % W;
+    y = (i / (K * W)) % H;
+    n = i / (K * W * H);
+  } else {
+    x = i % W;
+    y = (i / W) % H;
+    k = (i / (W * H)) % K;
+    n = i / (W * H * K);
+  }
+
+  for(c = 0; c < C; ++c) {
+    __global const float* filter = weights + (k * C + c) * 9;
+    for(r = 0; r < 3; ++r) {
+      for(s = 0; s < 3; ++s) {
+        sum += load_input(layout, in, n, c, (int)y + r - 1, (int)x + s - 1,
+                          C, H, W) * filter[r * 3 + s];
+      }
+    }
+  }
+
+  out[i] = sum;
+}
+
+__kernel void conv_direct_nchw(__global const float* in,
+                               __global const float* weights,
+                               __global float* out, uint N, uint C, uint H,
+                               uint W, uint K) {
+  conv_direct(LAYOUT_NCHW, in, weights, out, N, C, H, W, K);
+}
+
+__kernel void conv_direct_nhwc(__global const float* in,
+                               __global const float* weights,
+                               __global float* out, uint N, uint C, uint H,
+                               uint W, uint K) {
+  conv_direct(LAYOUT_NHWC, in, weights, out, N, C, H, W, K);
+}
+
+
+//==--- im2col and GEMM ----------------------------------------------------== //
+
+/**
+ * Unrolls the input into a (C * 9) x (N * H * W) matrix whose column for
+ * output pixel p holds the 3x3 neighbourhood of p in every channel, so the
+ * convolution becomes the product of the K x (C * 9) weights and it.
+ */
+inline void im2col(int layout, __global const float* in,
+                   __global float* cols, uint N, uint C, uint H, uint W) {
+  uint i   = get_global_id(0);
+  uint P   = N * H * W;
+  uint row = i / P;
+  uint p   = i % P;
+  uint n   = p / (H * W);
+  uint y   = (p / W) % H;
+  uint x   = p % W;
+
+  if(i >= C * 9 * P) {
+    return;
+  }
+
+  cols[i] = load_input(layout, in, n, row / 9, (int)y + (row / 3) % 3 - 1,
+                       (int)x + row % 3 - 1, C, H, W);
+}
+
+__kernel void im2col_nchw(__global const float* in, __global float* cols,
+                          uint N, uint C, uint H, uint W) {
+  im2col(LAYOUT_NCHW, in, cols, N, C, H, W);
+}
+
+__kernel void im2col_nhwc(__global const float* in, __global float* cols,
+                          uint N, uint C, uint H, uint W) {
+  im2col(LAYOUT_NHWC, in, cols, N, C, H, W);
+}
+
+// Where a GEMM stores C[m][n]: row-major, or as output channel m of pixel
+// n of an image of hw pixels in one of the layouts
+#define STORE_PLAIN 2
+
+/**
+ * C = A B, A M x L and B L x N, row-major, with the BLOCK_SIZE x BLOCK_SIZE
+ * local memory tiles of matmul_kernel.cl, and zero-filled edge tiles for
+ * sizes that are not multiples of BLOCK_SIZE.  The third NDRange dimension
+ * selects one of a batch of products stored one after another.
+ */
+inline void gemm(int store, __global const float* A,
+                 __global const float* B, __global float* C, uint M, uint N,
+                 uint L, uint hw) {
+  __local float scratchA[BLOCK_SIZE][BLOCK_SIZE];
+  __local float scratchB[BLOCK_SIZE][BLOCK_SIZE];
+
+  uint  batch = get_group_id(2);
+  uint  col   = get_global_id(0);
+  uint  row   = get_global_id(1);
+  uint  tidX  = get_local_id(0);
+  uint  tidY  = get_local_id(1);
+  uint  b, k;
+  float sum   = 0.0f;
+
+  A += (size_t)batch * M * L;
+  B += (size_t)batch * L * N;
+  C += (size_t)batch * M * N;
+
+  for(b = 0; b < L; b += BLOCK_SIZE) {
+    scratchA[tidY][tidX] = (row < M && b + tidX < L) ? A[row * L + b + tidX]
+                                                     : 0.0f;
+    scratchB[tidY][tidX] = (b + tidY < L && col < N) ? B[(b + tidY) * N + col]
+                                                     : 0.0f;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(k = 0; k < BLOCK_SIZE; ++k) {
+      sum += scratchA[tidY][k] * scratchB[k][tidX];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  if(row >= M || col >= N) {
+    return;
+  }
+  switch(store) {
+  case LAYOUT_NCHW: C[((col / hw) * M + row) * hw + col % hw] = sum; break;
+  case LAYOUT_NHWC: C[col * M + row] = sum;                        break;
+  default:          C[row * N + col] = sum;                        break;
+  }
+}
+
+__kernel void gemm_plain(__global const float* A, __global const float* B,
+                         __global float* C, uint M, uint N, uint L,
+                         uint hw) {
+  gemm(STORE_PLAIN, A, B, C, M, N, L, hw);
+}
+
+__kernel void gemm_nchw(__global const float* A, __global const float* B,
+                        __global float* C, uint M, uint N, uint L, uint hw) {
+  gemm(LAYOUT_NCHW, A, B, C, M, N, L, hw);
+}
+
+__kernel void gemm_nhwc(__global const float* A, __global const float* B,
+                        __global float* C, uint M, uint N, uint L, uint hw) {
+  gemm(LAYOUT_NHWC, A, B, C, M, N, L, hw);
+}
+
+
+//==--- Winograd -----------------------------------------------------------== //
+
+// F(2x2, 3x3): each 2x2 output tile is A^T [(G g G^T) . (B^T d B)] A, for
+// the 4x4 input tile d around it and the 3x3 filter g, which takes 16
+// multiplies instead of 36.  The input is cut into T = N * ceil(H/2) *
+// ceil(W/2) overlapping 4x4 tiles, and the 16 element-wise products summed
+// over channels become 16 GEMMs: M[e] (K x T) = U[e] (K x C) V[e] (C x T).
+
+/**
+ * U = G g G^T, with G = [1 0 0; 1/2 1/2 1/2; 1/2 -1/2 1/2; 0 0 1].  The
+ * weights are fixed, so this runs once per layer, not per batch.
+ */
+__kernel void winograd_filter(__global const float* weights,
+                              __global float* U, uint C, uint K) {
+  uint  i = get_global_id(0);
+  float t[12];
+  float u[16];
+  uint  j;
+
+  if(i >= K * C) {
+    return;
+  }
+
+  weights += i * 9;
+  for(j = 0; j < 3; ++j) {
+    t[0 * 3 + j] = weights[j];
+    t[1 * 3 + j] = 0.5f * (weights[j] + weights[3 + j] + weights[6 + j]);
+    t[2 * 3 + j] = 0.5f * (weights[j] - weights[3 + j] + weights[6 + j]);
+    t[3 * 3 + j] = weights[6 + j];
+  }
+  for(j = 0; j < 4; ++j) {
+    u[j * 4 + 0] = t[j * 3];
+    u[j * 4 + 1] = 0.5f * (t[j * 3] + t[j * 3 + 1] + t[j * 3 + 2]);
+    u[j * 4 + 2] = 0.5f * (t[j * 3] - t[j * 3 + 1] + t[j * 3 + 2]);
+    u[j * 4 + 3] = t[j * 3 + 2];
+  }
+
+  // Filter (k, c) is element i of each K x C matrix
+  for(j = 0; j < 16; ++j) {
+    U[j * K * C + i] = u[j];
+  }
+}
+
+/**
+ * V = B^T d B, with B^T = [1 0 -1 0; 0 1 1 0; 0 -1 1 0; 0 1 0 -1], a
+ * work-item per channel and tile.
+ */
+inline void winograd_input(int layout, __global const float* in,
+                           __global float* V, uint N, uint C, uint H,
+                           uint W) {
+  uint  tilesX = (W + 1) / 2;
+  uint  tilesY = (H + 1) / 2;
+  uint  T      = N * tilesY * tilesX;
+  uint  i      = get_global_id(0);
+  uint  c      = i / T;
+  uint  tile   = i % T;
+  uint  n      = tile / (tilesY * tilesX);
+  int   y0     = (int)((tile / tilesX) % tilesY) * 2 - 1;
+  int   x0     = (int)(tile % tilesX) * 2 - 1;
+  float d[16];
+  float t[16];
+  int   j;
+
+  if(i >= C * T) {
+    return;
+  }
+
+  for(j = 0; j < 16; ++j) {
+    d[j] = load_input(layout, in, n, c, y0 + j / 4, x0 + j % 4, C, H, W);
+  }
+  for(j = 0; j < 4; ++j) {
+    t[0 * 4 + j] = d[0 * 4 + j] - d[2 * 4 + j];
+    t[1 * 4 + j] = d[1 * 4 + j] + d[2 * 4 + j];
+    t[2 * 4 + j] = d[2 * 4 + j] - d[1 * 4 + j];
+    t[3 * 4 + j] = d[1 * 4 + j] - d[3 * 4 + j];
+  }
+  for(j = 0; j < 4; ++j) {
+    d[j * 4 + 0] = t[j * 4 + 0] - t[j * 4 + 2];
+    d[j * 4 + 1] = t[j * 4 + 1] + t[j * 4 + 2];
+    d[j * 4 + 2] = t[j * 4 + 2] - t[j * 4 + 1];
+    d[j * 4 + 3] = t[j * 4 + 1] - t[j * 4 + 3];
+  }
+
+  // Tile (c, tile) is element i of each C x T matrix
+  for(j = 0; j < 16; ++j) {
+    V[j * C * T + i] = d[j];
+  }
+}
+
+__kernel void winograd_input_nchw(__global const float* in,
+                                  __global float* V, uint N, uint C, uint H,
+                                  uint W) {
+  winograd_input(LAYOUT_NCHW, in, V, N, C, H, W);
+}
+
+__kernel void winograd_input_nhwc(__global const float* in,
+                                  __global float* V, uint N, uint C, uint H,
+                                  uint W) {
+  winograd_input(LAYOUT_NHWC, in, V, N, C, H, W);
+}
+
+/**
+ * Y = A^T m A, with A^T = [1 1 1 0; 0 1 -1 -1], a work-item per output
+ * channel and tile.  Tiles on the bottom and right edges of an odd-sized
+ * image store only their pixels inside it.
+ */
+inline void winograd_output(int layout, __global const float* M,
+                            __global float* out, uint N, uint H, uint W,
+                            uint K) {
+  uint  tilesX = (W + 1) / 2;
+  uint  tilesY = (H + 1) / 2;
+  uint  T      = N * tilesY * tilesX;
+  uint  i      = get_global_id(0);
+  uint  k      = i / T;
+  uint  tile   = i % T;
+  uint  n      = tile / (tilesY * tilesX);
+  uint  y0     = (tile / tilesX) % tilesY * 2;
+  uint  x0     = tile % tilesX * 2;
+  float t[8];
+  uint  j;
+
+  if(i >= K * T) {
+    return;
+  }
+
+  for(j = 0; j < 4; ++j) {
+    float m0 = M[(0 * 4 + j) * K * T + i];
+    float m1 = M[(1 * 4 + j) * K * T + i];
+    float m2 = M[(2 * 4 + j) * K * T + i];
+    float m3 = M[(3 * 4 + j) * K * T + i];
+    t[0 * 4 + j] = m0 + m1 + m2;
+    t[1 * 4 + j] = m1 - m2 - m3;
+  }
+  for(j = 0; j < 2; ++j) {
+    uint y = y0 + j;
+    if(y < H) {
+      out[offset(layout, n, k, y, x0, K, H, W)] =
+        t[j * 4 + 0] + t[j * 4 + 1] + t[j * 4 + 2];
+      if(x0 + 1 < W) {
+        out[offset(layout, n, k, y, x0 + 1, K, H, W)] =
+          t[j * 4 + 1] - t[j * 4 + 2] - t[j * 4 + 3];
+      }
+    }
+  }
+}
+
+__kernel void winograd_output_nchw(__global const float* M,
+                                   __global float* out, uint N, uint H,
+                                   uint W, uint K) {
+  winograd_output(LAYOUT_NCHW, M, out, N, H, W, K);
+}
+
+__kernel void winograd_output_nhwc(__global const float* M,
+                                   __global float* out, uint N, uint H,
+                                   uint W, uint K) {
+  winograd_output(LAYOUT_NHWC, M, out, N, H, W, K);
+}
@@ -0,0 +1,502 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "common/OCLSample.hpp"
+
+// These must be changed to reflect changes in fft_kernel.cl
+#define BLOCK_SIZE 256
+#define LOCAL_SIZE 4096
+#define TILE_DIM   32
+#define BLOCK_ROWS 8
+
+// Transforms of up to this many elements are checked against the host; the
+// rest of the batch is not, to keep the reference affordable
+#define VERIFY_ELEMENTS (1 << 20)
+
+typedef std::complex<double> Complex;
+
+/**
+ * A transform size.  One-dimensional transforms have a height of 1;
+ * two-dimensional ones transform rows of width elements, then columns of
+ * height elements.
+ */
+struct Shape {
+  unsigned int width;
+  unsigned int height;
+};
+
+const Shape kShapes[] = {
+  { 16,      1    },
+  { 256,     1    },
+  { 1024,    1    },
+  { 4096,    1    },
+  { 65536,   1    },
+  { 1048576, 1    },
+  { 256,     256  },
+  { 1024,    1024 },
+  { 512,     2048 },
+  { 2048,    2048 }
+};
+
+const int kNumShapes = sizeof(kShapes) / sizeof(kShapes[0]);
+
+const unsigned int kRadices[] = { 2, 4, 8 };
+
+const int kNumRadices = sizeof(kRadices) / sizeof(kRadices[0]);
+
+/**
+ * Batched complex-to-complex forward FFTs with Stockham kernels of radix 2,
+ * 4 and 8, for both the source and the binary program.  Rows of up to
+ * LOCAL_SIZE elements are transformed in local memory by one kernel, and
+ * longer rows by one kernel per pass; 2D transforms transform the rows,
+ * transpose, transform the rows again and transpose back.  Each result is
+ * checked against a double-precision host FFT, and its rate is reported in
+ * GFLOP/s by the usual 5 N log2(N) convention.
+ */
+class FFTSample : public OCLSample {
+public:
+
+  FFTSample();
+
+  virtual void run();
+
+  void setNumElements(unsigned int elements) {
+    assert(elements > 0 && (elements & (elements - 1)) == 0 &&
+           "Number of elements must be a power of two");
+    NumElements_ = elements;
+  }
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+
+private:
+
+  void createKernels(cl::Program& program);
+  void enqueue(cl::Kernel& kernel, const cl::NDRange& global,
+               const cl::NDRange& local);
+  cl::Buffer* enqueueRows(cl::Buffer* src, cl::Buffer* a, cl::Buffer* b,
+                          unsigned int n, unsigned int batches,
+                          unsigned int radix);
+  void enqueueTranspose(cl::Buffer* src, cl::Buffer* dst, unsigned int width,
+                        unsigned int height, unsigned int matrices);
+  cl::Buffer* enqueueTransform(const Shape& shape, unsigned int radix);
+  void transformHost(const Shape& shape, std::vector<Complex>& data);
+  bool runShapes(cl::Program& program);
+
+  cl::Program programCL_;
+  cl::Program programPTX_;
+
+  // Indexed by log2(radix) - 1
+  cl::Kernel  local_[3];
+  cl::Kernel  pass_[3];
+  cl::Kernel  transpose_;
+
+  cl::Buffer  deviceIn_;
+  cl::Buffer  deviceWork_[2];
+
+  std::vector<cl_float2> hostIn_;
+
+  // Every kernel launch of the transform being timed
+  std::vector<cl::Event> events_;
+
+  unsigned int NumElements_;
+};
+
+
+static unsigned int ilog2(unsigned int n) {
+  unsigned int bits = 0;
+
+  while((1u << bits) < n) {
+    ++bits;
+  }
+  return bits;
+}
+
+FFTSample::FFTSample()
+: NumElements_(1 << 23) {
+}
+
+void FFTSample::initialize() {
+  programCL_ = compileSource("fft_kernel.cl");
+  programPTX_ = loadBinary("fft_kernel.ptx");
+
+  // For this sample, let's run 16 iterations
+  setNumberOfIterations(16);
+}
+
+void FFTSample::createMemoryBuffers() {
+  cl_int result;
+  size_t bytes = (size_t)NumElements_*sizeof(cl_float2);
+
+  srand(time(NULL));
+  hostIn_.resize(NumElements_);
+  for(size_t i = 0; i < hostIn_.size(); ++i) {
+    hostIn_[i].s[0] = 2.0f * rand() / ((float)RAND_MAX + 1.0f) - 1.0f;
+    hostIn_[i].s[1] = 2.0f * rand() / ((float)RAND_MAX + 1.0f) - 1.0f;
+  }
+
+  deviceIn_ = cl::Buffer(getContext(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                         bytes, &hostIn_[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  for(unsigned int i = 0; i < 2; ++i) {
+    deviceWork_[i] = cl::Buffer(getContext(), CL_MEM_READ_WRITE, bytes, NULL,
+                                &result);
+    assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  }
+}
+
+void FFTSample::createKernels(cl::Program& program) {
+  cl_int result;
+
+  for(int r = 0; r < kNumRadices; ++r) {
+    std::stringstream local, pass;
+
+    local << "fft_local_" << kRadices[r];
+    local_[r] = cl::Kernel(program, local.str().c_str(), &result);
+    assert(result == CL_SUCCESS && "Failed to extract kernel");
+
+    pass << "fft_pass_" << kRadices[r];
+    pass_[r] = cl::Kernel(program, pass.str().c_str(), &result);
+    assert(result == CL_SUCCESS && "Failed to extract kernel");
+  }
+
+  transpose_ = cl::Kernel(program, "transpose_complex", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+}
+
+void FFTSample::enqueue(cl::Kernel& kernel, const cl::NDRange& global,
+                        const cl::NDRange& local) {
+  cl_int    result;
+  cl::Event event;
+
+  result = getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange,
+                                                  global, local, NULL,
+                                                  &event);
+  assert(result == CL_SUCCESS && "Failed to launch kernel");
+  events_.push_back(event);
+}
+
+/**
+ * Transforms batches rows of n elements from src, and returns the buffer
+ * holding the result.  The passes write a, b, a, ... in turn, so b may be
+ * src itself but a may not.
+ */
+cl::Buffer* FFTSample::enqueueRows(cl::Buffer* src, cl::Buffer* a,
+                                   cl::Buffer* b, unsigned int n,
+                                   unsigned int batches, unsigned int radix) {
+  cl_int result;
+
+  if(n <= LOCAL_SIZE) {
+    cl::Kernel&  kernel = local_[ilog2(radix) - 1];
+    unsigned int groups = (batches + LOCAL_SIZE / n - 1) / (LOCAL_SIZE / n);
+
+    result = kernel.setArg(0, *src);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+    result = kernel.setArg(1, *a);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+    result = kernel.setArg(2, (cl_uint)n);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+    result = kernel.setArg(3, (cl_uint)batches);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+
+    enqueue(kernel, cl::NDRange(groups * BLOCK_SIZE), cl::NDRange(BLOCK_SIZE));
+    return a;
+  }
+
+  cl::Buffer* in  = src;
+  cl::Buffer* out = a;
+
+  for(unsigned int p = 1; p < n; p *= radix) {
+    // The last pass takes whatever radix is left
+    radix = std::min(radix, n / p);
+
+    cl::Kernel& kernel  = pass_[ilog2(radix) - 1];
+    size_t      threads = (size_t)batches * (n / radix);
+
+    result = kernel.setArg(0, *in);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+    result = kernel.setArg(1, *out);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+    result = kernel.setArg(2, (cl_uint)n);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+    result = kernel.setArg(3, (cl_uint)p);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+    result = kernel.setArg(4, (cl_uint)batches);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 4");
+
+    enqueue(kernel,
+            cl::NDRange((threads + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE),
+            cl::NDRange(BLOCK_SIZE));
+
+    in  = out;
+    out = (out == a) ? b : a;
+  }
+
+  return in;
+}
+
+void FFTSample::enqueueTranspose(cl::Buffer* src, cl::Buffer* dst,
+                                 unsigned int width, unsigned int height,
+                                 unsigned int matrices) {
+  cl_int result;
+
+  result = transpose_.setArg(0, *src);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = transpose_.setArg(1, *dst);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = transpose_.setArg(2, (cl_uint)width);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = transpose_.setArg(3, (cl_uint)height);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+
+  enqueue(transpose_,
+          cl::NDRange((width + TILE_DIM - 1) / TILE_DIM * TILE_DIM,
+                      (height + TILE_DIM - 1) / TILE_DIM * BLOCK_ROWS *
+                      matrices),
+          cl::NDRange(TILE_DIM, BLOCK_ROWS));
+}
+
+/**
+ * Transforms every matrix of deviceIn_, which is left untouched, into one of
+ * the work buffers and returns it.
+ */
+cl::Buffer* FFTSample::enqueueTransform(const Shape& shape,
+                                        unsigned int radix) {
+  unsigned int matrices = NumElements_ / (shape.width * shape.height);
+  cl::Buffer*  rows;
+
+  events_.clear();
+  rows = enqueueRows(&deviceIn_, &deviceWork_[0], &deviceWork_[1],
+                     shape.width, shape.height * matrices, radix);
+  if(shape.height == 1) {
+    return rows;
+  }
+
+  cl::Buffer* other = (rows == &deviceWork_[0]) ? &deviceWork_[1]
+                                                : &deviceWork_[0];
+  cl::Buffer* columns;
+
+  enqueueTranspose(rows, other, shape.width, shape.height, matrices);
+  columns = enqueueRows(other, rows, other, shape.height,
+                        shape.width * matrices, radix);
+  other = (columns == &deviceWork_[0]) ? &deviceWork_[1] : &deviceWork_[0];
+  enqueueTranspose(columns, other, shape.height, shape.width, matrices);
+  return other;
+}
+
+/**
+ * In-place radix-2 decimation-in-time FFT of n elements, n a power of two.
+ */
+static void fftHost(Complex* x, unsigned int n) {
+  for(unsigned int i = 1, j = 0; i < n; ++i) {
+    unsigned int bit = n >> 1;
+    for(; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j |= bit;
+    if(i < j) {
+      std::swap(x[i], x[j]);
+    }
+  }
+
+  for(unsigned int len = 2; len <= n; len <<= 1) {
+    double angle = -2.0 * M_PI / len;
+    for(unsigned int i = 0; i < n; i += len) {
+      for(unsigned int k = 0; k < len / 2; ++k) {
+        Complex w = std::polar(1.0, angle * k);
+        Complex u = x[i + k];
+        Complex v = x[i + k + len / 2] * w;
+        x[i + k]           = u + v;
+        x[i + k + len / 2] = u - v;
+      }
+    }
+  }
+}
+
+/**
+ * Transforms the matrices of data, stored one after another.
+ */
+void FFTSample::transformHost(const Shape& shape, std::vector<Complex>& data) {
+  size_t               size = (size_t)shape.width * shape.height;
+  std::vector<Complex> column(shape.height);
+
+  for(size_t m = 0; m < data.size(); m += size) {
+    for(unsigned int y = 0; y < shape.height; ++y) {
+      fftHost(&data[m + (size_t)y*shape.width], shape.width);
+    }
+    if(shape.height == 1) {
+      continue;
+    }
+    for(unsigned int x = 0; x < shape.width; ++x) {
+      for(unsigned int y = 0; y < shape.height; ++y) {
+        column[y] = data[m + (size_t)y*shape.width + x];
+      }
+      fftHost(&column[0], shape.height);
+      for(unsigned int y = 0; y < shape.height; ++y) {
+        data[m + (size_t)y*shape.width + x] = column[y];
+      }
+    }
+  }
+}
+
+bool FFTSample::runShapes(cl::Program& program) {
+  cl_int                 result;
+  bool                   passed = true;
+  std::vector<cl_float2> hostOut(NumElements_);
+
+  createKernels(program);
+
+  std::cout << std::setw(12) << "shape" << std::setw(9) << "batch"
+            << std::setw(7) << "radix" << std::setw(8) << "kernel"
+            << std::setw(12) << "median ms" << std::setw(10) << "GFLOP/s"
+            << std::setw(11) << "error" << "\n";
+
+  for(int s = 0; s < kNumShapes; ++s) {
+    const Shape&      shape = kShapes[s];
+    size_t            size  = (size_t)shape.width * shape.height;
+    std::stringstream name;
+
+    name << shape.width;
+    if(shape.height > 1) {
+      name << "x" << shape.height;
+    }
+    if(size > NumElements_) {
+      std::cout << std::setw(12) << name.str() << std::setw(9) << "-" << "\n";
+      continue;
+    }
+
+    // Reference for the first matrices of the batch
+    unsigned int         matrices = NumElements_ / size;
+    size_t               checked  = std::max(size, (size_t)VERIFY_ELEMENTS);
+    std::vector<Complex> expected(std::min(checked, (size_t)NumElements_));
+    for(size_t i = 0; i < expected.size(); ++i) {
+      expected[i] = Complex(hostIn_[i].s[0], hostIn_[i].s[1]);
+    }
+    transformHost(shape, expected);
+
+    const char* tier = (std::max(shape.width, shape.height) <= LOCAL_SIZE)
+                     ? "local" : "global";
+
+    for(int r = 0; r < kNumRadices; ++r) {
+      // The first transform is a warm-up
+      std::vector<double> times;
+      cl::Buffer*         out = enqueueTransform(shape, kRadices[r]);
+      getElapsed(events_.front(), events_.back());
+      for(unsigned i = 0; i < getNumberOfIterations(); ++i) {
+        enqueueTransform(shape, kRadices[r]);
+        times.push_back(getElapsed(events_.front(), events_.back()));
+      }
+
+      result = getCommandQueue().enqueueReadBuffer(*out, CL_TRUE, 0,
+                                                   expected.size() *
+                                                   sizeof(cl_float2),
+                                                   &hostOut[0], NULL, NULL);
+      assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+
+      // Relative RMS error, which grows slowly with log2(N) in float
+      double error = 0.0, norm = 0.0;
+      for(size_t i = 0; i < expected.size(); ++i) {
+        Complex actual(hostOut[i].s[0], hostOut[i].s[1]);
+        error += std::norm(actual - expected[i]);
+        norm  += std::norm(expected[i]);
+      }
+      error = std::sqrt(error / norm);
+
+      bool correct = error <= 1e-5;
+      passed = passed && correct;
+
+      double time  = median(times);
+      double flops = 5.0 * size * ilog2(size) * matrices;
+
+      std::cout << std::setw(12) << name.str() << std::setw(9) << matrices
+                << std::setw(7) << kRadices[r] << std::setw(8) << tier
+                << std::fixed << std::setprecision(3) << std::setw(12)
+                << time * 1e3 << std::setprecision(2) << std::setw(10)
+                << flops / time / 1e9 << std::scientific << std::setw(11)
+                << error << (correct ? "" : "  FAILED") << "\n";
+      std::cout.unsetf(std::ios::floatfield);
+      std::cout << std::setprecision(6);
+    }
+  }
+
+  return passed;
+}
+
+void FFTSample::run() {
+  initialize();
+  createMemoryBuffers();
+
+  std::cout << "Problem Size:         " << NumElements_ << " elements\n";
+
+  cl::Program* programs[2] = { &programCL_, &programPTX_ };
+  const char*  names[2]    = { "Source", "Binary" };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernels\n";
+    std::cout << "------------------------------\n";
+
+    if(runShapes(*programs[k])) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+  }
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --elements N        Complex elements per batch, a power of "
+            << "two (default 8M)\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  FFTSample sample;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--elements" && i+1 < argc) {
+      sample.setNumElements(atoi(argv[++i]));
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sample.run();
+
+  return 0;
+}
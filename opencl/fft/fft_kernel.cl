@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+// These must match fft.cpp
+#define BLOCK_SIZE 256
+#define LOCAL_SIZE 4096
+#define TILE_DIM   32
+#define BLOCK_ROWS 8
+
+#define SQRT1_2 0.70710678118654752f
+
+// Complex numbers are float2s, and every transform is a forward transform,
+// X[k] = sum_j x[j] exp(-2 pi i j k / n), of a power-of-two size n.  Batches
+// of transforms are stored one after another.
+//
+// The transforms use the Stockham auto-sort formulation: a pass of radix r
+// with stride p (p = 1, r, r^2, ...) reads r elements spaced n/r apart,
+// applies twiddles and an r-point DFT, and writes them spaced p apart, so
+// the output comes out in natural order without a bit-reversal step.
+// Each kernel takes its radix as a constant, so the switches below fold
+// away once the helpers are inlined.
+
+inline float2 complex_mul(float2 a, float2 b) {
+  return (float2)(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+/**
+ * a * -i
+ */
+inline float2 mul_neg_i(float2 a) {
+  return (float2)(a.y, -a.x);
+}
+
+/**
+ * exp(-2 pi i num / den)
+ */
+inline float2 twiddle(uint num, uint den) {
+  float c;
+  float s = sincos(-2.0f * M_PI_F * num / den, &c);
+  return (float2)(c, s);
+}
+
+inline void dft2(float2* x) {
+  float2 t = x[0];
+
+  x[0] = t + x[1];
+  x[1] = t - x[1];
+}
+
+inline void dft4(float2* x) {
+  float2 t0 = x[0] + x[2];
+  float2 t1 = x[0] - x[2];
+  float2 t2 = x[1] + x[3];
+  float2 t3 = mul_neg_i(x[1] - x[3]);
+
+  x[0] = t0 + t2;
+  x[1] = t1 + t3;
+  x[2] = t0 - t2;
+  x[3] = t1 - t3;
+}
+
+/**
+ * Two 4-point DFTs of the even and odd elements, combined with the 8th
+ * roots of unity.
+ */
+inline void dft8(float2* x) {
+  float2 e[4] = { x[0], x[2], x[4], x[6] };
+  float2 o[4] = { x[1], x[3], x[5], x[7] };
+  uint   k;
+
+  dft4(e);
+  dft4(o);
+
+  // o[k] * exp(-2 pi i k / 8)
+  o[1] = (float2)(SQRT1_2 * (o[1].x + o[1].y), SQRT1_2 * (o[1].y - o[1].x));
+  o[2] = mul_neg_i(o[2]);
+  o[3] = (float2)(SQRT1_2 * (o[3].y - o[3].x), -SQRT1_2 * (o[3].x + o[3].y));
+
+  for(k = 0; k < 4; ++k) {
+    x[k]     = e[k] + o[k];
+    x[k + 4] = e[k] - o[k];
+  }
+}
+
+/**
+ * Twiddles and transforms the radix elements of butterfly k of a pass with
+ * stride p.
+ */
+inline void butterfly(float2* x, uint radix, uint k, uint p) {
+  uint r;
+
+  for(r = 1; r < radix; ++r) {
+    x[r] = complex_mul(x[r], twiddle(r * k, p * radix));
+  }
+
+  switch(radix) {
+  case 2:  dft2(x); break;
+  case 4:  dft4(x); break;
+  default: dft8(x); break;
+  }
+}
+
+
+//==--- Global Passes ------------------------------------------------------== //
+
+/**
+ * One pass over every transform of the batch, one work-item per butterfly.
+ * Sizes above LOCAL_SIZE take log_radix(n) of these, ping-ponging between
+ * two buffers, with a smaller radix for the last pass if needed.
+ */
+inline void fft_pass(__global const float2* in, __global float2* out,
+                     uint n, uint p, uint numBatches, uint radix) {
+  uint   threads = n / radix;
+  uint   gid     = get_global_id(0);
+  uint   batch   = gid / threads;
+  uint   i       = gid % threads;
+  uint   k       = i & (p - 1);
+  uint   j       = (i - k) * radix + k;
+  float2 x[8];
+  uint   r;
+
+  if(batch >= numBatches) {
+    return;
+  }
+  in  += (size_t)batch * n;
+  out += (size_t)batch * n;
+
+  for(r = 0; r < radix; ++r) {
+    x[r] = in[i + r * threads];
+  }
+  butterfly(x, radix, k, p);
+  for(r = 0; r < radix; ++r) {
+    out[j + r * p] = x[r];
+  }
+}
+
+__kernel void fft_pass_2(__global const float2* in, __global float2* out,
+                         uint n, uint p, uint numBatches) {
+  fft_pass(in, out, n, p, numBatches, 2);
+}
+
+__kernel void fft_pass_4(__global const float2* in, __global float2* out,
+                         uint n, uint p, uint numBatches) {
+  fft_pass(in, out, n, p, numBatches, 4);
+}
+
+__kernel void fft_pass_8(__global const float2* in, __global float2* out,
+                         uint n, uint p, uint numBatches) {
+  fft_pass(in, out, n, p, numBatches, 8);
+}
+
+
+//==--- Local Transforms ---------------------------------------------------== //
+
+/**
+ * One in-place pass over the count transforms staged in data.  Every
+ * work-item reads all of its butterflies before any of them are written
+ * back; with LOCAL_SIZE elements shared by BLOCK_SIZE work-items, that is
+ * at most LOCAL_SIZE / BLOCK_SIZE elements each.
+ */
+inline void local_pass(__local float2* data, uint n, uint count, uint p,
+                       uint radix) {
+  float2 v[LOCAL_SIZE / BLOCK_SIZE];
+  uint   threads     = n / radix;
+  uint   butterflies = count * threads;
+  uint   tid         = get_local_id(0);
+  uint   b, t, r;
+
+  for(b = 0, t = tid; t < butterflies; ++b, t += BLOCK_SIZE) {
+    uint base = (t / threads) * n + t % threads;
+    for(r = 0; r < radix; ++r) {
+      v[b * radix + r] = data[base + r * threads];
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(b = 0, t = tid; t < butterflies; ++b, t += BLOCK_SIZE) {
+    uint i = t % threads;
+    uint k = i & (p - 1);
+    uint j = (t / threads) * n + (i - k) * radix + k;
+
+    butterfly(&v[b * radix], radix, k, p);
+    for(r = 0; r < radix; ++r) {
+      data[j + r * p] = v[b * radix + r];
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+/**
+ * Every pass of LOCAL_SIZE / n transforms per work-group, in local memory,
+ * so the transforms read and write global memory once.  n must not exceed
+ * LOCAL_SIZE.
+ */
+inline void fft_local(__global const float2* in, __global float2* out,
+                      uint n, uint numBatches, uint radix,
+                      __local float2* data) {
+  uint first = get_group_id(0) * (LOCAL_SIZE / n);
+  uint count = min((uint)(LOCAL_SIZE / n), numBatches - first);
+  uint tid   = get_local_id(0);
+  uint e, p;
+
+  in  += (size_t)first * n;
+  out += (size_t)first * n;
+
+  for(e = tid; e < count * n; e += BLOCK_SIZE) {
+    data[e] = in[e];
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(p = 1; p * radix <= n; p *= radix) {
+    local_pass(data, n, count, p, radix);
+  }
+  if(p < n) {
+    local_pass(data, n, count, p, n / p);
+  }
+
+  for(e = tid; e < count * n; e += BLOCK_SIZE) {
+    out[e] = data[e];
+  }
+}
+
+__kernel void fft_local_2(__global const float2* in, __global float2* out,
+                          uint n, uint numBatches) {
+  __local float2 data[LOCAL_SIZE];
+
+  fft_local(in, out, n, numBatches, 2, data);
+}
+
+__kernel void fft_local_4(__global const float2* in, __global float2* out,
+                          uint n, uint numBatches) {
+  __local float2 data[LOCAL_SIZE];
+
+  fft_local(in, out, n, numBatches, 4, data);
+}
+
+__kernel void fft_local_8(__global const float2* in, __global float2* out,
+                          uint n, uint numBatches) {
+  __local float2 data[LOCAL_SIZE];
+
+  fft_local(in, out, n, numBatches, 8, data);
+}
+
+
+//==--- Transpose ----------------------------------------------------------== //
+
+/**
+ * Transposes each width x height matrix of a batch through a padded local
+ * memory tile, as in the transpose sample.  The y dimension of the NDRange
+ * covers the tile rows of all the matrices.
+ */
+__kernel void transpose_complex(__global const float2* in,
+                                __global float2* out, uint width,
+                                uint height) {
+  __local float2 tile[TILE_DIM * (TILE_DIM + 1)];
+  uint tilesY = (height + TILE_DIM - 1) / TILE_DIM;
+  uint matrix = get_group_id(1) / tilesY;
+  uint groupX = get_group_id(0);
+  uint groupY = get_group_id(1) % tilesY;
+  uint tidX   = get_local_id(0);
+  uint tidY   = get_local_id(1);
+  uint x      = groupX * TILE_DIM + tidX;
+  uint y      = groupY * TILE_DIM + tidY;
+  uint j;
+
+  in  += (size_t)matrix * width * height;
+  out += (size_t)matrix * width * height;
+
+  for(j = 0; j < TILE_DIM; j += BLOCK_ROWS) {
+    if(x < width && y + j < height) {
+      tile[(tidY + j) * (TILE_DIM + 1) + tidX] = in[(y + j) * width + x];
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  x = groupY * TILE_DIM + tidX;
+  y = groupX * TILE_DIM + tidY;
+  for(j = 0; j < TILE_DIM; j += BLOCK_ROWS) {
+    if(x < height && y + j < width) {
+      out[(y + j) * height + x] = tile[tidX * (TILE_DIM + 1) + tidY + j];
+    }
+  }
+}
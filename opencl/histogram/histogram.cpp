@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "common/OCLSample.hpp"
+
+// This must be changed to reflect changes in histogram_kernel.cl
+#define BLOCK_SIZE 256
+
+// Work-groups per compute unit in the NDRange of every histogram kernel
+#define GROUPS_PER_UNIT 8
+
+// The largest bin count, which sizes the per-group partial histograms
+#define MAX_BINS 65536
+
+const unsigned int kBinCounts[] = { 256, MAX_BINS };
+
+const int kNumBinCounts = sizeof(kBinCounts) / sizeof(kBinCounts[0]);
+
+/**
+ * A strategy of histogram_kernel.cl.  Privatized strategies write one
+ * histogram per work-group and need a merge pass; the others accumulate
+ * into a cleared histogram.  largeBins is false if the strategy's copies of
+ * the bins only fit local memory for the smallest bin count.
+ */
+struct Variant {
+  const char* name;
+  bool        privatized;
+  bool        largeBins;
+};
+
+const Variant kVariants[] = {
+  { "global", false, true  },
+  { "group",  true,  true  },
+  { "warp",   true,  false }
+};
+
+const int kNumVariants = sizeof(kVariants) / sizeof(kVariants[0]);
+
+enum Distribution {
+  DISTRIBUTION_UNIFORM,
+  DISTRIBUTION_SKEWED,
+  NUM_DISTRIBUTIONS
+};
+
+const char* kDistributionNames[NUM_DISTRIBUTIONS] = { "uniform", "skewed" };
+
+/**
+ * Bins a vector of 32-bit keys into 256 and into 64K bins with global
+ * atomics, with per-group private bins and with per-warp private bins, for
+ * uniform keys and for skewed keys whose hot bins make the atomics contend.
+ * Each histogram is checked against the host, and its GB/s is reported next
+ * to the device's copy bandwidth.
+ */
+class HistogramSample : public OCLSample {
+public:
+
+  HistogramSample();
+
+  virtual void run();
+
+  void setProblemSize(unsigned int size) {
+    assert(size > 0 && "Problem size must be positive");
+    ProblemSize_ = size;
+  }
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+
+private:
+
+  cl::Kernel getKernel(cl::Program& program, const std::string& name);
+  void enqueue(cl::Kernel& kernel, size_t globalSize, cl::Event* event);
+  double launchHistogram(const Variant& variant, cl_uint numBins,
+                         cl::Kernel& kernel, cl::Kernel& merge,
+                         cl::Kernel& clear);
+  void generateKeys(Distribution distribution);
+  bool runVariants(cl::Program& program, double copyRate);
+
+  cl::Program programCL_;
+  cl::Program programPTX_;
+
+  cl::Buffer  deviceData_;
+  cl::Buffer  deviceHist_;
+  cl::Buffer  devicePartials_;
+
+  std::vector<cl_uint> hostData_;
+
+  unsigned int ProblemSize_;
+  unsigned int WaveGroups_;
+};
+
+
+HistogramSample::HistogramSample()
+: ProblemSize_(1 << 24) {
+}
+
+void HistogramSample::initialize() {
+  programCL_ = compileSource("histogram_kernel.cl");
+  programPTX_ = loadBinary("histogram_kernel.ptx");
+
+  cl_uint units = getDevice().getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+  WaveGroups_ = std::max(units, 1u) * GROUPS_PER_UNIT;
+
+  // For this sample, let's run 16 iterations
+  setNumberOfIterations(16);
+}
+
+void HistogramSample::createMemoryBuffers() {
+  cl_int result;
+
+  hostData_.resize(ProblemSize_);
+
+  deviceData_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                           ProblemSize_*sizeof(cl_uint), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceHist_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                           MAX_BINS*sizeof(cl_uint), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  devicePartials_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                               WaveGroups_*MAX_BINS*sizeof(cl_uint), NULL,
+                               &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+}
+
+cl::Kernel HistogramSample::getKernel(cl::Program& program,
+                                      const std::string& name) {
+  cl_int result;
+
+  cl::Kernel kernel(program, name.c_str(), &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  return kernel;
+}
+
+void HistogramSample::enqueue(cl::Kernel& kernel, size_t globalSize,
+                              cl::Event* event) {
+  cl_int      result;
+  cl::NDRange global((globalSize + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE);
+  cl::NDRange local(BLOCK_SIZE);
+
+  result = getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange,
+                                                  global, local, NULL,
+                                                  event);
+  assert(result == CL_SUCCESS && "Failed to launch kernel");
+}
+
+double HistogramSample::launchHistogram(const Variant& variant,
+                                        cl_uint numBins, cl::Kernel& kernel,
+                                        cl::Kernel& merge,
+                                        cl::Kernel& clear) {
+  cl_int    result;
+  cl::Event first, last;
+
+  result = kernel.setArg(0, deviceData_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernel.setArg(1, (cl_uint)ProblemSize_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+
+  if(variant.privatized) {
+    result = kernel.setArg(2, devicePartials_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+    enqueue(kernel, WaveGroups_*BLOCK_SIZE, &first);
+
+    // Second pass: one work-item per bin sums the per-group histograms
+    result = merge.setArg(0, devicePartials_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+    result = merge.setArg(1, deviceHist_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+    result = merge.setArg(2, (cl_uint)WaveGroups_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+    result = merge.setArg(3, numBins);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+    enqueue(merge, numBins, &last);
+  } else {
+    result = clear.setArg(0, deviceHist_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+    result = clear.setArg(1, numBins);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+    enqueue(clear, numBins, &first);
+
+    result = kernel.setArg(2, deviceHist_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+    enqueue(kernel, WaveGroups_*BLOCK_SIZE, &last);
+  }
+
+  return getElapsed(first, last);
+}
+
+void HistogramSample::generateKeys(Distribution distribution) {
+  cl_ulong state = 0x9e3779b97f4a7c15ULL;
+
+  // Bin 0 alone receives over a third of the skewed keys
+  for(unsigned int i = 0; i < ProblemSize_; ++i) {
+    cl_ulong key = distribution == DISTRIBUTION_SKEWED ? nextSkewed(state)
+                                                        : nextRandom(state);
+    hostData_[i] = (cl_uint)(key >> 32);
+  }
+
+  cl_int result;
+  result = getCommandQueue().enqueueWriteBuffer(deviceData_, CL_TRUE, 0,
+                                                ProblemSize_*sizeof(cl_uint),
+                                                &hostData_[0], NULL, NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+}
+
+bool HistogramSample::runVariants(cl::Program& program, double copyRate) {
+  bool       passed = true;
+  cl::Kernel merge  = getKernel(program, "merge_bins");
+  cl::Kernel clear  = getKernel(program, "clear_bins");
+
+  for(int d = 0; d < NUM_DISTRIBUTIONS; ++d) {
+    generateKeys((Distribution)d);
+
+    for(int b = 0; b < kNumBinCounts; ++b) {
+      cl_uint              numBins = kBinCounts[b];
+      std::vector<cl_uint> expected(numBins, 0);
+      std::vector<cl_uint> hist(numBins);
+
+      for(unsigned int i = 0; i < ProblemSize_; ++i) {
+        ++expected[hostData_[i] & (numBins - 1)];
+      }
+      cl_uint largest = *std::max_element(expected.begin(), expected.end());
+
+      std::cout << "* " << kDistributionNames[d] << " keys, " << numBins
+                << " bins (largest bin " << std::fixed
+                << std::setprecision(1) << 100.0 * largest / ProblemSize_
+                << "%)\n";
+      std::cout.unsetf(std::ios::floatfield);
+      std::cout << std::setprecision(6);
+      std::cout << std::setw(12) << "variant" << std::setw(12)
+                << "median ms" << std::setw(9) << "GB/s" << std::setw(9)
+                << "% copy" << "\n";
+
+      for(int v = 0; v < kNumVariants; ++v) {
+        const Variant& variant = kVariants[v];
+
+        std::cout << std::setw(12) << variant.name;
+        if(!variant.largeBins && numBins > kBinCounts[0]) {
+          std::cout << std::setw(12) << "-" << "\n";
+          continue;
+        }
+
+        std::ostringstream name;
+        name << "histogram_" << variant.name << "_" << numBins;
+
+        cl::Kernel          kernel = getKernel(program, name.str());
+        std::vector<double> times;
+
+        // The first launch is a warm-up
+        launchHistogram(variant, numBins, kernel, merge, clear);
+        for(unsigned i = 0; i < getNumberOfIterations(); ++i) {
+          times.push_back(launchHistogram(variant, numBins, kernel, merge,
+                                          clear));
+        }
+
+        cl_int status;
+        status = getCommandQueue().enqueueReadBuffer(deviceHist_, CL_TRUE, 0,
+                                                     numBins*sizeof(cl_uint),
+                                                     &hist[0], NULL, NULL);
+        assert(status == CL_SUCCESS && "Failed to queue data copy to host");
+
+        bool correct = (hist == expected);
+        passed = passed && correct;
+
+        double time = median(times);
+        double rate = ProblemSize_ * sizeof(cl_uint) / time / 1e9;
+
+        std::cout << std::fixed << std::setprecision(3) << std::setw(12)
+                  << time * 1e3 << std::setprecision(2) << std::setw(9)
+                  << rate << std::setw(9) << 100.0 * rate / copyRate
+                  << (correct ? "" : "  FAILED") << "\n";
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+      }
+    }
+  }
+
+  return passed;
+}
+
+void HistogramSample::run() {
+  initialize();
+  createMemoryBuffers();
+
+  std::cout << "Problem Size:         " << ProblemSize_ << "\n";
+
+  double copyRate = measureCopyBandwidth(ProblemSize_*sizeof(cl_uint));
+  std::cout << "Copy GB/s:            " << copyRate << "\n";
+
+  cl::Program* programs[2] = { &programCL_, &programPTX_ };
+  const char*  names[2]    = { "Source", "Binary" };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernels\n";
+    std::cout << "------------------------------\n";
+
+    if(runVariants(*programs[k], copyRate)) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+  }
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --size N            Keys to bin (default 16777216)\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  HistogramSample sample;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--size" && i+1 < argc) {
+      sample.setProblemSize(atoi(argv[++i]));
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sample.run();
+
+  return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma OPENCL EXTENSION cl_khr_global_int32_base_atomics : enable
+#pragma OPENCL EXTENSION cl_khr_local_int32_base_atomics : enable
+
+// These must match histogram.cpp
+#define BLOCK_SIZE 256
+#define WARP_SIZE  32
+#define NUM_WARPS  (BLOCK_SIZE / WARP_SIZE)
+
+// Bins of histogram_group_65536 counted in local memory per pass (32 KB)
+#define TILE_BINS  8192
+
+// Every kernel bins a vector of 32-bit keys by their low bits, with a
+// grid-stride loop so that a fixed number of work-groups covers any size.
+// The kernels that privatize the bins write one histogram per work-group to
+// partials, which merge_bins then sums into the final histogram.
+
+/**
+ * Zeroes the histogram that the global kernels accumulate into.
+ */
+__kernel void clear_bins(__global uint* hist, uint numBins) {
+  uint i = get_global_id(0);
+
+  if(i < numBins) {
+    hist[i] = 0;
+  }
+}
+
+/**
+ * Sums the per-group histograms of the privatized kernels, one bin per
+ * work-item, so consecutive work-items read consecutive bins.
+ */
+__kernel void merge_bins(__global const uint* partials, __global uint* hist,
+                         uint numGroups, uint numBins) {
+  uint i = get_global_id(0);
+  uint sum = 0;
+  uint g;
+
+  if(i >= numBins) {
+    return;
+  }
+  for(g = 0; g < numGroups; ++g) {
+    sum += partials[g * numBins + i];
+  }
+  hist[i] = sum;
+}
+
+
+//==--- Global Atomics -----------------------------------------------------== //
+
+/**
+ * Every work-item increments the shared histogram directly, so all work-items
+ * that see the same key serialize on one address in global memory.
+ */
+inline void histogram_global(__global const uint* data, uint n,
+                             __global uint* hist, uint numBins) {
+  uint i;
+
+  for(i = get_global_id(0); i < n; i += get_global_size(0)) {
+    atomic_inc(&hist[data[i] & (numBins - 1)]);
+  }
+}
+
+__kernel void histogram_global_256(__global const uint* data, uint n,
+                                   __global uint* hist) {
+  histogram_global(data, n, hist, 256);
+}
+
+__kernel void histogram_global_65536(__global const uint* data, uint n,
+                                     __global uint* hist) {
+  histogram_global(data, n, hist, 65536);
+}
+
+
+//==--- Per-Group Bins -----------------------------------------------------== //
+
+/**
+ * Each work-group counts into its own copy of the bins, so atomics only
+ * contend within the group, and then writes the copy out to partials.
+ */
+__kernel void histogram_group_256(__global const uint* data, uint n,
+                                  __global uint* partials) {
+  __local uint bins[256];
+  uint tid = get_local_id(0);
+  uint i;
+
+  for(i = tid; i < 256; i += BLOCK_SIZE) {
+    bins[i] = 0;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(i = get_global_id(0); i < n; i += get_global_size(0)) {
+    atomic_inc(&bins[data[i] & 255]);
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(i = tid; i < 256; i += BLOCK_SIZE) {
+    partials[get_group_id(0) * 256 + i] = bins[i];
+  }
+}
+
+/**
+ * 64K bins do not fit in local memory, so each work-group counts them
+ * TILE_BINS at a time: every pass re-reads the group's keys, counts those
+ * that fall in the current tile of bins with local atomics, and writes the
+ * tile out to the group's slice of partials.  The keys are read
+ * 65536 / TILE_BINS times in exchange.
+ */
+__kernel void histogram_group_65536(__global const uint* data, uint n,
+                                    __global uint* partials) {
+  __local uint bins[TILE_BINS];
+  __global uint* out = partials + get_group_id(0) * 65536;
+  uint tid = get_local_id(0);
+  uint tile, i;
+
+  for(tile = 0; tile < 65536; tile += TILE_BINS) {
+    for(i = tid; i < TILE_BINS; i += BLOCK_SIZE) {
+      bins[i] = 0;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(i = get_global_id(0); i < n; i += get_global_size(0)) {
+      uint bin = (data[i] & 65535) - tile;
+      if(bin < TILE_BINS) {
+        atomic_inc(&bins[bin]);
+      }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(i = tid; i < TILE_BINS; i += BLOCK_SIZE) {
+      out[tile + i] = bins[i];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+}
+
+
+//==--- Per-Warp Bins ------------------------------------------------------== //
+
+/**
+ * Each warp of the group counts into its own local copy of the bins, which
+ * divides the contention on a hot bin by NUM_WARPS.  The group sums its
+ * copies before writing them out to partials.  Only 256 bins fit NUM_WARPS
+ * times in local memory.
+ */
+__kernel void histogram_warp_256(__global const uint* data, uint n,
+                                 __global uint* partials) {
+  __local uint bins[NUM_WARPS * 256];
+  uint tid  = get_local_id(0);
+  uint base = (tid / WARP_SIZE) * 256;
+  uint i, w;
+
+  for(i = tid; i < NUM_WARPS * 256; i += BLOCK_SIZE) {
+    bins[i] = 0;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(i = get_global_id(0); i < n; i += get_global_size(0)) {
+    atomic_inc(&bins[base + (data[i] & 255)]);
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(i = tid; i < 256; i += BLOCK_SIZE) {
+    uint sum = 0;
+    for(w = 0; w < NUM_WARPS; ++w) {
+      sum += bins[w * 256 + i];
+    }
+    partials[get_group_id(0) * 256 + i] = sum;
+  }
+}
@@ -0,0 +1,464 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include "common/OCLSample.hpp"
+
+#define BLOCK_SIZE  16
+#define REDUCE_SIZE 256
+
+// The float iteration stalls at about twice the residual floor estimated
+// by residualFloor(), so the solvers aim a little above that
+#define FLOOR_MARGIN 4.0
+
+/**
+ * Solves the 2D Poisson problem -Laplace(u) = f on the unit square with
+ * Jacobi iteration.  The residual is reduced on the device and only read
+ * back every few sweeps, so the solver loop stays device-bound.
+ *
+ * A float iterate cannot have an arbitrarily small residual: rounding u to
+ * float perturbs every residual by a fraction of an ulp of u, which grows
+ * relative to the h^2-scaled right-hand side as the grid is refined.  The
+ * solvers therefore stop once the true relative residual falls below the
+ * larger of the tolerance and a margin over that floor, and the device
+ * solution passes if its residual, recomputed on the host in double, is
+ * below the same target.
+ */
+class JacobiSample : public OCLSample {
+public:
+
+  JacobiSample();
+
+  virtual void run();
+
+  void setProblemSize(unsigned int size) {
+    assert(size % BLOCK_SIZE == 0 && "Problem size must be a multiple of 16");
+    ProblemSize_ = size;
+  }
+
+  void setCheckInterval(unsigned int sweeps) {
+    assert(sweeps > 0 && "Check interval must be positive");
+    checkInterval_ = sweeps;
+  }
+
+  void setTolerance(float tolerance) {
+    tolerance_ = tolerance;
+  }
+
+  void setMaxIterations(unsigned int iterations) {
+    maxIterations_ = iterations;
+  }
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+
+private:
+
+  struct SolverKernels {
+    cl::Kernel sweep;
+    cl::Kernel sweepResidual;
+    cl::Kernel reduce;
+  };
+
+  void extractKernels(cl::Program& program, SolverKernels& kernels);
+  unsigned solveDevice(SolverKernels& kernels, double& residual);
+  unsigned solveHost(double& residual);
+  double hostResidual(const std::vector<float>& u);
+  double residualFloor();
+  void report(unsigned iterations, double residual, double elapsed);
+
+  cl::Program programCL_;
+  cl::Program programPTX_;
+
+  SolverKernels kernelsCL_;
+  SolverKernels kernelsPTX_;
+
+  cl::Buffer  deviceU_[2];
+  cl::Buffer  deviceF_;
+  cl::Buffer  devicePartial_;
+  cl::Buffer  deviceResidual_;
+
+  std::vector<float> hostF_;
+  std::vector<float> hostU_;
+  std::vector<float> deviceResult_;
+
+  unsigned int ProblemSize_;
+  unsigned int Pitch_;
+  unsigned int ArraySize_;
+  unsigned int NumGroups_;
+
+  unsigned int checkInterval_;
+  unsigned int maxIterations_;
+  float        tolerance_;
+  double       target_;
+  double       rhsNorm_;
+};
+
+
+JacobiSample::JacobiSample()
+: ProblemSize_(256), checkInterval_(64), maxIterations_(1000000),
+  tolerance_(1e-4f), target_(0.0), rhsNorm_(0.0) {
+}
+
+void JacobiSample::extractKernels(cl::Program& program,
+                                  SolverKernels& kernels) {
+  cl_int result;
+
+  kernels.sweep = cl::Kernel(program, "jacobi", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.sweepResidual = cl::Kernel(program, "jacobi_residual", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.reduce = cl::Kernel(program, "reduce_partials", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+}
+
+void JacobiSample::initialize() {
+  programCL_ = compileSource("jacobi_kernel.cl");
+  programPTX_ = loadBinary("jacobi_kernel.ptx");
+
+  extractKernels(programCL_, kernelsCL_);
+  extractKernels(programPTX_, kernelsPTX_);
+
+  setSourceKernel(kernelsCL_.sweep);
+  setBinaryKernel(kernelsPTX_.sweep);
+
+  Pitch_     = ProblemSize_ + 2;
+  ArraySize_ = Pitch_ * Pitch_;
+  NumGroups_ = (ProblemSize_ / BLOCK_SIZE) * (ProblemSize_ / BLOCK_SIZE);
+}
+
+void JacobiSample::createMemoryBuffers() {
+  cl_int result;
+  double h = 1.0 / (ProblemSize_ + 1);
+
+  // f = 2 pi^2 sin(pi x) sin(pi y), whose solution is sin(pi x) sin(pi y).
+  // The kernels expect f pre-scaled by h^2.
+  hostF_.assign(ArraySize_, 0.0f);
+  rhsNorm_ = 0.0;
+  for(unsigned int y = 1; y <= ProblemSize_; ++y) {
+    for(unsigned int x = 1; x <= ProblemSize_; ++x) {
+      double value = 2.0 * M_PI * M_PI * sin(M_PI * x * h) * sin(M_PI * y * h);
+      hostF_[y*Pitch_+x] = (float)(value * h * h);
+      rhsNorm_ += (double)hostF_[y*Pitch_+x] * hostF_[y*Pitch_+x];
+    }
+  }
+  rhsNorm_ = sqrt(rhsNorm_);
+  target_  = std::max((double)tolerance_, FLOOR_MARGIN * residualFloor());
+
+  // Both iterates start at zero, which also sets the Dirichlet border
+  for(unsigned int i = 0; i < 2; ++i) {
+    deviceU_[i] = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                             ArraySize_*sizeof(float), NULL, &result);
+    assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  }
+  deviceF_ = cl::Buffer(getContext(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                        ArraySize_*sizeof(float), &hostF_[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  devicePartial_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                              NumGroups_*sizeof(float), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceResidual_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                               2*sizeof(float), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+}
+
+unsigned JacobiSample::solveDevice(SolverKernels& kernels, double& residual) {
+  cl_int            result;
+  cl::CommandQueue& queue = getCommandQueue();
+  cl::NDRange       globalSize(ProblemSize_, ProblemSize_);
+  cl::NDRange       localSize(BLOCK_SIZE, BLOCK_SIZE);
+  std::vector<float> zero(ArraySize_, 0.0f);
+
+  for(unsigned int i = 0; i < 2; ++i) {
+    result = queue.enqueueWriteBuffer(deviceU_[i], CL_TRUE, 0,
+                                      ArraySize_*sizeof(float), &zero[0],
+                                      NULL, NULL);
+    assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+  }
+
+  result = kernels.reduce.setArg(0, devicePartial_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernels.reduce.setArg(1, deviceResidual_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = kernels.reduce.setArg(2, NumGroups_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = kernels.sweepResidual.setArg(4, devicePartial_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 4");
+
+  // Residual readbacks are double-buffered: the result of one check is
+  // only waited on after the next batch of sweeps has been queued, so the
+  // device never idles while the host inspects it.
+  float     hostSums[2];
+  cl::Event readEvents[2];
+  bool      pending   = false;
+  unsigned  slot      = 0;
+  unsigned  current   = 0;
+  unsigned  iterations = 0;
+  unsigned  checked    = 0;
+  bool      converged  = false;
+
+  residual = 0.0;
+
+  while(!converged && iterations < maxIterations_) {
+    for(unsigned k = 0; k < checkInterval_; ++k) {
+      cl::Kernel& kernel = (k + 1 == checkInterval_) ? kernels.sweepResidual
+                                                     : kernels.sweep;
+      result = kernel.setArg(0, deviceU_[current]);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+      result = kernel.setArg(1, deviceU_[1-current]);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+      result = kernel.setArg(2, deviceF_);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+      result = kernel.setArg(3, Pitch_);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+
+      result = queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalSize,
+                                          localSize, 0, NULL);
+      assert(result == CL_SUCCESS && "Failed to launch kernel");
+      current = 1 - current;
+    }
+    iterations += checkInterval_;
+
+    result = kernels.reduce.setArg(3, slot);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+    result = queue.enqueueNDRangeKernel(kernels.reduce, cl::NullRange,
+                                        cl::NDRange(REDUCE_SIZE),
+                                        cl::NDRange(REDUCE_SIZE), 0, NULL);
+    assert(result == CL_SUCCESS && "Failed to launch kernel");
+    result = queue.enqueueReadBuffer(deviceResidual_, CL_FALSE,
+                                     slot*sizeof(float), sizeof(float),
+                                     &hostSums[slot], NULL, &readEvents[slot]);
+    assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+    queue.flush();
+
+    if(pending) {
+      readEvents[1-slot].wait();
+      residual = sqrt((double)hostSums[1-slot]) / rhsNorm_;
+      converged = residual < target_;
+      checked = iterations - checkInterval_;
+    }
+    pending = true;
+    slot = 1 - slot;
+  }
+
+  if(!converged) {
+    readEvents[1-slot].wait();
+    residual = sqrt((double)hostSums[1-slot]) / rhsNorm_;
+    checked = iterations;
+  }
+
+  queue.finish();
+
+  deviceResult_.resize(ArraySize_);
+  result = queue.enqueueReadBuffer(deviceU_[current], CL_TRUE, 0,
+                                   ArraySize_*sizeof(float),
+                                   &deviceResult_[0], NULL, NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+
+  // The last batch of sweeps ran while the converged check was in flight
+  std::cout << "Converged At:         " << checked << " iterations\n";
+  return iterations;
+}
+
+double JacobiSample::hostResidual(const std::vector<float>& u) {
+  double sum = 0.0;
+
+  for(unsigned int y = 1; y <= ProblemSize_; ++y) {
+    for(unsigned int x = 1; x <= ProblemSize_; ++x) {
+      unsigned int i = y*Pitch_+x;
+      double r = hostF_[i] + u[i-1] + u[i+1] + u[i-Pitch_] + u[i+Pitch_]
+        - 4.0 * u[i];
+      sum += r * r;
+    }
+  }
+  return sqrt(sum) / rhsNorm_;
+}
+
+/**
+ * Estimates the relative residual of the solution rounded to float.  Each
+ * point's rounding error is uniform within half an ulp, and the residual
+ * at a point combines its own error four times and those of its four
+ * neighbours once, for a variance of 20 ulp^2 / 12.  The continuous
+ * solution stands in for the discrete one, which differs by O(h^2).
+ */
+double JacobiSample::residualFloor() {
+  double h   = 1.0 / (ProblemSize_ + 1);
+  double sum = 0.0;
+
+  for(unsigned int y = 1; y <= ProblemSize_; ++y) {
+    for(unsigned int x = 1; x <= ProblemSize_; ++x) {
+      int    exponent;
+      double u = sin(M_PI * x * h) * sin(M_PI * y * h);
+      frexp(u, &exponent);
+      double ulp = ldexp(1.0, exponent - 24);
+      sum += 20.0 / 12.0 * ulp * ulp;
+    }
+  }
+  return sqrt(sum) / rhsNorm_;
+}
+
+unsigned JacobiSample::solveHost(double& residual) {
+  std::vector<float> u[2];
+  unsigned current    = 0;
+  unsigned iterations = 0;
+
+  u[0].assign(ArraySize_, 0.0f);
+  u[1].assign(ArraySize_, 0.0f);
+  residual = 0.0;
+
+  while(iterations < maxIterations_) {
+    const float* in  = &u[current][0];
+    float*       out = &u[1-current][0];
+    bool         check = ((iterations + 1) % checkInterval_ == 0);
+    double       sum = 0.0;
+
+    for(unsigned int y = 1; y <= ProblemSize_; ++y) {
+      for(unsigned int x = 1; x <= ProblemSize_; ++x) {
+        unsigned int i = y*Pitch_+x;
+        float value = 0.25f * (in[i-1] + in[i+1] + in[i-Pitch_] +
+                               in[i+Pitch_] + hostF_[i]);
+        if(check) {
+          double r = (double)hostF_[i] + in[i-1] + in[i+1] + in[i-Pitch_]
+            + in[i+Pitch_] - 4.0 * in[i];
+          sum += r * r;
+        }
+        out[i] = value;
+      }
+    }
+    current = 1 - current;
+    ++iterations;
+
+    if(check) {
+      residual = sqrt(sum) / rhsNorm_;
+      if(residual < target_) {
+        break;
+      }
+    }
+  }
+
+  hostU_.swap(u[current]);
+  return iterations;
+}
+
+void JacobiSample::report(unsigned iterations, double residual,
+                          double elapsed) {
+  std::cout << "Iterations:           " << iterations << "\n";
+  std::cout << "Relative Residual:    " << residual << "\n";
+  std::cout << "Time to Solution:     " << elapsed << " sec\n";
+  std::cout << "Iterations per Sec:   " << iterations / elapsed << "\n";
+  std::cout << "Updates per Sec:      "
+            << (double)iterations * ProblemSize_ * ProblemSize_ / elapsed
+            << "\n";
+}
+
+void JacobiSample::run() {
+  initialize();
+  createMemoryBuffers();
+
+  std::cout << "Problem Size:         " << ProblemSize_ << " x "
+            << ProblemSize_ << "\n";
+  std::cout << "Check Interval:       " << checkInterval_ << " sweeps\n";
+  std::cout << "Tolerance:            " << tolerance_ << "\n";
+  std::cout << "Float Residual Floor: " << residualFloor() << "\n";
+  std::cout << "Target Residual:      " << target_ << "\n";
+
+  std::cout << "------------------------------\n";
+  std::cout << "* Host Solver\n";
+  std::cout << "------------------------------\n";
+  double hostRes;
+  double start = getTimeStamp();
+  unsigned hostIterations = solveHost(hostRes);
+  double hostTime = getTimeStamp() - start;
+  report(hostIterations, hostRes, hostTime);
+
+  SolverKernels* kernels[2] = { &kernelsCL_, &kernelsPTX_ };
+  const char*    names[2]   = { "Source", "Binary" };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    double residual;
+
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernel\n";
+    std::cout << "------------------------------\n";
+
+    start = getTimeStamp();
+    unsigned iterations = solveDevice(*kernels[k], residual);
+    double elapsed = getTimeStamp() - start;
+
+    // Check the device solution independently of the device reduction
+    double checkRes = hostResidual(deviceResult_);
+    if(checkRes < target_ && residual < target_) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+    std::cout << "Host-Side Residual:   " << checkRes << "\n";
+
+    report(iterations, residual, elapsed);
+    std::cout << "Speedup vs Host:      " << hostTime / elapsed << "x\n";
+  }
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --size N            Interior grid points per side "
+               "(default 256)\n"
+            << "  --check K           Sweeps between convergence checks "
+               "(default 64)\n"
+            << "  --tolerance T       Relative residual to stop at, raised "
+               "to what float\n"
+            << "                      Jacobi can reach (default 1e-4)\n"
+            << "  --max-iterations N  Iteration limit (default 1000000)\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  JacobiSample sample;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--size" && i+1 < argc) {
+      sample.setProblemSize(atoi(argv[++i]));
+    } else if(arg == "--check" && i+1 < argc) {
+      sample.setCheckInterval(atoi(argv[++i]));
+    } else if(arg == "--tolerance" && i+1 < argc) {
+      sample.setTolerance((float)atof(argv[++i]));
+    } else if(arg == "--max-iterations" && i+1 < argc) {
+      sample.setMaxIterations(atoi(argv[++i]));
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sample.run();
+
+  return 0;
+}
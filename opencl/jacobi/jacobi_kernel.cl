@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+// These must match BLOCK_SIZE and REDUCE_SIZE in jacobi.cpp
+#define BLOCK_SIZE  16
+#define REDUCE_SIZE 256
+
+#define ACCESS(buffer,y,x) (buffer[(y)*width+(x)])
+
+/**
+ * One Jacobi sweep for the 2D Poisson problem -Laplace(u) = f on a grid
+ * with a one point zero border.  The right-hand side is pre-scaled by h^2.
+ */
+__kernel
+void jacobi(__global float* u, __global float* unew, __global float* f,
+            uint width) {
+
+  // Add 1 to account for padding
+  int x = get_global_id(0)+1;
+  int y = get_global_id(1)+1;
+
+  ACCESS(unew, y, x) = 0.25f * (ACCESS(u, y,   x-1) + ACCESS(u, y,   x+1) +
+                                ACCESS(u, y-1, x  ) + ACCESS(u, y+1, x  ) +
+                                ACCESS(f, y,   x  ));
+}
+
+/**
+ * Jacobi sweep that also reduces the squared residual of the input iterate
+ * over each work-group, from the loads the sweep makes anyway.  The
+ * residual is summed from the differences to the neighbours, which are
+ * exact in float for a smooth u, so it stays accurate long after
+ * f + (sum of neighbours) - 4u has been lost to cancellation.
+ */
+__kernel
+void jacobi_residual(__global float* u, __global float* unew,
+                     __global float* f, uint width,
+                     __global float* partial) {
+
+  __local float scratch[BLOCK_SIZE*BLOCK_SIZE];
+
+  // Add 1 to account for padding
+  int x = get_global_id(0)+1;
+  int y = get_global_id(1)+1;
+
+  float old   = ACCESS(u, y, x);
+  float value = 0.25f * (ACCESS(u, y,   x-1) + ACCESS(u, y,   x+1) +
+                         ACCESS(u, y-1, x  ) + ACCESS(u, y+1, x  ) +
+                         ACCESS(f, y,   x  ));
+  float r     = ACCESS(f, y, x) +
+                ((ACCESS(u, y,   x-1) - old) + (ACCESS(u, y,   x+1) - old)) +
+                ((ACCESS(u, y-1, x  ) - old) + (ACCESS(u, y+1, x  ) - old));
+
+  ACCESS(unew, y, x) = value;
+
+  int tid = get_local_id(1)*BLOCK_SIZE + get_local_id(0);
+  int s;
+
+  scratch[tid] = r * r;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(s = BLOCK_SIZE*BLOCK_SIZE/2; s > 0; s >>= 1) {
+    if(tid < s) {
+      scratch[tid] += scratch[tid + s];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  if(tid == 0) {
+    partial[get_group_id(1)*get_num_groups(0) + get_group_id(0)] =
+      scratch[0];
+  }
+}
+
+/**
+ * Sums the per-group partials into result[slot] with a single work-group.
+ */
+__kernel
+void reduce_partials(__global float* partial, __global float* result,
+                     uint count, uint slot) {
+
+  __local float scratch[REDUCE_SIZE];
+
+  int  tid = get_local_id(0);
+  uint i;
+  int  s;
+  float sum = 0.0f;
+
+  for(i = tid; i < count; i += REDUCE_SIZE) {
+    sum += partial[i];
+  }
+
+  scratch[tid] = sum;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(s = REDUCE_SIZE/2; s > 0; s >>= 1) {
+    if(tid < s) {
+      scratch[tid] += scratch[tid + s];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  if(tid == 0) {
+    result[slot] = scratch[0];
+  }
+}
@@ -0,0 +1,370 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "common/OCLSample.hpp"
+
+// These must be changed to reflect changes in monte-carlo_kernel.cl
+#define BLOCK_SIZE     256
+#define PATHS_PER_ITEM 256
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+// Paths are handed out a work-group at a time
+#define PATHS_PER_GROUP (BLOCK_SIZE * PATHS_PER_ITEM)
+
+// The option: a one-year at-the-money European call
+#define SPOT       100.0
+#define STRIKE     100.0
+#define RATE       0.05
+#define VOLATILITY 0.2
+#define MATURITY   1.0
+
+// Key of the generator
+#define SEED0 0x243f6a88u
+#define SEED1 0x85a308d3u
+
+/**
+ * Estimates the price of a European call under Black-Scholes by Monte Carlo,
+ * with a Philox4x32-10 counter-based generator on the device, for both the
+ * source and the binary program.  Each work-item draws its own stream by
+ * counter, and the payoffs are summed on the device.  A kernel that only
+ * sums uniforms measures the generator alone.  Both sums are checked
+ * against the same generator run on the host, and the rates are reported in
+ * samples per second.
+ */
+class MonteCarloSample : public OCLSample {
+public:
+
+  MonteCarloSample();
+
+  virtual void run();
+
+  void setNumPaths(unsigned int paths) {
+    assert(paths > 0 && paths % PATHS_PER_GROUP == 0 &&
+           "Number of paths must be a positive multiple of 65536");
+    NumPaths_ = paths;
+  }
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+
+private:
+
+  double launch(cl::Kernel& kernel, cl::Kernel& reduce);
+  bool runKernels(cl::Program& program);
+
+  cl::Program programCL_;
+  cl::Program programPTX_;
+
+  cl::Buffer  devicePartials_;
+  cl::Buffer  deviceResult_;
+
+  // Sums of the uniforms, and of the payoffs, and of their squares
+  double      hostUniforms_[2];
+  double      hostPayoffs_[2];
+
+  unsigned int NumPaths_;
+};
+
+
+/**
+ * Philox4x32-10, as in monte-carlo_kernel.cl.
+ */
+static void philox4x32_10(cl_uint* ctr, cl_uint k0, cl_uint k1) {
+  for(unsigned r = 0; r < 10; ++r) {
+    cl_ulong p0 = (cl_ulong)PHILOX_M0 * ctr[0];
+    cl_ulong p1 = (cl_ulong)PHILOX_M1 * ctr[2];
+
+    ctr[0] = (cl_uint)(p1 >> 32) ^ ctr[1] ^ k0;
+    ctr[1] = (cl_uint)p1;
+    ctr[2] = (cl_uint)(p0 >> 32) ^ ctr[3] ^ k1;
+    ctr[3] = (cl_uint)p0;
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+}
+
+/**
+ * The known-answer test of the Random123 distribution.  The host reference
+ * sums are only as good as the host generator, so a mismatch fails the
+ * sample.
+ */
+static bool checkKnownAnswers() {
+  cl_uint zeros[4] = { 0, 0, 0, 0 };
+  cl_uint ones[4]  = { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff };
+  philox4x32_10(zeros, 0, 0);
+  philox4x32_10(ones, 0xffffffff, 0xffffffff);
+  return zeros[0] == 0x6627e8d5 && zeros[1] == 0xe169c58d &&
+         zeros[2] == 0xbc57ac4c && zeros[3] == 0x9b00dbd8 &&
+         ones[0] == 0x408f276d && ones[1] == 0x41c83b0e &&
+         ones[2] == 0xa20bc7c6 && ones[3] == 0x6d5451fd;
+}
+
+static float toUniform(cl_uint x) {
+  return ((x >> 9) + 0.5f) * (1.0f / 8388608.0f);
+}
+
+MonteCarloSample::MonteCarloSample()
+: NumPaths_(1 << 24) {
+}
+
+void MonteCarloSample::initialize() {
+  programCL_ = compileSource("monte-carlo_kernel.cl");
+  programPTX_ = loadBinary("monte-carlo_kernel.ptx");
+
+  // For this sample, let's run 16 iterations
+  setNumberOfIterations(16);
+}
+
+/**
+ * Runs both kernels' streams on the host.  The uniforms are the ones the
+ * device converts, so only the float math of the payoffs differs.
+ */
+void MonteCarloSample::createMemoryBuffers() {
+  cl_int result;
+  size_t numItems = NumPaths_ / PATHS_PER_ITEM;
+  size_t numGroups = NumPaths_ / PATHS_PER_GROUP;
+  double drift = (RATE - 0.5 * VOLATILITY * VOLATILITY) * MATURITY;
+  double vol   = VOLATILITY * std::sqrt(MATURITY);
+
+  std::fill(hostUniforms_, hostUniforms_ + 2, 0.0);
+  std::fill(hostPayoffs_, hostPayoffs_ + 2, 0.0);
+  for(size_t item = 0; item < numItems; ++item) {
+    for(cl_uint i = 0; i < PATHS_PER_ITEM / 4; ++i) {
+      cl_uint x[4] = { i, (cl_uint)item, 0, 0 };
+      philox4x32_10(x, SEED0, SEED1);
+
+      for(unsigned j = 0; j < 4; ++j) {
+        double u = toUniform(x[j]);
+        hostUniforms_[0] += u;
+        hostUniforms_[1] += u * u;
+      }
+      for(unsigned j = 0; j < 4; j += 2) {
+        double radius = std::sqrt(-2.0 * std::log((double)toUniform(x[j])));
+        double theta  = 2.0 * M_PI * toUniform(x[j + 1]);
+        double z[2]   = { radius * std::cos(theta), radius * std::sin(theta) };
+        for(unsigned k = 0; k < 2; ++k) {
+          double payoff = std::max(SPOT * std::exp(drift + vol * z[k])
+                                   - STRIKE, 0.0);
+          hostPayoffs_[0] += payoff;
+          hostPayoffs_[1] += payoff * payoff;
+        }
+      }
+    }
+  }
+
+  devicePartials_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                               2*numGroups*sizeof(float), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceResult_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                             2*sizeof(float), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+}
+
+/**
+ * Runs a generating kernel and the reduction of its partials, and returns
+ * the time from the start of one to the end of the other.
+ */
+double MonteCarloSample::launch(cl::Kernel& kernel, cl::Kernel& reduce) {
+  cl_int      result;
+  cl::Event   first, last;
+  cl::NDRange global(NumPaths_ / PATHS_PER_ITEM);
+  cl::NDRange local(BLOCK_SIZE);
+
+  result = getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange,
+                                                  global, local, NULL,
+                                                  &first);
+  assert(result == CL_SUCCESS && "Failed to launch kernel");
+  result = getCommandQueue().enqueueNDRangeKernel(reduce, cl::NullRange,
+                                                  local, local, NULL,
+                                                  &last);
+  assert(result == CL_SUCCESS && "Failed to launch kernel");
+  return getElapsed(first, last);
+}
+
+bool MonteCarloSample::runKernels(cl::Program& program) {
+  cl_int  result;
+  bool    passed   = true;
+  cl_uint numGroups = NumPaths_ / PATHS_PER_GROUP;
+  float   drift    = (float)((RATE - 0.5 * VOLATILITY * VOLATILITY)
+                             * MATURITY);
+  float   vol      = (float)(VOLATILITY * std::sqrt(MATURITY));
+
+  cl::Kernel uniforms(program, "sum_uniforms", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  result = uniforms.setArg(0, devicePartials_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = uniforms.setArg(1, (cl_uint)SEED0);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = uniforms.setArg(2, (cl_uint)SEED1);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+
+  cl::Kernel option(program, "price_option", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  result = option.setArg(0, devicePartials_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = option.setArg(1, (cl_float)SPOT);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = option.setArg(2, (cl_float)STRIKE);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = option.setArg(3, drift);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+  result = option.setArg(4, vol);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 4");
+  result = option.setArg(5, (cl_uint)SEED0);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 5");
+  result = option.setArg(6, (cl_uint)SEED1);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 6");
+
+  cl::Kernel reduce(program, "reduce_partials", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  result = reduce.setArg(0, devicePartials_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = reduce.setArg(1, deviceResult_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = reduce.setArg(2, numGroups);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+
+  std::cout << std::setw(10) << "kernel" << std::setw(12) << "median ms"
+            << std::setw(12) << "Gsamples/s" << std::setw(12) << "mean"
+            << std::setw(12) << "host" << "\n";
+
+  cl::Kernel* kernels[2]  = { &uniforms, &option };
+  const char* names[2]    = { "uniform", "option" };
+  double*     expected[2] = { hostUniforms_, hostPayoffs_ };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    // The first launch is a warm-up
+    std::vector<double> times;
+    launch(*kernels[k], reduce);
+    for(unsigned i = 0; i < getNumberOfIterations(); ++i) {
+      times.push_back(launch(*kernels[k], reduce));
+    }
+
+    float sums[2];
+    result = getCommandQueue().enqueueReadBuffer(deviceResult_, CL_TRUE, 0,
+                                                 2*sizeof(float), sums, NULL,
+                                                 NULL);
+    assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+
+    // The device sums in float, and its exp, log, sin and cos differ from
+    // the host's by a few ulps
+    double mean    = sums[0] / NumPaths_;
+    double hostMean = expected[k][0] / NumPaths_;
+    bool   correct = std::fabs(mean - hostMean) <= 1e-4 * hostMean &&
+                     std::fabs(sums[1] - expected[k][1])
+                     <= 1e-4 * expected[k][1];
+    passed = passed && correct;
+
+    double time = median(times);
+
+    std::cout << std::setw(10) << names[k] << std::fixed
+              << std::setprecision(3) << std::setw(12) << time * 1e3
+              << std::setw(12) << NumPaths_ / time / 1e9
+              << std::setprecision(6) << std::setw(12) << mean
+              << std::setw(12) << hostMean << (correct ? "" : "  FAILED")
+              << "\n";
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+  }
+
+  // The discounted mean payoff, its standard error, and the closed form
+  double discount = std::exp(-RATE * MATURITY);
+  double mean     = hostPayoffs_[0] / NumPaths_;
+  double variance = hostPayoffs_[1] / NumPaths_ - mean * mean;
+  double d1       = (std::log(SPOT / STRIKE)
+                     + (RATE + 0.5 * VOLATILITY * VOLATILITY) * MATURITY)
+                    / (VOLATILITY * std::sqrt(MATURITY));
+  double d2       = d1 - VOLATILITY * std::sqrt(MATURITY);
+  double exact    = SPOT * 0.5 * erfc(-d1 / M_SQRT2)
+                    - STRIKE * discount * 0.5 * erfc(-d2 / M_SQRT2);
+
+  std::cout << "Call price:           " << discount * mean << " +/- "
+            << discount * std::sqrt(variance / NumPaths_)
+            << " (Black-Scholes " << exact << ")\n";
+
+  return passed;
+}
+
+void MonteCarloSample::run() {
+  initialize();
+  createMemoryBuffers();
+
+  bool generatorCorrect = checkKnownAnswers();
+
+  std::cout << "Paths:                " << NumPaths_ << "\n";
+  std::cout << "Philox4x32-10 known-answer test "
+            << (generatorCorrect ? "PASSED" : "FAILED") << "\n";
+
+  cl::Program* programs[2] = { &programCL_, &programPTX_ };
+  const char*  names[2]    = { "Source", "Binary" };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernels\n";
+    std::cout << "------------------------------\n";
+
+    if(runKernels(*programs[k]) && generatorCorrect) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+  }
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --paths N           Paths per estimate, a multiple of "
+            << PATHS_PER_GROUP << " (default 16M)\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  MonteCarloSample sample;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--paths" && i+1 < argc) {
+      sample.setNumPaths(atoi(argv[++i]));
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sample.run();
+
+  return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+// These must match monte-carlo.cpp
+#define BLOCK_SIZE     256
+#define PATHS_PER_ITEM 256
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+#define TWO_PI 6.28318530717958647692f
+
+/**
+ * Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2,
+ * 3"): ten rounds of two 32x32->64-bit multiplies, keyed by (k0, k1),
+ * replace the four words of ctr with four random ones.  The output depends
+ * only on the counter and key, so work-item gid draws block i of its
+ * stream by encrypting (i, gid, 0, 0), with no state kept in memory.
+ */
+inline void philox4x32_10(uint* ctr, uint k0, uint k1) {
+  uint r;
+
+  for(r = 0; r < 10; ++r) {
+    uint hi0 = mul_hi(PHILOX_M0, ctr[0]);
+    uint lo0 = PHILOX_M0 * ctr[0];
+    uint hi1 = mul_hi(PHILOX_M1, ctr[2]);
+    uint lo1 = PHILOX_M1 * ctr[2];
+
+    ctr[0] = hi1 ^ ctr[1] ^ k0;
+    ctr[1] = lo1;
+    ctr[2] = hi0 ^ ctr[3] ^ k1;
+    ctr[3] = lo0;
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+}
+
+/**
+ * The top 23 bits of x as a float strictly inside (0, 1), so its log is
+ * finite and nonzero: the largest value, 1 - 2^-24, is exact in a float.
+ */
+inline float to_uniform(uint x) {
+  return ((x >> 9) + 0.5f) * (1.0f / 8388608.0f);
+}
+
+/**
+ * Sums a value and its square over the work-group, and stores both to
+ * out[2 * group] and out[2 * group + 1].  scratch holds 2 * BLOCK_SIZE
+ * floats.
+ */
+inline void store_group_sums(__global float* out, float sum, float squares,
+                             __local float* scratch) {
+  uint tid = get_local_id(0);
+  uint s;
+
+  scratch[tid]              = sum;
+  scratch[BLOCK_SIZE + tid] = squares;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(s = BLOCK_SIZE / 2; s > 0; s >>= 1) {
+    if(tid < s) {
+      scratch[tid]              += scratch[tid + s];
+      scratch[BLOCK_SIZE + tid] += scratch[BLOCK_SIZE + tid + s];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  if(tid == 0) {
+    out[2 * get_group_id(0)]     = scratch[0];
+    out[2 * get_group_id(0) + 1] = scratch[BLOCK_SIZE];
+  }
+}
+
+/**
+ * The generator alone: PATHS_PER_ITEM uniforms per work-item, and the sums
+ * of them and their squares per work-group.
+ */
+__kernel void sum_uniforms(__global float* partials, uint seed0,
+                           uint seed1) {
+  __local float scratch[2 * BLOCK_SIZE];
+  float sum = 0.0f, squares = 0.0f;
+  uint  i, j;
+
+  for(i = 0; i < PATHS_PER_ITEM / 4; ++i) {
+    uint x[4];
+    x[0] = i;
+    x[1] = get_global_id(0);
+    x[2] = 0;
+    x[3] = 0;
+    philox4x32_10(x, seed0, seed1);
+
+    for(j = 0; j < 4; ++j) {
+      float u = to_uniform(x[j]);
+      sum     += u;
+      squares += u * u;
+    }
+  }
+
+  store_group_sums(partials, sum, squares, scratch);
+}
+
+/**
+ * Undiscounted payoff of a European call whose underlying ends at
+ * S0 exp(drift + vol z).
+ */
+inline float call_payoff(float S0, float strike, float drift, float vol,
+                         float z) {
+  return max(S0 * exp(drift + vol * z) - strike, 0.0f);
+}
+
+/**
+ * PATHS_PER_ITEM paths of geometric Brownian motion per work-item, from
+ * normals made by Box-Muller, and the sums of the payoffs and their squares
+ * per work-group.  drift is (r - sigma^2 / 2) T and vol sigma sqrt(T).
+ */
+__kernel void price_option(__global float* partials, float S0, float strike,
+                           float drift, float vol, uint seed0, uint seed1) {
+  __local float scratch[2 * BLOCK_SIZE];
+  float sum = 0.0f, squares = 0.0f;
+  uint  i, j;
+
+  for(i = 0; i < PATHS_PER_ITEM / 4; ++i) {
+    uint x[4];
+    x[0] = i;
+    x[1] = get_global_id(0);
+    x[2] = 0;
+    x[3] = 0;
+    philox4x32_10(x, seed0, seed1);
+
+    for(j = 0; j < 4; j += 2) {
+      float radius = sqrt(-2.0f * log(to_uniform(x[j])));
+      float theta  = TWO_PI * to_uniform(x[j + 1]);
+      float p0     = call_payoff(S0, strike, drift, vol, radius * cos(theta));
+      float p1     = call_payoff(S0, strike, drift, vol, radius * sin(theta));
+      sum     += p0 + p1;
+      squares += p0 * p0 + p1 * p1;
+    }
+  }
+
+  store_group_sums(partials, sum, squares, scratch);
+}
+
+/**
+ * Second pass, a single work-group: sums the numGroups pairs of partials
+ * into result[0] and result[1].
+ */
+__kernel void reduce_partials(__global const float* partials,
+                              __global float* result, uint numGroups) {
+  __local float scratch[2 * BLOCK_SIZE];
+  float sum = 0.0f, squares = 0.0f;
+  uint  g;
+
+  for(g = get_local_id(0); g < numGroups; g += BLOCK_SIZE) {
+    sum     += partials[2 * g];
+    squares += partials[2 * g + 1];
+  }
+
+  store_group_sums(result, sum, squares, scratch);
+}
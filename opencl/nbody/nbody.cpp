@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "common/OCLSample.hpp"
+
+// This must be changed to reflect changes in nbody_kernel.cl
+#define BLOCK_SIZE 256
+
+// Unroll factor the PTX was built with; see CMakeLists.txt
+#if !defined(BINARY_UNROLL)
+#define BINARY_UNROLL 4
+#endif
+
+// By the usual convention for this kernel, an interaction costs 20 flops
+#define FLOPS_PER_INTERACTION 20
+
+/**
+ * All-pairs gravitational N-body simulation, run for a number of time steps
+ * with positions ping-ponging between two buffers, for both the source and
+ * the binary program.  The first step is checked against the host, and the
+ * rest report interactions per second.
+ */
+class NBodySample : public OCLSample {
+public:
+
+  NBodySample();
+
+  virtual void run();
+
+  void setNumBodies(unsigned int bodies) {
+    assert(bodies > 0 && "Number of bodies must be positive");
+    NumBodies_ = bodies;
+  }
+
+  void setNumSteps(unsigned int steps) {
+    assert(steps > 0 && "Number of steps must be positive");
+    NumSteps_ = steps;
+  }
+
+  void setUnroll(unsigned int unroll) {
+    assert(unroll > 0 && BLOCK_SIZE % unroll == 0
+           && "Unroll factor must divide the work-group size");
+    Unroll_ = unroll;
+  }
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+
+private:
+
+  void resetBodies();
+  double step(cl::Kernel& kernel, unsigned int s);
+  bool checkFirstStep(cl::Kernel& kernel);
+  bool runProgram(cl::Program& program);
+
+  cl::Program programCL_;
+  cl::Program programPTX_;
+
+  cl::Buffer  devicePos_[2];
+  cl::Buffer  deviceVel_;
+
+  std::vector<cl_float4> hostPos_;
+  std::vector<cl_float4> hostVel_;
+
+  unsigned int NumBodies_;
+  unsigned int NumSteps_;
+  unsigned int Unroll_;
+  float        TimeStep_;
+  float        Softening_;
+};
+
+
+NBodySample::NBodySample()
+: NumBodies_(16384), NumSteps_(10), Unroll_(BINARY_UNROLL),
+  TimeStep_(0.001f), Softening_(0.01f) {
+}
+
+void NBodySample::initialize() {
+  std::ostringstream options;
+  options << "-DUNROLL=" << Unroll_;
+
+  programCL_ = compileSource("nbody_kernel.cl", options.str());
+  programPTX_ = loadBinary("nbody_kernel.ptx");
+}
+
+void NBodySample::createMemoryBuffers() {
+  cl_int result;
+  size_t bytes = NumBodies_*sizeof(cl_float4);
+
+  // A unit of mass spread over a cube, with small random velocities
+  srand(12345);
+  hostPos_.resize(NumBodies_);
+  hostVel_.resize(NumBodies_);
+  for(unsigned int i = 0; i < NumBodies_; ++i) {
+    for(int c = 0; c < 3; ++c) {
+      hostPos_[i].s[c] = 2.0f * rand() / ((float)RAND_MAX + 1.0f) - 1.0f;
+      hostVel_[i].s[c] = 0.2f * rand() / ((float)RAND_MAX + 1.0f) - 0.1f;
+    }
+    hostPos_[i].s[3] = 1.0f / NumBodies_;
+    hostVel_[i].s[3] = 0.0f;
+  }
+
+  for(int b = 0; b < 2; ++b) {
+    devicePos_[b] = cl::Buffer(getContext(), CL_MEM_READ_WRITE, bytes, NULL,
+                               &result);
+    assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  }
+  deviceVel_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE, bytes, NULL,
+                          &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+}
+
+void NBodySample::resetBodies() {
+  cl_int result;
+  size_t bytes = NumBodies_*sizeof(cl_float4);
+
+  result = getCommandQueue().enqueueWriteBuffer(devicePos_[0], CL_TRUE, 0,
+                                                bytes, &hostPos_[0], NULL,
+                                                NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+  result = getCommandQueue().enqueueWriteBuffer(deviceVel_, CL_TRUE, 0,
+                                                bytes, &hostVel_[0], NULL,
+                                                NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+}
+
+double NBodySample::step(cl::Kernel& kernel, unsigned int s) {
+  cl_int      result;
+  cl::Event   event;
+  cl::NDRange global((NumBodies_ + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE);
+  cl::NDRange local(BLOCK_SIZE);
+
+  // Step s reads the positions step s-1 wrote
+  result = kernel.setArg(0, devicePos_[s % 2]);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernel.setArg(1, devicePos_[(s + 1) % 2]);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+
+  result = getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange,
+                                                  global, local, NULL,
+                                                  &event);
+  assert(result == CL_SUCCESS && "Failed to launch kernel");
+  return getElapsed(event, event);
+}
+
+bool NBodySample::checkFirstStep(cl::Kernel& kernel) {
+  cl_int                 result;
+  size_t                 bytes = NumBodies_*sizeof(cl_float4);
+  std::vector<cl_float4> pos(NumBodies_);
+  std::vector<cl_float4> vel(NumBodies_);
+  double                 dt    = TimeStep_;
+
+  resetBodies();
+  step(kernel, 0);
+
+  result = getCommandQueue().enqueueReadBuffer(devicePos_[1], CL_TRUE, 0,
+                                               bytes, &pos[0], NULL, NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+  result = getCommandQueue().enqueueReadBuffer(deviceVel_, CL_TRUE, 0,
+                                               bytes, &vel[0], NULL, NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+
+  for(unsigned int i = 0; i < NumBodies_; ++i) {
+    const cl_float4& bi = hostPos_[i];
+    double           acc[3]    = { 0.0, 0.0, 0.0 };
+    double           magnitude = 0.0;
+
+    for(unsigned int j = 0; j < NumBodies_; ++j) {
+      const cl_float4& bj = hostPos_[j];
+      double r[3]  = { bj.s[0] - bi.s[0], bj.s[1] - bi.s[1],
+                       bj.s[2] - bi.s[2] };
+      double dist2 = r[0]*r[0] + r[1]*r[1] + r[2]*r[2] + Softening_;
+      double s     = bj.s[3] / (dist2 * std::sqrt(dist2));
+      for(int c = 0; c < 3; ++c) {
+        acc[c] += r[c] * s;
+      }
+      magnitude += std::sqrt(dist2) * s;
+    }
+
+    // The accelerations are float sums of thousands of terms
+    for(int c = 0; c < 3; ++c) {
+      double v     = hostVel_[i].s[c] + acc[c] * dt;
+      double p     = bi.s[c] + v * dt;
+      double error = 1e-4 * (std::fabs(hostVel_[i].s[c]) + magnitude * dt);
+      if(std::fabs(vel[i].s[c] - v) > error
+         || std::fabs(pos[i].s[c] - p) > 1e-6 + error * dt) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool NBodySample::runProgram(cl::Program& program) {
+  cl_int     result;
+  cl::Kernel kernel(program, "nbody_step", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+
+  result = kernel.setArg(2, deviceVel_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = kernel.setArg(3, (cl_uint)NumBodies_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+  result = kernel.setArg(4, TimeStep_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 4");
+  result = kernel.setArg(5, Softening_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 5");
+
+  // The checked step doubles as the warm-up
+  bool passed = checkFirstStep(kernel);
+
+  std::vector<double> times;
+  resetBodies();
+  for(unsigned int s = 0; s < NumSteps_; ++s) {
+    times.push_back(step(kernel, s));
+  }
+
+  double total        = 0.0;
+  double interactions = (double)NumBodies_ * NumBodies_;
+  for(size_t s = 0; s < times.size(); ++s) {
+    total += times[s];
+  }
+
+  std::cout << "Total (ms):           " << total * 1e3 << "\n";
+  std::cout << "Median step (ms):     " << median(times) * 1e3 << "\n";
+  std::cout << "GInteractions/s:      "
+            << interactions * NumSteps_ / total / 1e9 << "\n";
+  std::cout << "GFLOP/s:              " << FLOPS_PER_INTERACTION
+               * interactions * NumSteps_ / total / 1e9 << "\n";
+
+  return passed;
+}
+
+void NBodySample::run() {
+  initialize();
+  createMemoryBuffers();
+
+  std::cout << "Bodies:               " << NumBodies_ << "\n";
+  std::cout << "Steps:                " << NumSteps_ << "\n";
+
+  cl::Program* programs[2] = { &programCL_, &programPTX_ };
+  const char*  names[2]    = { "Source", "Binary" };
+  unsigned int unrolls[2]  = { Unroll_, BINARY_UNROLL };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernels (UNROLL=" << unrolls[k]
+              << ")\n";
+    std::cout << "------------------------------\n";
+
+    if(runProgram(*programs[k])) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+  }
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --bodies N          Bodies to simulate (default 16384)\n"
+            << "  --steps N           Time steps to run (default 10)\n"
+            << "  --unroll N          Unroll factor of the program built "
+               "from source\n"
+            << "                      (default " << BINARY_UNROLL
+            << ", as the PTX)\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  NBodySample sample;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--bodies" && i+1 < argc) {
+      sample.setNumBodies(atoi(argv[++i]));
+    } else if(arg == "--steps" && i+1 < argc) {
+      sample.setNumSteps(atoi(argv[++i]));
+    } else if(arg == "--unroll" && i+1 < argc) {
+      sample.setUnroll(atoi(argv[++i]));
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sample.run();
+
+  return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+// This must match BLOCK_SIZE in nbody.cpp
+#define BLOCK_SIZE 256
+
+// Unroll factor of the interaction loop.  The build sets this with
+// -DUNROLL=n; it must divide BLOCK_SIZE.
+#if !defined(UNROLL)
+#define UNROLL 4
+#endif
+
+#if BLOCK_SIZE % UNROLL != 0
+#error "UNROLL must divide BLOCK_SIZE"
+#endif
+
+// Bodies are float4s of position and mass (in w).  Velocities are float4s
+// whose w is unused.
+
+/**
+ * Adds the acceleration of body i due to body j to acc: the softened
+ * inverse-square law, with softening eps2 so that a body's interaction with
+ * itself, or with the zero-mass padding of the last tile, contributes
+ * nothing.  About 20 flops, one of them a reciprocal square root.
+ */
+inline float4 interact(float4 bi, float4 bj, float4 acc, float eps2) {
+  float4 r;
+  float  distSqr, invDist, s;
+
+  r.x = bj.x - bi.x;
+  r.y = bj.y - bi.y;
+  r.z = bj.z - bi.z;
+  r.w = 0.0f;
+
+  distSqr = r.x * r.x + r.y * r.y + r.z * r.z + eps2;
+  invDist = rsqrt(distSqr);
+  s       = bj.w * invDist * invDist * invDist;
+
+  return acc + r * s;
+}
+
+/**
+ * One time step of the all-pairs simulation, one work-item per body.  Each
+ * work-group stages BLOCK_SIZE bodies at a time in local memory, so every
+ * body is read from global memory once per work-group rather than once per
+ * work-item, and then integrates its own body with semi-implicit Euler.
+ * Positions ping-pong between posIn and posOut; velocities are updated in
+ * place.
+ */
+__kernel void nbody_step(__global const float4* posIn,
+                         __global float4* posOut, __global float4* vel,
+                         uint n, float dt, float eps2) {
+  __local float4 tile[BLOCK_SIZE];
+  uint   i   = get_global_id(0);
+  uint   tid = get_local_id(0);
+  float4 bi  = (i < n) ? posIn[i] : (float4)(0.0f);
+  float4 acc = (float4)(0.0f);
+  uint   base, j;
+
+  for(base = 0; base < n; base += BLOCK_SIZE) {
+    tile[tid] = (base + tid < n) ? posIn[base + tid] : (float4)(0.0f);
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+#pragma unroll UNROLL
+    for(j = 0; j < BLOCK_SIZE; ++j) {
+      acc = interact(bi, tile[j], acc, eps2);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  if(i < n) {
+    float4 v = vel[i] + acc * dt;
+    float4 p = bi + v * dt;
+
+    // Keep the mass
+    p.w = bi.w;
+
+    vel[i]    = v;
+    posOut[i] = p;
+  }
+}
@@ -0,0 +1,572 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+#include "common/OCLSample.hpp"
+
+// These must be changed to reflect changes in radix-sort_kernel.cl
+#define BLOCK_SIZE       256
+#define ITEMS_PER_THREAD 4
+#define TILE_SIZE        (BLOCK_SIZE * ITEMS_PER_THREAD)
+#define BLELLOCH_TILE    (2 * BLOCK_SIZE)
+#define RADIX_BITS       4
+#define RADIX            (1 << RADIX_BITS)
+
+
+//==--- Host Reference -----------------------------------------------------== //
+
+/**
+ * LSD radix sort on the host, eight bits per pass, spread over a number of
+ * threads: each thread counts the digits of its slice of the input, and
+ * after an exclusive scan in (digit, thread) order scatters its slice, so
+ * every pass is stable.
+ */
+template <typename Key>
+class HostRadixSort {
+public:
+
+  HostRadixSort(unsigned numThreads)
+  : numThreads_(numThreads), counts_(numThreads * 256) {
+  }
+
+  /**
+   * Sorts keys, and values (if not NULL) along with them.
+   */
+  void sort(std::vector<Key>& keys, std::vector<cl_uint>* values) {
+    std::vector<Key>     keysTemp(keys.size());
+    std::vector<cl_uint> valuesTemp(values != NULL ? values->size() : 0);
+
+    n_ = keys.size();
+    for(shift_ = 0; shift_ < 8 * sizeof(Key); shift_ += 8) {
+      keysIn_    = &keys[0];
+      keysOut_   = &keysTemp[0];
+      valuesIn_  = (values != NULL) ? &(*values)[0] : NULL;
+      valuesOut_ = (values != NULL) ? &valuesTemp[0] : NULL;
+
+      runThreads(countThread);
+
+      size_t offset = 0;
+      for(unsigned d = 0; d < 256; ++d) {
+        for(unsigned t = 0; t < numThreads_; ++t) {
+          size_t count = counts_[t * 256 + d];
+          counts_[t * 256 + d] = offset;
+          offset += count;
+        }
+      }
+
+      runThreads(scatterThread);
+
+      keys.swap(keysTemp);
+      if(values != NULL) {
+        values->swap(valuesTemp);
+      }
+    }
+  }
+
+private:
+
+  struct ThreadArgs {
+    HostRadixSort* sorter;
+    unsigned       thread;
+  };
+
+  /**
+   * Runs body once per slice in parallel.  Slices that no thread could be
+   * created for run on the calling thread.
+   */
+  void runThreads(void* (*body)(void*)) {
+    std::vector<pthread_t>  threads(numThreads_);
+    std::vector<ThreadArgs> args(numThreads_);
+    unsigned                numStarted = 0;
+
+    for(unsigned t = 0; t < numThreads_; ++t) {
+      args[t].sorter = this;
+      args[t].thread = t;
+      if(numStarted == t &&
+         pthread_create(&threads[t], NULL, body, &args[t]) == 0) {
+        ++numStarted;
+      }
+    }
+    for(unsigned t = numStarted; t < numThreads_; ++t) {
+      body(&args[t]);
+    }
+    for(unsigned t = 0; t < numStarted; ++t) {
+      pthread_join(threads[t], NULL);
+    }
+  }
+
+  void getSlice(unsigned thread, size_t& begin, size_t& end) const {
+    begin = n_ * thread / numThreads_;
+    end   = n_ * (thread + 1) / numThreads_;
+  }
+
+  static void* countThread(void* data) {
+    ThreadArgs*    args   = static_cast<ThreadArgs*>(data);
+    HostRadixSort* self   = args->sorter;
+    size_t*        counts = &self->counts_[args->thread * 256];
+    size_t         begin, end;
+
+    self->getSlice(args->thread, begin, end);
+    std::fill(counts, counts + 256, 0);
+    for(size_t i = begin; i < end; ++i) {
+      ++counts[(self->keysIn_[i] >> self->shift_) & 0xff];
+    }
+    return NULL;
+  }
+
+  static void* scatterThread(void* data) {
+    ThreadArgs*    args    = static_cast<ThreadArgs*>(data);
+    HostRadixSort* self    = args->sorter;
+    size_t*        offsets = &self->counts_[args->thread * 256];
+    size_t         begin, end;
+
+    self->getSlice(args->thread, begin, end);
+    for(size_t i = begin; i < end; ++i) {
+      size_t dst = offsets[(self->keysIn_[i] >> self->shift_) & 0xff]++;
+      self->keysOut_[dst] = self->keysIn_[i];
+      if(self->valuesIn_ != NULL) {
+        self->valuesOut_[dst] = self->valuesIn_[i];
+      }
+    }
+    return NULL;
+  }
+
+  unsigned            numThreads_;
+  std::vector<size_t> counts_;
+
+  // The current pass
+  size_t              n_;
+  unsigned            shift_;
+  const Key*          keysIn_;
+  Key*                keysOut_;
+  const cl_uint*      valuesIn_;
+  cl_uint*            valuesOut_;
+};
+
+
+//==--- Sample -------------------------------------------------------------== //
+
+enum Distribution {
+  DISTRIBUTION_UNIFORM,
+  DISTRIBUTION_SKEWED,
+  NUM_DISTRIBUTIONS
+};
+
+const char* kDistributionNames[NUM_DISTRIBUTIONS] = { "uniform", "skewed" };
+
+/**
+ * LSD radix sort of 32-bit and 64-bit keys, alone or with 32-bit values,
+ * four bits per pass.  Each pass builds a local-memory histogram per tile,
+ * scans the histograms of all tiles, and scatters each tile stably through
+ * a counting sort in local memory.  Keys per second are reported for
+ * uniform keys and for skewed keys, whose few distinct digits make the
+ * histogram atomics contend, next to a multithreaded host radix sort that
+ * also serves as the reference.
+ */
+class RadixSortSample : public OCLSample {
+public:
+
+  RadixSortSample();
+
+  virtual void run();
+
+  void setProblemSize(unsigned int size) {
+    assert(size > 0 && "Problem size must be positive");
+    ProblemSize_ = size;
+  }
+
+  void setHostThreads(unsigned int threads) {
+    assert(threads > 0 && "At least one host thread is needed");
+    HostThreads_ = threads;
+  }
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+
+private:
+
+  struct SortKernels {
+    cl::Kernel histogram32;
+    cl::Kernel scatter32;
+    cl::Kernel histogram64;
+    cl::Kernel scatter64;
+    cl::Kernel scan;
+    cl::Kernel addOffsets;
+  };
+
+  void extractKernels(cl::Program& program, SortKernels& kernels);
+  void enqueue(cl::Kernel& kernel, size_t groups, cl::Event* event);
+  void scanHistograms(SortKernels& kernels, cl::Buffer& data, cl_uint n,
+                      unsigned level);
+  double sortDevice(SortKernels& kernels, unsigned keyBits, bool hasValues);
+  template <typename Key>
+  bool runCase(SortKernels& kernels, Distribution distribution,
+               bool hasValues);
+  bool runCases(SortKernels& kernels);
+
+  cl::Program programCL_;
+  cl::Program programPTX_;
+
+  SortKernels kernelsCL_;
+  SortKernels kernelsPTX_;
+
+  // Unsorted input, and the ping-pong buffers of the passes
+  cl::Buffer  deviceKeys_;
+  cl::Buffer  deviceValues_;
+  cl::Buffer  deviceKeysTemp_[2];
+  cl::Buffer  deviceValuesTemp_[2];
+  cl::Buffer  deviceHistograms_;
+
+  // Tile totals of each level of the histogram scan
+  std::vector<cl::Buffer> levelSums_;
+
+  unsigned int ProblemSize_;
+  unsigned int NumTiles_;
+  unsigned int HostThreads_;
+};
+
+
+RadixSortSample::RadixSortSample()
+: ProblemSize_(1 << 24) {
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  HostThreads_ = (processors > 0) ? (unsigned)processors : 1;
+}
+
+void RadixSortSample::extractKernels(cl::Program& program,
+                                     SortKernels& kernels) {
+  cl_int result;
+
+  kernels.histogram32 = cl::Kernel(program, "radix_histogram_32", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.scatter32 = cl::Kernel(program, "radix_scatter_32", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.histogram64 = cl::Kernel(program, "radix_histogram_64", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.scatter64 = cl::Kernel(program, "radix_scatter_64", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.scan = cl::Kernel(program, "scan_blelloch", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.addOffsets = cl::Kernel(program, "add_offsets", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+}
+
+void RadixSortSample::initialize() {
+  programCL_ = compileSource("radix-sort_kernel.cl");
+  programPTX_ = loadBinary("radix-sort_kernel.ptx");
+
+  extractKernels(programCL_, kernelsCL_);
+  extractKernels(programPTX_, kernelsPTX_);
+
+  NumTiles_ = (ProblemSize_ + TILE_SIZE - 1) / TILE_SIZE;
+
+  setNumberOfIterations(4);
+}
+
+void RadixSortSample::createMemoryBuffers() {
+  cl_int result;
+  size_t keyBytes   = ProblemSize_*sizeof(cl_ulong);
+  size_t valueBytes = ProblemSize_*sizeof(cl_uint);
+
+  // Sized for 64-bit keys; 32-bit keys use the first half
+  deviceKeys_ = cl::Buffer(getContext(), CL_MEM_READ_ONLY, keyBytes, NULL,
+                           &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceValues_ = cl::Buffer(getContext(), CL_MEM_READ_ONLY, valueBytes,
+                             NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  for(unsigned int i = 0; i < 2; ++i) {
+    deviceKeysTemp_[i] = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                                    keyBytes, NULL, &result);
+    assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+    deviceValuesTemp_[i] = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                                      valueBytes, NULL, &result);
+    assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  }
+
+  cl_uint numCounts = RADIX * NumTiles_;
+  deviceHistograms_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                                 numCounts*sizeof(cl_uint), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+
+  for(cl_uint n = numCounts; n > 1; ) {
+    n = (n + BLELLOCH_TILE - 1) / BLELLOCH_TILE;
+    levelSums_.push_back(cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                                    n*sizeof(cl_uint), NULL, &result));
+    assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  }
+}
+
+void RadixSortSample::enqueue(cl::Kernel& kernel, size_t groups,
+                              cl::Event* event) {
+  cl_int      result;
+  cl::NDRange globalSize(groups*BLOCK_SIZE);
+  cl::NDRange localSize(BLOCK_SIZE);
+
+  result = getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange,
+                                                  globalSize, localSize,
+                                                  NULL, event);
+  assert(result == CL_SUCCESS && "Failed to launch kernel");
+}
+
+void RadixSortSample::scanHistograms(SortKernels& kernels, cl::Buffer& data,
+                                     cl_uint n, unsigned level) {
+  cl_int  result;
+  cl_uint groups = (n + BLELLOCH_TILE - 1) / BLELLOCH_TILE;
+
+  result = kernels.scan.setArg(0, data);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernels.scan.setArg(1, data);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = kernels.scan.setArg(2, levelSums_[level]);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = kernels.scan.setArg(3, n);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+  enqueue(kernels.scan, groups, NULL);
+
+  if(groups > 1) {
+    scanHistograms(kernels, levelSums_[level], groups, level + 1);
+
+    result = kernels.addOffsets.setArg(0, data);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+    result = kernels.addOffsets.setArg(1, levelSums_[level]);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+    result = kernels.addOffsets.setArg(2, n);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+    enqueue(kernels.addOffsets, groups, NULL);
+  }
+}
+
+double RadixSortSample::sortDevice(SortKernels& kernels, unsigned keyBits,
+                                   bool hasValues) {
+  cl_int      result;
+  cl::Kernel& histogram = (keyBits == 32) ? kernels.histogram32
+                                          : kernels.histogram64;
+  cl::Kernel& scatter   = (keyBits == 32) ? kernels.scatter32
+                                          : kernels.scatter64;
+  cl_uint     n         = ProblemSize_;
+  cl::Event   first, last;
+
+  // The first pass reads the unsorted input, and the passes then alternate
+  // between the two buffers; with an even number of passes the result ends
+  // up in deviceKeysTemp_[1]
+  for(cl_uint shift = 0; shift < keyBits; shift += RADIX_BITS) {
+    unsigned    pass      = shift / RADIX_BITS;
+    cl::Buffer& keysIn    = (pass == 0) ? deviceKeys_
+                                        : deviceKeysTemp_[(pass + 1) % 2];
+    cl::Buffer& valuesIn  = (pass == 0) ? deviceValues_
+                                        : deviceValuesTemp_[(pass + 1) % 2];
+    cl_uint     withValues = hasValues ? 1 : 0;
+
+    result = histogram.setArg(0, keysIn);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+    result = histogram.setArg(1, deviceHistograms_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+    result = histogram.setArg(2, n);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+    result = histogram.setArg(3, shift);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+    enqueue(histogram, NumTiles_, (pass == 0) ? &first : NULL);
+
+    scanHistograms(kernels, deviceHistograms_, RADIX * NumTiles_, 0);
+
+    result = scatter.setArg(0, keysIn);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+    result = scatter.setArg(1, deviceKeysTemp_[pass % 2]);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+    result = scatter.setArg(2, valuesIn);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+    result = scatter.setArg(3, deviceValuesTemp_[pass % 2]);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+    result = scatter.setArg(4, deviceHistograms_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 4");
+    result = scatter.setArg(5, n);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 5");
+    result = scatter.setArg(6, shift);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 6");
+    result = scatter.setArg(7, withValues);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 7");
+    enqueue(scatter, NumTiles_, &last);
+  }
+
+  return getElapsed(first, last);
+}
+
+template <typename Key>
+bool RadixSortSample::runCase(SortKernels& kernels,
+                              Distribution distribution, bool hasValues) {
+  cl_int               result;
+  cl::CommandQueue&    queue   = getCommandQueue();
+  unsigned             keyBits = 8 * sizeof(Key);
+  cl_ulong             state   = 0x9e3779b97f4a7c15ULL;
+  std::vector<Key>     keys(ProblemSize_);
+  std::vector<cl_uint> values(ProblemSize_);
+
+  // A few digits dominate every pass over the skewed keys
+  for(unsigned int i = 0; i < ProblemSize_; ++i) {
+    cl_ulong key = distribution == DISTRIBUTION_SKEWED ? nextSkewed(state)
+                                                        : nextRandom(state);
+    keys[i]   = (Key)key;
+    values[i] = i;
+  }
+
+  result = queue.enqueueWriteBuffer(deviceKeys_, CL_TRUE, 0,
+                                    ProblemSize_*sizeof(Key), &keys[0],
+                                    NULL, NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+  result = queue.enqueueWriteBuffer(deviceValues_, CL_TRUE, 0,
+                                    ProblemSize_*sizeof(cl_uint), &values[0],
+                                    NULL, NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+
+  // The first sort is a warm-up
+  std::vector<double> times;
+  sortDevice(kernels, keyBits, hasValues);
+  for(unsigned i = 0; i < getNumberOfIterations(); ++i) {
+    times.push_back(sortDevice(kernels, keyBits, hasValues));
+  }
+
+  // Host reference, timed the same way
+  HostRadixSort<Key>   hostSort(HostThreads_);
+  std::vector<double>  hostTimes;
+  std::vector<Key>     hostKeys;
+  std::vector<cl_uint> hostValues;
+  for(unsigned i = 0; i < getNumberOfIterations(); ++i) {
+    hostKeys   = keys;
+    hostValues = values;
+    double start = getTimeStamp();
+    hostSort.sort(hostKeys, hasValues ? &hostValues : NULL);
+    hostTimes.push_back(getTimeStamp() - start);
+  }
+
+  // Both sorts are stable, so the values must match as well
+  result = queue.enqueueReadBuffer(deviceKeysTemp_[1], CL_TRUE, 0,
+                                   ProblemSize_*sizeof(Key), &keys[0], NULL,
+                                   NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+  bool correct = (keys == hostKeys);
+  if(hasValues) {
+    result = queue.enqueueReadBuffer(deviceValuesTemp_[1], CL_TRUE, 0,
+                                     ProblemSize_*sizeof(cl_uint),
+                                     &values[0], NULL, NULL);
+    assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+    correct = correct && (values == hostValues);
+  }
+  for(unsigned int i = 1; correct && i < ProblemSize_; ++i) {
+    correct = hostKeys[i - 1] <= hostKeys[i];
+  }
+
+  double rate     = ProblemSize_ / median(times) / 1e6;
+  double hostRate = ProblemSize_ / median(hostTimes) / 1e6;
+
+  std::cout << std::setw(10) << kDistributionNames[distribution]
+            << std::setw(6) << keyBits << std::setw(8)
+            << (hasValues ? "pairs" : "keys") << std::fixed
+            << std::setprecision(1) << std::setw(12) << rate
+            << std::setw(12) << hostRate << std::setprecision(2)
+            << std::setw(9) << rate / hostRate
+            << (correct ? "" : "  FAILED") << "\n";
+  std::cout.unsetf(std::ios::floatfield);
+  std::cout << std::setprecision(6);
+
+  return correct;
+}
+
+bool RadixSortSample::runCases(SortKernels& kernels) {
+  bool passed = true;
+
+  std::cout << std::setw(10) << "keys" << std::setw(6) << "bits"
+            << std::setw(8) << "sort" << std::setw(12) << "Mkeys/s"
+            << std::setw(12) << "host" << std::setw(9) << "speedup" << "\n";
+
+  for(int d = 0; d < NUM_DISTRIBUTIONS; ++d) {
+    Distribution distribution = (Distribution)d;
+    for(int v = 0; v < 2; ++v) {
+      passed = runCase<cl_uint>(kernels, distribution, v == 1) && passed;
+    }
+    for(int v = 0; v < 2; ++v) {
+      passed = runCase<cl_ulong>(kernels, distribution, v == 1) && passed;
+    }
+  }
+
+  return passed;
+}
+
+void RadixSortSample::run() {
+  initialize();
+  createMemoryBuffers();
+
+  std::cout << "Problem Size:         " << ProblemSize_ << "\n";
+  std::cout << "Host Threads:         " << HostThreads_ << "\n";
+
+  SortKernels* kernels[2] = { &kernelsCL_, &kernelsPTX_ };
+  const char*  names[2]   = { "Source", "Binary" };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernels\n";
+    std::cout << "------------------------------\n";
+
+    if(runCases(*kernels[k])) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+  }
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --size N            Keys to sort (default 16777216)\n"
+            << "  --threads N         Threads of the host sort "
+               "(default: one per processor)\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  RadixSortSample sample;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--size" && i+1 < argc) {
+      sample.setProblemSize(atoi(argv[++i]));
+    } else if(arg == "--threads" && i+1 < argc) {
+      sample.setHostThreads(atoi(argv[++i]));
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sample.run();
+
+  return 0;
+}
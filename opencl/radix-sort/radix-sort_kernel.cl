@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+// These must match the definitions in radix-sort.cpp
+#define BLOCK_SIZE       256
+#define ITEMS_PER_THREAD 4
+#define TILE_SIZE        (BLOCK_SIZE * ITEMS_PER_THREAD)
+#define BLELLOCH_TILE    (2 * BLOCK_SIZE)
+#define RADIX_BITS       4
+#define RADIX            (1 << RADIX_BITS)
+
+// Local memory has 32 banks; padding every 32nd word keeps the strided
+// accesses below free of bank conflicts
+#define LOG_NUM_BANKS 5
+#define PAD(i) ((i) + ((i) >> LOG_NUM_BANKS))
+
+#define DIGIT(key, shift) ((uint)((key) >> (shift)) & (RADIX - 1))
+
+/**
+ * Exclusive scan of one value per work-item, with the up-sweep and
+ * down-sweep of Blelloch over scratch (BLOCK_SIZE elements).  Returns the
+ * prefix of the calling work-item.
+ */
+inline uint group_scan(uint value, __local uint* scratch) {
+  int tid = get_local_id(0);
+  int offset;
+  uint prefix;
+
+  scratch[tid] = value;
+
+  for(offset = 1; offset < BLOCK_SIZE; offset <<= 1) {
+    int i = (tid + 1) * 2 * offset - 1;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if(i < BLOCK_SIZE) {
+      scratch[i] += scratch[i - offset];
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  if(tid == 0) {
+    scratch[BLOCK_SIZE - 1] = 0;
+  }
+
+  for(offset = BLOCK_SIZE / 2; offset > 0; offset >>= 1) {
+    int i = (tid + 1) * 2 * offset - 1;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if(i < BLOCK_SIZE) {
+      uint t = scratch[i - offset];
+      scratch[i - offset] = scratch[i];
+      scratch[i] += t;
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  prefix = scratch[tid];
+  barrier(CLK_LOCAL_MEM_FENCE);
+  return prefix;
+}
+
+/**
+ * Counts the first count digits of the calling work-item into the local
+ * histogram of the tile, and writes it to histograms in digit-major order:
+ * the count of digit d in tile t goes to d * get_num_groups(0) + t, so an
+ * exclusive scan of histograms gives each tile the output offset of each
+ * of its digits, in a stable order.
+ */
+inline void histogram_tile(const uint* digits, uint count,
+                           __global uint* histograms, __local uint* hist) {
+  int  tid = get_local_id(0);
+  uint k;
+
+  if(tid < RADIX) {
+    hist[tid] = 0;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(k = 0; k < count; ++k) {
+    atomic_inc(&hist[digits[k]]);
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  if(tid < RADIX) {
+    histograms[tid * get_num_groups(0) + get_group_id(0)] = hist[tid];
+  }
+}
+
+/**
+ * Stable counting sort of the digits of a tile, where each work-item holds
+ * the consecutive elements tid * ITEMS_PER_THREAD + k.  Leaves in ranks the
+ * position of each of the work-item's elements in the sorted tile, and in
+ * digitStart the position of the first element of each digit.
+ *
+ * counts holds a column of RADIX per-digit counts for every work-item;
+ * scanning it in digit-major order gives, for digit d and work-item t, the
+ * number of elements of the tile with a smaller digit or with digit d in
+ * an earlier work-item.
+ */
+inline void rank_tile(const uint* digits, uint* ranks,
+                      __local uint* counts, __local uint* scratch,
+                      __local uint* digitStart) {
+  int  tid   = get_local_id(0);
+  int  first = tid * RADIX;
+  uint sum   = 0;
+  uint prefix;
+  int  d, k;
+
+  for(d = 0; d < RADIX; ++d) {
+    counts[PAD(d * BLOCK_SIZE + tid)] = 0;
+  }
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    counts[PAD(digits[k] * BLOCK_SIZE + tid)] += 1;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(k = 0; k < RADIX; ++k) {
+    sum += counts[PAD(first + k)];
+  }
+
+  prefix = group_scan(sum, scratch);
+
+  for(k = 0; k < RADIX; ++k) {
+    uint value = counts[PAD(first + k)];
+    counts[PAD(first + k)] = prefix;
+    prefix += value;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  // The first entry of each digit belongs to work-item 0, which updates it
+  // below
+  if(tid < RADIX) {
+    digitStart[tid] = counts[PAD(tid * BLOCK_SIZE)];
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  // Each work-item only touches its own column
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    ranks[k] = counts[PAD(digits[k] * BLOCK_SIZE + tid)]++;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+/**
+ * Loads the global output offset of each digit of the tile, less its start
+ * within the sorted tile, into base.
+ */
+inline void load_offsets(__global const uint* offsets,
+                         __local const uint* digitStart, __local uint* base) {
+  int tid = get_local_id(0);
+
+  if(tid < RADIX) {
+    base[tid] = offsets[tid * get_num_groups(0) + get_group_id(0)]
+      - digitStart[tid];
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+
+//==--- 32-bit Keys --------------------------------------------------------== //
+
+// Every pass runs radix_histogram, scans the histograms with scan_blelloch
+// and add_offsets, and then runs radix_scatter over the same tiles.  Keys
+// past n only take part in the scatter, with the largest digit, so they are
+// ranked after every real key of their tile and never written.
+
+__kernel
+void radix_histogram_32(__global const uint* keys, __global uint* histograms,
+                        uint n, uint shift) {
+
+  __local uint hist[RADIX];
+
+  uint first = get_group_id(0) * TILE_SIZE
+    + get_local_id(0) * ITEMS_PER_THREAD;
+  uint digits[ITEMS_PER_THREAD];
+  uint count = 0;
+  int  k;
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    if(first + k < n) {
+      digits[count++] = DIGIT(keys[first + k], shift);
+    }
+  }
+
+  histogram_tile(digits, count, histograms, hist);
+}
+
+__kernel
+void radix_scatter_32(__global const uint* keysIn, __global uint* keysOut,
+                      __global const uint* valuesIn, __global uint* valuesOut,
+                      __global const uint* offsets, uint n, uint shift,
+                      uint hasValues) {
+
+  __local uint counts[PAD(RADIX * BLOCK_SIZE)];
+  __local uint scratch[BLOCK_SIZE];
+  __local uint digitStart[RADIX];
+  __local uint base[RADIX];
+  __local uint sortedKeys[TILE_SIZE];
+  __local uint sortedValues[TILE_SIZE];
+
+  int  tid       = get_local_id(0);
+  uint tileStart = get_group_id(0) * TILE_SIZE;
+  uint first     = tileStart + tid * ITEMS_PER_THREAD;
+  uint valid     = min((uint)TILE_SIZE, n - tileStart);
+  uint keys[ITEMS_PER_THREAD];
+  uint digits[ITEMS_PER_THREAD];
+  uint ranks[ITEMS_PER_THREAD];
+  int  k, p;
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    keys[k]   = (first + k < n) ? keysIn[first + k] : 0;
+    digits[k] = (first + k < n) ? DIGIT(keys[k], shift) : RADIX - 1;
+  }
+
+  rank_tile(digits, ranks, counts, scratch, digitStart);
+  load_offsets(offsets, digitStart, base);
+
+  // Sort the tile in local memory, so that the writes below are runs of
+  // consecutive addresses
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    sortedKeys[ranks[k]] = keys[k];
+    if(hasValues) {
+      sortedValues[ranks[k]] = (first + k < n) ? valuesIn[first + k] : 0;
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(p = tid; p < valid; p += BLOCK_SIZE) {
+    uint key = sortedKeys[p];
+    uint dst = base[DIGIT(key, shift)] + p;
+    keysOut[dst] = key;
+    if(hasValues) {
+      valuesOut[dst] = sortedValues[p];
+    }
+  }
+}
+
+
+//==--- 64-bit Keys --------------------------------------------------------== //
+
+__kernel
+void radix_histogram_64(__global const ulong* keys, __global uint* histograms,
+                        uint n, uint shift) {
+
+  __local uint hist[RADIX];
+
+  uint first = get_group_id(0) * TILE_SIZE
+    + get_local_id(0) * ITEMS_PER_THREAD;
+  uint digits[ITEMS_PER_THREAD];
+  uint count = 0;
+  int  k;
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    if(first + k < n) {
+      digits[count++] = DIGIT(keys[first + k], shift);
+    }
+  }
+
+  histogram_tile(digits, count, histograms, hist);
+}
+
+__kernel
+void radix_scatter_64(__global const ulong* keysIn, __global ulong* keysOut,
+                      __global const uint* valuesIn, __global uint* valuesOut,
+                      __global const uint* offsets, uint n, uint shift,
+                      uint hasValues) {
+
+  __local uint  counts[PAD(RADIX * BLOCK_SIZE)];
+  __local uint  scratch[BLOCK_SIZE];
+  __local uint  digitStart[RADIX];
+  __local uint  base[RADIX];
+  __local ulong sortedKeys[TILE_SIZE];
+  __local uint  sortedValues[TILE_SIZE];
+
+  int   tid       = get_local_id(0);
+  uint  tileStart = get_group_id(0) * TILE_SIZE;
+  uint  first     = tileStart + tid * ITEMS_PER_THREAD;
+  uint  valid     = min((uint)TILE_SIZE, n - tileStart);
+  ulong keys[ITEMS_PER_THREAD];
+  uint  digits[ITEMS_PER_THREAD];
+  uint  ranks[ITEMS_PER_THREAD];
+  int   k, p;
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    keys[k]   = (first + k < n) ? keysIn[first + k] : 0;
+    digits[k] = (first + k < n) ? DIGIT(keys[k], shift) : RADIX - 1;
+  }
+
+  rank_tile(digits, ranks, counts, scratch, digitStart);
+  load_offsets(offsets, digitStart, base);
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    sortedKeys[ranks[k]] = keys[k];
+    if(hasValues) {
+      sortedValues[ranks[k]] = (first + k < n) ? valuesIn[first + k] : 0;
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(p = tid; p < valid; p += BLOCK_SIZE) {
+    ulong key = sortedKeys[p];
+    uint  dst = base[DIGIT(key, shift)] + p;
+    keysOut[dst] = key;
+    if(hasValues) {
+      valuesOut[dst] = sortedValues[p];
+    }
+  }
+}
+
+
+//==--- Histogram Scan -----------------------------------------------------== //
+
+/**
+ * Exclusive work-efficient scan of BLELLOCH_TILE elements per work-group,
+ * two per work-item, writing the total of each tile to sums.  Scanning
+ * sums with the same kernel and adding it back with add_offsets scans any
+ * length.  in and out may alias.
+ */
+__kernel
+void scan_blelloch(__global const uint* in, __global uint* out,
+                   __global uint* sums, uint n) {
+
+  __local uint temp[PAD(BLELLOCH_TILE)];
+
+  int  tid    = get_local_id(0);
+  uint base   = get_group_id(0) * BLELLOCH_TILE;
+  int  ai     = tid;
+  int  bi     = tid + BLOCK_SIZE;
+  int  offset = 1;
+  int  d;
+
+  temp[PAD(ai)] = (base + ai < n) ? in[base + ai] : 0;
+  temp[PAD(bi)] = (base + bi < n) ? in[base + bi] : 0;
+
+  for(d = BLELLOCH_TILE >> 1; d > 0; d >>= 1) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if(tid < d) {
+      int i = offset * (2 * tid + 1) - 1;
+      int j = offset * (2 * tid + 2) - 1;
+      temp[PAD(j)] += temp[PAD(i)];
+    }
+    offset <<= 1;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  if(tid == 0) {
+    sums[get_group_id(0)] = temp[PAD(BLELLOCH_TILE - 1)];
+    temp[PAD(BLELLOCH_TILE - 1)] = 0;
+  }
+
+  for(d = 1; d < BLELLOCH_TILE; d <<= 1) {
+    offset >>= 1;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if(tid < d) {
+      int  i = offset * (2 * tid + 1) - 1;
+      int  j = offset * (2 * tid + 2) - 1;
+      uint t = temp[PAD(i)];
+      temp[PAD(i)] = temp[PAD(j)];
+      temp[PAD(j)] += t;
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  if(base + ai < n) {
+    out[base + ai] = temp[PAD(ai)];
+  }
+  if(base + bi < n) {
+    out[base + bi] = temp[PAD(bi)];
+  }
+}
+
+/**
+ * Adds the scanned tile totals of scan_blelloch back to each tile.
+ */
+__kernel
+void add_offsets(__global uint* out, __global const uint* sums, uint n) {
+
+  int  tid    = get_local_id(0);
+  uint base   = get_group_id(0) * BLELLOCH_TILE;
+  uint offset = sums[get_group_id(0)];
+
+  if(base + tid < n) {
+    out[base + tid] += offset;
+  }
+  if(base + tid + BLOCK_SIZE < n) {
+    out[base + tid + BLOCK_SIZE] += offset;
+  }
+}
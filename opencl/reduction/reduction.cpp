@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "common/OCLSample.hpp"
+
+// This must be changed to reflect changes in reduction_kernel.cl
+#define BLOCK_SIZE 256
+
+// Work-groups per compute unit in the NDRange of the grid-stride tiers
+#define GROUPS_PER_UNIT 8
+
+/**
+ * An algorithm tier of reduction_kernel.cl.  Grid-stride tiers are launched
+ * with a fixed number of work-groups; the others need a work-item per
+ * element.
+ */
+struct Tier {
+  const char* name;
+  bool        gridStride;
+  bool        atomicFinish;
+};
+
+const Tier kTiers[] = {
+  { "interleaved", false, false },
+  { "sequential",  false, false },
+  { "unrolled",    false, false },
+  { "multiple",    true,  false },
+  { "atomic",      true,  true  }
+};
+
+const int kNumTiers = sizeof(kTiers) / sizeof(kTiers[0]);
+
+/**
+ * A reduction operator.  partial names the operator that combines the
+ * per-group results.
+ */
+struct Operator {
+  const char* name;
+  const char* partial;
+  float       identity;
+  int         numInputs;
+};
+
+const Operator kOperators[] = {
+  { "sum", "sum", 0.0f,       1 },
+  { "min", "min", HUGE_VALF,  1 },
+  { "max", "max", -HUGE_VALF, 1 },
+  { "dot", "sum", 0.0f,       2 }
+};
+
+const int kNumOperators = sizeof(kOperators) / sizeof(kOperators[0]);
+
+/**
+ * Reduces a vector with every combination of operator and algorithm tier,
+ * for both the source and the binary program, checks each result against
+ * the host and reports its GB/s next to the device's copy bandwidth.
+ *
+ * Each combination goes through the setupKernel(), runPasses() and
+ * finishKernel() hooks and is timed by timeKernel().  run() is overridden
+ * because the stock one times a single kernel per program, and this
+ * sample times twenty.
+ */
+class ReductionSample : public OCLSample {
+public:
+
+  ReductionSample();
+
+  virtual void run();
+
+  void setProblemSize(unsigned int size) {
+    assert(size > 0 && "Problem size must be positive");
+    ProblemSize_ = size;
+  }
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+  virtual void setupKernel(cl::Kernel kernel);
+  virtual void finishKernel(cl::Kernel kernel);
+  virtual void runPasses(cl::Kernel kernel, cl::Event* first,
+                         cl::Event* last);
+
+private:
+
+  cl::Kernel getKernel(cl::Program& program, const std::string& name);
+  unsigned getNumGroups(const Tier& tier);
+  double reduceHost(const Operator& op, double& magnitude);
+  bool runTiers(cl::Program& program, double copyRate);
+
+  cl::Program programCL_;
+  cl::Program programPTX_;
+
+  cl::Buffer  deviceA_;
+  cl::Buffer  deviceB_;
+  cl::Buffer  devicePartial_;
+  cl::Buffer  deviceResult_;
+
+  std::vector<float> hostA_;
+  std::vector<float> hostB_;
+
+  // The combination being timed, the kernel of its second pass, and the
+  // result read back by finishKernel()
+  const Tier*     tier_;
+  const Operator* op_;
+  cl::Kernel      finish_;
+  float           result_;
+
+  unsigned int ProblemSize_;
+  unsigned int WaveGroups_;
+};
+
+
+ReductionSample::ReductionSample()
+: tier_(NULL), op_(NULL), result_(0.0f), ProblemSize_(1 << 23) {
+}
+
+void ReductionSample::initialize() {
+  programCL_ = compileSource("reduction_kernel.cl");
+  programPTX_ = loadBinary("reduction_kernel.ptx");
+
+  cl_uint units = getDevice().getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+  WaveGroups_ = std::max(units, 1u) * GROUPS_PER_UNIT;
+
+  // For this sample, let's run 16 iterations
+  setNumberOfIterations(16);
+}
+
+void ReductionSample::createMemoryBuffers() {
+  cl_int result;
+  size_t bytes = ProblemSize_*sizeof(float);
+
+  // Signed data, so that min and max are not trivially the first element
+  srand(time(NULL));
+  hostA_.resize(ProblemSize_);
+  hostB_.resize(ProblemSize_);
+  for(unsigned int i = 0; i < ProblemSize_; ++i) {
+    hostA_[i] = 2.0f * rand() / ((float)RAND_MAX + 1.0f) - 1.0f;
+    hostB_[i] = 2.0f * rand() / ((float)RAND_MAX + 1.0f) - 1.0f;
+  }
+
+  // One partial per work-group of the largest NDRange
+  unsigned int maxGroups = std::max(getNumGroups(kTiers[0]), WaveGroups_);
+
+  deviceA_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                        bytes, &hostA_[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceB_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                        bytes, &hostB_[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  devicePartial_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                              maxGroups*sizeof(float), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceResult_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                             sizeof(float), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+}
+
+cl::Kernel ReductionSample::getKernel(cl::Program& program,
+                                      const std::string& name) {
+  cl_int result;
+
+  cl::Kernel kernel(program, name.c_str(), &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  return kernel;
+}
+
+unsigned ReductionSample::getNumGroups(const Tier& tier) {
+  unsigned groups = (ProblemSize_ + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+  return tier.gridStride ? std::min(groups, WaveGroups_) : groups;
+}
+
+void ReductionSample::setupKernel(cl::Kernel kernel) {
+  cl_int result;
+
+  result = kernel.setArg(0, deviceA_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernel.setArg(1, deviceB_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = kernel.setArg(2, tier_->atomicFinish ? deviceResult_
+                                                : devicePartial_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = kernel.setArg(3, (cl_int)ProblemSize_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+
+  // Second pass: one work-group reduces the per-group partials
+  result = finish_.setArg(0, devicePartial_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = finish_.setArg(1, devicePartial_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = finish_.setArg(2, deviceResult_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = finish_.setArg(3, (cl_int)getNumGroups(*tier_));
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+}
+
+void ReductionSample::runPasses(cl::Kernel kernel, cl::Event* first,
+                                cl::Event* last) {
+  cl_int            result;
+  cl::CommandQueue& queue  = getCommandQueue();
+  unsigned int      groups = getNumGroups(*tier_);
+
+  if(tier_->atomicFinish) {
+    // OpenCL 1.1 has no fill, so the identity is written from the host
+    result = queue.enqueueWriteBuffer(deviceResult_, CL_FALSE, 0,
+                                      sizeof(float), &op_->identity, NULL,
+                                      first);
+    assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+    result = queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                                        cl::NDRange(groups*BLOCK_SIZE),
+                                        cl::NDRange(BLOCK_SIZE), NULL, last);
+    assert(result == CL_SUCCESS && "Failed to launch kernel");
+  } else {
+    result = queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                                        cl::NDRange(groups*BLOCK_SIZE),
+                                        cl::NDRange(BLOCK_SIZE), NULL, first);
+    assert(result == CL_SUCCESS && "Failed to launch kernel");
+    result = queue.enqueueNDRangeKernel(finish_, cl::NullRange,
+                                        cl::NDRange(BLOCK_SIZE),
+                                        cl::NDRange(BLOCK_SIZE), NULL, last);
+    assert(result == CL_SUCCESS && "Failed to launch kernel");
+  }
+}
+
+void ReductionSample::finishKernel(cl::Kernel kernel) {
+  cl_int result;
+
+  result = getCommandQueue().enqueueReadBuffer(deviceResult_, CL_TRUE, 0,
+                                               sizeof(float), &result_, NULL,
+                                               NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+}
+
+double ReductionSample::reduceHost(const Operator& op, double& magnitude) {
+  std::string name   = op.name;
+  double      result = (name == "min") ? HUGE_VAL
+                     : (name == "max") ? -HUGE_VAL : 0.0;
+
+  // magnitude bounds the rounding error of a float sum or dot product
+  magnitude = 0.0;
+
+  for(unsigned int i = 0; i < ProblemSize_; ++i) {
+    double a = hostA_[i];
+
+    if(name == "min") {
+      result = std::min(result, a);
+    } else if(name == "max") {
+      result = std::max(result, a);
+    } else {
+      double term = (name == "dot") ? a * hostB_[i] : a;
+      result    += term;
+      magnitude += std::fabs(term);
+    }
+  }
+
+  return result;
+}
+
+bool ReductionSample::runTiers(cl::Program& program, double copyRate) {
+  bool passed = true;
+
+  for(int o = 0; o < kNumOperators; ++o) {
+    const Operator& op = kOperators[o];
+    double          magnitude;
+    double          expected = reduceHost(op, magnitude);
+
+    op_     = &op;
+    finish_ = getKernel(program, std::string("reduce_multiple_")
+                                 + op.partial);
+
+    std::cout << "* " << op.name << " (host: " << expected << ")\n";
+    std::cout << std::setw(12) << "tier" << std::setw(14) << "result"
+              << std::setw(12) << "median ms" << std::setw(9) << "GB/s"
+              << std::setw(9) << "% copy" << "\n";
+
+    for(int t = 0; t < kNumTiers; ++t) {
+      const Tier& tier   = kTiers[t];
+      cl::Kernel  kernel = getKernel(program, std::string("reduce_")
+                                     + tier.name + "_" + op.name);
+      cl::Event   first, last;
+
+      tier_ = &tier;
+      setupKernel(kernel);
+
+      // The first launch is a warm-up
+      runPasses(kernel, &first, &last);
+      getCommandQueue().finish();
+      std::vector<double> times = timeKernel(kernel);
+
+      finishKernel(kernel);
+      float result = result_;
+
+      // Min and max are exact; sums may round differently in any order
+      double error   = std::fabs(result - expected);
+      bool   correct = (magnitude == 0.0) ? error == 0.0
+                                          : error <= 1e-5 * magnitude;
+      passed = passed && correct;
+
+      double time  = median(times);
+      double bytes = (double)op.numInputs * ProblemSize_ * sizeof(float);
+      double rate  = bytes / time / 1e9;
+
+      std::cout << std::setw(12) << tier.name << std::setw(14) << result
+                << std::fixed << std::setprecision(3) << std::setw(12)
+                << time * 1e3 << std::setprecision(2) << std::setw(9) << rate
+                << std::setw(9) << 100.0 * rate / copyRate
+                << (correct ? "" : "  FAILED") << "\n";
+      std::cout.unsetf(std::ios::floatfield);
+      std::cout << std::setprecision(6);
+    }
+  }
+
+  return passed;
+}
+
+void ReductionSample::run() {
+  initialize();
+  createMemoryBuffers();
+
+  std::cout << "Problem Size:         " << ProblemSize_ << "\n";
+
+  double copyRate = measureCopyBandwidth(ProblemSize_*sizeof(float));
+  std::cout << "Copy GB/s:            " << copyRate << "\n";
+
+  cl::Program* programs[2] = { &programCL_, &programPTX_ };
+  const char*  names[2]    = { "Source", "Binary" };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernels\n";
+    std::cout << "------------------------------\n";
+
+    if(runTiers(*programs[k], copyRate)) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+  }
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --size N            Elements to reduce (default 8388608)\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  ReductionSample sample;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--size" && i+1 < argc) {
+      sample.setProblemSize(atoi(argv[++i]));
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sample.run();
+
+  return 0;
+}
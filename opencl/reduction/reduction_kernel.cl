@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma OPENCL EXTENSION cl_khr_global_int32_base_atomics : enable
+
+// This must match BLOCK_SIZE in reduction.cpp
+#define BLOCK_SIZE 256
+
+// The operators.  Each kernel passes one of these as a constant, so the
+// switches below fold away once the helpers are inlined.
+#define OP_SUM 0
+#define OP_MIN 1
+#define OP_MAX 2
+#define OP_DOT 3
+
+/**
+ * Neutral element of combine().
+ */
+inline float identity(int op) {
+  switch(op) {
+  case OP_MIN: return INFINITY;
+  case OP_MAX: return -INFINITY;
+  default:     return 0.0f;
+  }
+}
+
+/**
+ * Element i of the input; only the dot product reads B.
+ */
+inline float load(int op, __global const float* A, __global const float* B,
+                  int i) {
+  return (op == OP_DOT) ? A[i] * B[i] : A[i];
+}
+
+/**
+ * Associative and commutative combination of two values.  The dot product
+ * combines its per-element products, and its partials, as a sum.
+ */
+inline float combine(int op, float a, float b) {
+  switch(op) {
+  case OP_MIN: return a < b ? a : b;
+  case OP_MAX: return a > b ? a : b;
+  default:     return a + b;
+  }
+}
+
+/**
+ * Combines value into *address atomically, with a compare-and-swap loop on
+ * its bits since OpenCL has no floating-point atomics.
+ */
+inline void atomic_combine(int op, __global float* address, float value) {
+  volatile __global int* bits = (volatile __global int*)address;
+  int expected = *bits;
+
+  for(;;) {
+    int desired  = as_int(combine(op, as_float(expected), value));
+    int previous = atomic_cmpxchg(bits, expected, desired);
+    if(previous == expected) {
+      break;
+    }
+    expected = previous;
+  }
+}
+
+
+// Each tier reduces BLOCK_SIZE work-item groups to one value per group,
+// written to out[group] (or, for the atomic tier, combined into out[0]).
+// Local memory must be declared at kernel scope, so every kernel passes its
+// scratch array to the helpers.
+
+/**
+ * Interleaved addressing: the active work-items of each step are spread
+ * across the group, so every warp diverges and local memory accesses
+ * conflict.
+ */
+inline void reduce_interleaved(int op, __global const float* A,
+                               __global const float* B, __global float* out,
+                               int N, __local volatile float* scratch) {
+  int tid = get_local_id(0);
+  int i   = get_group_id(0) * BLOCK_SIZE + tid;
+  int s;
+
+  scratch[tid] = (i < N) ? load(op, A, B, i) : identity(op);
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(s = 1; s < BLOCK_SIZE; s *= 2) {
+    if(tid % (2 * s) == 0) {
+      scratch[tid] = combine(op, scratch[tid], scratch[tid + s]);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  if(tid == 0) {
+    out[get_group_id(0)] = scratch[0];
+  }
+}
+
+/**
+ * Sequential addressing: the active work-items are contiguous, so whole
+ * warps retire as the step size halves.
+ */
+inline void reduce_block(int op, int tid, float value,
+                         __local volatile float* scratch) {
+  int s;
+
+  scratch[tid] = value;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(s = BLOCK_SIZE / 2; s > 0; s >>= 1) {
+    if(tid < s) {
+      scratch[tid] = value = combine(op, value, scratch[tid + s]);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+}
+
+inline void reduce_sequential(int op, __global const float* A,
+                              __global const float* B, __global float* out,
+                              int N, __local volatile float* scratch) {
+  int tid = get_local_id(0);
+  int i   = get_group_id(0) * BLOCK_SIZE + tid;
+
+  reduce_block(op, tid, (i < N) ? load(op, A, B, i) : identity(op), scratch);
+
+  if(tid == 0) {
+    out[get_group_id(0)] = scratch[0];
+  }
+}
+
+/**
+ * As reduce_block(), but once a single warp is left it runs without
+ * barriers.  This relies on the 32-wide lockstep execution of NVIDIA
+ * devices and is not portable OpenCL.
+ */
+inline void reduce_block_unrolled(int op, int tid, float value,
+                                  __local volatile float* scratch) {
+  int s;
+
+  scratch[tid] = value;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(s = BLOCK_SIZE / 2; s > 32; s >>= 1) {
+    if(tid < s) {
+      scratch[tid] = value = combine(op, value, scratch[tid + s]);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  if(tid < 32) {
+    scratch[tid] = value = combine(op, value, scratch[tid + 32]);
+    scratch[tid] = value = combine(op, value, scratch[tid + 16]);
+    scratch[tid] = value = combine(op, value, scratch[tid + 8]);
+    scratch[tid] = value = combine(op, value, scratch[tid + 4]);
+    scratch[tid] = value = combine(op, value, scratch[tid + 2]);
+    scratch[tid] = value = combine(op, value, scratch[tid + 1]);
+  }
+}
+
+inline void reduce_unrolled(int op, __global const float* A,
+                            __global const float* B, __global float* out,
+                            int N, __local volatile float* scratch) {
+  int tid = get_local_id(0);
+  int i   = get_group_id(0) * BLOCK_SIZE + tid;
+
+  reduce_block_unrolled(op, tid, (i < N) ? load(op, A, B, i) : identity(op),
+                        scratch);
+
+  if(tid == 0) {
+    out[get_group_id(0)] = scratch[0];
+  }
+}
+
+/**
+ * Multiple elements per work-item: each work-item first accumulates a
+ * grid-stride slice of the input in a register, so the NDRange only needs
+ * to fill the device.
+ */
+inline float accumulate(int op, __global const float* A,
+                        __global const float* B, int N) {
+  int   stride = get_num_groups(0) * BLOCK_SIZE;
+  float value  = identity(op);
+  int   i;
+
+  for(i = get_global_id(0); i < N; i += stride) {
+    value = combine(op, value, load(op, A, B, i));
+  }
+
+  return value;
+}
+
+inline void reduce_multiple(int op, __global const float* A,
+                            __global const float* B, __global float* out,
+                            int N, __local volatile float* scratch) {
+  int tid = get_local_id(0);
+
+  reduce_block_unrolled(op, tid, accumulate(op, A, B, N), scratch);
+
+  if(tid == 0) {
+    out[get_group_id(0)] = scratch[0];
+  }
+}
+
+/**
+ * Single pass: as reduce_multiple(), but each group combines its result into
+ * out[0] atomically, which must hold the identity beforehand.
+ */
+inline void reduce_atomic(int op, __global const float* A,
+                          __global const float* B, __global float* out,
+                          int N, __local volatile float* scratch) {
+  int tid = get_local_id(0);
+
+  reduce_block_unrolled(op, tid, accumulate(op, A, B, N), scratch);
+
+  if(tid == 0) {
+    atomic_combine(op, out, scratch[0]);
+  }
+}
+
+
+// Every kernel takes (A, B, out, N) and is named reduce_<tier>_<operator>,
+// as in kernels/reduction.
+
+#define DEFINE_REDUCTION(tier, name, op)                                \
+  __kernel                                                              \
+  void reduce_##tier##_##name(__global const float* A,                  \
+                              __global const float* B,                  \
+                              __global float* out, int N) {             \
+    __local volatile float scratch[BLOCK_SIZE];                         \
+    reduce_##tier(op, A, B, out, N, scratch);                           \
+  }
+
+#define DEFINE_REDUCTIONS(name, op)                                     \
+  DEFINE_REDUCTION(interleaved, name, op)                               \
+  DEFINE_REDUCTION(sequential, name, op)                                \
+  DEFINE_REDUCTION(unrolled, name, op)                                  \
+  DEFINE_REDUCTION(multiple, name, op)                                  \
+  DEFINE_REDUCTION(atomic, name, op)
+
+DEFINE_REDUCTIONS(sum, OP_SUM)
+DEFINE_REDUCTIONS(min, OP_MIN)
+DEFINE_REDUCTIONS(max, OP_MAX)
+DEFINE_REDUCTIONS(dot, OP_DOT)
@@ -0,0 +1,519 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "common/OCLSample.hpp"
+
+// These must be changed to reflect changes in scan_kernel.cl
+#define BLOCK_SIZE       256
+#define ITEMS_PER_THREAD 8
+#define TILE_SIZE        (BLOCK_SIZE * ITEMS_PER_THREAD)
+#define BLELLOCH_TILE    (2 * BLOCK_SIZE)
+
+// Work-groups per compute unit in the reduce-then-scan variant, whose
+// group totals must also fit the single work-group of scan_sums
+#define GROUPS_PER_UNIT 8
+#define MAX_GROUPS      TILE_SIZE
+
+enum Variant {
+  VARIANT_BLELLOCH,
+  VARIANT_REDUCE_THEN_SCAN,
+  VARIANT_LOOKBACK,
+  NUM_VARIANTS
+};
+
+const char* kVariantNames[NUM_VARIANTS] = {
+  "blelloch", "3-kernel", "look-back"
+};
+
+/**
+ * Exclusive and inclusive prefix sums of 32-bit integers with three
+ * algorithms: Blelloch's work-efficient tree applied recursively to the
+ * tile totals, a reduce-then-scan over a fixed number of work-groups in
+ * three kernels, and a single-pass scan with decoupled look-back.  Each is
+ * checked against the host and timed over a sweep of lengths, next to the
+ * device's copy bandwidth.
+ */
+class ScanSample : public OCLSample {
+public:
+
+  ScanSample();
+
+  virtual void run();
+
+  void setSizeRange(unsigned int minSize, unsigned int maxSize) {
+    assert(minSize > 1 && minSize <= maxSize && "Invalid problem sizes");
+    MinSize_ = minSize;
+    MaxSize_ = maxSize;
+  }
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+
+private:
+
+  struct ScanKernels {
+    cl::Kernel blelloch;
+    cl::Kernel addOffsets;
+    cl::Kernel reduceTiles;
+    cl::Kernel scanSums;
+    cl::Kernel scanTiles;
+    cl::Kernel lookback;
+  };
+
+  void extractKernels(cl::Program& program, ScanKernels& kernels);
+  void enqueue(cl::Kernel& kernel, size_t groups, cl::Event* event);
+  void scanBlelloch(ScanKernels& kernels, cl::Buffer& in, cl::Buffer& out,
+                    cl_uint n, cl_uint inclusive, unsigned level,
+                    cl::Event* first, cl::Event* last);
+  void scanReduceThenScan(ScanKernels& kernels, cl_uint n, cl_uint inclusive,
+                          cl::Event* first, cl::Event* last);
+  void scanLookback(ScanKernels& kernels, cl_uint n, cl_uint inclusive,
+                    cl::Event* first, cl::Event* last);
+  double runScan(ScanKernels& kernels, int variant, cl_uint n,
+                 cl_uint inclusive);
+  bool checkResult(cl_uint n, cl_uint inclusive);
+  bool runSweep(ScanKernels& kernels);
+
+  cl::Program programCL_;
+  cl::Program programPTX_;
+
+  ScanKernels kernelsCL_;
+  ScanKernels kernelsPTX_;
+
+  cl::Buffer  deviceIn_;
+  cl::Buffer  deviceOut_;
+  cl::Buffer  deviceSums_;
+  cl::Buffer  deviceFlags_;
+  cl::Buffer  deviceAggregates_;
+  cl::Buffer  devicePrefixes_;
+  cl::Buffer  deviceCounter_;
+
+  // Tile totals of each level of the Blelloch recursion
+  std::vector<cl::Buffer> levelSums_;
+
+  std::vector<cl_uint> hostIn_;
+  std::vector<cl_uint> hostOut_;
+
+  unsigned int MinSize_;
+  unsigned int MaxSize_;
+  unsigned int NumGroups_;
+
+  // Tickets handed out by the look-back counter, and launches so far
+  cl_uint ticket_;
+  cl_uint epoch_;
+};
+
+
+ScanSample::ScanSample()
+: MinSize_(1 << 20), MaxSize_(1 << 30), ticket_(0), epoch_(0) {
+}
+
+void ScanSample::extractKernels(cl::Program& program, ScanKernels& kernels) {
+  cl_int result;
+
+  kernels.blelloch = cl::Kernel(program, "scan_blelloch", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.addOffsets = cl::Kernel(program, "add_offsets", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.reduceTiles = cl::Kernel(program, "reduce_tiles", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.scanSums = cl::Kernel(program, "scan_sums", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.scanTiles = cl::Kernel(program, "scan_tiles", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  kernels.lookback = cl::Kernel(program, "scan_lookback", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+}
+
+void ScanSample::initialize() {
+  programCL_ = compileSource("scan_kernel.cl");
+  programPTX_ = loadBinary("scan_kernel.ptx");
+
+  extractKernels(programCL_, kernelsCL_);
+  extractKernels(programPTX_, kernelsPTX_);
+
+  cl_uint units = getDevice().getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+  NumGroups_ = std::min(std::max(units, 1u) * GROUPS_PER_UNIT,
+                        (cl_uint)MAX_GROUPS);
+
+  // The input and output buffers must fit the device
+  cl_ulong maxAlloc  = getDevice().getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+  cl_ulong globalMem = getDevice().getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>();
+  cl_ulong limit     = std::min(maxAlloc, globalMem * 2 / 5);
+  while(MaxSize_ > MinSize_ && MaxSize_ * sizeof(cl_uint) > limit) {
+    MaxSize_ /= 2;
+  }
+
+  setNumberOfIterations(8);
+}
+
+void ScanSample::createMemoryBuffers() {
+  cl_int result;
+  size_t bytes = MaxSize_*sizeof(cl_uint);
+
+  // Small values, so that the sums of short runs stay readable when
+  // debugging; longer sums wrap around identically on host and device
+  hostIn_.resize(MaxSize_);
+  hostOut_.resize(MaxSize_);
+  for(unsigned int i = 0; i < MaxSize_; ++i) {
+    hostIn_[i] = rand() % 16;
+  }
+
+  deviceIn_ = cl::Buffer(getContext(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                         bytes, &hostIn_[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceOut_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE, bytes, NULL,
+                          &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+
+  for(cl_uint n = MaxSize_; n > 1; ) {
+    n = (n + BLELLOCH_TILE - 1) / BLELLOCH_TILE;
+    levelSums_.push_back(cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                                    n*sizeof(cl_uint), NULL, &result));
+    assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  }
+
+  deviceSums_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                           MAX_GROUPS*sizeof(cl_uint), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+
+  // The look-back flags must start out clear, as must the ticket counter
+  cl_uint              maxTiles = (MaxSize_ + TILE_SIZE - 1) / TILE_SIZE;
+  std::vector<cl_uint> zero(maxTiles, 0);
+
+  deviceFlags_ = cl::Buffer(getContext(),
+                            CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                            maxTiles*sizeof(cl_uint), &zero[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceAggregates_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                                 maxTiles*sizeof(cl_uint), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  devicePrefixes_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                               maxTiles*sizeof(cl_uint), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceCounter_ = cl::Buffer(getContext(),
+                              CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                              sizeof(cl_uint), &zero[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+}
+
+void ScanSample::enqueue(cl::Kernel& kernel, size_t groups,
+                         cl::Event* event) {
+  cl_int      result;
+  cl::NDRange globalSize(groups*BLOCK_SIZE);
+  cl::NDRange localSize(BLOCK_SIZE);
+
+  result = getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange,
+                                                  globalSize, localSize,
+                                                  NULL, event);
+  assert(result == CL_SUCCESS && "Failed to launch kernel");
+}
+
+void ScanSample::scanBlelloch(ScanKernels& kernels, cl::Buffer& in,
+                              cl::Buffer& out, cl_uint n, cl_uint inclusive,
+                              unsigned level, cl::Event* first,
+                              cl::Event* last) {
+  cl_int    result;
+  cl_uint   groups = (n + BLELLOCH_TILE - 1) / BLELLOCH_TILE;
+  cl::Event event;
+
+  result = kernels.blelloch.setArg(0, in);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernels.blelloch.setArg(1, out);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = kernels.blelloch.setArg(2, levelSums_[level]);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = kernels.blelloch.setArg(3, n);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+  result = kernels.blelloch.setArg(4, inclusive);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 4");
+  enqueue(kernels.blelloch, groups, &event);
+
+  if(first != NULL) {
+    *first = event;
+  }
+  if(groups == 1) {
+    if(last != NULL) {
+      *last = event;
+    }
+    return;
+  }
+
+  // Scan the tile totals in place, then add them back to the tiles
+  scanBlelloch(kernels, levelSums_[level], levelSums_[level], groups, 0,
+               level + 1, NULL, NULL);
+
+  result = kernels.addOffsets.setArg(0, out);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernels.addOffsets.setArg(1, levelSums_[level]);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = kernels.addOffsets.setArg(2, n);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  enqueue(kernels.addOffsets, groups, last);
+}
+
+void ScanSample::scanReduceThenScan(ScanKernels& kernels, cl_uint n,
+                                    cl_uint inclusive, cl::Event* first,
+                                    cl::Event* last) {
+  cl_int  result;
+  cl_uint tiles         = (n + TILE_SIZE - 1) / TILE_SIZE;
+  cl_uint groups        = std::min(tiles, NumGroups_);
+  cl_uint tilesPerGroup = (tiles + groups - 1) / groups;
+
+  groups = (tiles + tilesPerGroup - 1) / tilesPerGroup;
+
+  result = kernels.reduceTiles.setArg(0, deviceIn_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernels.reduceTiles.setArg(1, deviceSums_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = kernels.reduceTiles.setArg(2, n);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = kernels.reduceTiles.setArg(3, tilesPerGroup);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+  enqueue(kernels.reduceTiles, groups, first);
+
+  result = kernels.scanSums.setArg(0, deviceSums_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernels.scanSums.setArg(1, groups);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  enqueue(kernels.scanSums, 1, NULL);
+
+  result = kernels.scanTiles.setArg(0, deviceIn_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernels.scanTiles.setArg(1, deviceOut_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = kernels.scanTiles.setArg(2, deviceSums_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = kernels.scanTiles.setArg(3, n);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+  result = kernels.scanTiles.setArg(4, tilesPerGroup);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 4");
+  result = kernels.scanTiles.setArg(5, inclusive);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 5");
+  enqueue(kernels.scanTiles, groups, last);
+}
+
+void ScanSample::scanLookback(ScanKernels& kernels, cl_uint n,
+                              cl_uint inclusive, cl::Event* first,
+                              cl::Event* last) {
+  cl_int  result;
+  cl_uint tiles = (n + TILE_SIZE - 1) / TILE_SIZE;
+
+  // Each launch tags its flags with a new epoch, so stale flags of earlier
+  // launches never need clearing
+  ++epoch_;
+
+  result = kernels.lookback.setArg(0, deviceIn_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = kernels.lookback.setArg(1, deviceOut_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  result = kernels.lookback.setArg(2, deviceFlags_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+  result = kernels.lookback.setArg(3, deviceAggregates_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+  result = kernels.lookback.setArg(4, devicePrefixes_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 4");
+  result = kernels.lookback.setArg(5, deviceCounter_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 5");
+  result = kernels.lookback.setArg(6, n);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 6");
+  result = kernels.lookback.setArg(7, ticket_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 7");
+  result = kernels.lookback.setArg(8, epoch_);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 8");
+  result = kernels.lookback.setArg(9, inclusive);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 9");
+  enqueue(kernels.lookback, tiles, first);
+
+  ticket_ += tiles;
+  *last = *first;
+}
+
+double ScanSample::runScan(ScanKernels& kernels, int variant, cl_uint n,
+                           cl_uint inclusive) {
+  cl::Event first, last;
+
+  switch(variant) {
+  case VARIANT_BLELLOCH:
+    scanBlelloch(kernels, deviceIn_, deviceOut_, n, inclusive, 0, &first,
+                 &last);
+    break;
+  case VARIANT_REDUCE_THEN_SCAN:
+    scanReduceThenScan(kernels, n, inclusive, &first, &last);
+    break;
+  default:
+    scanLookback(kernels, n, inclusive, &first, &last);
+    break;
+  }
+
+  return getElapsed(first, last);
+}
+
+bool ScanSample::checkResult(cl_uint n, cl_uint inclusive) {
+  cl_int  result;
+  cl_uint sum = 0;
+
+  result = getCommandQueue().enqueueReadBuffer(deviceOut_, CL_TRUE, 0,
+                                               n*sizeof(cl_uint),
+                                               &hostOut_[0], NULL, NULL);
+  assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+
+  for(cl_uint i = 0; i < n; ++i) {
+    cl_uint next = sum + hostIn_[i];
+    if(hostOut_[i] != (inclusive ? next : sum)) {
+      return false;
+    }
+    sum = next;
+  }
+  return true;
+}
+
+bool ScanSample::runSweep(ScanKernels& kernels) {
+  const char* modes[2] = { "exclusive", "inclusive" };
+  bool        passed   = true;
+
+  // A length that is not a multiple of any tile, so that partial tiles and
+  // uneven runs of tiles are checked too
+  cl_uint tail = MinSize_ - 1;
+  for(int v = 0; v < NUM_VARIANTS; ++v) {
+    for(cl_uint inclusive = 0; inclusive < 2; ++inclusive) {
+      runScan(kernels, v, tail, inclusive);
+      if(!checkResult(tail, inclusive)) {
+        std::cout << "Length " << tail << " failed: " << kVariantNames[v]
+                  << " " << modes[inclusive] << "\n";
+        passed = false;
+      }
+    }
+  }
+
+  std::cout << "GB/s at 8 bytes moved per element:\n";
+  std::cout << std::setw(11) << "elements" << std::setw(11) << "mode"
+            << std::setw(9) << "copy";
+  for(int v = 0; v < NUM_VARIANTS; ++v) {
+    std::cout << std::setw(11) << kVariantNames[v];
+  }
+  std::cout << "\n";
+  std::cout << std::fixed << std::setprecision(2);
+
+  for(cl_uint n = MinSize_; n <= MaxSize_; n *= 4) {
+    double copyRate = measureCopyBandwidth(n*sizeof(cl_uint));
+    double bytes    = 2.0 * n * sizeof(cl_uint);
+
+    for(cl_uint inclusive = 0; inclusive < 2; ++inclusive) {
+      std::cout << std::setw(11) << n << std::setw(11) << modes[inclusive]
+                << std::setw(9) << copyRate;
+
+      for(int v = 0; v < NUM_VARIANTS; ++v) {
+        std::vector<double> times;
+
+        // The first launch is a warm-up
+        runScan(kernels, v, n, inclusive);
+        for(unsigned i = 0; i < getNumberOfIterations(); ++i) {
+          times.push_back(runScan(kernels, v, n, inclusive));
+        }
+
+        if(checkResult(n, inclusive)) {
+          std::cout << std::setw(11) << bytes / median(times) / 1e9;
+        } else {
+          std::cout << std::setw(11) << "FAILED";
+          passed = false;
+        }
+      }
+      std::cout << "\n";
+    }
+
+    // Stop before n overflows
+    if(n > MaxSize_ / 4) {
+      break;
+    }
+  }
+
+  std::cout.unsetf(std::ios::floatfield);
+  std::cout << std::setprecision(6);
+
+  return passed;
+}
+
+void ScanSample::run() {
+  initialize();
+  createMemoryBuffers();
+
+  std::cout << "Problem Sizes:        " << MinSize_ << " to " << MaxSize_
+            << " elements\n";
+
+  ScanKernels* kernels[2] = { &kernelsCL_, &kernelsPTX_ };
+  const char*  names[2]   = { "Source", "Binary" };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernels\n";
+    std::cout << "------------------------------\n";
+
+    if(runSweep(*kernels[k])) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+  }
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --min-size N        Shortest length of the sweep "
+               "(default 1048576)\n"
+            << "  --max-size N        Longest length of the sweep, capped by "
+               "device memory\n"
+            << "                      (default 1073741824)\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  ScanSample   sample;
+  unsigned int minSize = 1 << 20;
+  unsigned int maxSize = 1 << 30;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--min-size" && i+1 < argc) {
+      minSize = strtoul(argv[++i], NULL, 10);
+    } else if(arg == "--max-size" && i+1 < argc) {
+      maxSize = strtoul(argv[++i], NULL, 10);
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sample.setSizeRange(minSize, maxSize);
+  sample.run();
+
+  return 0;
+}
@@ -0,0 +1,383 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+// These must match the definitions in scan.cpp
+#define BLOCK_SIZE       256
+#define ITEMS_PER_THREAD 8
+#define TILE_SIZE        (BLOCK_SIZE * ITEMS_PER_THREAD)
+#define BLELLOCH_TILE    (2 * BLOCK_SIZE)
+
+// Local memory has 32 banks; padding every 32nd word keeps the strided
+// accesses of the scans below free of bank conflicts
+#define LOG_NUM_BANKS 5
+#define PAD(i) ((i) + ((i) >> LOG_NUM_BANKS))
+
+// Tile states of the look-back scan, in the low bits of a flag word whose
+// upper bits hold the epoch of the launch that wrote it
+#define STATUS_AGGREGATE 1
+#define STATUS_PREFIX    2
+#define STATUS_MASK      3
+
+/**
+ * Exclusive scan of one value per work-item, with the up-sweep and
+ * down-sweep of Blelloch over scratch (BLOCK_SIZE elements).  Returns the
+ * prefix of the calling work-item and stores the group total in *total.
+ */
+inline uint group_scan(uint value, __local uint* scratch, uint* total) {
+  int tid = get_local_id(0);
+  int offset;
+  uint prefix;
+
+  scratch[tid] = value;
+
+  for(offset = 1; offset < BLOCK_SIZE; offset <<= 1) {
+    int i = (tid + 1) * 2 * offset - 1;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if(i < BLOCK_SIZE) {
+      scratch[i] += scratch[i - offset];
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  *total = scratch[BLOCK_SIZE - 1];
+  barrier(CLK_LOCAL_MEM_FENCE);
+  if(tid == 0) {
+    scratch[BLOCK_SIZE - 1] = 0;
+  }
+
+  for(offset = BLOCK_SIZE / 2; offset > 0; offset >>= 1) {
+    int i = (tid + 1) * 2 * offset - 1;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if(i < BLOCK_SIZE) {
+      uint t = scratch[i - offset];
+      scratch[i - offset] = scratch[i];
+      scratch[i] += t;
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  prefix = scratch[tid];
+  barrier(CLK_LOCAL_MEM_FENCE);
+  return prefix;
+}
+
+/**
+ * Scans the TILE_SIZE elements of in at base (zero past n) in local memory,
+ * leaving the exclusive or inclusive prefix of each element in tile, and
+ * returns the tile total.  Loads are coalesced; each work-item then scans
+ * ITEMS_PER_THREAD consecutive elements serially, so only one value per
+ * work-item goes through group_scan().
+ */
+inline uint scan_tile(__global const uint* in, uint base, uint n,
+                      uint inclusive, __local uint* tile,
+                      __local uint* scratch) {
+  int  tid   = get_local_id(0);
+  int  first = tid * ITEMS_PER_THREAD;
+  uint sum   = 0;
+  uint total, prefix;
+  int  k;
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    uint i = k * BLOCK_SIZE + tid;
+    tile[PAD(i)] = (base + i < n) ? in[base + i] : 0;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    sum += tile[PAD(first + k)];
+  }
+
+  prefix = group_scan(sum, scratch, &total);
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    uint value = tile[PAD(first + k)];
+    tile[PAD(first + k)] = inclusive ? prefix + value : prefix;
+    prefix += value;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  return total;
+}
+
+/**
+ * Writes the prefixes left in tile by scan_tile(), offset by seed, to the
+ * elements of out at base that are below n.
+ */
+inline void store_tile(__global uint* out, uint base, uint n, uint seed,
+                       __local uint* tile) {
+  int tid = get_local_id(0);
+  int k;
+
+  for(k = 0; k < ITEMS_PER_THREAD; ++k) {
+    uint i = k * BLOCK_SIZE + tid;
+    if(base + i < n) {
+      out[base + i] = seed + tile[PAD(i)];
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+
+//==--- Blelloch -----------------------------------------------------------== //
+
+/**
+ * Work-efficient scan of BLELLOCH_TILE elements per work-group, two per
+ * work-item, writing the total of each tile to sums.  Scanning sums with
+ * the same kernel and adding it back with add_offsets scans any length.
+ * in and out may alias.
+ */
+__kernel
+void scan_blelloch(__global const uint* in, __global uint* out,
+                   __global uint* sums, uint n, uint inclusive) {
+
+  __local uint temp[PAD(BLELLOCH_TILE)];
+
+  int  tid    = get_local_id(0);
+  uint base   = get_group_id(0) * BLELLOCH_TILE;
+  int  ai     = tid;
+  int  bi     = tid + BLOCK_SIZE;
+  uint a      = (base + ai < n) ? in[base + ai] : 0;
+  uint b      = (base + bi < n) ? in[base + bi] : 0;
+  int  offset = 1;
+  int  d;
+
+  temp[PAD(ai)] = a;
+  temp[PAD(bi)] = b;
+
+  // Up-sweep: build partial sums in place
+  for(d = BLELLOCH_TILE >> 1; d > 0; d >>= 1) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if(tid < d) {
+      int i = offset * (2 * tid + 1) - 1;
+      int j = offset * (2 * tid + 2) - 1;
+      temp[PAD(j)] += temp[PAD(i)];
+    }
+    offset <<= 1;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  if(tid == 0) {
+    sums[get_group_id(0)] = temp[PAD(BLELLOCH_TILE - 1)];
+    temp[PAD(BLELLOCH_TILE - 1)] = 0;
+  }
+
+  // Down-sweep: push the prefixes back down the tree
+  for(d = 1; d < BLELLOCH_TILE; d <<= 1) {
+    offset >>= 1;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if(tid < d) {
+      int  i = offset * (2 * tid + 1) - 1;
+      int  j = offset * (2 * tid + 2) - 1;
+      uint t = temp[PAD(i)];
+      temp[PAD(i)] = temp[PAD(j)];
+      temp[PAD(j)] += t;
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  if(base + ai < n) {
+    out[base + ai] = temp[PAD(ai)] + (inclusive ? a : 0);
+  }
+  if(base + bi < n) {
+    out[base + bi] = temp[PAD(bi)] + (inclusive ? b : 0);
+  }
+}
+
+/**
+ * Adds the scanned tile totals of scan_blelloch back to each tile.
+ */
+__kernel
+void add_offsets(__global uint* out, __global const uint* sums, uint n) {
+
+  int  tid    = get_local_id(0);
+  uint base   = get_group_id(0) * BLELLOCH_TILE;
+  uint offset = sums[get_group_id(0)];
+
+  if(base + tid < n) {
+    out[base + tid] += offset;
+  }
+  if(base + tid + BLOCK_SIZE < n) {
+    out[base + tid + BLOCK_SIZE] += offset;
+  }
+}
+
+
+//==--- Reduce-Then-Scan ---------------------------------------------------== //
+
+// A fixed number of work-groups each own a contiguous run of tilesPerGroup
+// tiles.  The input is read twice, but the only intermediate data is one
+// value per work-group.
+
+/**
+ * First pass: the total of each work-group's run of tiles.
+ */
+__kernel
+void reduce_tiles(__global const uint* in, __global uint* sums, uint n,
+                  uint tilesPerGroup) {
+
+  __local uint scratch[BLOCK_SIZE];
+
+  int  tid   = get_local_id(0);
+  uint start = get_group_id(0) * tilesPerGroup * TILE_SIZE;
+  uint end   = min(start + tilesPerGroup * TILE_SIZE, n);
+  uint sum   = 0;
+  uint i;
+  int  s;
+
+  for(i = start + tid; i < end; i += BLOCK_SIZE) {
+    sum += in[i];
+  }
+
+  scratch[tid] = sum;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(s = BLOCK_SIZE / 2; s > 0; s >>= 1) {
+    if(tid < s) {
+      scratch[tid] += scratch[tid + s];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  if(tid == 0) {
+    sums[get_group_id(0)] = scratch[0];
+  }
+}
+
+/**
+ * Second pass: an exclusive scan of the count <= TILE_SIZE work-group
+ * totals, by a single work-group.
+ */
+__kernel
+void scan_sums(__global uint* sums, uint count) {
+
+  __local uint tile[PAD(TILE_SIZE)];
+  __local uint scratch[BLOCK_SIZE];
+
+  scan_tile(sums, 0, count, 0, tile, scratch);
+  store_tile(sums, 0, count, 0, tile);
+}
+
+/**
+ * Third pass: each work-group rescans its run of tiles, starting from its
+ * scanned total.
+ */
+__kernel
+void scan_tiles(__global const uint* in, __global uint* out,
+                __global const uint* sums, uint n, uint tilesPerGroup,
+                uint inclusive) {
+
+  __local uint tile[PAD(TILE_SIZE)];
+  __local uint scratch[BLOCK_SIZE];
+
+  uint start = get_group_id(0) * tilesPerGroup * TILE_SIZE;
+  uint carry = sums[get_group_id(0)];
+  uint t;
+
+  for(t = 0; t < tilesPerGroup && start + t * TILE_SIZE < n; ++t) {
+    uint base  = start + t * TILE_SIZE;
+    uint total = scan_tile(in, base, n, inclusive, tile, scratch);
+    store_tile(out, base, n, carry, tile);
+    carry += total;
+  }
+}
+
+
+//==--- Decoupled Look-Back ------------------------------------------------== //
+
+/**
+ * Single-pass scan with decoupled look-back (Merrill and Garland).  Each
+ * work-group takes the next tile from counter, scans it, publishes its
+ * total, and then walks back over the tiles before it, adding their totals
+ * until it reaches one that has published its inclusive prefix.  Tiles are
+ * handed out in the order work-groups start, so a work-group only ever
+ * waits on one that is already running.
+ *
+ * Flag words carry the epoch of the launch that wrote them, so flags left
+ * by earlier launches read as "not yet published" and nothing needs to be
+ * cleared between launches; the caller passes a fresh epoch every time,
+ * and first, the value of counter before the launch.
+ *
+ * OpenCL 1.1 does not order global memory between work-groups, so this
+ * relies on the volatile accesses and fences being honoured device-wide,
+ * as they are on NVIDIA hardware.
+ */
+__kernel
+void scan_lookback(__global const uint* in, __global uint* out,
+                   __global volatile uint* flags,
+                   __global volatile uint* aggregates,
+                   __global volatile uint* prefixes,
+                   __global uint* counter, uint n, uint first, uint epoch,
+                   uint inclusive) {
+
+  __local uint tile[PAD(TILE_SIZE)];
+  __local uint scratch[BLOCK_SIZE];
+  __local uint tileId;
+  __local uint seed;
+
+  int  tid = get_local_id(0);
+  uint tag = epoch << 2;
+  uint id, total;
+
+  if(tid == 0) {
+    tileId = atomic_inc(counter) - first;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+  id = tileId;
+
+  total = scan_tile(in, id * TILE_SIZE, n, inclusive, tile, scratch);
+
+  if(tid == 0) {
+    uint exclusive = 0;
+
+    if(id > 0) {
+      uint j = id - 1;
+
+      aggregates[id] = total;
+      write_mem_fence(CLK_GLOBAL_MEM_FENCE);
+      flags[id] = tag | STATUS_AGGREGATE;
+
+      for(;;) {
+        uint flag;
+        do {
+          flag = flags[j];
+        } while((flag & ~STATUS_MASK) != tag);
+        read_mem_fence(CLK_GLOBAL_MEM_FENCE);
+
+        if((flag & STATUS_MASK) == STATUS_PREFIX) {
+          exclusive += prefixes[j];
+          break;
+        }
+        exclusive += aggregates[j];
+        --j;
+      }
+    }
+
+    prefixes[id] = exclusive + total;
+    write_mem_fence(CLK_GLOBAL_MEM_FENCE);
+    flags[id] = tag | STATUS_PREFIX;
+    seed = exclusive;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  store_tile(out, id * TILE_SIZE, n, seed, tile);
+}
@@ -0,0 +1,349 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "common/OCLSample.hpp"
+
+// These must be changed to reflect changes in sort_kernel.cl
+#define BLOCK_SIZE 256
+#define ITEMS      8
+#define TILE_SIZE  (BLOCK_SIZE * ITEMS)
+
+// Segment sizes, in elements; 0 sorts the whole array as one segment
+const unsigned int kSegmentSizes[] = { 1024, 4096, 16384, 65536, 0 };
+
+const int kNumSegmentSizes = sizeof(kSegmentSizes) / sizeof(kSegmentSizes[0]);
+
+enum Algorithm {
+  BITONIC,
+  MERGE
+};
+
+const char* const kAlgorithms[] = { "bitonic", "merge" };
+
+const int kNumAlgorithms = sizeof(kAlgorithms) / sizeof(kAlgorithms[0]);
+
+/**
+ * Sorts an array of floats as a batch of independent segments of each size,
+ * with a bitonic sort and a merge-path merge sort, for both the source and
+ * the binary program.  Every segment is sorted by the same launches, which
+ * handle segments of up to TILE_SIZE elements in local memory and merge
+ * longer ones with further launches.  Each result is checked against
+ * std::sort, and its rate is reported in millions of keys per second.
+ */
+class SortSample : public OCLSample {
+public:
+
+  SortSample();
+
+  virtual void run();
+
+  void setNumElements(unsigned int elements) {
+    assert(elements >= TILE_SIZE && (elements & (elements - 1)) == 0 &&
+           "Number of elements must be a power of two of at least one tile");
+    NumElements_ = elements;
+  }
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+
+private:
+
+  void createKernels(cl::Program& program);
+  void enqueue(cl::Kernel& kernel, size_t global);
+  cl::Buffer* enqueueBitonic(unsigned int segSize);
+  cl::Buffer* enqueueMerge(unsigned int segSize);
+  bool runSorts(cl::Program& program);
+
+  cl::Program programCL_;
+  cl::Program programPTX_;
+
+  cl::Kernel  bitonicSortLocal_;
+  cl::Kernel  bitonicMergeGlobal_;
+  cl::Kernel  bitonicMergeLocal_;
+  cl::Kernel  mergeSortLocal_;
+  cl::Kernel  mergeGlobal_;
+
+  cl::Buffer  deviceIn_;
+  cl::Buffer  deviceWork_[2];
+
+  std::vector<float> hostIn_;
+
+  // Every kernel launch of the sort being timed
+  std::vector<cl::Event> events_;
+
+  unsigned int NumElements_;
+};
+
+
+SortSample::SortSample()
+: NumElements_(1 << 22) {
+}
+
+void SortSample::initialize() {
+  programCL_ = compileSource("sort_kernel.cl");
+  programPTX_ = loadBinary("sort_kernel.ptx");
+
+  // For this sample, let's run 16 iterations
+  setNumberOfIterations(16);
+}
+
+void SortSample::createMemoryBuffers() {
+  cl_int result;
+  size_t bytes = (size_t)NumElements_*sizeof(float);
+
+  srand(time(NULL));
+  hostIn_.resize(NumElements_);
+  for(size_t i = 0; i < hostIn_.size(); ++i) {
+    hostIn_[i] = rand() / ((float)RAND_MAX + 1.0f);
+  }
+
+  deviceIn_ = cl::Buffer(getContext(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                         bytes, &hostIn_[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  for(unsigned int i = 0; i < 2; ++i) {
+    deviceWork_[i] = cl::Buffer(getContext(), CL_MEM_READ_WRITE, bytes, NULL,
+                                &result);
+    assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  }
+}
+
+void SortSample::createKernels(cl::Program& program) {
+  cl_int result;
+
+  bitonicSortLocal_ = cl::Kernel(program, "bitonic_sort_local", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  bitonicMergeGlobal_ = cl::Kernel(program, "bitonic_merge_global", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  bitonicMergeLocal_ = cl::Kernel(program, "bitonic_merge_local", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  mergeSortLocal_ = cl::Kernel(program, "merge_sort_local", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+  mergeGlobal_ = cl::Kernel(program, "merge_global", &result);
+  assert(result == CL_SUCCESS && "Failed to extract kernel");
+}
+
+void SortSample::enqueue(cl::Kernel& kernel, size_t global) {
+  cl_int    result;
+  cl::Event event;
+
+  result = getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange,
+                                                  cl::NDRange(global),
+                                                  cl::NDRange(BLOCK_SIZE),
+                                                  NULL, &event);
+  assert(result == CL_SUCCESS && "Failed to launch kernel");
+  events_.push_back(event);
+}
+
+/**
+ * Sorts deviceWork_[0] in place: the fused local stages, then for each
+ * longer stage a launch per step that spans work-groups and one fused
+ * launch for the rest.
+ */
+cl::Buffer* SortSample::enqueueBitonic(unsigned int segSize) {
+  cl_int result;
+  size_t tiles = NumElements_ / TILE_SIZE;
+
+  result = bitonicSortLocal_.setArg(0, deviceWork_[0]);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = bitonicSortLocal_.setArg(1, (cl_uint)segSize);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  enqueue(bitonicSortLocal_, tiles * BLOCK_SIZE);
+
+  for(unsigned int k = 2 * TILE_SIZE; k <= segSize; k <<= 1) {
+    for(unsigned int j = k >> 1; j >= TILE_SIZE; j >>= 1) {
+      result = bitonicMergeGlobal_.setArg(0, deviceWork_[0]);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+      result = bitonicMergeGlobal_.setArg(1, (cl_uint)segSize);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+      result = bitonicMergeGlobal_.setArg(2, (cl_uint)k);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+      result = bitonicMergeGlobal_.setArg(3, (cl_uint)j);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+      enqueue(bitonicMergeGlobal_, NumElements_ / 2);
+    }
+
+    result = bitonicMergeLocal_.setArg(0, deviceWork_[0]);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+    result = bitonicMergeLocal_.setArg(1, (cl_uint)segSize);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+    result = bitonicMergeLocal_.setArg(2, (cl_uint)k);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+    enqueue(bitonicMergeLocal_, tiles * BLOCK_SIZE);
+  }
+
+  return &deviceWork_[0];
+}
+
+/**
+ * Sorts the tiles of deviceWork_[0] in place, then merges runs of
+ * TILE_SIZE, 2 TILE_SIZE, ... back and forth between the work buffers,
+ * and returns the one holding the result.
+ */
+cl::Buffer* SortSample::enqueueMerge(unsigned int segSize) {
+  cl_int result;
+  size_t tiles = NumElements_ / TILE_SIZE;
+  int    in    = 0;
+
+  result = mergeSortLocal_.setArg(0, deviceWork_[0]);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+  result = mergeSortLocal_.setArg(1, (cl_uint)segSize);
+  assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+  enqueue(mergeSortLocal_, tiles * BLOCK_SIZE);
+
+  for(unsigned int width = TILE_SIZE; width < segSize; width <<= 1) {
+    result = mergeGlobal_.setArg(0, deviceWork_[in]);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+    result = mergeGlobal_.setArg(1, deviceWork_[1 - in]);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+    result = mergeGlobal_.setArg(2, (cl_uint)width);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+    enqueue(mergeGlobal_, tiles * BLOCK_SIZE);
+    in = 1 - in;
+  }
+
+  return &deviceWork_[in];
+}
+
+bool SortSample::runSorts(cl::Program& program) {
+  cl_int             result;
+  bool               passed = true;
+  size_t             bytes  = (size_t)NumElements_*sizeof(float);
+  std::vector<float> hostOut(NumElements_);
+
+  createKernels(program);
+
+  std::cout << std::setw(10) << "segment" << std::setw(10) << "segments"
+            << std::setw(10) << "sort" << std::setw(12) << "median ms"
+            << std::setw(11) << "Mkeys/s" << "\n";
+
+  for(int s = 0; s < kNumSegmentSizes; ++s) {
+    unsigned int segSize = kSegmentSizes[s] ? kSegmentSizes[s] : NumElements_;
+
+    if(segSize > NumElements_) {
+      std::cout << std::setw(10) << segSize << std::setw(10) << "-" << "\n";
+      continue;
+    }
+
+    std::vector<float> expected(hostIn_);
+    for(size_t i = 0; i < expected.size(); i += segSize) {
+      std::sort(expected.begin() + i, expected.begin() + i + segSize);
+    }
+
+    for(int a = 0; a < kNumAlgorithms; ++a) {
+      std::vector<double> times;
+      cl::Buffer*         out = NULL;
+
+      // The first sort is a warm-up; every sort starts from the input
+      for(unsigned i = 0; i <= getNumberOfIterations(); ++i) {
+        result = getCommandQueue().enqueueCopyBuffer(deviceIn_,
+                                                     deviceWork_[0], 0, 0,
+                                                     bytes, NULL, NULL);
+        assert(result == CL_SUCCESS && "Failed to queue buffer copy");
+
+        events_.clear();
+        out = (a == BITONIC) ? enqueueBitonic(segSize)
+                             : enqueueMerge(segSize);
+        double time = getElapsed(events_.front(), events_.back());
+        if(i > 0) {
+          times.push_back(time);
+        }
+      }
+
+      result = getCommandQueue().enqueueReadBuffer(*out, CL_TRUE, 0, bytes,
+                                                   &hostOut[0], NULL, NULL);
+      assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+
+      bool correct = hostOut == expected;
+      passed = passed && correct;
+
+      double time = median(times);
+
+      std::cout << std::setw(10) << segSize << std::setw(10)
+                << NumElements_ / segSize << std::setw(10) << kAlgorithms[a]
+                << std::fixed << std::setprecision(3) << std::setw(12)
+                << time * 1e3 << std::setprecision(1) << std::setw(11)
+                << NumElements_ / time / 1e6
+                << (correct ? "" : "  FAILED") << "\n";
+      std::cout.unsetf(std::ios::floatfield);
+      std::cout << std::setprecision(6);
+    }
+  }
+
+  return passed;
+}
+
+void SortSample::run() {
+  initialize();
+  createMemoryBuffers();
+
+  std::cout << "Problem Size:         " << NumElements_ << " elements\n";
+
+  cl::Program* programs[2] = { &programCL_, &programPTX_ };
+  const char*  names[2]    = { "Source", "Binary" };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernels\n";
+    std::cout << "------------------------------\n";
+
+    if(runSorts(*programs[k])) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+  }
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --elements N        Keys in total, a power of two "
+            << "(default 4M)\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  SortSample sample;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--elements" && i+1 < argc) {
+      sample.setNumElements(atoi(argv[++i]));
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sample.run();
+
+  return 0;
+}
@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+// These must match sort.cpp
+#define BLOCK_SIZE 256
+#define ITEMS      8
+#define TILE_SIZE  (BLOCK_SIZE * ITEMS)
+
+// Every kernel sorts float keys ascending within segments of segSize
+// elements, a power of two, stored one after another; a launch covers all
+// the segments, and the NDRange all the elements.  A work-group sorts or
+// merges a tile of TILE_SIZE elements in local memory, which holds whole
+// segments when they are that small.
+
+
+//==--- Bitonic Sort -------------------------------------------------------== //
+
+// Step j of stage k compares element i with element i ^ j, and orders the
+// pair ascending when bit k of i (within its segment) is clear, so the
+// last stage, k = segSize, sorts the whole segment ascending.
+
+/**
+ * Orders the pair at i and i + j, i the comparator's lower index.
+ */
+inline void compare_exchange(__local float* keys, uint i, uint j,
+                             bool ascending) {
+  float a = keys[i];
+  float b = keys[i + j];
+
+  if((a > b) == ascending) {
+    keys[i]     = b;
+    keys[i + j] = a;
+  }
+}
+
+/**
+ * Lower index of comparator t of step j.
+ */
+inline uint lower_index(uint t, uint j) {
+  return ((t & ~(j - 1)) << 1) | (t & (j - 1));
+}
+
+/**
+ * Steps j = first, first / 2, ..., 1 of stage k on a tile in local memory,
+ * TILE_SIZE / 2 comparators per step.  base is the tile's offset in the
+ * array, which the comparator directions depend on.
+ */
+inline void bitonic_steps(__local float* keys, uint base, uint segSize,
+                          uint k, uint first) {
+  uint tid = get_local_id(0);
+  uint j, t;
+
+  for(j = first; j > 0; j >>= 1) {
+    for(t = tid; t < TILE_SIZE / 2; t += BLOCK_SIZE) {
+      uint i = lower_index(t, j);
+      compare_exchange(keys, i, j, ((base + i) & k & (segSize - 1)) == 0);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+}
+
+inline void load_tile(__global const float* data, __local float* keys) {
+  uint tid = get_local_id(0);
+  uint e;
+
+  data += get_group_id(0) * TILE_SIZE;
+  for(e = tid; e < TILE_SIZE; e += BLOCK_SIZE) {
+    keys[e] = data[e];
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+inline void store_tile(__global float* data, __local const float* keys) {
+  uint tid = get_local_id(0);
+  uint e;
+
+  data += get_group_id(0) * TILE_SIZE;
+  for(e = tid; e < TILE_SIZE; e += BLOCK_SIZE) {
+    data[e] = keys[e];
+  }
+}
+
+/**
+ * Every stage up to min(segSize, TILE_SIZE), fused in local memory.  This
+ * sorts segments of up to TILE_SIZE elements, and leaves the tiles of
+ * larger ones sorted in alternating directions for the merges.
+ */
+__kernel void bitonic_sort_local(__global float* data, uint segSize) {
+  __local float keys[TILE_SIZE];
+  uint base = get_group_id(0) * TILE_SIZE;
+  uint k;
+
+  load_tile(data, keys);
+  for(k = 2; k <= min(segSize, (uint)TILE_SIZE); k <<= 1) {
+    bitonic_steps(keys, base, segSize, k, k >> 1);
+  }
+  store_tile(data, keys);
+}
+
+/**
+ * One step of stage k with j >= TILE_SIZE, whose pairs span work-groups,
+ * one comparator per work-item.
+ */
+__kernel void bitonic_merge_global(__global float* data, uint segSize,
+                                   uint k, uint j) {
+  uint  i = lower_index(get_global_id(0), j);
+  float a = data[i];
+  float b = data[i + j];
+
+  if((a > b) == ((i & k & (segSize - 1)) == 0)) {
+    data[i]     = b;
+    data[i + j] = a;
+  }
+}
+
+/**
+ * The remaining steps of stage k, j = TILE_SIZE / 2 down to 1, fused in
+ * local memory.
+ */
+__kernel void bitonic_merge_local(__global float* data, uint segSize,
+                                  uint k) {
+  __local float keys[TILE_SIZE];
+  uint base = get_group_id(0) * TILE_SIZE;
+
+  load_tile(data, keys);
+  bitonic_steps(keys, base, segSize, k, TILE_SIZE / 2);
+  store_tile(data, keys);
+}
+
+
+//==--- Merge Sort ---------------------------------------------------------== //
+
+// Merge path: the first diag outputs of merging sorted runs A and B take a
+// elements of A and diag - a of B, where a is found by a binary search
+// along the diagonal.  Ties go to A, which keeps the merge stable.  The
+// runs are ranges [aBegin, aBegin + aCount) and [bBegin, bBegin + bCount)
+// of one array; local and global memory need separate copies.
+
+inline uint merge_path_local(__local const float* keys, uint aBegin,
+                             uint aCount, uint bBegin, uint bCount,
+                             uint diag) {
+  uint lo = (diag > bCount) ? diag - bCount : 0;
+  uint hi = min(diag, aCount);
+
+  while(lo < hi) {
+    uint mid = (lo + hi) >> 1;
+    if(keys[aBegin + mid] <= keys[bBegin + diag - 1 - mid]) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+inline uint merge_path_global(__global const float* keys, uint aBegin,
+                              uint aCount, uint bBegin, uint bCount,
+                              uint diag) {
+  uint lo = (diag > bCount) ? diag - bCount : 0;
+  uint hi = min(diag, aCount);
+
+  while(lo < hi) {
+    uint mid = (lo + hi) >> 1;
+    if(keys[aBegin + mid] <= keys[bBegin + diag - 1 - mid]) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/**
+ * ITEMS outputs of the merge, starting from elements a and b.
+ */
+inline void merge_serial(__local const float* keys, uint a, uint aEnd,
+                         uint b, uint bEnd, float* out) {
+  uint i;
+
+  for(i = 0; i < ITEMS; ++i) {
+    if(b >= bEnd || (a < aEnd && keys[a] <= keys[b])) {
+      out[i] = keys[a++];
+    } else {
+      out[i] = keys[b++];
+    }
+  }
+}
+
+/**
+ * Sorts each work-item's ITEMS elements in registers, then merges runs of
+ * ITEMS, 2 ITEMS, ... in local memory, every work-item producing ITEMS
+ * outputs of each merge.  This sorts segments of up to TILE_SIZE elements,
+ * and the tiles of larger ones.
+ */
+__kernel void merge_sort_local(__global float* data, uint segSize) {
+  __local float keys[TILE_SIZE];
+  float v[ITEMS];
+  uint  tid   = get_local_id(0);
+  uint  first = tid * ITEMS;
+  uint  width, i, r;
+
+  load_tile(data, keys);
+  for(i = 0; i < ITEMS; ++i) {
+    v[i] = keys[first + i];
+  }
+
+  // Odd-even transposition sort
+  for(r = 0; r < ITEMS; ++r) {
+    for(i = r & 1; i + 1 < ITEMS; i += 2) {
+      float a = v[i];
+      float b = v[i + 1];
+      v[i]     = min(a, b);
+      v[i + 1] = max(a, b);
+    }
+  }
+
+  for(width = ITEMS; width < min(segSize, (uint)TILE_SIZE); width <<= 1) {
+    uint base = first & ~(2 * width - 1);
+    uint diag = first - base;
+    uint a;
+
+    for(i = 0; i < ITEMS; ++i) {
+      keys[first + i] = v[i];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    a = merge_path_local(keys, base, width, base + width, width, diag);
+    merge_serial(keys, base + a, base + width, base + width + diag - a,
+                 base + 2 * width, v);
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  for(i = 0; i < ITEMS; ++i) {
+    keys[first + i] = v[i];
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+  store_tile(data, keys);
+}
+
+/**
+ * One pass merging runs of width >= TILE_SIZE from in into out.  Each
+ * work-group produces a tile of the output: it finds the ranges of the two
+ * runs that the tile takes by merge path in global memory, stages them in
+ * local memory, and merges them there as merge_sort_local() does.
+ */
+__kernel void merge_global(__global const float* in, __global float* out,
+                           uint width) {
+  __local float keys[TILE_SIZE];
+  __local uint  bounds[2];
+  float v[ITEMS];
+  uint  tid    = get_local_id(0);
+  uint  start  = get_group_id(0) * TILE_SIZE;
+  uint  base   = start & ~(2 * width - 1);
+  uint  diag   = start - base;
+  uint  aBegin, aCount, bBegin, bCount, e, a;
+
+  if(tid < 2) {
+    bounds[tid] = merge_path_global(in, base, width, base + width, width,
+                                    diag + tid * TILE_SIZE);
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  aBegin = base + bounds[0];
+  aCount = bounds[1] - bounds[0];
+  bBegin = base + width + diag - bounds[0];
+  bCount = TILE_SIZE - aCount;
+
+  for(e = tid; e < TILE_SIZE; e += BLOCK_SIZE) {
+    keys[e] = (e < aCount) ? in[aBegin + e] : in[bBegin + e - aCount];
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  a = merge_path_local(keys, 0, aCount, aCount, bCount, tid * ITEMS);
+  merge_serial(keys, a, aCount, aCount + tid * ITEMS - a, TILE_SIZE, v);
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(e = 0; e < ITEMS; ++e) {
+    keys[tid * ITEMS + e] = v[e];
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  out += start;
+  for(e = tid; e < TILE_SIZE; e += BLOCK_SIZE) {
+    out[e] = keys[e];
+  }
+}
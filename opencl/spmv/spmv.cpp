@@ -0,0 +1,702 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+#include "common/MatrixMarket.hpp"
+#include "common/OCLSample.hpp"
+
+// These must be changed to reflect changes in spmv_kernel.cl
+#define BLOCK_SIZE 256
+#define WARP_SIZE  32
+#define SLICE_SIZE 32
+
+// Rows sorted by length together in SELL-C-sigma
+#define SELL_SIGMA 1024
+
+// ELLPACK is skipped when it would store more than this many times the
+// non-zeros of a matrix
+#define ELL_MAX_FILL 4
+
+
+//==--- Host Formats -------------------------------------------------------== //
+
+/**
+ * ELLPACK: every row padded to width entries, stored column-major with a
+ * pitch of whole warps.  Padding has column -1.
+ */
+struct ELLMatrix {
+  unsigned           width;
+  unsigned           pitch;
+  std::vector<int>   columns;
+  std::vector<float> values;
+};
+
+/**
+ * SELL-C-sigma with C = SLICE_SIZE and sigma = SELL_SIGMA; see spmv_sell in
+ * spmv_kernel.cl.  Padding is never read, so it is left zero.
+ */
+struct SELLMatrix {
+  std::vector<cl_uint> sliceOffsets;
+  std::vector<cl_uint> rowLengths;
+  std::vector<cl_uint> rows;
+  std::vector<int>     columns;
+  std::vector<float>   values;
+};
+
+/**
+ * A matrix of the benchmark, with the formats built from its CSR form.
+ */
+struct HostMatrix {
+  std::string name;
+  CSRMatrix   csr;
+  bool        hasELL;
+  ELLMatrix   ell;
+  SELLMatrix  sell;
+};
+
+typedef void (*SliceTask)(void* context, unsigned begin, unsigned end);
+
+struct SliceArgs {
+  SliceTask task;
+  void*     context;
+  unsigned  begin;
+  unsigned  end;
+};
+
+static void* sliceThread(void* data) {
+  SliceArgs* args = static_cast<SliceArgs*>(data);
+  args->task(args->context, args->begin, args->end);
+  return NULL;
+}
+
+/**
+ * Splits [0, count) into one contiguous slice per thread and runs task on
+ * every slice in parallel.  Slices that no thread could be created for run
+ * on the calling thread.
+ */
+static void forEachSlice(unsigned numThreads, unsigned count, SliceTask task,
+                         void* context) {
+  std::vector<pthread_t> threads(numThreads);
+  std::vector<SliceArgs> args(numThreads);
+  unsigned               numStarted = 0;
+
+  for(unsigned t = 0; t < numThreads; ++t) {
+    args[t].task    = task;
+    args[t].context = context;
+    args[t].begin   = (size_t)count * t / numThreads;
+    args[t].end     = (size_t)count * (t + 1) / numThreads;
+    if(numStarted == t &&
+       pthread_create(&threads[t], NULL, sliceThread, &args[t]) == 0) {
+      ++numStarted;
+    }
+  }
+  for(unsigned t = numStarted; t < numThreads; ++t) {
+    sliceThread(&args[t]);
+  }
+  for(unsigned t = 0; t < numStarted; ++t) {
+    pthread_join(threads[t], NULL);
+  }
+}
+
+static void fillELLRows(void* context, unsigned begin, unsigned end) {
+  HostMatrix*      matrix = static_cast<HostMatrix*>(context);
+  const CSRMatrix& csr    = matrix->csr;
+  ELLMatrix&       ell    = matrix->ell;
+
+  for(unsigned r = begin; r < end; ++r) {
+    unsigned first = csr.rowOffsets[r];
+    for(unsigned k = 0; k < csr.getRowLength(r); ++k) {
+      ell.columns[k * ell.pitch + r] = csr.columns[first + k];
+      ell.values[k * ell.pitch + r]  = csr.values[first + k];
+    }
+  }
+}
+
+/**
+ * Builds the ELLPACK form of matrix.csr, unless it would store more than
+ * ELL_MAX_FILL times the non-zeros or need a buffer over maxBytes.
+ */
+static void buildELL(HostMatrix& matrix, unsigned numThreads,
+                     size_t maxBytes) {
+  const CSRMatrix& csr = matrix.csr;
+  ELLMatrix&       ell = matrix.ell;
+
+  ell.width = 0;
+  for(unsigned r = 0; r < csr.numRows; ++r) {
+    ell.width = std::max(ell.width, csr.getRowLength(r));
+  }
+  ell.pitch = (csr.numRows + WARP_SIZE - 1) / WARP_SIZE * WARP_SIZE;
+
+  double stored = (double)ell.width * ell.pitch;
+  matrix.hasELL = stored <= (double)ELL_MAX_FILL * csr.getNumNonZeros()
+                  && stored * sizeof(float) <= maxBytes;
+  if(!matrix.hasELL) {
+    return;
+  }
+
+  ell.columns.assign((size_t)ell.width * ell.pitch, -1);
+  ell.values.assign((size_t)ell.width * ell.pitch, 0.0f);
+  forEachSlice(numThreads, csr.numRows, fillELLRows, &matrix);
+}
+
+/**
+ * Orders the rows of a range of sigma-windows by decreasing length.
+ */
+struct LongerRow {
+  const CSRMatrix* csr;
+
+  bool operator()(cl_uint a, cl_uint b) const {
+    return csr->getRowLength(a) > csr->getRowLength(b);
+  }
+};
+
+static void sortSELLWindows(void* context, unsigned begin, unsigned end) {
+  HostMatrix* matrix = static_cast<HostMatrix*>(context);
+  SELLMatrix& sell   = matrix->sell;
+  unsigned    last   = matrix->csr.numRows;
+  LongerRow   longer = { &matrix->csr };
+
+  for(unsigned w = begin; w < end; ++w) {
+    unsigned first = w * SELL_SIGMA;
+    std::stable_sort(sell.rows.begin() + first,
+                     sell.rows.begin() + std::min(first + SELL_SIGMA, last),
+                     longer);
+  }
+}
+
+static void fillSELLSlices(void* context, unsigned begin, unsigned end) {
+  HostMatrix*      matrix = static_cast<HostMatrix*>(context);
+  const CSRMatrix& csr    = matrix->csr;
+  SELLMatrix&      sell   = matrix->sell;
+
+  for(unsigned i = begin * SLICE_SIZE;
+      i < std::min(end * SLICE_SIZE, csr.numRows); ++i) {
+    unsigned row   = sell.rows[i];
+    unsigned first = csr.rowOffsets[row];
+    unsigned base  = sell.sliceOffsets[i / SLICE_SIZE] + i % SLICE_SIZE;
+
+    for(unsigned k = 0; k < sell.rowLengths[i]; ++k) {
+      sell.columns[base + k * SLICE_SIZE] = csr.columns[first + k];
+      sell.values[base + k * SLICE_SIZE]  = csr.values[first + k];
+    }
+  }
+}
+
+/**
+ * Builds the SELL-C-sigma form of matrix.csr.
+ */
+static void buildSELL(HostMatrix& matrix, unsigned numThreads) {
+  const CSRMatrix& csr       = matrix.csr;
+  SELLMatrix&      sell      = matrix.sell;
+  unsigned         numSlices = (csr.numRows + SLICE_SIZE - 1) / SLICE_SIZE;
+
+  sell.rows.resize(csr.numRows);
+  for(unsigned r = 0; r < csr.numRows; ++r) {
+    sell.rows[r] = r;
+  }
+  forEachSlice(numThreads, (csr.numRows + SELL_SIGMA - 1) / SELL_SIGMA,
+               sortSELLWindows, &matrix);
+
+  // Each slice is as wide as its first, and longest, row
+  size_t offset = 0;
+  sell.rowLengths.resize(csr.numRows);
+  sell.sliceOffsets.resize(numSlices + 1);
+  for(unsigned i = 0; i < csr.numRows; ++i) {
+    sell.rowLengths[i] = csr.getRowLength(sell.rows[i]);
+    if(i % SLICE_SIZE == 0) {
+      sell.sliceOffsets[i / SLICE_SIZE] = offset;
+      offset += (size_t)SLICE_SIZE * sell.rowLengths[i];
+    }
+  }
+  sell.sliceOffsets[numSlices] = offset;
+
+  sell.columns.assign(offset, 0);
+  sell.values.assign(offset, 0.0f);
+  forEachSlice(numThreads, numSlices, fillSELLSlices, &matrix);
+}
+
+
+//==--- Synthetic Matrices -------------------------------------------------== //
+
+/**
+ * The 5-point Laplacian of a k*k grid, with k*k close to size: the regular
+ * case, with at most five entries per row and all of them near the
+ * diagonal.
+ */
+static void makeStencil(unsigned size, CSRMatrix& csr) {
+  unsigned k = std::max((unsigned)std::sqrt((double)size), 1u);
+
+  csr = CSRMatrix();
+  csr.numRows = csr.numCols = k * k;
+  csr.rowOffsets.push_back(0);
+  for(unsigned i = 0; i < k; ++i) {
+    for(unsigned j = 0; j < k; ++j) {
+      int row = i * k + j;
+      if(i > 0) {
+        csr.columns.push_back(row - k);
+        csr.values.push_back(-1.0f);
+      }
+      if(j > 0) {
+        csr.columns.push_back(row - 1);
+        csr.values.push_back(-1.0f);
+      }
+      csr.columns.push_back(row);
+      csr.values.push_back(4.0f);
+      if(j + 1 < k) {
+        csr.columns.push_back(row + 1);
+        csr.values.push_back(-1.0f);
+      }
+      if(i + 1 < k) {
+        csr.columns.push_back(row + k);
+        csr.values.push_back(-1.0f);
+      }
+      csr.rowOffsets.push_back(csr.values.size());
+    }
+  }
+}
+
+/**
+ * A size*size matrix with random columns.  With powerLaw, row lengths
+ * follow a Pareto distribution (alpha 1.5, at least 4 entries, at most
+ * 4096), like the degrees of a web or social graph; otherwise they are
+ * uniform in [1, 31].
+ */
+static void makeRandom(unsigned size, bool powerLaw, CSRMatrix& csr) {
+  cl_ulong state = powerLaw ? 0x2545f4914f6cdd1dULL : 0x9e3779b97f4a7c15ULL;
+  std::vector<int> row;
+
+  csr = CSRMatrix();
+  csr.numRows = csr.numCols = size;
+  csr.rowOffsets.push_back(0);
+  for(unsigned r = 0; r < size; ++r) {
+    unsigned length;
+    if(powerLaw) {
+      double u = 1.0 - nextUniform(state);
+      length = (unsigned)std::min(4.0 / std::pow(u, 1.0 / 1.5), 4096.0);
+    } else {
+      length = 1 + (unsigned)(nextUniform(state) * 31);
+    }
+
+    row.resize(length);
+    for(unsigned k = 0; k < length; ++k) {
+      row[k] = (int)(nextUniform(state) * size);
+    }
+    std::sort(row.begin(), row.end());
+    for(unsigned k = 0; k < length; ++k) {
+      csr.columns.push_back(row[k]);
+      csr.values.push_back((float)(2.0 * nextUniform(state) - 1.0));
+    }
+    csr.rowOffsets.push_back(csr.values.size());
+  }
+}
+
+
+//==--- Sample -------------------------------------------------------------== //
+
+enum Format {
+  FORMAT_CSR_SCALAR,
+  FORMAT_CSR_VECTOR,
+  FORMAT_ELL,
+  FORMAT_SELL,
+  NUM_FORMATS
+};
+
+const char* kFormatNames[NUM_FORMATS] = {
+  "csr-scalar", "csr-vector", "ell", "sell"
+};
+
+const char* kKernelNames[NUM_FORMATS] = {
+  "spmv_csr_scalar", "spmv_csr_vector", "spmv_ell", "spmv_sell"
+};
+
+/**
+ * Sparse matrix-vector multiply in CSR (a work-item or a warp per row),
+ * ELLPACK and SELL-C-sigma form, on synthetic matrices and on any Matrix
+ * Market files given.  Each product is checked against the host, and its
+ * GFLOP/s and effective bandwidth (every byte of the format, x and y moved
+ * once) are reported.
+ */
+class SpMVSample : public OCLSample {
+public:
+
+  SpMVSample();
+
+  virtual void run();
+
+  void setProblemSize(unsigned int size) {
+    assert(size > 0 && "Problem size must be positive");
+    ProblemSize_ = size;
+  }
+
+  void setHostThreads(unsigned int threads) {
+    assert(threads > 0 && "At least one host thread is needed");
+    HostThreads_ = threads;
+  }
+
+  void addMatrixFile(const std::string& filename) {
+    MatrixFiles_.push_back(filename);
+  }
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+
+private:
+
+  void addMatrix(const std::string& name, CSRMatrix& csr);
+  template <typename T>
+  cl::Buffer createBuffer(const std::vector<T>& data);
+  double launchSpMV(cl::Kernel& kernel, size_t globalSize);
+  bool runMatrix(cl::Program& program, const HostMatrix& matrix);
+
+  cl::Program programCL_;
+  cl::Program programPTX_;
+
+  cl::Buffer  deviceX_;
+  cl::Buffer  deviceY_;
+
+  std::vector<HostMatrix*> matrices_;
+  std::vector<float>       hostX_;
+  std::vector<std::string> MatrixFiles_;
+
+  unsigned int ProblemSize_;
+  unsigned int HostThreads_;
+};
+
+
+SpMVSample::SpMVSample()
+: ProblemSize_(1 << 20) {
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  HostThreads_ = (processors > 0) ? (unsigned)processors : 1;
+}
+
+void SpMVSample::addMatrix(const std::string& name, CSRMatrix& csr) {
+  size_t      maxBytes = getDevice().getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+  HostMatrix* matrix   = new HostMatrix;
+
+  matrix->name = name;
+  matrix->csr.numRows = csr.numRows;
+  matrix->csr.numCols = csr.numCols;
+  matrix->csr.rowOffsets.swap(csr.rowOffsets);
+  matrix->csr.columns.swap(csr.columns);
+  matrix->csr.values.swap(csr.values);
+
+  buildELL(*matrix, HostThreads_, maxBytes);
+  buildSELL(*matrix, HostThreads_);
+  matrices_.push_back(matrix);
+}
+
+void SpMVSample::initialize() {
+  CSRMatrix csr;
+
+  programCL_ = compileSource("spmv_kernel.cl");
+  programPTX_ = loadBinary("spmv_kernel.ptx");
+
+  makeStencil(ProblemSize_, csr);
+  addMatrix("stencil", csr);
+  makeRandom(ProblemSize_, false, csr);
+  addMatrix("random", csr);
+  makeRandom(ProblemSize_, true, csr);
+  addMatrix("power-law", csr);
+
+  for(size_t f = 0; f < MatrixFiles_.size(); ++f) {
+    double start = getTimeStamp();
+    if(!loadMatrixMarket(MatrixFiles_[f], HostThreads_, csr)) {
+      std::cerr << "Failed to load Matrix Market file " << MatrixFiles_[f]
+                << "\n";
+      exit(1);
+    }
+    std::cout << "Loaded " << MatrixFiles_[f] << " in " << std::fixed
+              << std::setprecision(2) << getTimeStamp() - start << " s\n";
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+
+    // Name the matrix after the file, without its directory
+    std::string name = MatrixFiles_[f];
+    addMatrix(name.substr(name.find_last_of('/') + 1), csr);
+  }
+
+  // For this sample, let's run 16 iterations
+  setNumberOfIterations(16);
+}
+
+void SpMVSample::createMemoryBuffers() {
+  cl_int   result;
+  unsigned maxRows = 0;
+  unsigned maxCols = 0;
+  cl_ulong state   = 0x853c49e6748fea9bULL;
+
+  for(size_t m = 0; m < matrices_.size(); ++m) {
+    maxRows = std::max(maxRows, matrices_[m]->csr.numRows);
+    maxCols = std::max(maxCols, matrices_[m]->csr.numCols);
+  }
+
+  // Every matrix multiplies a prefix of the same x
+  hostX_.resize(maxCols);
+  for(unsigned i = 0; i < maxCols; ++i) {
+    hostX_[i] = (float)(2.0 * nextUniform(state) - 1.0);
+  }
+
+  deviceX_ = createBuffer(hostX_);
+  deviceY_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE,
+                        maxRows*sizeof(float), NULL, &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+}
+
+template <typename T>
+cl::Buffer SpMVSample::createBuffer(const std::vector<T>& data) {
+  cl_int     result;
+  cl::Buffer buffer;
+
+  // Buffers may not be empty, even for a matrix without non-zeros
+  if(data.empty()) {
+    buffer = cl::Buffer(getContext(), CL_MEM_READ_ONLY, sizeof(T), NULL,
+                        &result);
+  } else {
+    buffer = cl::Buffer(getContext(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                        data.size()*sizeof(T), const_cast<T*>(&data[0]),
+                        &result);
+  }
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  return buffer;
+}
+
+double SpMVSample::launchSpMV(cl::Kernel& kernel, size_t globalSize) {
+  cl_int      result;
+  cl::Event   event;
+  cl::NDRange global((globalSize + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE);
+  cl::NDRange local(BLOCK_SIZE);
+
+  result = getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange,
+                                                  global, local, NULL,
+                                                  &event);
+  assert(result == CL_SUCCESS && "Failed to launch kernel");
+  return getElapsed(event, event);
+}
+
+bool SpMVSample::runMatrix(cl::Program& program, const HostMatrix& matrix) {
+  cl_int            result;
+  const CSRMatrix&  csr    = matrix.csr;
+  const SELLMatrix& sell   = matrix.sell;
+  size_t            nnz    = csr.getNumNonZeros();
+  bool              passed = true;
+
+  // Host reference, and the magnitude that bounds each row's rounding error
+  std::vector<double> expected(csr.numRows);
+  std::vector<double> magnitude(csr.numRows);
+  unsigned            longest = 0;
+  for(unsigned r = 0; r < csr.numRows; ++r) {
+    double sum = 0.0, bound = 0.0;
+    for(unsigned j = csr.rowOffsets[r]; j < csr.rowOffsets[r + 1]; ++j) {
+      double term = (double)csr.values[j] * hostX_[csr.columns[j]];
+      sum   += term;
+      bound += std::fabs(term);
+    }
+    expected[r]  = sum;
+    magnitude[r] = bound;
+    longest      = std::max(longest, csr.getRowLength(r));
+  }
+
+  std::cout << "* " << matrix.name << ": " << csr.numRows << " x "
+            << csr.numCols << ", " << nnz << " non-zeros (" << std::fixed
+            << std::setprecision(1) << (double)nnz / csr.numRows
+            << " per row, longest " << longest << ")\n";
+  std::cout.unsetf(std::ios::floatfield);
+  std::cout << std::setprecision(6);
+  std::cout << std::setw(12) << "format" << std::setw(8) << "fill"
+            << std::setw(12) << "median ms" << std::setw(10) << "GFLOP/s"
+            << std::setw(9) << "GB/s" << "\n";
+
+  for(int f = 0; f < NUM_FORMATS; ++f) {
+    std::cout << std::setw(12) << kFormatNames[f];
+    if(f == FORMAT_ELL && !matrix.hasELL) {
+      std::cout << std::setw(8) << "-" << "\n";
+      continue;
+    }
+
+    cl::Kernel kernel(program, kKernelNames[f], &result);
+    assert(result == CL_SUCCESS && "Failed to extract kernel");
+
+    // The format's buffers, and the bytes a product reads from them
+    std::vector<cl::Buffer> buffers;
+    double                  stored;
+    size_t                  globalSize = csr.numRows;
+    size_t                  bytes;
+    if(f == FORMAT_ELL) {
+      const ELLMatrix& ell = matrix.ell;
+      stored = (double)ell.width * ell.pitch;
+      bytes  = ell.columns.size()*sizeof(int)
+               + ell.values.size()*sizeof(float);
+      buffers.push_back(createBuffer(ell.columns));
+      buffers.push_back(createBuffer(ell.values));
+    } else if(f == FORMAT_SELL) {
+      stored = (double)sell.values.size();
+      bytes  = sell.sliceOffsets.size()*sizeof(cl_uint)
+               + csr.numRows*2*sizeof(cl_uint)
+               + sell.columns.size()*sizeof(int)
+               + sell.values.size()*sizeof(float);
+      buffers.push_back(createBuffer(sell.sliceOffsets));
+      buffers.push_back(createBuffer(sell.rowLengths));
+      buffers.push_back(createBuffer(sell.rows));
+      buffers.push_back(createBuffer(sell.columns));
+      buffers.push_back(createBuffer(sell.values));
+    } else {
+      stored = (double)nnz;
+      bytes  = csr.rowOffsets.size()*sizeof(cl_uint)
+               + nnz*(sizeof(int) + sizeof(float));
+      buffers.push_back(createBuffer(csr.rowOffsets));
+      buffers.push_back(createBuffer(csr.columns));
+      buffers.push_back(createBuffer(csr.values));
+      if(f == FORMAT_CSR_VECTOR) {
+        globalSize *= WARP_SIZE;
+      }
+    }
+    bytes += (csr.numCols + csr.numRows)*sizeof(float);
+
+    // Format buffers, then x, y and the sizes
+    cl_uint arg = 0;
+    for(size_t b = 0; b < buffers.size(); ++b, ++arg) {
+      result = kernel.setArg(arg, buffers[b]);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument");
+    }
+    result = kernel.setArg(arg++, deviceX_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument");
+    result = kernel.setArg(arg++, deviceY_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument");
+    result = kernel.setArg(arg++, (cl_uint)csr.numRows);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument");
+    if(f == FORMAT_ELL) {
+      result = kernel.setArg(arg++, (cl_uint)matrix.ell.width);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument");
+      result = kernel.setArg(arg++, (cl_uint)matrix.ell.pitch);
+      assert(result == CL_SUCCESS && "Failed to set kernel argument");
+    }
+
+    // The first launch is a warm-up
+    std::vector<double> times;
+    launchSpMV(kernel, globalSize);
+    for(unsigned i = 0; i < getNumberOfIterations(); ++i) {
+      times.push_back(launchSpMV(kernel, globalSize));
+    }
+
+    std::vector<float> y(csr.numRows);
+    result = getCommandQueue().enqueueReadBuffer(deviceY_, CL_TRUE, 0,
+                                                 csr.numRows*sizeof(float),
+                                                 &y[0], NULL, NULL);
+    assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+
+    // Each format sums a row in its own order, and rows of the power-law
+    // matrix are thousands of entries long
+    bool correct = true;
+    for(unsigned r = 0; correct && r < csr.numRows; ++r) {
+      correct = std::fabs(y[r] - expected[r]) <= 1e-4 * magnitude[r];
+    }
+    passed = passed && correct;
+
+    double time = median(times);
+
+    std::cout << std::fixed << std::setprecision(2) << std::setw(8)
+              << stored / nnz << std::setprecision(3) << std::setw(12)
+              << time * 1e3 << std::setprecision(2) << std::setw(10)
+              << 2.0 * nnz / time / 1e9 << std::setw(9)
+              << bytes / time / 1e9 << (correct ? "" : "  FAILED") << "\n";
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+  }
+
+  return passed;
+}
+
+void SpMVSample::run() {
+  initialize();
+  createMemoryBuffers();
+
+  std::cout << "Problem Size:         " << ProblemSize_ << "\n";
+  std::cout << "Host Threads:         " << HostThreads_ << "\n";
+
+  cl::Program* programs[2] = { &programCL_, &programPTX_ };
+  const char*  names[2]    = { "Source", "Binary" };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    bool passed = true;
+
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernels\n";
+    std::cout << "------------------------------\n";
+
+    for(size_t m = 0; m < matrices_.size(); ++m) {
+      passed = runMatrix(*programs[k], *matrices_[m]) && passed;
+    }
+
+    if(passed) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+  }
+
+  for(size_t m = 0; m < matrices_.size(); ++m) {
+    delete matrices_[m];
+  }
+  matrices_.clear();
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options] [file.mtx ...]\n"
+            << "  --size N            Rows of the synthetic matrices "
+               "(default 1048576)\n"
+            << "  --threads N         Threads that build the host formats "
+               "(default: one per processor)\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  SpMVSample sample;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--size" && i+1 < argc) {
+      sample.setProblemSize(atoi(argv[++i]));
+    } else if(arg == "--threads" && i+1 < argc) {
+      sample.setHostThreads(atoi(argv[++i]));
+    } else if(arg.compare(0, 2, "--") != 0) {
+      sample.addMatrixFile(arg);
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sample.run();
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+// These must match spmv.cpp
+#define BLOCK_SIZE 256
+#define WARP_SIZE  32
+#define SLICE_SIZE 32
+
+// Every kernel computes y = A*x for one storage format of A.  Column indices
+// are signed so that ELLPACK can mark its padding with -1.
+
+/**
+ * CSR, one work-item per row.  Neighbouring work-items walk different rows,
+ * so their loads of the matrix are not coalesced, and a long row holds up
+ * its whole warp.
+ */
+__kernel void spmv_csr_scalar(__global const uint* rowOffsets,
+                              __global const int* columns,
+                              __global const float* values,
+                              __global const float* x, __global float* y,
+                              uint numRows) {
+  uint  row = get_global_id(0);
+  float sum = 0.0f;
+  uint  j;
+
+  if(row >= numRows) {
+    return;
+  }
+  for(j = rowOffsets[row]; j < rowOffsets[row + 1]; ++j) {
+    sum += values[j] * x[columns[j]];
+  }
+  y[row] = sum;
+}
+
+/**
+ * CSR, one warp per row.  The lanes of a warp read consecutive entries of
+ * the row, and their partial sums are reduced in local memory.  Rows much
+ * shorter than a warp leave most lanes idle.
+ */
+__kernel void spmv_csr_vector(__global const uint* rowOffsets,
+                              __global const int* columns,
+                              __global const float* values,
+                              __global const float* x, __global float* y,
+                              uint numRows) {
+  __local float scratch[BLOCK_SIZE];
+  uint  tid  = get_local_id(0);
+  uint  lane = tid % WARP_SIZE;
+  uint  row  = get_global_id(0) / WARP_SIZE;
+  float sum  = 0.0f;
+  uint  j, s;
+
+  if(row < numRows) {
+    for(j = rowOffsets[row] + lane; j < rowOffsets[row + 1];
+        j += WARP_SIZE) {
+      sum += values[j] * x[columns[j]];
+    }
+  }
+
+  // Every work-item reaches the barriers, including those past the last row
+  scratch[tid] = sum;
+  barrier(CLK_LOCAL_MEM_FENCE);
+  for(s = WARP_SIZE / 2; s > 0; s /= 2) {
+    if(lane < s) {
+      scratch[tid] += scratch[tid + s];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  if(lane == 0 && row < numRows) {
+    y[row] = scratch[tid];
+  }
+}
+
+/**
+ * ELLPACK, one work-item per row.  Every row is padded to the longest, and
+ * entry k of row i is stored at k*pitch + i, so the loads of a warp are
+ * coalesced.  Padding sits at the end of each row.
+ */
+__kernel void spmv_ell(__global const int* columns,
+                       __global const float* values,
+                       __global const float* x, __global float* y,
+                       uint numRows, uint width, uint pitch) {
+  uint  row = get_global_id(0);
+  float sum = 0.0f;
+  uint  k;
+
+  if(row >= numRows) {
+    return;
+  }
+  for(k = 0; k < width; ++k) {
+    int column = columns[k * pitch + row];
+    if(column < 0) {
+      break;
+    }
+    sum += values[k * pitch + row] * x[column];
+  }
+  y[row] = sum;
+}
+
+/**
+ * SELL-C-sigma, one work-item per row.  Rows are sorted by length within
+ * windows of sigma rows, and each slice of SLICE_SIZE sorted rows is stored
+ * like a small ELLPACK matrix padded to its own longest row, so a warp's
+ * rows have similar lengths and little padding is stored.  Row i of the
+ * sorted order is row rows[i] of the matrix.
+ */
+__kernel void spmv_sell(__global const uint* sliceOffsets,
+                        __global const uint* rowLengths,
+                        __global const uint* rows,
+                        __global const int* columns,
+                        __global const float* values,
+                        __global const float* x, __global float* y,
+                        uint numRows) {
+  uint  i   = get_global_id(0);
+  float sum = 0.0f;
+  uint  base, length, k;
+
+  if(i >= numRows) {
+    return;
+  }
+  base   = sliceOffsets[i / SLICE_SIZE] + i % SLICE_SIZE;
+  length = rowLengths[i];
+  for(k = 0; k < length; ++k) {
+    sum += values[base + k * SLICE_SIZE] * x[columns[base + k * SLICE_SIZE]];
+  }
+  y[rows[i]] = sum;
+}
@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "common/OCLSample.hpp"
+
+// These must be changed to reflect changes in transpose_kernel.cl
+#define TILE_DIM   32
+#define BLOCK_ROWS 8
+
+/**
+ * A kernel of transpose_kernel.cl.  The copy kernel does not transpose, and
+ * is the bandwidth the others are compared against.
+ */
+struct Variant {
+  const char* name;
+  const char* kernel;
+  bool        transposes;
+};
+
+const Variant kVariants[] = {
+  { "copy",     "copy",               false },
+  { "naive",    "transpose_naive",    true  },
+  { "tiled",    "transpose_tiled",    true  },
+  { "padded",   "transpose_padded",   true  },
+  { "diagonal", "transpose_diagonal", true  }
+};
+
+const int kNumVariants = sizeof(kVariants) / sizeof(kVariants[0]);
+
+/**
+ * Transposes a matrix naively, through a local memory tile with and without
+ * padding against bank conflicts, and with work-groups ordered along
+ * diagonals against partition camping, for both the source and the binary
+ * program.  Each result is checked against the host, and its GB/s is
+ * reported next to that of a copy kernel with the same access pattern.
+ */
+class TransposeSample : public OCLSample {
+public:
+
+  TransposeSample();
+
+  virtual void run();
+
+  void setWidth(unsigned int width) {
+    assert(width > 0 && "Width must be positive");
+    Width_ = width;
+  }
+
+  void setHeight(unsigned int height) {
+    assert(height > 0 && "Height must be positive");
+    Height_ = height;
+  }
+
+protected:
+
+  virtual void initialize();
+  virtual void createMemoryBuffers();
+
+private:
+
+  double launchVariant(cl::Kernel& kernel);
+  bool runVariants(cl::Program& program);
+
+  cl::Program programCL_;
+  cl::Program programPTX_;
+
+  cl::Buffer  deviceIn_;
+  cl::Buffer  deviceOut_;
+
+  std::vector<float> hostIn_;
+
+  unsigned int Width_;
+  unsigned int Height_;
+};
+
+
+TransposeSample::TransposeSample()
+: Width_(4096), Height_(4096) {
+}
+
+void TransposeSample::initialize() {
+  programCL_ = compileSource("transpose_kernel.cl");
+  programPTX_ = loadBinary("transpose_kernel.ptx");
+
+  // For this sample, let's run 16 iterations
+  setNumberOfIterations(16);
+}
+
+void TransposeSample::createMemoryBuffers() {
+  cl_int result;
+  size_t bytes = (size_t)Width_*Height_*sizeof(float);
+
+  srand(time(NULL));
+  hostIn_.resize((size_t)Width_*Height_);
+  for(size_t i = 0; i < hostIn_.size(); ++i) {
+    hostIn_[i] = rand() / ((float)RAND_MAX + 1.0f);
+  }
+
+  deviceIn_ = cl::Buffer(getContext(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                         bytes, &hostIn_[0], &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+  deviceOut_ = cl::Buffer(getContext(), CL_MEM_READ_WRITE, bytes, NULL,
+                          &result);
+  assert(result == CL_SUCCESS && "Failed to allocate device buffer");
+}
+
+double TransposeSample::launchVariant(cl::Kernel& kernel) {
+  cl_int      result;
+  cl::Event   event;
+  cl::NDRange global((Width_ + TILE_DIM - 1) / TILE_DIM * TILE_DIM,
+                     (Height_ + TILE_DIM - 1) / TILE_DIM * BLOCK_ROWS);
+  cl::NDRange local(TILE_DIM, BLOCK_ROWS);
+
+  result = getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange,
+                                                  global, local, NULL,
+                                                  &event);
+  assert(result == CL_SUCCESS && "Failed to launch kernel");
+  return getElapsed(event, event);
+}
+
+bool TransposeSample::runVariants(cl::Program& program) {
+  cl_int             result;
+  bool               passed   = true;
+  double             copyRate = 0.0;
+  size_t             count    = (size_t)Width_*Height_;
+  std::vector<float> hostOut(count);
+
+  std::cout << std::setw(12) << "kernel" << std::setw(12) << "median ms"
+            << std::setw(9) << "GB/s" << std::setw(9) << "% copy" << "\n";
+
+  for(int v = 0; v < kNumVariants; ++v) {
+    const Variant& variant = kVariants[v];
+    cl::Kernel     kernel(program, variant.kernel, &result);
+    assert(result == CL_SUCCESS && "Failed to extract kernel");
+
+    result = kernel.setArg(0, deviceIn_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 0");
+    result = kernel.setArg(1, deviceOut_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 1");
+    result = kernel.setArg(2, (cl_int)Width_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 2");
+    result = kernel.setArg(3, (cl_int)Height_);
+    assert(result == CL_SUCCESS && "Failed to set kernel argument 3");
+
+    // Clear the output, so that elements a kernel misses are caught
+    std::fill(hostOut.begin(), hostOut.end(), -1.0f);
+    result = getCommandQueue().enqueueWriteBuffer(deviceOut_, CL_TRUE, 0,
+                                                  count*sizeof(float),
+                                                  &hostOut[0], NULL, NULL);
+    assert(result == CL_SUCCESS && "Failed to queue data copy to device");
+
+    // The first launch is a warm-up
+    std::vector<double> times;
+    launchVariant(kernel);
+    for(unsigned i = 0; i < getNumberOfIterations(); ++i) {
+      times.push_back(launchVariant(kernel));
+    }
+
+    result = getCommandQueue().enqueueReadBuffer(deviceOut_, CL_TRUE, 0,
+                                                 count*sizeof(float),
+                                                 &hostOut[0], NULL, NULL);
+    assert(result == CL_SUCCESS && "Failed to queue data copy to host");
+
+    // Element (x, y) of the input is element (y, x) of the transpose
+    bool correct = true;
+    for(unsigned y = 0; correct && y < Height_; ++y) {
+      for(unsigned x = 0; correct && x < Width_; ++x) {
+        size_t to = variant.transposes ? (size_t)x*Height_ + y
+                                       : (size_t)y*Width_ + x;
+        correct = hostOut[to] == hostIn_[(size_t)y*Width_ + x];
+      }
+    }
+    passed = passed && correct;
+
+    // A read and a write per element
+    double time = median(times);
+    double rate = 2.0 * count * sizeof(float) / time / 1e9;
+    if(!variant.transposes) {
+      copyRate = rate;
+    }
+
+    std::cout << std::setw(12) << variant.name << std::fixed
+              << std::setprecision(3) << std::setw(12) << time * 1e3
+              << std::setprecision(2) << std::setw(9) << rate
+              << std::setw(9) << 100.0 * rate / copyRate
+              << (correct ? "" : "  FAILED") << "\n";
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+  }
+
+  return passed;
+}
+
+void TransposeSample::run() {
+  initialize();
+  createMemoryBuffers();
+
+  std::cout << "Problem Size:         " << Width_ << " x " << Height_ << "\n";
+
+  cl::Program* programs[2] = { &programCL_, &programPTX_ };
+  const char*  names[2]    = { "Source", "Binary" };
+
+  for(unsigned int k = 0; k < 2; ++k) {
+    std::cout << "------------------------------\n";
+    std::cout << "* " << names[k] << " Kernels\n";
+    std::cout << "------------------------------\n";
+
+    if(runVariants(*programs[k])) {
+      std::cout << "Host reference comparison test PASSED\n";
+    } else {
+      std::cout << "Host reference comparison test FAILED\n";
+    }
+  }
+}
+
+static void usage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --width N           Columns of the matrix (default 4096)\n"
+            << "  --height N          Rows of the matrix (default 4096)\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  TransposeSample sample;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if(arg == "--width" && i+1 < argc) {
+      sample.setWidth(atoi(argv[++i]));
+    } else if(arg == "--height" && i+1 < argc) {
+      sample.setHeight(atoi(argv[++i]));
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sample.run();
+
+  return 0;
+}
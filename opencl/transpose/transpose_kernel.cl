@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+// These must match transpose.cpp
+#define TILE_DIM   32
+#define BLOCK_ROWS 8
+
+// Every kernel moves a TILE_DIM x TILE_DIM tile of a width x height matrix
+// per work-group of TILE_DIM x BLOCK_ROWS work-items, each work-item
+// handling TILE_DIM / BLOCK_ROWS elements of a column.  Tiles on the right
+// and bottom edges may be partial.  The transposed matrix is height x width.
+
+/**
+ * Straight copy with the same access pattern as the transposes, as the
+ * bandwidth they should reach.
+ */
+__kernel void copy(__global const float* in, __global float* out,
+                   int width, int height) {
+  int x = get_group_id(0) * TILE_DIM + get_local_id(0);
+  int y = get_group_id(1) * TILE_DIM + get_local_id(1);
+  int j;
+
+  for(j = 0; j < TILE_DIM; j += BLOCK_ROWS) {
+    if(x < width && y + j < height) {
+      out[(y + j) * width + x] = in[(y + j) * width + x];
+    }
+  }
+}
+
+/**
+ * Reads rows and writes columns directly, so the reads of a warp are
+ * coalesced and its writes are TILE_DIM separate transactions.
+ */
+__kernel void transpose_naive(__global const float* in, __global float* out,
+                              int width, int height) {
+  int x = get_group_id(0) * TILE_DIM + get_local_id(0);
+  int y = get_group_id(1) * TILE_DIM + get_local_id(1);
+  int j;
+
+  for(j = 0; j < TILE_DIM; j += BLOCK_ROWS) {
+    if(x < width && y + j < height) {
+      out[x * height + y + j] = in[(y + j) * width + x];
+    }
+  }
+}
+
+/**
+ * Transposes the tile at (groupX, groupY) through tile, so that both the
+ * reads and the writes of a warp are coalesced.  Whether reading a column
+ * of tile conflicts on the local memory banks depends on its row pitch.
+ */
+inline void transpose_tile(__global const float* in, __global float* out,
+                           int width, int height, int groupX, int groupY,
+                           __local float* tile, int pitch) {
+  int tidX = get_local_id(0);
+  int tidY = get_local_id(1);
+  int x    = groupX * TILE_DIM + tidX;
+  int y    = groupY * TILE_DIM + tidY;
+  int j;
+
+  for(j = 0; j < TILE_DIM; j += BLOCK_ROWS) {
+    if(x < width && y + j < height) {
+      tile[(tidY + j) * pitch + tidX] = in[(y + j) * width + x];
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  // The tile's column tidX becomes row tidX of the output tile
+  x = groupY * TILE_DIM + tidX;
+  y = groupX * TILE_DIM + tidY;
+  for(j = 0; j < TILE_DIM; j += BLOCK_ROWS) {
+    if(x < height && y + j < width) {
+      out[(y + j) * height + x] = tile[tidX * pitch + tidY + j];
+    }
+  }
+}
+
+/**
+ * Tiled through local memory with a row pitch of TILE_DIM words, so the
+ * TILE_DIM reads of a tile column all fall in the same bank.
+ */
+__kernel void transpose_tiled(__global const float* in, __global float* out,
+                              int width, int height) {
+  __local float tile[TILE_DIM * TILE_DIM];
+
+  transpose_tile(in, out, width, height, get_group_id(0), get_group_id(1),
+                 tile, TILE_DIM);
+}
+
+/**
+ * Tiled with one word of padding per row, which spreads a tile column over
+ * all the banks.
+ */
+__kernel void transpose_padded(__global const float* in, __global float* out,
+                               int width, int height) {
+  __local float tile[TILE_DIM * (TILE_DIM + 1)];
+
+  transpose_tile(in, out, width, height, get_group_id(0), get_group_id(1),
+                 tile, TILE_DIM + 1);
+}
+
+/**
+ * Padded, with work-groups assigned to tiles along diagonals.  Groups run
+ * roughly in order of their linear index; with the usual row-major order,
+ * the concurrent groups of a power-of-two wide matrix write columns that map
+ * to the same few memory partitions, while diagonal order spreads them.
+ */
+__kernel void transpose_diagonal(__global const float* in,
+                                 __global float* out, int width,
+                                 int height) {
+  __local float tile[TILE_DIM * (TILE_DIM + 1)];
+  int numX = get_num_groups(0);
+  int numY = get_num_groups(1);
+  int groupX, groupY;
+
+  if(numX == numY) {
+    groupY = get_group_id(0);
+    groupX = (get_group_id(0) + get_group_id(1)) % numX;
+  } else {
+    int linear = get_group_id(1) * numX + get_group_id(0);
+    groupY = linear % numY;
+    groupX = (linear / numY + groupY) % numX;
+  }
+
+  transpose_tile(in, out, width, height, groupX, groupY, tile,
+                 TILE_DIM + 1);
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <stdint.h>
+#include "common/PTXInterpreter.hpp"
+
+/**
+ * Checks that the PTX interpreter reports kernel accesses outside device
+ * allocations as launch faults instead of touching host memory.  Every case
+ * runs against both HostMemory, where device addresses are host pointers,
+ * and ArenaMemory.
+ */
+
+namespace {
+
+const char* kSource =
+  ".version 3.2\n"
+  ".target sm_20\n"
+  ".address_size 64\n"
+  "\n"
+  ".visible .entry store_word(\n"
+  "\t.param .u64 store_word_param_0,\n"
+  "\t.param .u64 store_word_param_1\n"
+  ")\n"
+  "{\n"
+  "\t.reg .b32 \t%r<2>;\n"
+  "\t.reg .b64 \t%rd<4>;\n"
+  "\n"
+  "\tld.param.u64 \t%rd1, [store_word_param_0];\n"
+  "\tld.param.u64 \t%rd2, [store_word_param_1];\n"
+  "\tadd.s64 \t%rd3, %rd1, %rd2;\n"
+  "\tmov.u32 \t%r1, 42;\n"
+  "\tst.global.u32 \t[%rd3], %r1;\n"
+  "\tret;\n"
+  "}\n"
+  "\n"
+  ".visible .entry store_far(\n"
+  "\t.param .u64 store_far_param_0\n"
+  ")\n"
+  "{\n"
+  "\t.reg .b32 \t%r<2>;\n"
+  "\t.reg .b64 \t%rd<2>;\n"
+  "\n"
+  "\tld.param.u64 \t%rd1, [store_far_param_0];\n"
+  "\tmov.u32 \t%r1, 42;\n"
+  "\tst.global.u32 \t[%rd1+100000000000], %r1;\n"
+  "\tret;\n"
+  "}\n"
+  "\n"
+  ".visible .entry load_word(\n"
+  "\t.param .u64 load_word_param_0,\n"
+  "\t.param .u64 load_word_param_1,\n"
+  "\t.param .u64 load_word_param_2\n"
+  ")\n"
+  "{\n"
+  "\t.reg .b32 \t%r<2>;\n"
+  "\t.reg .b64 \t%rd<5>;\n"
+  "\n"
+  "\tld.param.u64 \t%rd1, [load_word_param_0];\n"
+  "\tld.param.u64 \t%rd2, [load_word_param_1];\n"
+  "\tld.param.u64 \t%rd3, [load_word_param_2];\n"
+  "\tadd.s64 \t%rd4, %rd2, %rd3;\n"
+  "\tld.global.u32 \t%r1, [%rd4];\n"
+  "\tst.global.u32 \t[%rd1], %r1;\n"
+  "\tret;\n"
+  "}\n";
+
+const unsigned kGrid[3]  = { 1, 1, 1 };
+const unsigned kBlock[3] = { 1, 1, 1 };
+
+/**
+ * Launches name with the given parameters on one thread and checks that it
+ * succeeds, or fails with an invalid global address, as expected.
+ */
+bool expectLaunch(const ptx::Program& program, const std::string& name,
+                  const uint64_t* params, unsigned numParams,
+                  bool expectSuccess) {
+  const ptx::Kernel* kernel = program.getKernel(name);
+  std::string        error;
+
+  bool ok = program.launch(*kernel, kGrid, kBlock, params,
+                           numParams * sizeof(uint64_t), 0, error, 1);
+  if(ok != expectSuccess) {
+    std::cout << "  " << name << ": expected "
+              << (expectSuccess ? "success" : "a fault") << ", got "
+              << (ok ? "success" : error) << "\n";
+    return false;
+  }
+  if(!ok && error.find("invalid global address") == std::string::npos) {
+    std::cout << "  " << name << ": unexpected fault: " << error << "\n";
+    return false;
+  }
+  return true;
+}
+
+bool runCases(ptx::Memory& memory, const char* label) {
+  ptx::Program program;
+  std::string  log;
+  bool         passed = true;
+
+  std::cout << label << "\n";
+  if(!program.load(kSource, memory, log)) {
+    std::cout << "  failed to load module: " << log << "\n";
+    return false;
+  }
+
+  uint64_t  buffer = memory.allocate(16);
+  uint64_t  result = memory.allocate(4);
+  uint32_t* words  = (uint32_t*)(memory.getBase() + buffer);
+  memset(words, 0, 16);
+
+  // In bounds: the last word of the buffer
+  uint64_t last[2] = { buffer, 12 };
+  passed &= expectLaunch(program, "store_word", last, 2, true);
+  if(words[3] != 42) {
+    std::cout << "  store_word: in-bounds store was lost\n";
+    passed = false;
+  }
+
+  // One past the end, far past the end, and below the start
+  uint64_t end[2]   = { buffer, 16 };
+  uint64_t far[1]   = { buffer };
+  uint64_t below[2] = { buffer, (uint64_t)-4 };
+  passed &= expectLaunch(program, "store_word", end, 2, false);
+  passed &= expectLaunch(program, "store_far", far, 1, false);
+  passed &= expectLaunch(program, "store_word", below, 2, false);
+
+  // Loads are checked the same way
+  uint64_t load[3]    = { result, buffer, 12 };
+  uint64_t overrun[3] = { result, buffer, 14 };
+  passed &= expectLaunch(program, "load_word", load, 3, true);
+  passed &= expectLaunch(program, "load_word", overrun, 3, false);
+
+  // A released buffer is no longer addressable
+  memory.release(buffer);
+  passed &= expectLaunch(program, "store_word", last, 2, false);
+
+  memory.release(result);
+  return passed;
+}
+
+}
+
+int main() {
+  ptx::HostMemory  host;
+  ptx::ArenaMemory arena(16 << 20);
+  bool             passed = true;
+
+  passed &= runCases(host, "HostMemory");
+  passed &= runCases(arena, "ArenaMemory");
+
+  std::cout << "Out-of-bounds access test " << (passed ? "PASSED" : "FAILED")
+            << "\n";
+  return passed ? 0 : 1;
+}
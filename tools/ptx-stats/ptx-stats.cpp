@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2011 by Justin Holewinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include "common/PTXAnalysis.hpp"
+
+/**
+ * ptx-stats: reports what llc generated for each kernel of one or more PTX
+ * files -- register classes and estimated register pressure, shared and
+ * local memory, memory instruction mix, FMA and branch counts -- and the
+ * occupancy those resources allow on a chosen SM model.  The build runs it
+ * on every generated .ptx so that code-quality regressions show up without
+ * a device.
+ */
+
+namespace {
+
+struct Options {
+
+  Options()
+  : model(ptx::findSMModel("sm_20")), blockSize(256), maxRegisters(0),
+    maxLocal(-1) {
+  }
+
+  const ptx::SMModel*      model;
+  unsigned                 blockSize;
+  unsigned                 maxRegisters;   ///< 0: no limit
+  long                     maxLocal;       ///< Negative: no limit
+  std::string              output;
+  std::vector<std::string> files;
+};
+
+void printUsage(const char* program) {
+  std::cerr << "Usage: " << program << " [options] file.ptx...\n"
+            << "  --sm <model>             SM model for occupancy"
+            << " (default sm_20)\n"
+            << "  --block <threads>        Block size of kernels that do not"
+            << " fix one (default 256)\n"
+            << "  --max-registers <count>  Fail if a kernel needs more"
+            << " registers\n"
+            << "  --max-local <bytes>      Fail if a kernel uses more local"
+            << " memory\n"
+            << "  -o <file>                Also write the report to file\n"
+            << "Models:";
+  for(const ptx::SMModel* model = ptx::getSMModels(); model->name != NULL;
+      ++model) {
+    std::cerr << " " << model->name;
+  }
+  std::cerr << "\n";
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  for(int i = 1; i < argc; ++i) {
+    std::string arg  = argv[i];
+    bool        more = i + 1 < argc;
+
+    if(arg == "--sm" && more) {
+      options.model = ptx::findSMModel(argv[++i]);
+      if(options.model == NULL) {
+        std::cerr << "Unknown SM model '" << argv[i] << "'\n";
+        return false;
+      }
+    } else if(arg == "--block" && more) {
+      options.blockSize = (unsigned)atoi(argv[++i]);
+    } else if(arg == "--max-registers" && more) {
+      options.maxRegisters = (unsigned)atoi(argv[++i]);
+    } else if(arg == "--max-local" && more) {
+      options.maxLocal = atol(argv[++i]);
+    } else if(arg == "-o" && more) {
+      options.output = argv[++i];
+    } else if(!arg.empty() && arg[0] == '-') {
+      return false;
+    } else {
+      options.files.push_back(arg);
+    }
+  }
+  return !options.files.empty() && options.blockSize > 0;
+}
+
+void printRegisters(std::ostream& out, const ptx::KernelStats& stats) {
+  out << "  Registers (virtual):   ";
+  if(stats.registerClasses.empty()) {
+    out << "none";
+  }
+  for(size_t i = 0; i < stats.registerClasses.size(); ++i) {
+    const ptx::RegisterClass& regClass = stats.registerClasses[i];
+    out << (i > 0 ? ", " : "") << regClass.name << " ."
+        << ptx::getTypeName(regClass.type) << " " << regClass.count;
+  }
+  out << "\n";
+  out << "  Registers (estimated): " << stats.estimatedRegisters << " (+"
+      << stats.estimatedPredicates << " predicates)\n";
+}
+
+void printAccesses(std::ostream& out, const char* label,
+                   const unsigned counts[ptx::NUM_SPACES][2]) {
+  static const ptx::StateSpace kSpaces[] = {
+    ptx::SPACE_GLOBAL, ptx::SPACE_SHARED, ptx::SPACE_LOCAL,
+    ptx::SPACE_CONST, ptx::SPACE_GENERIC
+  };
+
+  for(size_t i = 0; i < sizeof(kSpaces) / sizeof(kSpaces[0]); ++i) {
+    const unsigned* count = counts[kSpaces[i]];
+    if(count[0] == 0 && count[1] == 0 && kSpaces[i] != ptx::SPACE_GLOBAL &&
+       kSpaces[i] != ptx::SPACE_SHARED) {
+      continue;
+    }
+
+    std::string name = std::string(ptx::getSpaceName(kSpaces[i])) + " " +
+      label + ":";
+    name[0] = (char)toupper(name[0]);
+    out << "  " << std::left << std::setw(23) << name << std::right
+        << count[0] << " scalar, " << count[1] << " vector\n";
+  }
+}
+
+/**
+ * Reports one function; returns false if it breaks one of the limits.
+ */
+bool reportFunction(std::ostream& out, std::ostream& errors,
+                    const ptx::Function& function, const Options& options) {
+  ptx::KernelStats stats;
+  ptx::analyzeFunction(function, stats);
+
+  out << "  " << (function.isEntry ? "Kernel" : "Function") << ":"
+      << std::string(function.isEntry ? 16 : 14, ' ') << function.name
+      << "\n";
+  printRegisters(out, stats);
+  out << "  Shared memory:         " << stats.sharedSize << " bytes"
+      << (stats.usesDynamicShared ? " + dynamic" : "") << "\n";
+  out << "  Local memory:          " << stats.localSize << " bytes\n";
+  out << "  Instructions:          " << stats.instructions << "\n";
+  printAccesses(out, "loads", stats.loads);
+  printAccesses(out, "stores", stats.stores);
+  out << "  FMA:                   " << stats.fma << "\n";
+  out << "  Branches:              " << stats.branches << "\n";
+  out << "  Barriers:              " << stats.barriers << "\n";
+  if(stats.atomics > 0) {
+    out << "  Atomics:               " << stats.atomics << "\n";
+  }
+
+  if(function.isEntry) {
+    unsigned blockSize = stats.maxThreadsPerBlock ? stats.maxThreadsPerBlock
+      : options.blockSize;
+    ptx::Occupancy occupancy = ptx::estimateOccupancy(*options.model, stats,
+                                                      blockSize, 0);
+    out << "  Occupancy:             " << std::fixed << std::setprecision(0)
+        << occupancy.occupancy * 100.0 << "% on " << options.model->name
+        << " with " << blockSize << " threads (" << occupancy.blocksPerSM
+        << " blocks, " << occupancy.activeWarps << " warps; limited by "
+        << occupancy.limiter << ")\n";
+    if(stats.estimatedRegisters > options.model->maxRegistersPerThread) {
+      out << "  Warning:               estimated registers exceed the "
+          << options.model->maxRegistersPerThread
+          << " per thread limit; expect spills\n";
+    }
+  }
+
+  bool ok = true;
+  if(options.maxRegisters > 0 &&
+     stats.estimatedRegisters > options.maxRegisters) {
+    errors << "ERROR: " << function.name << " needs an estimated "
+              << stats.estimatedRegisters << " registers, limit is "
+              << options.maxRegisters << "\n";
+    ok = false;
+  }
+  if(options.maxLocal >= 0 && stats.localSize > (size_t)options.maxLocal) {
+    errors << "ERROR: " << function.name << " uses " << stats.localSize
+           << " bytes of local memory, limit is " << options.maxLocal
+           << "\n";
+    ok = false;
+  }
+  return ok;
+}
+
+}
+
+//==--- Entry Point --------------------------------------------------------== //
+
+int main(int argc, char** argv) {
+  Options options;
+  if(!parseOptions(argc, argv, options)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  std::ostringstream report;
+  std::ostringstream errors;
+  bool               ok = true;
+
+  for(size_t i = 0; i < options.files.size(); ++i) {
+    std::ifstream file(options.files[i].c_str());
+    if(!file.is_open()) {
+      std::cerr << "Failed to open " << options.files[i] << "\n";
+      return 1;
+    }
+    std::string source(std::istreambuf_iterator<char>(file),
+                       (std::istreambuf_iterator<char>()));
+
+    ptx::Module module;
+    std::string log;
+    if(!ptx::parseModule(source, module, log)) {
+      std::cerr << options.files[i] << ": " << log << "\n";
+      return 1;
+    }
+
+    report << options.files[i] << " (" << module.target << ", "
+           << module.addressSize << "-bit)\n";
+    for(size_t f = 0; f < module.functions.size(); ++f) {
+      ok = reportFunction(report, errors, module.functions[f], options) && ok;
+    }
+  }
+
+  std::cout << report.str();
+  std::cerr << errors.str();
+  if(!options.output.empty()) {
+    std::ofstream output(options.output.c_str());
+    output << report.str();
+  }
+  return ok ? 0 : 1;
+}